@@ -0,0 +1,67 @@
+// Inserted after the #version line of the scene shaders' GPU-driven variants and the cull shader (see
+// gpuculling.h). Draws find their object by its index, the base instance of their indirect command.
+#extension GL_ARB_shader_storage_buffer_object : require
+
+// What the ObjectData block of a draw holds on the CPU path (ObjectUniforms in drawlist.h)
+struct Object {
+    mat4 model;
+    mat4 normalMatrix;
+    vec4 positionScale;
+    vec4 positionOffset;
+    vec4 specular;
+    vec4 surface;
+};
+
+// Object i is part i % partCount of instance i / partCount (GpuInstance and GpuPart in gpuculling.h)
+struct Instance {
+    mat4 transform;
+    mat4 normalMatrix;  // inverse transpose of transform
+    uvec4 materials;    // a byte per part: index into the palette, 255 for the part's own material
+};
+
+struct Part {
+    mat4 transform;     // within its instance
+    mat4 normalMatrix;
+    vec4 sphere;        // object space bounding sphere: center, radius
+    vec4 specular;      // own material; w: shininess
+    uvec4 lod;          // first batch, levels, sectors of level 0, 1 if drawn
+    vec4 lodShape;      // radius of the circle level 0 splits into sectors, bounding radius of the chain
+};
+
+layout (std430) readonly buffer Instances {
+    Instance instances[];
+};
+
+layout (std430) readonly buffer Parts {
+    Part parts[];
+};
+
+layout (std430) readonly buffer Materials {
+    vec4 materials[];   // specular color, w: shininess
+};
+
+uniform uint partCount;
+
+// Dequantization of the mesh the batch draws, and whether its material has a normal map (w)
+uniform vec4 meshPositionScale;
+uniform vec4 meshPositionOffset;
+
+Object loadObject(uint id)
+{
+    Instance instance = instances[id / partCount];
+    uint part = id % partCount;
+    Object object;
+    object.model = instance.transform * parts[part].transform;
+    object.normalMatrix = instance.normalMatrix * parts[part].normalMatrix;
+    object.positionScale = meshPositionScale;
+    object.positionOffset = meshPositionOffset;
+    object.specular = parts[part].specular;
+    if (part < 16u) {
+        uint material = (instance.materials[part / 4u] >> (8u * (part % 4u))) & 255u;
+        if (material != 255u) {
+            object.specular = materials[material];
+        }
+    }
+    object.surface = vec4(0.0);
+    return object;
+}
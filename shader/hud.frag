@@ -0,0 +1,14 @@
+#version 330 core
+
+in vec2 UV;
+in vec4 vertexColor;
+
+out vec4 color;
+
+uniform sampler2D font;
+
+void main()
+{
+    // The font atlas is coverage only; solid quads sample its filled cell
+    color = vec4(vertexColor.rgb, vertexColor.a * texture(font, UV).r);
+}
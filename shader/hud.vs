@@ -0,0 +1,17 @@
+#version 330 core
+
+layout (location = 0) in vec4 positionUV; // pixel position from the top left, atlas UV
+layout (location = 1) in vec4 color;
+
+out vec2 UV;
+out vec4 vertexColor;
+
+uniform vec2 screenSize;
+
+void main()
+{
+    vec2 ndc = positionUV.xy / screenSize * 2.0 - 1.0;
+    gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+    UV = positionUV.zw;
+    vertexColor = color;
+}
@@ -5,9 +5,6 @@ out vec4 FragColor;
 struct Material {
     sampler2D diffuse;
     sampler2D normal;
-    vec3 specular;
-    float shininess;
-    bool hasNormalMap;
 }; 
 
 struct DirLight {
@@ -41,15 +38,34 @@ uniform DirLight dirLight;
 uniform PointLight pointLights[NR_POINT_LIGHTS];
 uniform Material material;
 
+#ifdef GPU_DRIVEN
+// Per-object data of the GPU-driven path, from the object the draw's base instance selects (gpudriven.glsl)
+flat in uint vObjectId;
+Object object;
+#else
+// Per-object data, one block per draw in the object ring (ObjectUniforms in drawlist.h)
+layout (std140) uniform ObjectData {
+    mat4 model;
+    mat4 normalMatrix;   // inverse transpose of model
+    vec4 positionScale;  // packed positions: position * scale + offset; w: 1 if normals are packed
+    vec4 positionOffset; // w: 1 if the material has a normal map
+    vec4 specular;       // w: shininess
+    vec4 surface;        // analytic surface (MeshParams): radius, top radius, height, shape
+} object;
+#endif
+
 // function prototypes
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 
 void main()
 {    
+#ifdef GPU_DRIVEN
+    object = loadObject(vObjectId);
+#endif
     // properties
     vec3 norm = vec3(0.0, 0.0, 0.0);
-    if(material.hasNormalMap) {
+    if(object.positionOffset.w > 0.5) {
         // obtain normal from normal map in range [0,1]
         norm = texture(material.normal, TexCoords).rgb;
         norm = normalize(norm * 2.0 - 1.0);
@@ -79,17 +95,17 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
 
     // specular shading
     float spec = 0.0;
-    if(material.shininess > 0.0 && diff > 0.0) // no shininess in the dark!
+    if(object.specular.w > 0.0 && diff > 0.0) // no shininess in the dark!
     {
         vec3 halfway_direction = normalize(lightDir + viewDir);
-        //spec = pow(max(0.0, dot(viewDir, reflect(-lightDir, normal))), material.shininess); // phong
-        spec = pow(max(0.0, dot(normal, halfway_direction)), material.shininess); // blinn-phong
+        //spec = pow(max(0.0, dot(viewDir, reflect(-lightDir, normal))), object.specular.w); // phong
+        spec = pow(max(0.0, dot(normal, halfway_direction)), object.specular.w); // blinn-phong
     }
 
     // combine results
     vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
     vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * (spec * material.specular);
+    vec3 specular = light.specular * (spec * object.specular.rgb);
     return (ambient + diffuse + specular);
 }
 
@@ -101,15 +117,15 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float diff = max(dot(normal, lightDir), 0.0);
     // specular shading
     vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), object.specular.w);
     // attenuation
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
     // combine results
     vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
     vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    //vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords)); // material specular texture not implemented yet
-    vec3 specular = light.specular * (spec * material.specular);
+    //vec3 specular = light.specular * spec * vec3(texture(object.specular.rgb, TexCoords)); // material specular texture not implemented yet
+    vec3 specular = light.specular * (spec * object.specular.rgb);
     ambient *= attenuation;
     diffuse *= attenuation;
     specular *= attenuation;
@@ -7,14 +7,47 @@ out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+#ifdef GPU_DRIVEN
+// Per-object data of the GPU-driven path, from the object the draw's base instance selects (gpudriven.glsl)
+layout (location = 5) in uint aObjectId;
+flat out uint vObjectId;
+Object object;
+#else
+// Per-object data, one block per draw in the object ring (ObjectUniforms in drawlist.h)
+layout (std140) uniform ObjectData {
+    mat4 model;
+    mat4 normalMatrix;   // inverse transpose of model
+    vec4 positionScale;  // packed positions: position * scale + offset; w: 1 if normals are packed
+    vec4 positionOffset; // w: 1 if the material has a normal map
+    vec4 specular;       // w: shininess
+    vec4 surface;        // analytic surface (MeshParams): radius, top radius, height, shape
+} object;
+#endif
+
+vec3 octDecode(vec2 e)
+{
+    vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0) {
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(v);
+}
+
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;  
+#ifdef GPU_DRIVEN
+    object = loadObject(aObjectId);
+    vObjectId = aObjectId;
+#endif
+    // Packed vertices: positions relative to the mesh bounds, octahedral normals
+    vec3 position = aPos * object.positionScale.xyz + object.positionOffset.xyz;
+    vec3 normal = object.positionScale.w > 0.5 ? octDecode(aNormal.xy) : aNormal;
+
+    FragPos = vec3(object.model * vec4(position, 1.0));
+    Normal = mat3(object.normalMatrix) * normal;
     TexCoords = aTexCoords;
     
     gl_Position = projection * view * vec4(FragPos, 1.0);
@@ -2,7 +2,7 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in vec3 aTangent;
+layout (location = 3) in vec4 aTangent; // packed: w is the bitangent's handedness
 layout (location = 4) in vec3 aBitangent;
 
 // Output to frag shader:
@@ -12,8 +12,7 @@ out vec3 TangentLightPos;
 out vec3 TangentViewPos;
 out vec3 TangentFragPos;
 
-// MVP uniforms:
-uniform mat4 model;
+// VP uniforms:
 uniform mat4 view;
 uniform mat4 projection;
 
@@ -21,21 +20,57 @@ uniform mat4 projection;
 uniform vec3 lightPos;
 uniform vec3 viewPos;
 
+#ifdef GPU_DRIVEN
+// Per-object data of the GPU-driven path, from the object the draw's base instance selects (gpudriven.glsl)
+layout (location = 5) in uint aObjectId;
+flat out uint vObjectId;
+Object object;
+#else
+// Per-object data, one block per draw in the object ring (ObjectUniforms in drawlist.h)
+layout (std140) uniform ObjectData {
+    mat4 model;
+    mat4 normalMatrix;   // inverse transpose of model
+    vec4 positionScale;  // packed positions: position * scale + offset; w: 1 if normals are packed
+    vec4 positionOffset; // w: 1 if the material has a normal map
+    vec4 specular;       // w: shininess
+    vec4 surface;        // analytic surface (MeshParams): radius, top radius, height, shape
+} object;
+#endif
+
+vec3 octDecode(vec2 e)
+{
+    vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0) {
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(v);
+}
+
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
+#ifdef GPU_DRIVEN
+    object = loadObject(aObjectId);
+    vObjectId = aObjectId;
+#endif
+    // Packed vertices: positions relative to the mesh bounds, octahedral normals and tangents
+    bool packedNormals = object.positionScale.w > 0.5;
+    vec3 position = aPos * object.positionScale.xyz + object.positionOffset.xyz;
+    vec3 normal = packedNormals ? octDecode(aNormal.xy) : aNormal;
+    vec3 tangent = packedNormals ? octDecode(aTangent.xy) : aTangent.xyz;
+
+    FragPos = vec3(object.model * vec4(position, 1.0));
     TexCoords = aTexCoords;
 
-    mat3 normalMatrix = transpose(inverse(mat3(model)));
-    vec3 T = normalize(normalMatrix * aTangent);
-    vec3 N = normalize(normalMatrix * aNormal);
+    mat3 normalMatrix = mat3(object.normalMatrix);
+    vec3 T = normalize(normalMatrix * tangent);
+    vec3 N = normalize(normalMatrix * normal);
     T = normalize(T - dot(T, N) * N);
-    vec3 B = cross(N, T);
+    vec3 B = cross(N, T) * (packedNormals ? sign(aTangent.w) : 1.0);
     
     mat3 TBN = transpose(mat3(T, B, N));    
     TangentLightPos = TBN * lightPos;
     TangentViewPos  = TBN * viewPos;
     TangentFragPos  = TBN * FragPos;
         
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * vec4(FragPos, 1.0);
 }
\ No newline at end of file
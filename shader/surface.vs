@@ -0,0 +1,51 @@
+#version 400 core
+layout (location = 0) in vec3 aPatch; // surface parameters s, t and the part of the surface
+
+out vec3 vPatch;
+out vec3 vWorldPos;
+
+// Per-object data, one block per draw in the object ring (ObjectUniforms in drawlist.h)
+layout (std140) uniform ObjectData {
+    mat4 model;
+    mat4 normalMatrix;   // inverse transpose of model
+    vec4 positionScale;  // packed positions: position * scale + offset; w: 1 if normals are packed
+    vec4 positionOffset; // w: 1 if the material has a normal map
+    vec4 specular;       // w: shininess
+    vec4 surface;        // analytic surface (MeshParams): radius, top radius, height, shape
+} object;
+
+// Analytic surface: shape 0 = sphere, 1 = cylinder, 2 = torus
+#define surfaceShape int(object.surface.w + 0.5)
+#define surfaceRadius object.surface.x
+#define surfaceTopRadius object.surface.y
+#define surfaceHeight object.surface.z
+
+const float PI = 3.14159265358979;
+
+// Position only, the control stage needs it to measure patch edges on screen
+vec3 surfacePosition(vec2 st, int part)
+{
+    float angle = 2.0 * PI * st.x;
+    if (surfaceShape == 0) {
+        float stackAngle = PI / 2.0 - PI * st.y;
+        return surfaceRadius * vec3(cos(stackAngle) * cos(angle), cos(stackAngle) * sin(angle), sin(stackAngle));
+    }
+    if (surfaceShape == 1) {
+        if (part == 0) {
+            float radius = mix(surfaceRadius, surfaceTopRadius, st.y);
+            return vec3(radius * cos(angle), radius * sin(angle), (st.y - 0.5) * surfaceHeight);
+        }
+        bool top = part == 2;
+        float radius = st.y * (top ? surfaceTopRadius : surfaceRadius);
+        return vec3(radius * cos(angle), radius * sin(angle), (top ? 0.5 : -0.5) * surfaceHeight);
+    }
+    float mainAngle = 2.0 * PI * st.y;
+    float ring = surfaceRadius + surfaceTopRadius * cos(angle);
+    return vec3(ring * cos(mainAngle), ring * sin(mainAngle), surfaceTopRadius * sin(angle));
+}
+
+void main()
+{
+    vPatch = aPatch;
+    vWorldPos = vec3(object.model * vec4(surfacePosition(aPatch.xy, int(aPatch.z + 0.5)), 1.0));
+}
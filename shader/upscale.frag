@@ -0,0 +1,37 @@
+#version 330 core
+
+in vec2 screenUV;
+
+out vec4 color;
+
+uniform sampler2D source;
+uniform vec2 texelSize;
+uniform vec2 uvScale;   // of the rendered corner of the source
+uniform vec2 uvMin;     // half a texel inside it
+uniform vec2 uvMax;
+uniform float sharpness; // 0 to 1
+
+vec3 fetch(vec2 uv)
+{
+    return texture(source, clamp(uv, uvMin, uvMax)).rgb;
+}
+
+void main()
+{
+    // Bilinear upscale of the center and its four neighbours, a source texel away
+    vec2 uv = screenUV * uvScale;
+    vec3 center = fetch(uv);
+    vec3 up = fetch(uv + vec2(0.0, texelSize.y));
+    vec3 down = fetch(uv - vec2(0.0, texelSize.y));
+    vec3 left = fetch(uv - vec2(texelSize.x, 0.0));
+    vec3 right = fetch(uv + vec2(texelSize.x, 0.0));
+
+    // Contrast-adaptive sharpening (after FidelityFX CAS): the negative lobe of the neighbours is weakest where
+    // the local range already reaches black or white, so edges don't ring or clip
+    vec3 lowest = min(center, min(min(up, down), min(left, right)));
+    vec3 highest = max(center, max(max(up, down), max(left, right)));
+    vec3 amount = sqrt(clamp(min(lowest, 1.0 - highest) / max(highest, 1.0e-4), 0.0, 1.0));
+    vec3 lobe = -0.2 * sharpness * amount;
+    vec3 sharpened = (center + (up + down + left + right) * lobe) / (1.0 + 4.0 * lobe);
+    color = vec4(clamp(sharpened, 0.0, 1.0), 1.0);
+}
@@ -0,0 +1,248 @@
+#include "assetpack.h"
+#include "lz4.h"
+
+#include <cstdio>
+#include <cstring>
+
+AssetPack AssetPack::mounted;
+
+// Smallest entry worth compressing:
+const size_t ASSET_PACK_MIN_COMPRESS = 64;
+
+// Paths are compared with forward slashes and without a leading "./":
+static std::string normalizePath(const char *path) {
+    std::string normalized = path;
+    for (char &c : normalized) {
+        if (c == '\\') {
+            c = '/';
+        }
+    }
+    while (normalized.compare(0, 2, "./") == 0) {
+        normalized.erase(0, 2);
+    }
+    return normalized;
+}
+
+// FNV-1a of a path; 0 marks empty slots, so it is never returned:
+static uint64_t hashPath(const std::string &path) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : path) {
+        hash = (hash ^ (unsigned char) c) * 1099511628211ull;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+AssetPack::AssetPack() {
+    slots = nullptr;
+    slotCount = 0;
+    entryCount = 0;
+    strings = nullptr;
+    stringsSize = 0;
+}
+
+bool AssetPack::open(const char *path) {
+    close();
+    if (!file.open(path)) {
+        return false;
+    }
+    if (!validate()) {
+        printf("ERROR: %s is not a valid version %u asset pack\n", path, ASSET_PACK_VERSION);
+        close();
+        return false;
+    }
+    decompressed.resize(slotCount);
+    return true;
+}
+
+void AssetPack::close() {
+    file.close();
+    slots = nullptr;
+    slotCount = 0;
+    entryCount = 0;
+    strings = nullptr;
+    stringsSize = 0;
+    decompressed.clear();
+}
+
+bool AssetPack::validate() {
+    AssetPackHeader header;
+    size_t size = file.size();
+    if (size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, ASSET_PACK_MAGIC, 4) != 0 || header.version != ASSET_PACK_VERSION ||
+        header.fileSize != size || header.slotCount == 0 || (header.slotCount & (header.slotCount - 1)) != 0 ||
+        header.slotsOffset % ASSET_PACK_ALIGNMENT != 0 || header.slotsOffset > size ||
+        header.slotCount > (size - header.slotsOffset) / sizeof(AssetPackEntry) || header.stringsOffset > size ||
+        header.stringsSize == 0 || header.stringsSize > size - header.stringsOffset) {
+        return false;
+    }
+    slots = (const AssetPackEntry *) (file.data() + header.slotsOffset);
+    slotCount = header.slotCount;
+    entryCount = header.entryCount;
+    strings = (const char *) file.data() + header.stringsOffset;
+    stringsSize = header.stringsSize;
+    if (strings[stringsSize - 1] != '\0') {
+        return false;
+    }
+
+    // Every entry must lie within the file, so lookups need no checks:
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < slotCount; ++i) {
+        const AssetPackEntry &entry = slots[i];
+        if (entry.hash == 0) {
+            continue;
+        }
+        ++used;
+        bool compressed = (entry.flags & ASSET_LZ4) != 0;
+        if (entry.offset % ASSET_PACK_ALIGNMENT != 0 || entry.offset > size || entry.storedSize > size - entry.offset ||
+            entry.path >= stringsSize || (!compressed && entry.storedSize != entry.size)) {
+            return false;
+        }
+    }
+    return used == entryCount && used < slotCount;
+}
+
+AssetView AssetPack::find(const char *path) {
+    AssetView view = {nullptr, 0};
+    if (!isOpen()) {
+        return view;
+    }
+    std::string key = normalizePath(path);
+    uint64_t hash = hashPath(key);
+
+    // Linear probing up to the first empty slot (the table is never full):
+    for (uint32_t i = (uint32_t) hash & (slotCount - 1);; i = (i + 1) & (slotCount - 1)) {
+        const AssetPackEntry &entry = slots[i];
+        if (entry.hash == 0) {
+            return view;
+        }
+        if (entry.hash != hash || key != strings + entry.path) {
+            continue;
+        }
+        if ((entry.flags & ASSET_LZ4) == 0) {
+            view.data = file.data() + entry.offset;
+            view.size = (size_t) entry.size;
+            return view;
+        }
+        std::lock_guard<std::mutex> lock(decompressMutex);
+        std::vector<unsigned char> &bytes = decompressed[i];
+        if (bytes.size() != entry.size) {
+            bytes.resize((size_t) entry.size);
+            if (!lz4Decompress(file.data() + entry.offset, (size_t) entry.storedSize, bytes.data(), bytes.size())) {
+                printf("ERROR: Asset %s is corrupt\n", key.c_str());
+                bytes.clear();
+                return view;
+            }
+        }
+        view.data = bytes.data();
+        view.size = bytes.size();
+        return view;
+    }
+}
+
+// Reads a whole file:
+static bool readFile(const char *path, std::vector<unsigned char> &bytes) {
+    FILE *in = fopen(path, "rb");
+    if (in == nullptr) {
+        return false;
+    }
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    bytes.resize(size > 0 ? (size_t) size : 0);
+    bool read = size >= 0 && fread(bytes.data(), 1, bytes.size(), in) == bytes.size();
+    fclose(in);
+    return read;
+}
+
+// Rounds offset up to the entry alignment:
+static uint64_t alignEntry(uint64_t offset) {
+    return (offset + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT;
+}
+
+bool AssetPack::write(const char *path, const std::vector<std::string> &files) {
+    AssetPackHeader header = {};
+    memcpy(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic));
+    header.version = ASSET_PACK_VERSION;
+    header.slotCount = 1;
+    while (header.slotCount < files.size() * 2) {
+        header.slotCount *= 2; // at most half full, so probes stay short
+    }
+    std::vector<AssetPackEntry> table(header.slotCount);
+    memset(table.data(), 0, table.size() * sizeof(AssetPackEntry));
+    std::string pathStrings;
+    std::vector<unsigned char> data;
+    header.slotsOffset = alignEntry(sizeof(header));
+    uint64_t dataOffset = alignEntry(header.slotsOffset + table.size() * sizeof(AssetPackEntry));
+
+    size_t originalBytes = 0;
+    for (const std::string &name : files) {
+        std::string key = normalizePath(name.c_str());
+        uint64_t hash = hashPath(key);
+        uint32_t slot = (uint32_t) hash & (header.slotCount - 1);
+        bool duplicate = false;
+        for (; table[slot].hash != 0; slot = (slot + 1) & (header.slotCount - 1)) {
+            duplicate = duplicate || (table[slot].hash == hash && key == pathStrings.c_str() + table[slot].path);
+        }
+        if (duplicate) {
+            printf("WARNING: %s is listed twice, packed once\n", name.c_str());
+            continue;
+        }
+        std::vector<unsigned char> bytes;
+        if (!readFile(name.c_str(), bytes)) {
+            printf("ERROR: Failed to read %s\n", name.c_str());
+            return false;
+        }
+        originalBytes += bytes.size();
+
+        // Keep the compressed form only if it pays for the decompression:
+        AssetPackEntry &entry = table[slot];
+        entry.hash = hash;
+        entry.size = bytes.size();
+        entry.path = (uint32_t) pathStrings.size();
+        pathStrings += key;
+        pathStrings += '\0';
+        if (bytes.size() >= ASSET_PACK_MIN_COMPRESS) {
+            std::vector<unsigned char> compressed(lz4CompressBound(bytes.size()));
+            compressed.resize(lz4Compress(bytes.data(), bytes.size(), compressed.data()));
+            if (compressed.size() <= bytes.size() - bytes.size() / 8) {
+                bytes.swap(compressed);
+                entry.flags = ASSET_LZ4;
+            }
+        }
+        entry.storedSize = bytes.size();
+        data.resize((size_t) (alignEntry(dataOffset + data.size()) - dataOffset), 0);
+        entry.offset = dataOffset + data.size();
+        data.insert(data.end(), bytes.begin(), bytes.end());
+        ++header.entryCount;
+    }
+    header.stringsOffset = dataOffset + data.size();
+    header.stringsSize = pathStrings.size() + 1;
+    header.fileSize = header.stringsOffset + header.stringsSize;
+
+    FILE *out = fopen(path, "wb");
+    if (out == nullptr) {
+        printf("ERROR: Failed to write %s\n", path);
+        return false;
+    }
+    std::vector<unsigned char> padding(ASSET_PACK_ALIGNMENT, 0);
+    bool written = fwrite(&header, sizeof(header), 1, out) == 1 &&
+                   fwrite(padding.data(), 1, (size_t) (header.slotsOffset - sizeof(header)), out) ==
+                   header.slotsOffset - sizeof(header) &&
+                   fwrite(table.data(), sizeof(AssetPackEntry), table.size(), out) == table.size() &&
+                   fwrite(padding.data(), 1, (size_t) (dataOffset - header.slotsOffset -
+                                                       table.size() * sizeof(AssetPackEntry)), out) ==
+                   dataOffset - header.slotsOffset - table.size() * sizeof(AssetPackEntry) &&
+                   fwrite(data.data(), 1, data.size(), out) == data.size() &&
+                   fwrite(pathStrings.c_str(), 1, (size_t) header.stringsSize, out) == header.stringsSize;
+    written = fclose(out) == 0 && written;
+    if (!written) {
+        printf("ERROR: Failed to write %s\n", path);
+        return false;
+    }
+    printf("INFO: Packed %u assets into %s: %.2f MB (%.2f MB unpacked)\n", header.entryCount, path,
+           header.fileSize / (1024.0 * 1024.0), originalBytes / (1024.0 * 1024.0));
+    return true;
+}
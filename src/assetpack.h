@@ -0,0 +1,90 @@
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "mappedfile.h"
+
+// Asset packs start with this tag and version:
+const char ASSET_PACK_MAGIC[4] = {'P', 'A', 'C', 'K'};
+const uint32_t ASSET_PACK_VERSION = 1;
+
+// Entries start on this many bytes, so mapped data can be read in place with any alignment it needs:
+const uint32_t ASSET_PACK_ALIGNMENT = 16;
+
+// Entry flags:
+const uint32_t ASSET_LZ4 = 1; // stored LZ4 compressed (see lz4.h)
+
+// A slot of the table of contents; slots with a hash of 0 are empty.
+struct AssetPackEntry {
+    uint64_t hash;       // FNV-1a of the path
+    uint64_t offset;     // in bytes from the start of the file
+    uint64_t storedSize; // bytes in the file
+    uint64_t size;       // bytes once decompressed
+    uint32_t path;       // offset of the path in the strings
+    uint32_t flags;
+};
+
+// Binary header; offsets are in bytes from the start of the file.
+struct AssetPackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t slotCount;     // AssetPackEntry[slotCount], a power of two
+    uint64_t slotsOffset;
+    uint64_t stringsOffset; // null-terminated paths
+    uint64_t stringsSize;
+    uint64_t fileSize;
+};
+
+// The bytes of an asset, read in place. data is null if the asset doesn't exist.
+struct AssetView {
+    const unsigned char *data;
+    size_t size;
+};
+
+// A single file holding many assets (images, KTX textures, shader sources, mesh cache files), mapped once.
+//
+// The table of contents is an open-addressing hash table of the paths, so a lookup hashes the path and
+// usually reads one slot. Uncompressed entries are returned as views into the mapping: no file is opened,
+// read or copied per asset. LZ4 entries are decompressed on first use into a buffer the pack keeps.
+class AssetPack {
+public:
+    AssetPack();
+
+    // Maps a pack and checks its table of contents, closing any previous one.
+    bool open(const char *path);
+
+    void close();
+
+    bool isOpen() const { return file.isOpen(); }
+
+    uint32_t getEntryCount() const { return entryCount; }
+
+    // Returns an asset by the path it was packed under ('\' and '/' are the same), or a null view. Safe to call
+    // from several threads at once.
+    AssetView find(const char *path);
+
+    // Packs files under the paths given. Entries are compressed if that saves at least an eighth.
+    static bool write(const char *path, const std::vector<std::string> &files);
+
+    // The pack assets are read from, if open (--pack); otherwise they are read from their files.
+    static AssetPack mounted;
+
+private:
+    bool validate();
+
+    MappedFile file;
+    const AssetPackEntry *slots;
+    uint32_t slotCount;
+    uint32_t entryCount;
+    const char *strings;
+    uint64_t stringsSize;
+    std::vector<std::vector<unsigned char>> decompressed; // by slot, filled on first use
+    std::mutex decompressMutex;
+};
+
+#endif //ASSETPACK_H
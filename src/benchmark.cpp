@@ -0,0 +1,603 @@
+#include "benchmark.h"
+#include "meshgen.h"
+#include "meshopt.h"
+#include "model.h"
+#include "plane.h"
+#include "cube.h"
+#include "pyramid.h"
+#include "sphere.h"
+#include "cylinder.h"
+#include "importer.h"
+#include "jobs.h"
+#include "mappedfile.h"
+#include "geometry.h"
+#include "transformbatch.h"
+
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <stb_image.h>
+
+using namespace std;
+
+// Number of timed runs per configuration (the median is reported):
+const int BENCHMARK_RUNS = 5;
+
+// Milliseconds elapsed since start:
+static double elapsedMs(chrono::high_resolution_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+}
+
+static double median(vector<double> samples) {
+    sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+// The sphere build the generator replaced: push_back into separate V/N/T arrays, then interleave.
+static void buildSpherePushBack(float radius, int sectors, int stacks, vector<float> &interleaved,
+                                vector<unsigned int> &indices) {
+    const float pi = acos(-1.0f);
+    vector<float> vertices, normals, texCoords;
+    float sectorStep = 2 * pi / sectors;
+    float stackStep = pi / stacks;
+
+    for (int i = 0; i <= stacks; ++i) {
+        float stackAngle = pi / 2 - i * stackStep;
+        float xy = radius * cosf(stackAngle);
+        float z = radius * sinf(stackAngle);
+        for (int j = 0; j <= sectors; ++j) {
+            float sectorAngle = j * sectorStep;
+            float x = xy * cosf(sectorAngle);
+            float y = xy * sinf(sectorAngle);
+            vertices.push_back(x);
+            vertices.push_back(y);
+            vertices.push_back(z);
+            normals.push_back(x / radius);
+            normals.push_back(y / radius);
+            normals.push_back(z / radius);
+            texCoords.push_back((float) j / sectors);
+            texCoords.push_back((float) i / stacks);
+        }
+    }
+
+    for (int i = 0; i < stacks; ++i) {
+        unsigned int k1 = i * (sectors + 1);
+        unsigned int k2 = k1 + sectors + 1;
+        for (int j = 0; j < sectors; ++j, ++k1, ++k2) {
+            if (i != 0) {
+                indices.push_back(k1);
+                indices.push_back(k2);
+                indices.push_back(k1 + 1);
+            }
+            if (i != stacks - 1) {
+                indices.push_back(k1 + 1);
+                indices.push_back(k2);
+                indices.push_back(k2 + 1);
+            }
+        }
+    }
+
+    for (size_t i = 0, j = 0; i < vertices.size(); i += 3, j += 2) {
+        interleaved.insert(interleaved.end(), &vertices[i], &vertices[i] + 3);
+        interleaved.insert(interleaved.end(), &normals[i], &normals[i] + 3);
+        interleaved.insert(interleaved.end(), &texCoords[j], &texCoords[j] + 2);
+    }
+}
+
+// Median time of generating a mesh into preallocated buffers with the given thread count:
+static double timeGenerator(const MeshParams &params, int threads) {
+    vector<double> samples;
+    for (int run = 0; run < BENCHMARK_RUNS; ++run) {
+        auto start = chrono::high_resolution_clock::now();
+        MeshGenerator generator(params);
+        vector<float> vertices((size_t) generator.getVertexCount() * MESH_VERTEX_FLOATS);
+        vector<unsigned int> indices(generator.getIndexCount());
+        generator.generate(vertices.data(), indices.data(), nullptr, threads);
+        samples.push_back(elapsedMs(start));
+    }
+    return median(samples);
+}
+
+int runMeshBenchmark() {
+    const char *shapeNames[] = {"sphere", "cylinder", "torus"};
+    const int sizes[][2] = {{256, 128}, {1024, 512}, {2048, 1024}, {4096, 2048}};
+    int threads = (int) max(1u, thread::hardware_concurrency());
+
+    printf("Mesh generator benchmark (median of %d runs, %d hardware threads)\n", BENCHMARK_RUNS, threads);
+    printf("%-9s %6s %6s %10s %12s %12s %12s %8s\n", "shape", "sectors", "stacks", "vertices", "push_back ms",
+           "1 thread ms", "N threads ms", "speedup");
+
+    for (const auto &size : sizes) {
+        for (int shape = MESH_SPHERE; shape <= MESH_TORUS; ++shape) {
+            // Cylinders get stacks along their height so the grid is as dense as the others:
+            MeshParams params = {(MeshShape) shape, size[0], size[1], 1.0f, 0.5f, 2.0f};
+            MeshGenerator generator(params);
+
+            // Only the sphere still has its old push_back path to compare against:
+            double pushBackMs = 0.0;
+            if (shape == MESH_SPHERE) {
+                vector<double> samples;
+                for (int run = 0; run < BENCHMARK_RUNS; ++run) {
+                    vector<float> interleaved;
+                    vector<unsigned int> indices;
+                    auto start = chrono::high_resolution_clock::now();
+                    buildSpherePushBack(params.radius, params.sectors, params.stacks, interleaved, indices);
+                    samples.push_back(elapsedMs(start));
+                }
+                pushBackMs = median(samples);
+            }
+
+            double singleMs = timeGenerator(params, 1);
+            double parallelMs = timeGenerator(params, threads);
+
+            char pushBack[32] = "-";
+            if (pushBackMs > 0.0) {
+                snprintf(pushBack, sizeof(pushBack), "%.2f", pushBackMs);
+            }
+            printf("%-9s %6d %6d %10u %12s %12.2f %12.2f %7.2fx\n", shapeNames[shape], size[0], size[1],
+                   generator.getVertexCount(), pushBack, singleMs, parallelMs,
+                   (pushBackMs > 0.0 ? pushBackMs : singleMs) / parallelMs);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// Optimizes one primitive and prints a row of the report:
+static void reportMeshOpt(const char *name, const vector<float> &vertices, int floatsPerVertex,
+                          const vector<unsigned int> &indices) {
+    unsigned int vertexCount = (unsigned int) (vertices.size() / floatsPerVertex);
+    const unsigned int *input = indices.empty() ? nullptr : indices.data();
+    MeshOptimizationStats stats = {};
+    vector<double> samples;
+    for (int run = 0; run < BENCHMARK_RUNS; ++run) {
+        vector<float> optimizedVertices;
+        vector<unsigned int> optimizedIndices;
+        auto start = chrono::high_resolution_clock::now();
+        optimizeMesh(vertices.data(), vertexCount, floatsPerVertex, input, (unsigned int) indices.size(),
+                     optimizedVertices, optimizedIndices, &stats);
+        samples.push_back(elapsedMs(start));
+    }
+    printf("%-16s %8u %8u %6.3f %6.3f %6.3f %6.3f %9.2f\n", name, stats.verticesBefore, stats.verticesAfter,
+           stats.before.acmr, stats.after.acmr, stats.before.atvr, stats.after.atvr, median(samples));
+}
+
+// Generates a sphere, cylinder or torus and reports it:
+static void reportGeneratedMeshOpt(const char *name, const MeshParams &params) {
+    MeshGenerator generator(params);
+    vector<float> vertices((size_t) generator.getVertexCount() * MESH_VERTEX_FLOATS);
+    vector<unsigned int> indices(generator.getIndexCount());
+    generator.generate(vertices.data(), indices.data());
+    reportMeshOpt(name, vertices, MESH_VERTEX_FLOATS, indices);
+}
+
+// Prepares a dense sphere with meshlets, with float and packed vertices; packing may only grow the meshlets'
+// spheres by half a quantization step, or the GPU would stop culling them:
+static bool checkPackedMeshlets() {
+    MeshGenerator generator({MESH_SPHERE, 256, 128, 1.0f, 0.0f, 0.0f});
+    vector<float> vertices((size_t) generator.getVertexCount() * MESH_VERTEX_FLOATS);
+    vector<unsigned int> indices(generator.getIndexCount());
+    generator.generate(vertices.data(), indices.data());
+
+    bool useMeshlets = Mesh::useMeshlets;
+    bool usePackedVertices = Mesh::usePackedVertices;
+    Mesh::useMeshlets = true;
+    MeshData data[2];
+    for (int packed = 0; packed < 2; ++packed) {
+        Mesh::usePackedVertices = packed != 0;
+        Mesh::prepare(vertices.data(), generator.getVertexCount(), MESH_VERTEX_FLOATS, indices.data(),
+                      generator.getIndexCount(), data[packed]);
+    }
+    Mesh::useMeshlets = useMeshlets;
+    Mesh::usePackedVertices = usePackedVertices;
+
+    // Half a step across a 2 unit cube, and some rounding:
+    float epsilon = 0.5f * glm::length(glm::vec3(2.0f)) / PACKED_POSITION_STEPS + 1e-5f;
+    bool passed = !data[0].meshlets.empty() && data[0].meshlets.size() == data[1].meshlets.size();
+    float maxGrowth = 0.0f;
+    for (size_t i = 0; passed && i < data[0].meshlets.size(); ++i) {
+        float growth = data[1].meshlets[i].radius - data[0].meshlets[i].radius;
+        maxGrowth = max(maxGrowth, growth);
+        passed = growth >= 0.0f && growth <= epsilon;
+    }
+    printf("Meshlets of sphere 256x128: %d, packing grows their radii by up to %g\n",
+           (int) data[0].meshlets.size(), (double) maxGrowth);
+    if (!passed) {
+        printf("ERROR: Packed meshlet spheres differ from the float ones by more than half a step\n");
+    }
+    return passed;
+}
+
+int runMeshOptBenchmark() {
+    printf("Mesh optimizer report (%d entry FIFO cache, median of %d runs)\n", VERTEX_CACHE_SIZE, BENCHMARK_RUNS);
+    printf("%-16s %8s %8s %6s %6s %6s %6s %9s\n", "primitive", "verts", "welded", "ACMR", "->", "ATVR", "->",
+           "opt ms");
+
+    // The scene's primitives, at the sizes main() creates them:
+    vector<float> vertices;
+    vector<unsigned int> indices;
+    Plane(4.0f, 2.5f).buildVertices(vertices);
+    reportMeshOpt("plane", vertices, MESH_VERTEX_FLOATS, vector<unsigned int>());
+    Cube(2.1f, 0.9f, 0.1f).buildVertices(vertices);
+    reportMeshOpt("cube", vertices, MESH_TANGENT_VERTEX_FLOATS, vector<unsigned int>());
+    Pyramid(2.0f, 2.0f / 1.618f).buildVertices(vertices, indices);
+    reportMeshOpt("pyramid", vertices, MESH_VERTEX_FLOATS, indices);
+
+    Sphere sphere;
+    vertices.assign(sphere.getInterleavedVertices(),
+                    sphere.getInterleavedVertices() + sphere.getInterleavedVertexCount() * MESH_VERTEX_FLOATS);
+    indices.assign(sphere.getIndices(), sphere.getIndices() + sphere.getIndexCount());
+    reportMeshOpt("sphere 36x18", vertices, MESH_VERTEX_FLOATS, indices);
+
+    Cylinder cylinder(0.2f, 0.2f, 0.6f);
+    vertices.assign(cylinder.getInterleavedVertices(),
+                    cylinder.getInterleavedVertices() + cylinder.getInterleavedVertexCount() * MESH_VERTEX_FLOATS);
+    indices.assign(cylinder.getIndices(), cylinder.getIndices() + cylinder.getIndexCount());
+    reportMeshOpt("cylinder", vertices, MESH_VERTEX_FLOATS, indices);
+
+    reportGeneratedMeshOpt("torus 20x20", {MESH_TORUS, 20, 20, 0.03f, 0.015f, 0.0f});
+
+    // Dense grids, where rows longer than the cache make the generator's order costly:
+    reportGeneratedMeshOpt("sphere 256x128", {MESH_SPHERE, 256, 128, 1.0f, 0.0f, 0.0f});
+    reportGeneratedMeshOpt("cylinder 256x128", {MESH_CYLINDER, 256, 128, 1.0f, 1.0f, 2.0f});
+    reportGeneratedMeshOpt("torus 256x128", {MESH_TORUS, 256, 128, 1.0f, 0.5f, 0.0f});
+
+    return checkPackedMeshlets() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Writes a generated mesh as an OBJ file with positions, uvs and normals:
+static bool writeBenchmarkObj(const char *path, const vector<float> &vertices, const vector<unsigned int> &indices) {
+    FILE *out = fopen(path, "w");
+    if (out == nullptr) {
+        return false;
+    }
+    for (size_t i = 0; i < vertices.size(); i += MESH_VERTEX_FLOATS) {
+        const float *v = &vertices[i];
+        fprintf(out, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n", v[0], v[1], v[2], v[6], v[7], v[3],
+                v[4], v[5]);
+    }
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        unsigned int a = indices[i] + 1, b = indices[i + 1] + 1, c = indices[i + 2] + 1;
+        fprintf(out, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+    }
+    return fclose(out) == 0;
+}
+
+// Writes a generated mesh as a binary glTF file: one interleaved vertex view and one index view.
+static bool writeBenchmarkGlb(const char *path, const vector<float> &vertices, const vector<unsigned int> &indices) {
+    size_t vertexBytes = vertices.size() * sizeof(float);
+    size_t indexBytes = indices.size() * sizeof(unsigned int);
+    size_t vertexCount = vertices.size() / MESH_VERTEX_FLOATS;
+    char json[2048];
+    snprintf(json, sizeof(json),
+             "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+             "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},"
+             "\"indices\":3}]}],\"buffers\":[{\"byteLength\":%zu}],\"bufferViews\":["
+             "{\"buffer\":0,\"byteLength\":%zu,\"byteStride\":%d},"
+             "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}],\"accessors\":["
+             "{\"bufferView\":0,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\"},"
+             "{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\"},"
+             "{\"bufferView\":0,\"byteOffset\":24,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC2\"},"
+             "{\"bufferView\":1,\"componentType\":5125,\"count\":%zu,\"type\":\"SCALAR\"}]}",
+             vertexBytes + indexBytes, vertexBytes, MESH_VERTEX_STRIDE, vertexBytes, indexBytes, vertexCount,
+             vertexCount, vertexCount, indices.size());
+
+    // Chunks are padded to 4 bytes, the JSON with spaces:
+    string text = json;
+    text.resize((text.size() + 3) & ~(size_t) 3, ' ');
+    uint32_t jsonChunk[2] = {(uint32_t) text.size(), 0x4e4f534a};
+    uint32_t binaryChunk[2] = {(uint32_t) (vertexBytes + indexBytes), 0x004e4942};
+    uint32_t header[3] = {0x46546c67, 2, (uint32_t) (12 + 8 + text.size() + 8 + vertexBytes + indexBytes)};
+
+    FILE *out = fopen(path, "wb");
+    if (out == nullptr) {
+        return false;
+    }
+    bool written = fwrite(header, sizeof(header), 1, out) == 1 && fwrite(jsonChunk, sizeof(jsonChunk), 1, out) == 1 &&
+                   fwrite(text.data(), text.size(), 1, out) == 1 &&
+                   fwrite(binaryChunk, sizeof(binaryChunk), 1, out) == 1 &&
+                   fwrite(vertices.data(), vertexBytes, 1, out) == 1 &&
+                   fwrite(indices.data(), indexBytes, 1, out) == 1;
+    return fclose(out) == 0 && written;
+}
+
+// Imports a file on one thread and on every hardware thread and prints a row of the report:
+static bool reportImport(const char *path, int threads) {
+    double times[2];
+    int threadCounts[2] = {1, threads};
+    ModelImporter importer;
+    for (int t = 0; t < 2; ++t) {
+        vector<double> samples;
+        for (int run = 0; run < BENCHMARK_RUNS; ++run) {
+            auto start = chrono::high_resolution_clock::now();
+            if (!importer.load(path, threadCounts[t])) {
+                return false;
+            }
+            samples.push_back(elapsedMs(start));
+        }
+        times[t] = median(samples);
+    }
+    const char *name = strrchr(path, '/') != nullptr ? strrchr(path, '/') + 1 : path;
+    double megabytes = importer.getBytesRead() / (1024.0 * 1024.0);
+    printf("%-24s %8.1f %10u %10u %10.2f %8.1f %10.2f %8.1f %7.2fx\n", name, megabytes, importer.getVertexCount(),
+           importer.getTriangleCount(), times[0], megabytes * 1000.0 / times[0], times[1],
+           megabytes * 1000.0 / times[1], times[0] / times[1]);
+    return true;
+}
+
+int runImportBenchmark(const char *path) {
+    int threads = (int) max(1u, thread::hardware_concurrency());
+    printf("Model import benchmark (median of %d runs, %d hardware threads)\n", BENCHMARK_RUNS, threads);
+    printf("%-24s %8s %10s %10s %10s %8s %10s %8s %8s\n", "file", "MB", "vertices", "triangles", "1 thread ms",
+           "MB/s", "N threads ms", "MB/s", "speedup");
+    if (path != nullptr) {
+        return reportImport(path, threads) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // A dense torus, written in both formats and removed afterwards:
+    MeshGenerator generator({MESH_TORUS, 1024, 512, 1.0f, 0.4f, 0.0f});
+    vector<float> vertices((size_t) generator.getVertexCount() * MESH_VERTEX_FLOATS);
+    vector<unsigned int> indices(generator.getIndexCount());
+    generator.generate(vertices.data(), indices.data());
+    const char *objPath = "import_benchmark.obj";
+    const char *glbPath = "import_benchmark.glb";
+    bool passed = writeBenchmarkObj(objPath, vertices, indices) && writeBenchmarkGlb(glbPath, vertices, indices);
+    if (!passed) {
+        printf("ERROR: Failed to write the benchmark models\n");
+    }
+    passed = passed && reportImport(objPath, threads) && reportImport(glbPath, threads);
+    remove(objPath);
+    remove(glbPath);
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Median time of a workload on the job pool, after one untimed run to warm caches and wake the workers:
+static double timeJobs(const function<void()> &workload) {
+    workload();
+    vector<double> samples;
+    for (int run = 0; run < BENCHMARK_RUNS; ++run) {
+        auto start = chrono::high_resolution_clock::now();
+        workload();
+        samples.push_back(elapsedMs(start));
+    }
+    return median(samples);
+}
+
+int runJobBenchmark() {
+    const int itemCount = 1 << 20;
+    int hardwareThreads = (int) max(1u, thread::hardware_concurrency());
+    vector<int> threadCounts;
+    for (int threads = 1; threads < hardwareThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(hardwareThreads);
+
+    // Transforms and bounds scattered through a cube, seen by a camera at its center:
+    vector<glm::vec3> positions(itemCount), rotations(itemCount), scales(itemCount);
+    unsigned int random = 12345;
+    auto unit = [&random]() {
+        random = random * 1664525u + 1013904223u;
+        return (float) (random >> 8) / (float) (1 << 24);
+    };
+    for (int i = 0; i < itemCount; ++i) {
+        positions[i] = glm::vec3(unit(), unit(), unit()) * 200.0f - 100.0f;
+        rotations[i] = glm::vec3(unit(), unit(), unit()) * 6.2832f;
+        scales[i] = glm::vec3(0.5f + unit());
+    }
+    glm::mat4 viewProjection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 150.0f) *
+                               glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::vec4 planes[6];
+    for (int i = 0; i < 3; ++i) {
+        glm::vec4 row(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        glm::vec4 w(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+        planes[i * 2] = (w + row) / glm::length(glm::vec3(w + row));
+        planes[i * 2 + 1] = (w - row) / glm::length(glm::vec3(w - row));
+    }
+    vector<float> keys(itemCount);
+    for (int i = 0; i < itemCount; ++i) {
+        keys[i] = glm::length(positions[i]);
+    }
+
+    // The repository's images, each decoded several times so there are enough to spread:
+    const char *imagePaths[] = {"images/can_top.png", "images/computer_monitor_texture.jpg",
+                                "images/cup_texture.jpg", "images/cup_texture.png", "images/desk_texture.jpg",
+                                "images/pyramid_texture.jpg", "images/ring_texture.jpg", "images/scene_texture.jpg"};
+    const int imageRepeats = 4;
+    vector<unique_ptr<MappedFile>> images;
+    for (const char *path : imagePaths) {
+        unique_ptr<MappedFile> image(new MappedFile());
+        if (image->open(path, false)) {
+            images.push_back(move(image));
+        }
+    }
+
+    vector<glm::mat4> models(itemCount);
+    vector<unsigned char> visible(itemCount);
+    vector<float> sorted(itemCount);
+    MeshGenerator generator({MESH_TORUS, 2048, 1024, 1.0f, 0.4f, 0.0f});
+    vector<float> vertices((size_t) generator.getVertexCount() * MESH_VERTEX_FLOATS);
+    vector<unsigned int> indices(generator.getIndexCount());
+
+    struct Workload {
+        const char *name;
+        function<void()> run;
+    };
+    const Workload workloads[] = {
+        {"transforms", [&]() {
+            jobs.parallelFor(itemCount, 0, [&](int begin, int end) {
+                for (int i = begin; i < end; ++i) {
+                    models[i] = glm::translate(positions[i]) * glm::toMat4(glm::quat(rotations[i])) *
+                                glm::scale(scales[i]);
+                }
+            });
+        }},
+        {"culling", [&]() {
+            jobs.parallelFor(itemCount, 0, [&](int begin, int end) {
+                for (int i = begin; i < end; ++i) {
+                    float radius = scales[i].x;
+                    bool inside = true;
+                    for (int p = 0; p < 6 && inside; ++p) {
+                        inside = glm::dot(glm::vec3(planes[p]), positions[i]) + planes[p].w >= -radius;
+                    }
+                    visible[i] = inside ? 1 : 0;
+                }
+            });
+        }},
+        {"sort", [&]() {
+            // Sort chunks, then merge neighbours in rounds of doubling width:
+            copy(keys.begin(), keys.end(), sorted.begin());
+            int chunk = max(1, itemCount / (jobs.getThreadCount() * 4));
+            jobs.parallelFor(itemCount, chunk, [&](int begin, int end) {
+                sort(sorted.begin() + begin, sorted.begin() + end);
+            });
+            for (int width = chunk; width < itemCount; width *= 2) {
+                int pairs = (itemCount + 2 * width - 1) / (2 * width);
+                jobs.parallelFor(pairs, 1, [&](int begin, int end) {
+                    for (int pair = begin; pair < end; ++pair) {
+                        int first = pair * 2 * width;
+                        int middle = min(itemCount, first + width);
+                        int last = min(itemCount, first + 2 * width);
+                        inplace_merge(sorted.begin() + first, sorted.begin() + middle, sorted.begin() + last);
+                    }
+                });
+            }
+        }},
+        {"mesh", [&]() {
+            generator.generate(vertices.data(), indices.data(), nullptr, jobs.getThreadCount());
+        }},
+        {"decode", [&]() {
+            jobs.parallelFor((int) images.size() * imageRepeats, 1, [&](int begin, int end) {
+                for (int i = begin; i < end; ++i) {
+                    const MappedFile &image = *images[i % images.size()];
+                    int width, height, channels;
+                    unsigned char *pixels = stbi_load_from_memory(image.data(), (int) image.size(), &width,
+                                                                  &height, &channels, 0);
+                    stbi_image_free(pixels);
+                }
+            });
+        }},
+    };
+
+    printf("Job system benchmark (median of %d runs, %d hardware threads, %d items, %d images)\n", BENCHMARK_RUNS,
+           hardwareThreads, itemCount, (int) images.size() * imageRepeats);
+    printf("%-11s %7s %10s %8s\n", "workload", "threads", "ms", "speedup");
+    vector<vector<double>> times(threadCounts.size());
+    for (size_t t = 0; t < threadCounts.size(); ++t) {
+        jobs.stop();
+        jobs.start(threadCounts[t]);
+        for (const Workload &workload : workloads) {
+            times[t].push_back(timeJobs(workload.run));
+        }
+    }
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w) {
+        for (size_t t = 0; t < threadCounts.size(); ++t) {
+            printf("%-11s %7d %10.2f %7.2fx\n", workloads[w].name, threadCounts[t], times[t][w],
+                   times[0][w] / times[t][w]);
+        }
+    }
+
+    // Check the results of the last run against single threaded ones:
+    bool passed = is_sorted(sorted.begin(), sorted.end());
+    for (int i = 0; passed && i < itemCount; i += 997) {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; ++p) {
+            inside = glm::dot(glm::vec3(planes[p]), positions[i]) + planes[p].w >= -scales[i].x;
+        }
+        passed = visible[i] == (inside ? 1 : 0);
+    }
+    if (!passed) {
+        printf("ERROR: Parallel results differ from serial ones\n");
+    }
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int runTransformBenchmark() {
+    const int objectCount = 100000;
+
+    // Placements like the scene's: anywhere in a cube, turned any way, scaled unevenly:
+    TransformBatch batch;
+    batch.resize(objectCount);
+    unsigned int random = 12345;
+    auto unit = [&random]() {
+        random = random * 1664525u + 1013904223u;
+        return (float) (random >> 8) / (float) (1 << 24);
+    };
+    for (int i = 0; i < objectCount; ++i) {
+        batch.set(i, glm::vec3(unit(), unit(), unit()) * 200.0f - 100.0f,
+                  (glm::vec3(unit(), unit(), unit()) * 2.0f - 1.0f) * (float) PI,
+                  glm::vec3(0.5f + unit(), 0.5f + unit(), 0.5f + unit()));
+    }
+
+    // The per-object path the draw list used: a quaternion per object, then a 4x4 inverse for its normals
+    vector<glm::mat4> referenceWorld(objectCount), referenceNormals(objectCount);
+    auto perObject = [&]() {
+        for (int i = 0; i < objectCount; ++i) {
+            glm::vec3 position(batch.positionX[i], batch.positionY[i], batch.positionZ[i]);
+            glm::vec3 rotation(batch.rotationX[i], batch.rotationY[i], batch.rotationZ[i]);
+            glm::vec3 scale(batch.scaleX[i], batch.scaleY[i], batch.scaleZ[i]);
+            referenceWorld[i] = glm::translate(position) * glm::toMat4(glm::quat(rotation)) * glm::scale(scale);
+            referenceNormals[i] = glm::transpose(glm::inverse(referenceWorld[i]));
+        }
+    };
+    auto time = [](const function<void()> &workload) {
+        workload();
+        vector<double> samples;
+        for (int run = 0; run < BENCHMARK_RUNS; ++run) {
+            auto start = chrono::high_resolution_clock::now();
+            workload();
+            samples.push_back(elapsedMs(start));
+        }
+        return median(samples);
+    };
+
+    printf("Transform benchmark (median of %d runs, %d objects, one thread, world and normal matrices)\n",
+           BENCHMARK_RUNS, objectCount);
+    printf("%-18s %10s %10s %8s %12s\n", "path", "ms", "ns/object", "speedup", "max error");
+    double perObjectMs = time(perObject);
+    printf("%-18s %10.2f %10.1f %7.2fx %12s\n", "per object (glm)", perObjectMs, perObjectMs * 1.0e6 / objectCount,
+           1.0, "-");
+
+    bool passed = true;
+    vector<glm::mat4> world(objectCount), normals(objectCount);
+    for (int kernel = 0; kernel < TRANSFORM_KERNEL_COUNT; ++kernel) {
+        char name[32];
+        snprintf(name, sizeof(name), "batch %s", getTransformKernelName((TransformKernel) kernel));
+        if (!isTransformKernelSupported((TransformKernel) kernel)) {
+            printf("%-18s %10s\n", name, "n/a");
+            continue;
+        }
+        double ms = time([&]() {
+            composeTransforms((TransformKernel) kernel, batch, 0, objectCount, world.data(), normals.data());
+        });
+
+        // Largest difference from GLM, relative to the element's size (normal matrices: the upper 3x3 only):
+        float error = 0.0f;
+        for (int i = 0; i < objectCount; ++i) {
+            for (int column = 0; column < 4; ++column) {
+                for (int row = 0; row < 4; ++row) {
+                    float expected = referenceWorld[i][column][row];
+                    error = max(error, fabs(world[i][column][row] - expected) / (1.0f + fabs(expected)));
+                    if (column < 3 && row < 3) {
+                        expected = referenceNormals[i][column][row];
+                        error = max(error, fabs(normals[i][column][row] - expected) / (1.0f + fabs(expected)));
+                    }
+                }
+            }
+        }
+        passed = passed && error < 1.0e-4f;
+        printf("%-18s %10.2f %10.1f %7.2fx %12.2e\n", name, ms, ms * 1.0e6 / objectCount, perObjectMs / ms, error);
+    }
+    printf("Transforms use the %s kernel\n", getTransformKernelName(getTransformKernel()));
+    if (!passed) {
+        printf("ERROR: Batch transforms differ from GLM's\n");
+    }
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
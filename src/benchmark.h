@@ -0,0 +1,22 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+// Times the parametric mesh generator at very high sector and stack counts:
+int runMeshBenchmark();
+
+// Reports vertex counts, ACMR and ATVR of every primitive before and after the mesh optimizer:
+int runMeshOptBenchmark();
+
+// Times importing a model file (OBJ or glTF) on one thread and on every hardware thread, in MB/s. Without a
+// path, large OBJ and glTF files are generated and imported.
+int runImportBenchmark(const char *path);
+
+// Times transform updates, culling, sorting, mesh generation and image decoding split into jobs on 1, 2, 4 ... up
+// to every hardware thread, with the speedup over one thread:
+int runJobBenchmark();
+
+// Times composing world and normal matrices for many objects one at a time with GLM and with the batch kernels
+// of every instruction set the CPU supports (see transformbatch.h), and checks the kernels against GLM:
+int runTransformBenchmark();
+
+#endif //BENCHMARK_H
@@ -125,6 +125,20 @@ void Camera::ProcessMouseScroll(float yoffset) {
 
 }
 
+// Places the camera at position and derives the euler angles that face target:
+void Camera::lookAt(const glm::vec3 &position, const glm::vec3 &target) {
+    glm::vec3 front = glm::normalize(target - position);
+    Position = position;
+    Yaw = glm::degrees(atan2(front.z, front.x));
+    Pitch = glm::degrees(asin(front.y));
+    updateCameraVectors();
+}
+
+// Sets the aspect ratio used by the perspective projection:
+void Camera::setAspect(float aspect) {
+    this->aspect = aspect;
+}
+
 // Calculates the front vector from the camera's updated euler angles:
 void Camera::updateCameraVectors() {
     // Calculate the new Front vector
@@ -38,6 +38,12 @@ public:
 
     void toggleOrthographic();
 
+    // Places the camera at position, facing target:
+    void lookAt(const glm::vec3 &position, const glm::vec3 &target);
+
+    // Sets the aspect ratio of the perspective projection (width / height):
+    void setAspect(float aspect);
+
     // Camera attributes:
     glm::vec3 Position;
     glm::vec3 Front;
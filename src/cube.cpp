@@ -1,5 +1,6 @@
 #include "cube.h"
 #include <stdio.h> 
+#include <vector>
 
 Cube::Cube(float width, float height, float length) {
     this->width = width;
@@ -9,16 +10,9 @@ Cube::Cube(float width, float height, float length) {
     bufferTexture = nullptr;
 }
 
-// Initialize the cube with a texture:
-bool Cube::init(const char *filename) {
-    if (!renderToTexture) {
-        if (!loadTexture(filename)) {
-            return false;
-        }
-    }
-
+// Build the unindexed triangle list, MESH_TANGENT_VERTEX_FLOATS per vertex:
+void Cube::buildVertices(std::vector<float> &vertices) const {
     // Vertex data
-    mesh.nVertices = 36;
     glm::vec3 verts[36] = {
             // Back:
             glm::vec3(width, -height, -length),
@@ -70,7 +64,6 @@ bool Cube::init(const char *filename) {
     };
 
     // UV data:
-    mesh.totalUVs = 36;
     glm::vec2 uvs[36] = {
             // Back:
             glm::vec2(1.0f, 0.0f),
@@ -122,7 +115,6 @@ bool Cube::init(const char *filename) {
     };
 
     // Normal data:
-    mesh.totalNormals = 36;
     glm::vec3 normals[36] = {
             // Back
             glm::vec3(0.0f, 0.0f, -1.0f),
@@ -176,7 +168,7 @@ bool Cube::init(const char *filename) {
     glm::vec3 tangent[36];
     glm::vec3 bitangent[36];
 
-    for (int i = 0; i < mesh.totalNormals; i += 3) {
+    for (int i = 0; i < 36; i += 3) {
         glm::vec3 edge1 = verts[i + 1] - verts[i];
         glm::vec3 edge2 = verts[i + 2] - verts[i];
         glm::vec2 deltaUV1 = uvs[i + 1] - uvs[i];
@@ -195,57 +187,41 @@ bool Cube::init(const char *filename) {
         }
     }
 
-    glGenVertexArrays(1, &mesh.vao); // create VAO
-    glBindVertexArray(mesh.vao); // bind VAO
-
-    // Vertex buffer:
-    glGenBuffers(1, &mesh.vbo); // create vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo); // bind VBO
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * mesh.nVertices, verts,
-                 GL_STATIC_DRAW); // send vertex data to the GPU
-
-    // Create vertex attribute:
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void *) nullptr);
-    glEnableVertexAttribArray(0); // enable vertices
-
-    // Normal buffer:
-    glGenBuffers(1, &mesh.normalBuffer); // create normal buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.normalBuffer); // bind normal buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * mesh.totalNormals, normals,
-                 GL_STATIC_DRAW); // send normal data to GPU
-
-    // Create normal attribute:
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void *) nullptr);
-    glEnableVertexAttribArray(1); // enable normals
-
-    // UV buffer:
-    glGenBuffers(1, &mesh.uvBuffer); // create UV buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.uvBuffer); // bind UV buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * mesh.totalUVs, uvs, GL_STATIC_DRAW); // send UV data to GPU
-
-    // Create UV attribute:
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void *) nullptr);
-    glEnableVertexAttribArray(2); // enable UVs
-
-    // Tangent buffer:
-    glGenBuffers(1, &mesh.tangentBuffer); // create tangent buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.tangentBuffer); // bind tangent buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * mesh.totalNormals, tangent,
-                 GL_STATIC_DRAW); // send tangent data to GPU
-
-    // Create tangent attribute:
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, (void *) nullptr);
-    glEnableVertexAttribArray(3); // enable tangents
-
-    // Bitangent buffer:
-    glGenBuffers(1, &mesh.bitangentBuffer); // create bitangent buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.bitangentBuffer); // bind bitangent buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * mesh.totalNormals, bitangent,
-                 GL_STATIC_DRAW); // send bitangent data to GPU
-
-    // Create bitangent attribute:
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 0, (void *) nullptr);
-    glEnableVertexAttribArray(4); // enable bitangents
+    // Interleave V/N/T/tangent/bitangent into one buffer:
+    vertices.resize(36 * MESH_TANGENT_VERTEX_FLOATS);
+    for (int i = 0; i < 36; ++i) {
+        float *v = &vertices[i * MESH_TANGENT_VERTEX_FLOATS];
+        v[0] = verts[i].x;
+        v[1] = verts[i].y;
+        v[2] = verts[i].z;
+        v[3] = normals[i].x;
+        v[4] = normals[i].y;
+        v[5] = normals[i].z;
+        v[6] = uvs[i].x;
+        v[7] = uvs[i].y;
+        v[8] = tangent[i].x;
+        v[9] = tangent[i].y;
+        v[10] = tangent[i].z;
+        v[11] = bitangent[i].x;
+        v[12] = bitangent[i].y;
+        v[13] = bitangent[i].z;
+    }
+}
+
+// Initialize the cube with a texture:
+bool Cube::init(const char *filename) {
+    if (!renderToTexture) {
+        if (!loadTexture(filename)) {
+            return false;
+        }
+    }
+
+    // Upload welds the 36 corners into 24 indexed vertices:
+    std::vector<float> vertices;
+    buildVertices(vertices);
+    mesh.totalUVs = 36;
+    mesh.totalNormals = 36;
+    mesh.upload(vertices.data(), 36, MESH_TANGENT_VERTEX_FLOATS);
 
     return true;
 }
@@ -281,9 +257,7 @@ void Cube::render() {
         }
     }
 
-    glBindVertexArray(mesh.vao); // activate the VBOs contained within the mesh's VAO
-    glDrawArrays(GL_TRIANGLES, 0, mesh.nVertices); // draw the cube
-    glBindVertexArray(0); // unbind VAO:
+    mesh.draw(GL_TRIANGLES); // draw the cube
 
     glDisableVertexAttribArray(0);
     glDisableVertexAttribArray(1);
@@ -3,6 +3,8 @@
 
 #include "model.h"
 
+#include <vector>
+
 class Cube : public Model {
 public:
     Cube(float width = 0.5f, float height = 0.5f, float length = 0.5f);
@@ -13,6 +15,9 @@ public:
 
     void render() override;
 
+    // Build the unindexed triangle list, MESH_TANGENT_VERTEX_FLOATS per vertex:
+    void buildVertices(std::vector<float> &vertices) const;
+
 private:
     float width;
     float height;
@@ -15,7 +15,9 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include <cmath>
+#include <algorithm>
 #include "cylinder.h"
+#include "meshgen.h"
 
 const int MIN_SECTOR_COUNT = 3;
 const int MIN_STACK_COUNT = 1;
@@ -30,39 +32,42 @@ bool Cylinder::init(const char *filename) {
         return false;
     }
 
-    glGenVertexArrays(1, &mesh.vao); // create VAO
-    glBindVertexArray(mesh.vao); // bind VAO
-
-    // VBO:
-    glGenBuffers(1, &mesh.vbo); // create vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo); // bind VBO
-    glBufferData(GL_ARRAY_BUFFER, getInterleavedVertexSize(), getInterleavedVertices(),
-                 GL_STATIC_DRAW); // Sends vertex or coordinate data to the GPU
-
-    // Index buffer:
-    mesh.nIndices = getIndexSize();
-    glGenBuffers(1, &mesh.indexBuffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.nIndices, getIndices(), GL_STATIC_DRAW);
-
-    int stride = getInterleavedStride();
-
-    // Vertices:
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, nullptr);
-    glEnableVertexAttribArray(0); // enable vertices
+    // Tessellated surface patches replace the mesh and its LOD chain (smooth shading only):
+    MeshParams params = {MESH_CYLINDER, sectorCount, stackCount, baseRadius, topRadius, height};
+    if (Model::useTessellation && smooth) {
+        initPatches(params);
+        return true;
+    }
 
-    // Normals:
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void *) (sizeof(float) * 3));
-    glEnableVertexAttribArray(1); // enable normals
+    // Smooth cylinders come from the generator with coarser levels for distant cylinders, through the mesh
+    // cache. Only the sectors around the wider end need detail, the height is split into straight stacks:
+    if (smooth) {
+        float radius = std::max(baseRadius, topRadius);
+        initMeshChain(params, sectorCount, radius, std::sqrt(radius * radius + height * height * 0.25f));
+        return true;
+    }
 
-    // Texture coords:
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void *) (sizeof(float) * 6));
-    glEnableVertexAttribArray(2); // enable texture coords
+    // Interleaved V/N/T vertices and triangle indices:
+    mesh.upload(getInterleavedVertices(), getInterleavedVertexCount(), MESH_VERTEX_FLOATS, getIndices(),
+                getIndexCount());
 
     return true;
 }
 
+void Cylinder::prepare() {
+    // Build the mesh chain init uploads, if it uses one
+    if (smooth && !Model::useTessellation) {
+        float radius = std::max(baseRadius, topRadius);
+        prepareMeshChain({MESH_CYLINDER, sectorCount, stackCount, baseRadius, topRadius, height}, sectorCount,
+                         radius, std::sqrt(radius * radius + height * height * 0.25f));
+    }
+}
+
 void Cylinder::render() {
+    renderLod(0);
+}
+
+void Cylinder::renderLod(int level) {
     glEnableVertexAttribArray(0);
     glEnableVertexAttribArray(1);
     glEnableVertexAttribArray(2);
@@ -71,9 +76,7 @@ void Cylinder::render() {
         mesh.material.diffuse.bind();
     }
 
-    glBindVertexArray(mesh.vao); // activate the VBOs contained within the mesh's VAO
-    glDrawElements(GL_TRIANGLES, getIndexCount(), GL_UNSIGNED_INT, NULL);
-    glBindVertexArray(0); // unbind vao
+    getLodMesh(level)->draw(GL_TRIANGLES);
 
     glDisableVertexAttribArray(0);
     glDisableVertexAttribArray(1);
@@ -150,117 +153,27 @@ void Cylinder::clearArrays() {
     std::vector<float>().swap(texCoords);
     std::vector<unsigned int>().swap(indices);
     std::vector<unsigned int>().swap(lineIndices);
+    std::vector<float>().swap(interleavedVertices);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // build vertices of cylinder with smooth shading
 // where v: sector angle (0 <= v <= 360)
+// the generator writes interleaved V/N/T straight into exactly sized arrays
 ///////////////////////////////////////////////////////////////////////////////
 void Cylinder::buildVerticesSmooth() {
     // clear memory of prev arrays
     clearArrays();
 
-    float x, y, z;                                  // vertex position
-    //float s, t;                                     // texCoord
-    float radius;                                   // radius for each stack
-
-    // get normals for cylinder sides
-    std::vector<float> sideNormals = getSideNormals();
-
-    // put vertices of side cylinder to array by scaling unit circle
-    for (int i = 0; i <= stackCount; ++i) {
-        z = -(height * 0.5f) + (float) i / stackCount * height;      // vertex position z
-        radius = baseRadius + (float) i / stackCount * (topRadius - baseRadius);     // lerp
-        float t = 1.0f - (float) i / stackCount;   // top-to-bottom
-
-        for (int j = 0, k = 0; j <= sectorCount; ++j, k += 3) {
-            x = unitCircleVertices[k];
-            y = unitCircleVertices[k + 1];
-            addVertex(x * radius, y * radius, z);   // position
-            addNormal(sideNormals[k], sideNormals[k + 1], sideNormals[k + 2]); // normal
-            addTexCoord((float) j / sectorCount, t); // tex coord
-        }
-    }
-
-    // remember where the base.top vertices start
-    unsigned int baseVertexIndex = (unsigned int) vertices.size() / 3;
+    MeshGenerator generator({MESH_CYLINDER, sectorCount, stackCount, baseRadius, topRadius, height});
+    interleavedVertices.resize((std::size_t) generator.getVertexCount() * MESH_VERTEX_FLOATS);
+    indices.resize(generator.getIndexCount());
+    lineIndices.resize(generator.getLineIndexCount());
+    generator.generate(interleavedVertices.data(), indices.data(), lineIndices.data());
 
-    // put vertices of base of cylinder
-    z = -height * 0.5f;
-    addVertex(0, 0, z);
-    addNormal(0, 0, -1);
-    addTexCoord(0.5f, 0.5f);
-    for (int i = 0, j = 0; i < sectorCount; ++i, j += 3) {
-        x = unitCircleVertices[j];
-        y = unitCircleVertices[j + 1];
-        addVertex(x * baseRadius, y * baseRadius, z);
-        addNormal(0, 0, -1);
-        addTexCoord(-x * 0.5f + 0.5f, -y * 0.5f + 0.5f);    // flip horizontal
-    }
-
-    // remember where the base vertices start
-    unsigned int topVertexIndex = (unsigned int) vertices.size() / 3;
-
-    // put vertices of top of cylinder
-    z = height * 0.5f;
-    addVertex(0, 0, z);
-    addNormal(0, 0, 1);
-    addTexCoord(0.5f, 0.5f);
-    for (int i = 0, j = 0; i < sectorCount; ++i, j += 3) {
-        x = unitCircleVertices[j];
-        y = unitCircleVertices[j + 1];
-        addVertex(x * topRadius, y * topRadius, z);
-        addNormal(0, 0, 1);
-        addTexCoord(x * 0.5f + 0.5f, -y * 0.5f + 0.5f);
-    }
-
-    // put indices for sides
-    unsigned int k1, k2;
-    for (int i = 0; i < stackCount; ++i) {
-        k1 = i * (sectorCount + 1);     // bebinning of current stack
-        k2 = k1 + sectorCount + 1;      // beginning of next stack
-
-        for (int j = 0; j < sectorCount; ++j, ++k1, ++k2) {
-            // 2 trianles per sector
-            addIndices(k1, k1 + 1, k2);
-            addIndices(k2, k1 + 1, k2 + 1);
-
-            // vertical lines for all stacks
-            lineIndices.push_back(k1);
-            lineIndices.push_back(k2);
-            // horizontal lines
-            lineIndices.push_back(k2);
-            lineIndices.push_back(k2 + 1);
-            if (i == 0) {
-                lineIndices.push_back(k1);
-                lineIndices.push_back(k1 + 1);
-            }
-        }
-    }
-
-    // remember where the base indices start
-    baseIndex = (unsigned int) indices.size();
-
-    // put indices for base
-    for (int i = 0, k = baseVertexIndex + 1; i < sectorCount; ++i, ++k) {
-        if (i < (sectorCount - 1))
-            addIndices(baseVertexIndex, k + 1, k);
-        else    // last triangle
-            addIndices(baseVertexIndex, baseVertexIndex + 1, k);
-    }
-
-    // remember where the base indices start
-    topIndex = (unsigned int) indices.size();
-
-    for (int i = 0, k = topVertexIndex + 1; i < sectorCount; ++i, ++k) {
-        if (i < (sectorCount - 1))
-            addIndices(topVertexIndex, k, k + 1);
-        else
-            addIndices(topVertexIndex, k, topVertexIndex + 1);
-    }
-
-    // generate interleaved vertex array as well
-    buildInterleavedVertices();
+    // remember where the base/top indices start
+    baseIndex = generator.getBaseStartIndex();
+    topIndex = generator.getTopStartIndex();
 }
 
 
@@ -494,41 +407,6 @@ void Cylinder::addIndices(unsigned int i1, unsigned int i2, unsigned int i3) {
     indices.push_back(i3);
 }
 
-///////////////////////////////////////////////////////////////////////////////
-// generate shared normal vectors of the side of cylinder
-///////////////////////////////////////////////////////////////////////////////
-std::vector<float> Cylinder::getSideNormals() {
-    const float pi = acos(-1);
-    float sectorStep = 2 * pi / sectorCount;
-    float sectorAngle;  // radian
-
-    // compute the normal vector at 0 degree first
-    // tanA = (baseRadius-topRadius) / height
-    float zAngle = atan2(baseRadius - topRadius, height);
-    float x0 = cos(zAngle);     // nx
-    float y0 = 0;               // ny
-    float z0 = sin(zAngle);     // nz
-
-    // rotate (x0,y0,z0) per sector angle
-    std::vector<float> normals;
-    for (int i = 0; i <= sectorCount; ++i) {
-        sectorAngle = i * sectorStep;
-        normals.push_back(cos(sectorAngle) * x0 - sin(sectorAngle) * y0);   // nx
-        normals.push_back(sin(sectorAngle) * x0 + cos(sectorAngle) * y0);   // ny
-        normals.push_back(z0);  // nz
-        /*
-        //debug
-        float nx = cos(sectorAngle)*x0 - sin(sectorAngle)*y0;
-        float ny = sin(sectorAngle)*x0 + cos(sectorAngle)*y0;
-        std::cout << "normal=(" << nx << ", " << ny << ", " << z0
-                  << "), length=" << sqrtf(nx*nx + ny*ny + z0*z0) << std::endl;
-        */
-    }
-
-    return normals;
-}
-
-
 ///////////////////////////////////////////////////////////////////////////////
 // return face normal of a triangle v1-v2-v3
 // if a triangle has no surface (normal length = 0), then return a zero vector
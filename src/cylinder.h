@@ -29,8 +29,12 @@ public:
 
     bool init(const char *filename);
 
+    void prepare() override;
+
     void render() override;
 
+    void renderLod(int level) override;
+
     // getters/setters
     float getBaseRadius() const { return baseRadius; }
 
@@ -56,12 +60,8 @@ public:
 
     void setSmooth(bool smooth);
 
-    // for vertex data
-    unsigned int getVertexCount() const { return (unsigned int) vertices.size() / 3; }
-
-    unsigned int getNormalCount() const { return (unsigned int) normals.size() / 3; }
-
-    unsigned int getTexCoordCount() const { return (unsigned int) texCoords.size() / 2; }
+    // for vertex data: the interleaved vertices (below) and the indices
+    unsigned int getVertexCount() const { return (unsigned int) interleavedVertices.size() / 8; }
 
     unsigned int getIndexCount() const { return (unsigned int) indices.size(); }
 
@@ -69,22 +69,10 @@ public:
 
     unsigned int getTriangleCount() const { return getIndexCount() / 3; }
 
-    unsigned int getVertexSize() const { return (unsigned int) vertices.size() * sizeof(float); }
-
-    unsigned int getNormalSize() const { return (unsigned int) normals.size() * sizeof(float); }
-
-    unsigned int getTexCoordSize() const { return (unsigned int) texCoords.size() * sizeof(float); }
-
     unsigned int getIndexSize() const { return (unsigned int) indices.size() * sizeof(unsigned int); }
 
     unsigned int getLineIndexSize() const { return (unsigned int) lineIndices.size() * sizeof(unsigned int); }
 
-    const float *getVertices() const { return vertices.data(); }
-
-    const float *getNormals() const { return normals.data(); }
-
-    const float *getTexCoords() const { return texCoords.data(); }
-
     const unsigned int *getIndices() const { return indices.data(); }
 
     const unsigned int *getLineIndices() const { return lineIndices.data(); }
@@ -132,8 +120,6 @@ private:
 
     void addIndices(unsigned int i1, unsigned int i2, unsigned int i3);
 
-    std::vector<float> getSideNormals();
-
     std::vector<float> computeFaceNormal(float x1, float y1, float z1,
                                          float x2, float y2, float z2,
                                          float x3, float y3, float z3);
@@ -148,7 +134,7 @@ private:
     unsigned int topIndex;                  // starting index of top
     bool smooth;
     std::vector<float> unitCircleVertices;
-    std::vector<float> vertices;
+    std::vector<float> vertices;            // flat shading builds these, then interleaves them
     std::vector<float> normals;
     std::vector<float> texCoords;
     std::vector<unsigned int> indices;
@@ -0,0 +1,154 @@
+#include "drawlist.h"
+#include "jobs.h"
+#include "model.h"
+
+#include <algorithm>
+#include <cstring>
+
+bool DrawList::useCulling = true;
+
+void Frustum::set(const glm::mat4 &viewProjection) {
+    // Each plane is the last row of the matrix plus or minus one of the others (Gribb and Hartmann):
+    glm::vec4 w(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+    for (int axis = 0; axis < 3; ++axis) {
+        glm::vec4 row(viewProjection[0][axis], viewProjection[1][axis], viewProjection[2][axis],
+                      viewProjection[3][axis]);
+        planes[axis * 2] = w + row;
+        planes[axis * 2 + 1] = w - row;
+    }
+    for (glm::vec4 &plane : planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+bool Frustum::intersectsSphere(const glm::vec3 &center, float radius) const {
+    for (const glm::vec4 &plane : planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+DrawList::DrawList() : view(1.0f), projection(1.0f), viewportHeight(1), culled(0) {
+    frustum.set(glm::mat4(1.0f));
+}
+
+void DrawList::begin(const glm::mat4 &view, const glm::mat4 &projection, int viewportHeight) {
+    this->view = view;
+    this->projection = projection;
+    this->viewportHeight = viewportHeight;
+    frustum.set(projection * view);
+    for (std::vector<DrawPacket> &chunk : chunks) {
+        chunk.clear();
+    }
+    culled = 0;
+}
+
+void DrawList::build(int count, const std::function<void(int, int, std::vector<DrawPacket> &)> &body) {
+    if (count <= 0) {
+        return;
+    }
+
+    // Chunks of the same size every frame for a scene, so their buffers are reused:
+    int grain = std::max(DRAW_LIST_MIN_CHUNK, count / (jobs.getThreadCount() * 4));
+    int chunkCount = (count + grain - 1) / grain;
+    if ((int) chunks.size() < chunkCount) {
+        chunks.resize(chunkCount);
+    }
+    jobs.parallelFor(count, grain, [&](int begin, int end) {
+        body(begin, end, chunks[begin / grain]);
+    });
+}
+
+bool DrawList::add(Model *model, Shader *shader, const glm::mat4 &transform, const glm::mat4 &normalMatrix,
+                   const glm::vec3 &specular, float shininess, unsigned char &level,
+                   std::vector<DrawPacket> &packets) {
+    // The bounding sphere grows with the largest scale factor, so it stays a bound under any scale:
+    float maxScale = std::max(glm::length(glm::vec3(transform[0])),
+                              std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+    glm::vec3 center;
+    float radius;
+    model->getBoundingSphere(center, radius);
+    if (useCulling && !frustum.intersectsSphere(glm::vec3(transform * glm::vec4(center, 1.0f)), radius * maxScale)) {
+        culled.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    DrawPacket packet;
+    packet.model = model;
+    packet.shader = shader;
+    packet.transform = transform;
+    packet.normalMatrix = normalMatrix;
+    packet.specular = specular;
+    packet.shininess = shininess;
+    packet.lod = model->chooseLod(transform, level, view, projection, viewportHeight);
+    level = (unsigned char) packet.lod;
+    packet.objectData = 0;
+    packets.push_back(packet);
+    return true;
+}
+
+bool DrawList::writeObjects(RingBuffer &ring) {
+    unsigned int count = getPacketCount();
+    if (count == 0) {
+        return true;
+    }
+    GLsizeiptr stride = ring.getAlignedSize(sizeof(ObjectUniforms));
+    RingAllocation block = ring.allocate(stride * count);
+    if (block.data == nullptr) {
+        return false;
+    }
+
+    // Each chunk writes its packets after those of the chunks before it:
+    std::vector<unsigned int> firsts(chunks.size());
+    unsigned int first = 0;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        firsts[i] = first;
+        first += (unsigned int) chunks[i].size();
+    }
+    jobs.parallelFor((int) chunks.size(), 1, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            GLintptr offset = block.offset + stride * firsts[i];
+            for (DrawPacket &packet : chunks[i]) {
+                Model *model = packet.model;
+                const Mesh *mesh = model->getLodMesh(packet.lod);
+                float normalMap = model->getMaterial()->useNormalMap ? 1.0f : 0.0f;
+                ObjectUniforms object;
+                object.model = packet.transform;
+                object.normalMatrix = packet.normalMatrix;
+                object.positionScale = glm::vec4(mesh->positionScale, mesh->packed ? 1.0f : 0.0f);
+                object.positionOffset = glm::vec4(mesh->positionOffset, normalMap);
+                object.specular = glm::vec4(packet.specular, packet.shininess);
+                object.surface = glm::vec4(0.0f);
+                if (model->isTessellated()) {
+                    const MeshParams &params = model->getSurface();
+                    object.surface = glm::vec4(params.radius, params.topRadius, params.height, (float) params.shape);
+                }
+                memcpy(block.data + (offset - block.offset), &object, sizeof(object));
+                packet.objectData = offset;
+                offset += stride;
+            }
+        }
+    });
+    return true;
+}
+
+unsigned int DrawList::getPacketCount() const {
+    size_t count = 0;
+    for (const std::vector<DrawPacket> &chunk : chunks) {
+        count += chunk.size();
+    }
+    return (unsigned int) count;
+}
+
+bool DrawList::draws(const Model *model) const {
+    for (const std::vector<DrawPacket> &chunk : chunks) {
+        for (const DrawPacket &packet : chunk) {
+            if (packet.model == model) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,104 @@
+#ifndef DRAWLIST_H
+#define DRAWLIST_H
+
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "geometry.h"
+#include "ringbuffer.h"
+
+class Model;
+class Shader;
+
+// Fewest objects a job of the build phase culls and places:
+const int DRAW_LIST_MIN_CHUNK = 64;
+
+// The six planes of a view frustum (left, right, bottom, top, near, far), normalized and facing inwards:
+struct Frustum {
+    glm::vec4 planes[6];
+
+    // Extracts the planes of a projection * view matrix:
+    void set(const glm::mat4 &viewProjection);
+
+    bool intersectsSphere(const glm::vec3 &center, float radius) const;
+};
+
+// Uniform block binding of the per-object data:
+const GLuint OBJECT_DATA_BINDING = 0;
+
+// The ObjectData uniform block (std140) of the scene shaders, one per draw:
+struct ObjectUniforms {
+    glm::mat4 model;
+    glm::mat4 normalMatrix;    // inverse transpose of model, in the upper 3x3
+    glm::vec4 positionScale;   // dequantization of packed positions; w: 1 if normals are packed
+    glm::vec4 positionOffset;  // w: 1 if the material has a normal map
+    glm::vec4 specular;        // w: shininess
+    glm::vec4 surface;         // radius, top radius, height and shape of a tessellated model's surface
+};
+
+// One draw, resolved in the build phase: the submit phase reads nothing else to issue it.
+struct DrawPacket {
+    Model *model;
+    Shader *shader;      // the variant it is drawn with
+    glm::mat4 transform; // world space
+    glm::mat4 normalMatrix; // inverse transpose of transform, in the upper 3x3
+    glm::vec3 specular;
+    float shininess;
+    int lod;             // the level of detail drawn
+    GLintptr objectData; // offset of its ObjectUniforms in the ring buffer, once written
+};
+
+// The draws of a frame, built in two phases. The build phase runs on the job pool (see jobs.h): each chunk of
+// objects is culled against the view frustum, placed and given a level of detail and shader, and its packets go
+// to the chunk's own buffer, so workers share nothing. The submit phase, on the context thread, walks the
+// packets in order and only issues GL calls. Buffers keep their memory from frame to frame. In between, the
+// per-object data of every packet is written into a ring buffer on the job pool, for both passes.
+class DrawList {
+public:
+    DrawList();
+
+    // Starts a frame seen through view and projection, dropping the packets of the last one:
+    void begin(const glm::mat4 &view, const glm::mat4 &projection, int viewportHeight);
+
+    // Calls body(begin, end, packets) over objects [0, count) in chunks on the job pool, and returns once all
+    // have finished. Packets come out in the order of their objects.
+    void build(int count, const std::function<void(int, int, std::vector<DrawPacket> &)> &body);
+
+    // Adds a draw of a model placed by transform, with its normal matrix (see composeTransforms), unless it is
+    // outside the frustum, choosing its level of detail. level is the object's own: the level it drew last,
+    // which the choice keeps hysteresis around and is updated to it. Safe to call from build bodies as long as
+    // no other body has the same object. Returns false if it was culled.
+    bool add(Model *model, Shader *shader, const glm::mat4 &transform, const glm::mat4 &normalMatrix,
+             const glm::vec3 &specular, float shininess, unsigned char &level, std::vector<DrawPacket> &packets);
+
+    // Writes the ObjectUniforms of every packet into the frame's region of ring on the job pool, setting their
+    // objectData. Call between the ring's beginFrame and flush. Returns false if the region had no room.
+    bool writeObjects(RingBuffer &ring);
+
+    // The packets of each chunk, in order (chunks unused this frame are empty):
+    const std::vector<std::vector<DrawPacket>> &getChunks() const { return chunks; }
+
+    unsigned int getPacketCount() const;
+
+    // Whether any packet draws model:
+    bool draws(const Model *model) const;
+
+    unsigned int getCulledCount() const { return culled.load(); }
+
+    const glm::mat4 &getView() const { return view; }
+
+    const glm::mat4 &getProjection() const { return projection; }
+
+    // Skip objects outside the view frustum (on by default).
+    static bool useCulling;
+
+private:
+    glm::mat4 view;
+    glm::mat4 projection;
+    int viewportHeight;
+    Frustum frustum;
+    std::vector<std::vector<DrawPacket>> chunks;
+    std::atomic<unsigned int> culled;
+};
+
+#endif //DRAWLIST_H
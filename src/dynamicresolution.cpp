@@ -0,0 +1,145 @@
+#include "dynamicresolution.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+DynamicResolution dynamicResolution;
+
+DynamicResolution::DynamicResolution() {
+    enabled = false;
+    minScale = DYNAMIC_RESOLUTION_MIN_SCALE;
+    maxScale = DYNAMIC_RESOLUTION_MAX_SCALE;
+    targetMs = DYNAMIC_RESOLUTION_TARGET_MS;
+    sharpness = 0.5f;
+    scale = maxScale;
+    smoothedMs = 0.0;
+    framesSinceChange = 0;
+    shader = nullptr;
+    vao = 0;
+    windowWidth = 1;
+    windowHeight = 1;
+    scaleSum = 0.0;
+    frames = 0;
+    lowestScale = maxScale;
+    changes = 0;
+}
+
+bool DynamicResolution::init() {
+    shader = new Shader("shader/upscale.vs", "shader/upscale.frag");
+    if (shader->ID == 0) {
+        printf("ERROR: Failed to init the upscale shader!\n");
+        return false;
+    }
+    glGenVertexArrays(1, &vao);
+    return true;
+}
+
+void DynamicResolution::destroy() {
+    glDeleteVertexArrays(1, &vao);
+    vao = 0;
+    if (shader != nullptr) {
+        shader->destroy();
+        delete shader;
+        shader = nullptr;
+    }
+}
+
+void DynamicResolution::setScaleRange(float minScale, float maxScale) {
+    this->maxScale = std::max(0.1f, std::min(maxScale, 1.0f));
+    this->minScale = std::max(0.1f, std::min(minScale, this->maxScale));
+    scale = this->maxScale;
+    lowestScale = scale;
+}
+
+void DynamicResolution::setSharpness(float sharpness) {
+    this->sharpness = std::max(0.0f, std::min(sharpness, 1.0f));
+}
+
+void DynamicResolution::update(double gpuMs) {
+    if (!enabled) {
+        return;
+    }
+    scaleSum += scale;
+    ++frames;
+    if (gpuMs <= 0.0) {
+        return;
+    }
+    smoothedMs = smoothedMs <= 0.0 ? gpuMs : smoothedMs + (gpuMs - smoothedMs) * DYNAMIC_RESOLUTION_SMOOTHING;
+    if (++framesSinceChange < DYNAMIC_RESOLUTION_INTERVAL) {
+        return;
+    }
+
+    // Frames over the target drop the scale, and only frames well under it raise it:
+    double budget = targetMs * DYNAMIC_RESOLUTION_HEADROOM;
+    if (smoothedMs <= targetMs && smoothedMs >= budget * DYNAMIC_RESOLUTION_RAISE_BELOW) {
+        return;
+    }
+    float wanted = scale * (float) std::sqrt(budget / smoothedMs);
+    wanted = std::max(scale * (1.0f - DYNAMIC_RESOLUTION_MAX_STEP),
+                      std::min(wanted, scale * (1.0f + DYNAMIC_RESOLUTION_MAX_STEP)));
+    wanted = std::max(minScale, std::min(wanted, maxScale));
+    if (std::fabs(wanted - scale) < 0.01f) {
+        return;
+    }
+    scale = wanted;
+    lowestScale = std::min(lowestScale, scale);
+    framesSinceChange = 0;
+    ++changes;
+}
+
+void DynamicResolution::setWindowSize(int width, int height) {
+    windowWidth = std::max(1, width);
+    windowHeight = std::max(1, height);
+}
+
+int DynamicResolution::getTargetWidth() const {
+    return std::max(1, (int) std::ceil(windowWidth * maxScale));
+}
+
+int DynamicResolution::getTargetHeight() const {
+    return std::max(1, (int) std::ceil(windowHeight * maxScale));
+}
+
+int DynamicResolution::getRenderWidth() const {
+    return std::max(1, (int) std::lround(windowWidth * scale));
+}
+
+int DynamicResolution::getRenderHeight() const {
+    return std::max(1, (int) std::lround(windowHeight * scale));
+}
+
+void DynamicResolution::resolve(GLuint source) {
+    if (shader == nullptr) {
+        return;
+    }
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_BLEND);
+
+    // The pass covers the lower left renderWidth x renderHeight texels; samples stay half a texel inside them so
+    // the filter never reads what lies beyond:
+    glm::vec2 texel(1.0f / (float) getTargetWidth(), 1.0f / (float) getTargetHeight());
+    glm::vec2 rendered((float) getRenderWidth() * texel.x, (float) getRenderHeight() * texel.y);
+    shader->use();
+    shader->setInt("source", 0);
+    shader->setVec2("texelSize", texel);
+    shader->setVec2("uvScale", rendered);
+    shader->setVec2("uvMin", 0.5f * texel);
+    shader->setVec2("uvMax", rendered - 0.5f * texel);
+    shader->setFloat("sharpness", sharpness);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, source);
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+}
+
+void DynamicResolution::printReport() const {
+    if (!enabled || frames == 0) {
+        return;
+    }
+    printf("INFO: Dynamic resolution over %llu frames: average scale %.0f%%, lowest %.0f%% (range %.0f-%.0f%%, "
+           "target %.2f ms of GPU time); %llu changes\n", frames, 100.0 * scaleSum / (double) frames,
+           100.0f * lowestScale, 100.0f * minScale, 100.0f * maxScale, targetMs, changes);
+}
@@ -0,0 +1,110 @@
+#ifndef DYNAMICRESOLUTION_H
+#define DYNAMICRESOLUTION_H
+
+#include "opengl.h"
+#include "shader.h"
+
+// Default range of the render scale, a factor of the window's width and height:
+const float DYNAMIC_RESOLUTION_MIN_SCALE = 0.5f;
+const float DYNAMIC_RESOLUTION_MAX_SCALE = 1.0f;
+
+// GPU time per frame the scale aims for by default (60 FPS):
+const float DYNAMIC_RESOLUTION_TARGET_MS = 1000.0f / 60.0f;
+
+// Frames between changes of the scale. Longer than the profiler's readback delay, so each change is measured
+// before the next:
+const int DYNAMIC_RESOLUTION_INTERVAL = 8;
+
+// Weight of a new GPU time in the smoothed one:
+const float DYNAMIC_RESOLUTION_SMOOTHING = 0.2f;
+
+// Share of the target the scale aims under, so noise doesn't push frames over it. The scale only goes up again
+// once frames take less than RAISE_BELOW of that, so it doesn't swing back and forth around the target:
+const float DYNAMIC_RESOLUTION_HEADROOM = 0.9f;
+const float DYNAMIC_RESOLUTION_RAISE_BELOW = 0.85f;
+
+// Largest change of the scale at once, relative to it:
+const float DYNAMIC_RESOLUTION_MAX_STEP = 0.15f;
+
+// Renders the main pass into an offscreen target whose resolution follows the GPU's load, then upscales it to the
+// window with contrast-adaptive sharpening (after AMD's FidelityFX CAS), which restores some of the detail the
+// bilinear upscale blurs without ringing at edges.
+//
+// The target, a transient texture of the frame graph (see framegraph.h), has the size of the window at the
+// largest scale and the pass renders into its lower left corner, so changing the scale only changes the
+// viewport. Every DYNAMIC_RESOLUTION_INTERVAL frames the scale moves toward
+// the one that would fit the smoothed GPU time of a frame in the target, taking GPU time to grow with the pixels
+// drawn (the square of the scale). Costs that don't scale make it undershoot, which the next changes correct.
+class DynamicResolution {
+public:
+    DynamicResolution();
+
+    // Compiles the upscale shader; call on the context thread. Returns false if it fails.
+    bool init();
+
+    void destroy();
+
+    void setEnabled(bool enabled) { this->enabled = enabled; }
+
+    bool isEnabled() const { return enabled; }
+
+    // Limits the scale to [minScale, maxScale] (at most 1), starting at maxScale:
+    void setScaleRange(float minScale, float maxScale);
+
+    void setTargetMs(float ms) { targetMs = ms; }
+
+    float getTargetMs() const { return targetMs; }
+
+    // Strength of the sharpening, from 0 (bilinear upscale only) to 1:
+    void setSharpness(float sharpness);
+
+    // Feeds the GPU time of a frame, in milliseconds (0 if none was measured), and adjusts the scale when due.
+    void update(double gpuMs);
+
+    // Sets the size of the window the frame is drawn for:
+    void setWindowSize(int width, int height);
+
+    // Size of the target, the window at the largest scale:
+    int getTargetWidth() const;
+
+    int getTargetHeight() const;
+
+    // Size of the pass at the current scale:
+    int getRenderWidth() const;
+
+    int getRenderHeight() const;
+
+    float getScale() const { return scale; }
+
+    // Upscales what the pass rendered into source, the target, into the bound framebuffer, filling its viewport:
+    void resolve(GLuint source);
+
+    // Prints the scale over the whole run.
+    void printReport() const;
+
+private:
+    bool enabled;
+    float minScale;
+    float maxScale;
+    float targetMs;
+    float sharpness;
+    float scale;
+    double smoothedMs;
+    int framesSinceChange;
+
+    Shader *shader;
+    GLuint vao; // empty: the fullscreen triangle comes from gl_VertexID
+    int windowWidth;
+    int windowHeight;
+
+    // Over the whole run:
+    double scaleSum;
+    unsigned long long frames;
+    float lowestScale;
+    unsigned long long changes;
+};
+
+// The application's dynamic resolution:
+extern DynamicResolution dynamicResolution;
+
+#endif //DYNAMICRESOLUTION_H
@@ -0,0 +1,149 @@
+#include "framebenchmark.h"
+#include "renderstats.h"
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+CameraPath::CameraPath(const std::vector<glm::vec3> &keys, const glm::vec3 &target) {
+    this->keys = keys;
+    this->target = target;
+}
+
+CameraPath CameraPath::deskFlyby() {
+    return CameraPath({
+                              glm::vec3(0.0f, 0.0f, 3.0f),     // the interactive start position
+                              glm::vec3(4.5f, 0.5f, -1.0f),
+                              glm::vec3(6.0f, 1.5f, -6.0f),
+                              glm::vec3(0.0f, 2.0f, -11.0f),   // behind the monitor
+                              glm::vec3(-6.0f, 0.5f, -6.0f),
+                              glm::vec3(-3.0f, -0.5f, -2.0f),
+                              glm::vec3(0.0f, -0.8f, -2.8f),   // close to the screen
+                      }, glm::vec3(0.0f, -1.2f, -5.0f));
+}
+
+void CameraPath::apply(Camera *camera, float t) const {
+    // Segment and position within it:
+    int count = (int) keys.size();
+    float scaled = (t - std::floor(t)) * (float) count;
+    int segment = std::min((int) scaled, count - 1);
+    float u = scaled - (float) segment;
+
+    const glm::vec3 &p0 = keys[(segment + count - 1) % count];
+    const glm::vec3 &p1 = keys[segment];
+    const glm::vec3 &p2 = keys[(segment + 1) % count];
+    const glm::vec3 &p3 = keys[(segment + 2) % count];
+
+    // Uniform Catmull-Rom:
+    float u2 = u * u;
+    float u3 = u2 * u;
+    glm::vec3 position = 0.5f * ((2.0f * p1) + (p2 - p0) * u + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u2 +
+                                 (3.0f * p1 - p0 - 3.0f * p2 + p3) * u3);
+    camera->lookAt(position, target);
+}
+
+FrameBenchmark::FrameBenchmark(int frames) {
+    this->frames = std::max(frames, 1);
+    frame = 0;
+    glGenQueries(BENCHMARK_QUERY_FRAMES, queries);
+    for (int &queryFrame : queryFrames) {
+        queryFrame = -1;
+    }
+    cpuMs.reserve(this->frames);
+    gpuMs.assign(this->frames, 0.0);
+    drawCalls.reserve(this->frames);
+    triangles.reserve(this->frames);
+}
+
+void FrameBenchmark::destroy() {
+    glDeleteQueries(BENCHMARK_QUERY_FRAMES, queries);
+}
+
+float FrameBenchmark::getPathTime() const {
+    return (float) std::max(frame - BENCHMARK_WARMUP_FRAMES, 0) / (float) frames;
+}
+
+void FrameBenchmark::readQuery(int slot) {
+    if (queryFrames[slot] < 0) {
+        return;
+    }
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &elapsed);
+    gpuMs[queryFrames[slot]] = (double) elapsed / 1.0e6;
+    queryFrames[slot] = -1;
+}
+
+void FrameBenchmark::beginFrame() {
+    renderStats.reset();
+    frameStart = std::chrono::high_resolution_clock::now();
+
+    // Reuse the oldest query, reading the frame it timed first:
+    int slot = frame % BENCHMARK_QUERY_FRAMES;
+    readQuery(slot);
+    glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+}
+
+void FrameBenchmark::endFrame() {
+    int slot = frame % BENCHMARK_QUERY_FRAMES;
+    glEndQuery(GL_TIME_ELAPSED);
+
+    int measured = frame - BENCHMARK_WARMUP_FRAMES;
+    if (measured >= 0) {
+        queryFrames[slot] = measured;
+        cpuMs.push_back(std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - frameStart).count());
+        drawCalls.push_back((double) renderStats.drawCalls);
+        triangles.push_back((double) renderStats.triangles);
+    }
+    ++frame;
+}
+
+// Writes "name": {mean, percentiles and max} of samples:
+static void writeStats(FILE *file, const char *name, std::vector<double> samples, bool last) {
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double sample : samples) {
+        sum += sample;
+    }
+    // Nearest-rank percentile:
+    auto percentile = [&samples](double p) {
+        size_t rank = (size_t) std::ceil(p / 100.0 * (double) samples.size());
+        return samples[std::min(std::max(rank, (size_t) 1), samples.size()) - 1];
+    };
+    fprintf(file, "  \"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p95\": %.4f, \"p99\": %.4f, "
+                  "\"max\": %.4f}%s\n", name, sum / (double) samples.size(), percentile(50.0), percentile(90.0),
+            percentile(95.0), percentile(99.0), samples.back(), last ? "" : ",");
+}
+
+bool FrameBenchmark::writeJson(const char *path, const char *context, int width, int height, int instances) {
+    for (int slot = 0; slot < BENCHMARK_QUERY_FRAMES; ++slot) {
+        readQuery(slot);
+    }
+    if (cpuMs.empty()) {
+        printf("ERROR: No benchmark frames were rendered\n");
+        return false;
+    }
+
+    FILE *file = fopen(path, "w");
+    if (file == nullptr) {
+        printf("ERROR: Failed to write %s\n", path);
+        return false;
+    }
+    fprintf(file, "{\n");
+    fprintf(file, "  \"frames\": %d,\n", (int) cpuMs.size());
+    fprintf(file, "  \"width\": %d,\n", width);
+    fprintf(file, "  \"height\": %d,\n", height);
+    fprintf(file, "  \"context\": \"%s\",\n", context);
+    fprintf(file, "  \"instances\": %d,\n", instances);
+    fprintf(file, "  \"renderer\": \"%s\",\n", (const char *) glGetString(GL_RENDERER));
+    fprintf(file, "  \"version\": \"%s\",\n", (const char *) glGetString(GL_VERSION));
+    writeStats(file, "cpuFrameMs", cpuMs, false);
+    writeStats(file, "gpuFrameMs", gpuMs, false);
+    writeStats(file, "drawCalls", drawCalls, false);
+    writeStats(file, "triangles", triangles, true);
+    fprintf(file, "}\n");
+    fclose(file);
+
+    printf("INFO: Benchmark of %d frames written to %s\n", (int) cpuMs.size(), path);
+    return true;
+}
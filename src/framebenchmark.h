@@ -0,0 +1,70 @@
+#ifndef FRAMEBENCHMARK_H
+#define FRAMEBENCHMARK_H
+
+#include <chrono>
+#include <vector>
+#include "opengl.h"
+#include "camera.h"
+
+// Frames rendered before measuring, so shader compilation and first uploads don't count:
+const int BENCHMARK_WARMUP_FRAMES = 10;
+
+// GPU timer queries in flight; a query is read back this many frames after it was issued, when the GPU
+// is long done with it, so reading never stalls:
+const int BENCHMARK_QUERY_FRAMES = 4;
+
+// A closed camera path: a Catmull-Rom spline through key positions, always facing a target.
+class CameraPath {
+public:
+    CameraPath(const std::vector<glm::vec3> &keys, const glm::vec3 &target);
+
+    // The default path: a loop around the desk that dips in close to the monitor.
+    static CameraPath deskFlyby();
+
+    // Places the camera at t in [0, 1) along the path:
+    void apply(Camera *camera, float t) const;
+
+private:
+    std::vector<glm::vec3> keys;
+    glm::vec3 target;
+};
+
+// Runs the scene for a fixed number of frames along a camera path, recording CPU and GPU frame times,
+// draw calls and triangles, and writes the summary as JSON.
+class FrameBenchmark {
+public:
+    explicit FrameBenchmark(int frames);
+
+    // Releases the timer queries.
+    void destroy();
+
+    // Checks if every measured frame has been rendered.
+    bool finished() const { return frame >= BENCHMARK_WARMUP_FRAMES + frames; }
+
+    // Position along the camera path of the frame being rendered, in [0, 1):
+    float getPathTime() const;
+
+    // Brackets a frame, from before input/update to after the buffer swap:
+    void beginFrame();
+
+    void endFrame();
+
+    // Waits for the outstanding GPU timings and writes the summary, noting the desk setups drawn. Returns false
+    // if the file can't be written.
+    bool writeJson(const char *path, const char *context, int width, int height, int instances);
+
+private:
+    void readQuery(int slot);
+
+    int frames;
+    int frame;
+    std::chrono::high_resolution_clock::time_point frameStart;
+    std::vector<double> cpuMs;
+    std::vector<double> gpuMs;
+    std::vector<double> drawCalls;
+    std::vector<double> triangles;
+    GLuint queries[BENCHMARK_QUERY_FRAMES];
+    int queryFrames[BENCHMARK_QUERY_FRAMES]; // measured frame each query belongs to, -1 if none
+};
+
+#endif //FRAMEBENCHMARK_H
@@ -0,0 +1,419 @@
+#include "framegraph.h"
+#include "profiler.h"
+#include "renderstats.h"
+
+#include <algorithm>
+#include <cstdio>
+
+static bool isDepthFormat(GLenum format) {
+    return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32 ||
+           format == GL_DEPTH_COMPONENT32F || format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+static bool hasStencil(GLenum format) {
+    return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+static long long getTextureBytes(const FrameGraphTextureDesc &desc) {
+    long long texelBytes = 4;
+    switch (desc.format) {
+        case GL_R8:
+            texelBytes = 1;
+            break;
+        case GL_RG8:
+        case GL_DEPTH_COMPONENT16:
+            texelBytes = 2;
+            break;
+        case GL_RGBA16F:
+        case GL_DEPTH32F_STENCIL8:
+            texelBytes = 8;
+            break;
+        case GL_RGBA32F:
+            texelBytes = 16;
+            break;
+        default:
+            break;
+    }
+    return (long long) desc.width * desc.height * texelBytes;
+}
+
+static bool operator==(const FrameGraphTextureDesc &a, const FrameGraphTextureDesc &b) {
+    return a.width == b.width && a.height == b.height && a.format == b.format;
+}
+
+FrameGraph::FrameGraph() {
+    frame = 0;
+    culledPasses = 0;
+    transientBytes = 0;
+    allocatedBytes = 0;
+}
+
+void FrameGraph::destroy() {
+    for (CachedFramebuffer &cached : framebuffers) {
+        glDeleteFramebuffers(1, &cached.framebuffer);
+    }
+    framebuffers.clear();
+    for (PooledTexture &pooled : pool) {
+        glDeleteTextures(1, &pooled.texture);
+        memoryStats.textureBytes -= getTextureBytes(pooled.desc);
+    }
+    pool.clear();
+    reset();
+}
+
+void FrameGraph::reset() {
+    resources.clear();
+    passes.clear();
+    order.clear();
+}
+
+int FrameGraph::createTexture(const std::string &name, const FrameGraphTextureDesc &desc) {
+    resources.push_back({name, desc, 0, false, false, false, -1, -1});
+    return (int) resources.size() - 1;
+}
+
+int FrameGraph::importTexture(const std::string &name, GLuint texture, int width, int height) {
+    resources.push_back({name, {width, height, GL_NONE}, texture, true, false, false, -1, -1});
+    return (int) resources.size() - 1;
+}
+
+int FrameGraph::importWindow(int width, int height) {
+    resources.push_back({"window", {width, height, GL_NONE}, 0, true, true, false, -1, -1});
+    return (int) resources.size() - 1;
+}
+
+void FrameGraph::markOutput(int resource) {
+    resources[resource].output = true;
+}
+
+int FrameGraph::addPass(const std::string &name, const std::vector<int> &reads, const std::vector<int> &writes,
+                        const FrameGraphExecute &execute) {
+    passes.push_back({name, reads, writes, execute, std::vector<int>(), 0, false});
+    return (int) passes.size() - 1;
+}
+
+void FrameGraph::addDependencies() {
+    for (Pass &pass : passes) {
+        pass.dependencies.clear();
+    }
+    auto uses = [](const std::vector<int> &list, int resource) {
+        return std::find(list.begin(), list.end(), resource) != list.end();
+    };
+    auto depend = [this](int pass, int dependency) {
+        if (pass != dependency) {
+            passes[pass].dependencies.push_back(dependency);
+        }
+    };
+    for (int resource = 0; resource < (int) resources.size(); ++resource) {
+        std::vector<int> writers;
+        std::vector<int> readers;
+        for (int pass = 0; pass < (int) passes.size(); ++pass) {
+            if (uses(passes[pass].writes, resource)) {
+                writers.push_back(pass);
+            }
+            if (uses(passes[pass].reads, resource)) {
+                readers.push_back(pass);
+            }
+        }
+
+        // Writers in the order they were added:
+        for (size_t i = 1; i < writers.size(); ++i) {
+            depend(writers[i], writers[i - 1]);
+        }
+
+        // A reader sees the contents of the last writer added before it, or those of every writer if it came
+        // first; the writer after that one replaces them, so it waits for the reader:
+        for (int reader : readers) {
+            auto next = std::lower_bound(writers.begin(), writers.end(), reader);
+            if (next == writers.begin()) {
+                for (int writer : writers) {
+                    depend(reader, writer);
+                }
+                continue;
+            }
+            depend(reader, *(next - 1));
+            if (next != writers.end() && *next == reader) {
+                ++next;
+            }
+            if (next != writers.end()) {
+                depend(*next, reader);
+            }
+        }
+    }
+}
+
+bool FrameGraph::sortPasses(std::vector<int> &sorted) const {
+    // Kahn's algorithm, taking the ready pass added first each time so independent passes keep their order:
+    std::vector<int> pending(passes.size(), 0);
+    std::vector<std::vector<int>> dependents(passes.size());
+    for (int pass = 0; pass < (int) passes.size(); ++pass) {
+        for (int dependency : passes[pass].dependencies) {
+            ++pending[pass];
+            dependents[dependency].push_back(pass);
+        }
+    }
+    std::vector<bool> done(passes.size(), false);
+    sorted.clear();
+    while (sorted.size() < passes.size()) {
+        int next = -1;
+        for (int pass = 0; pass < (int) passes.size() && next < 0; ++pass) {
+            if (!done[pass] && pending[pass] == 0) {
+                next = pass;
+            }
+        }
+        if (next < 0) {
+            return false;
+        }
+        done[next] = true;
+        sorted.push_back(next);
+        for (int dependent : dependents[next]) {
+            --pending[dependent];
+        }
+    }
+    return true;
+}
+
+bool FrameGraph::compile() {
+    ++frame;
+    order.clear();
+    culledPasses = 0;
+    addDependencies();
+    std::vector<int> sorted;
+    if (!sortPasses(sorted)) {
+        printf("ERROR: The passes of the frame graph depend on each other in a cycle\n");
+        return false;
+    }
+
+    // Cull from the outputs back: a pass is kept if a resource it writes is needed, and then needs its reads:
+    std::vector<bool> needed(resources.size(), false);
+    for (size_t resource = 0; resource < resources.size(); ++resource) {
+        needed[resource] = resources[resource].output;
+    }
+    for (auto pass = sorted.rbegin(); pass != sorted.rend(); ++pass) {
+        Pass &current = passes[*pass];
+        current.live = false;
+        for (int resource : current.writes) {
+            current.live = current.live || needed[resource];
+        }
+        if (current.live) {
+            for (int resource : current.reads) {
+                needed[resource] = true;
+            }
+        }
+    }
+    for (int pass : sorted) {
+        if (passes[pass].live) {
+            order.push_back(pass);
+        }
+    }
+    culledPasses = (int) (passes.size() - order.size());
+
+    // Lifetimes of the transient textures, in positions of the execution order:
+    for (int position = 0; position < (int) order.size(); ++position) {
+        const Pass &pass = passes[order[position]];
+        for (const std::vector<int> *list : {&pass.reads, &pass.writes}) {
+            for (int resource : *list) {
+                Resource &used = resources[resource];
+                if (used.firstUse < 0) {
+                    used.firstUse = position;
+                }
+                used.lastUse = position;
+            }
+        }
+    }
+
+    // Hand out pooled textures at the first use and take them back after the last, so textures whose lifetimes
+    // don't overlap share one:
+    for (PooledTexture &pooled : pool) {
+        pooled.inUse = false;
+    }
+    transientBytes = 0;
+    allocatedBytes = 0;
+    for (int position = 0; position < (int) order.size(); ++position) {
+        for (Resource &resource : resources) {
+            if (!resource.imported && resource.firstUse == position) {
+                resource.texture = acquireTexture(resource.desc);
+                transientBytes += getTextureBytes(resource.desc);
+            }
+        }
+        for (Resource &resource : resources) {
+            if (!resource.imported && resource.lastUse == position) {
+                releaseTexture(resource.texture);
+            }
+        }
+    }
+    for (const PooledTexture &pooled : pool) {
+        if (pooled.lastFrame == frame) {
+            allocatedBytes += getTextureBytes(pooled.desc);
+        }
+    }
+
+    // Framebuffers of the passes that render into textures:
+    for (int pass : order) {
+        Pass &current = passes[pass];
+        current.framebuffer = 0;
+        bool toWindow = false;
+        for (int resource : current.writes) {
+            toWindow = toWindow || resources[resource].window;
+        }
+        if (toWindow && current.writes.size() > 1) {
+            printf("ERROR: Pass %s renders into the window and textures\n", current.name.c_str());
+            return false;
+        }
+        if (!toWindow && !current.writes.empty()) {
+            current.framebuffer = getFramebuffer(current);
+            if (current.framebuffer == 0) {
+                return false;
+            }
+        }
+    }
+    releaseUnused();
+    return true;
+}
+
+void FrameGraph::execute() {
+    for (int pass : order) {
+        Pass &current = passes[pass];
+        CpuProfileScope cpuScope(current.name.c_str());
+        GpuProfileScope gpuScope(current.name.c_str());
+        if (!current.writes.empty()) {
+            const Resource &target = resources[current.writes[0]];
+            glBindFramebuffer(GL_FRAMEBUFFER, current.framebuffer);
+            glViewport(0, 0, target.desc.width, target.desc.height);
+        }
+        current.execute(*this);
+    }
+}
+
+GLuint FrameGraph::getTexture(int resource) const {
+    return resources[resource].texture;
+}
+
+GLuint FrameGraph::getPassFramebuffer(int pass) const {
+    return passes[pass].framebuffer;
+}
+
+GLuint FrameGraph::acquireTexture(const FrameGraphTextureDesc &desc) {
+    for (PooledTexture &pooled : pool) {
+        if (!pooled.inUse && pooled.desc == desc) {
+            pooled.inUse = true;
+            pooled.lastFrame = frame;
+            return pooled.texture;
+        }
+    }
+
+    GLuint texture = 0;
+    GLenum format = GL_RGBA;
+    GLenum type = GL_UNSIGNED_BYTE;
+    if (isDepthFormat(desc.format)) {
+        format = hasStencil(desc.format) ? GL_DEPTH_STENCIL : GL_DEPTH_COMPONENT;
+        type = desc.format == GL_DEPTH24_STENCIL8 ? GL_UNSIGNED_INT_24_8 :
+               desc.format == GL_DEPTH32F_STENCIL8 ? GL_FLOAT_32_UNSIGNED_INT_24_8_REV : GL_FLOAT;
+    }
+    GLint filter = isDepthFormat(desc.format) ? GL_NEAREST : GL_LINEAR;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, desc.format, desc.width, desc.height, 0, format, type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    memoryStats.textureBytes += getTextureBytes(desc);
+    pool.push_back({desc, texture, frame, true});
+    return texture;
+}
+
+void FrameGraph::releaseTexture(GLuint texture) {
+    for (PooledTexture &pooled : pool) {
+        if (pooled.texture == texture) {
+            pooled.inUse = false;
+        }
+    }
+}
+
+GLuint FrameGraph::getFramebuffer(const Pass &pass) {
+    std::vector<GLuint> attachments;
+    for (int resource : pass.writes) {
+        attachments.push_back(resources[resource].texture);
+    }
+    for (CachedFramebuffer &cached : framebuffers) {
+        if (cached.attachments == attachments) {
+            cached.lastFrame = frame;
+            return cached.framebuffer;
+        }
+    }
+
+    // Colors in the order of the writes, and the depth buffer, if any:
+    GLuint framebuffer = 0;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    std::vector<GLenum> drawBuffers;
+    for (int resource : pass.writes) {
+        const Resource &target = resources[resource];
+        GLenum attachment = GL_COLOR_ATTACHMENT0 + (GLenum) drawBuffers.size();
+        if (isDepthFormat(target.desc.format)) {
+            attachment = hasStencil(target.desc.format) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        } else {
+            drawBuffers.push_back(attachment);
+        }
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, target.texture, 0);
+    }
+    if (drawBuffers.empty()) {
+        glDrawBuffer(GL_NONE);
+    } else {
+        glDrawBuffers((GLsizei) drawBuffers.size(), drawBuffers.data());
+    }
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        printf("ERROR: The framebuffer of pass %s is incomplete\n", pass.name.c_str());
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &framebuffer);
+        return 0;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    framebuffers.push_back({attachments, framebuffer, frame});
+    return framebuffer;
+}
+
+void FrameGraph::releaseUnused() {
+    std::vector<GLuint> deleted;
+    for (auto pooled = pool.begin(); pooled != pool.end();) {
+        if (pooled->lastFrame + FRAME_GRAPH_KEEP_FRAMES < frame) {
+            glDeleteTextures(1, &pooled->texture);
+            memoryStats.textureBytes -= getTextureBytes(pooled->desc);
+            deleted.push_back(pooled->texture);
+            pooled = pool.erase(pooled);
+        } else {
+            ++pooled;
+        }
+    }
+
+    // Framebuffers go with their textures, or once unused as long:
+    for (auto cached = framebuffers.begin(); cached != framebuffers.end();) {
+        bool stale = cached->lastFrame + FRAME_GRAPH_KEEP_FRAMES < frame;
+        for (GLuint texture : deleted) {
+            stale = stale || std::find(cached->attachments.begin(), cached->attachments.end(), texture) !=
+                             cached->attachments.end();
+        }
+        if (stale) {
+            glDeleteFramebuffers(1, &cached->framebuffer);
+            cached = framebuffers.erase(cached);
+        } else {
+            ++cached;
+        }
+    }
+}
+
+void FrameGraph::printReport() const {
+    std::string ran;
+    for (int pass : order) {
+        ran += (ran.empty() ? "" : ", ") + passes[pass].name;
+    }
+    if (ran.empty()) {
+        ran = "no passes";
+    }
+    printf("INFO: Frame graph of the last frame ran %s (%d of %d passes culled); transient targets %.1f MB, "
+           "%.1f MB with aliasing\n", ran.c_str(), culledPasses, (int) passes.size(),
+           (double) transientBytes / 1048576.0, (double) allocatedBytes / 1048576.0);
+}
@@ -0,0 +1,152 @@
+#ifndef FRAMEGRAPH_H
+#define FRAMEGRAPH_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "opengl.h"
+
+// Frames a pooled texture or framebuffer may go unused before it is deleted, e.g. once the window was resized:
+const int FRAME_GRAPH_KEEP_FRAMES = 3;
+
+// Size and format of a transient texture. Transient textures of equal descriptions share memory when their
+// lifetimes don't overlap.
+struct FrameGraphTextureDesc {
+    int width;
+    int height;
+    GLenum format; // sized internal format: GL_SRGB8_ALPHA8, GL_RGBA16F, GL_DEPTH_COMPONENT24, ...
+};
+
+class FrameGraph;
+
+// The work of a pass, called with its target bound and the viewport covering it:
+typedef std::function<void(FrameGraph &)> FrameGraphExecute;
+
+// The render passes of a frame and the textures they read and write, described anew every frame. Compiling the
+// graph orders the passes after the ones whose output they read, culls the passes whose outputs nothing needs
+// and gives every transient texture memory for the passes between its first and last use only. GL can't place
+// textures in shared memory, so aliasing reuses whole texture objects: a transient texture takes a pooled one
+// of its description that no pass between its first and last use needs. The pool lives across frames, and
+// textures it hasn't handed out for FRAME_GRAPH_KEEP_FRAMES frames are deleted.
+//
+// Textures that live outside the graph (whose contents last across frames) and the window are imported. Passes
+// keep their declared order where their reads and writes allow it: writers of a resource run in the order they
+// were added, a reader after the writers added before it (or after every writer, if all were added after it),
+// and a writer after the readers of the contents it replaces. Use it on the context thread only.
+class FrameGraph {
+public:
+    FrameGraph();
+
+    // Deletes the pooled textures and the framebuffers.
+    void destroy();
+
+    // Starts describing a frame, dropping the passes and resources of the last one:
+    void reset();
+
+    // A texture the graph allocates for this frame only; returns its id. Its contents are undefined until a pass
+    // writes it.
+    int createTexture(const std::string &name, const FrameGraphTextureDesc &desc);
+
+    // A texture that lives outside the graph:
+    int importTexture(const std::string &name, GLuint texture, int width, int height);
+
+    // The window's framebuffer, width x height pixels:
+    int importWindow(int width, int height);
+
+    // Keeps the passes writing a resource, and those they depend on, although no pass reads it:
+    void markOutput(int resource);
+
+    // Adds a pass and returns its id. It renders into its writes, which must have the same size, or into the
+    // window alone; a pass without writes gets no framebuffer bound.
+    int addPass(const std::string &name, const std::vector<int> &reads, const std::vector<int> &writes,
+                const FrameGraphExecute &execute);
+
+    // Orders and culls the passes and assigns the transient textures memory. Returns false if the passes depend
+    // on each other in a cycle, or a framebuffer can't be built.
+    bool compile();
+
+    // Runs the passes kept by compile in order, each in a CPU and GPU profiler scope of its name.
+    void execute();
+
+    // The GL texture of a resource, while the passes using it run:
+    GLuint getTexture(int resource) const;
+
+    // The framebuffer a pass renders into (0 for the window), e.g. to read it back or blit from it:
+    GLuint getPassFramebuffer(int pass) const;
+
+    // Of the last compile:
+    int getPassCount() const { return (int) passes.size(); }
+
+    int getCulledCount() const { return culledPasses; }
+
+    // Bytes the frame's transient textures would take each on their own, and take with aliasing:
+    long long getTransientBytes() const { return transientBytes; }
+
+    long long getAllocatedBytes() const { return allocatedBytes; }
+
+    // Prints the passes and the transient memory of the last frame.
+    void printReport() const;
+
+private:
+    struct Resource {
+        std::string name;
+        FrameGraphTextureDesc desc;
+        GLuint texture;    // imported, or assigned by compile (0 for the window)
+        bool imported;
+        bool window;
+        bool output;
+        int firstUse;      // position in the execution order of the first and last pass using it, -1 if none
+        int lastUse;
+    };
+
+    struct Pass {
+        std::string name;
+        std::vector<int> reads;
+        std::vector<int> writes;
+        FrameGraphExecute execute;
+        std::vector<int> dependencies;
+        GLuint framebuffer; // 0 for the window or no writes
+        bool live;
+    };
+
+    struct PooledTexture {
+        FrameGraphTextureDesc desc;
+        GLuint texture;
+        unsigned long long lastFrame; // handed out last
+        bool inUse;
+    };
+
+    struct CachedFramebuffer {
+        std::vector<GLuint> attachments;
+        GLuint framebuffer;
+        unsigned long long lastFrame;
+    };
+
+    void addDependencies();
+
+    // Passes in execution order (every pass, culled ones included); false on a cycle:
+    bool sortPasses(std::vector<int> &sorted) const;
+
+    // A pooled texture of desc that isn't in use, created if there is none:
+    GLuint acquireTexture(const FrameGraphTextureDesc &desc);
+
+    void releaseTexture(GLuint texture);
+
+    // A framebuffer with the pass's writes attached; 0 if it can't be completed:
+    GLuint getFramebuffer(const Pass &pass);
+
+    // Deletes the textures and framebuffers unused for FRAME_GRAPH_KEEP_FRAMES frames:
+    void releaseUnused();
+
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<int> order; // the live passes, in execution order
+    std::vector<PooledTexture> pool;
+    std::vector<CachedFramebuffer> framebuffers;
+    unsigned long long frame;
+    int culledPasses;
+    long long transientBytes;
+    long long allocatedBytes;
+};
+
+#endif //FRAMEGRAPH_H
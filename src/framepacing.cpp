@@ -0,0 +1,163 @@
+#include "framepacing.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+FramePacer framePacer;
+
+FramePacer::FramePacer() {
+    frameInterval = 0.0;
+    nextFrameTime = 0.0;
+    lateLatching = false;
+    latchedTime = 0.0;
+    for (PresentQuery &present : presents) {
+        present.query = 0;
+        present.inputTime = 0.0;
+        present.clockOffset = 0.0;
+        present.pending = false;
+    }
+    presentIndex = 0;
+    queriesCreated = false;
+    std::fill(latencies, latencies + PACING_LATENCY_SAMPLES, 0.0f);
+    latencyCount = 0;
+    latencySum = 0.0;
+    latencyMax = 0.0f;
+    droppedPresents = 0;
+}
+
+void FramePacer::destroy() {
+    if (queriesCreated) {
+        for (PresentQuery &present : presents) {
+            glDeleteQueries(1, &present.query);
+            present.query = 0;
+            present.pending = false;
+        }
+        queriesCreated = false;
+    }
+}
+
+void FramePacer::setFrameCap(double fps) {
+    frameInterval = fps > 0.0 ? 1.0 / fps : 0.0;
+}
+
+void FramePacer::waitForNextFrame() {
+    if (frameInterval <= 0.0) {
+        return;
+    }
+    double now = glfwGetTime();
+    if (nextFrameTime == 0.0 || now - nextFrameTime > frameInterval) {
+        // The first frame, or one that ran over by a whole interval: start the schedule again rather than rush
+        nextFrameTime = now;
+    }
+
+    // Handle events while most of the wait is slept, then spin out the rest:
+    while (nextFrameTime - now > PACING_SPIN_SECONDS) {
+        glfwWaitEventsTimeout(nextFrameTime - now - PACING_SPIN_SECONDS);
+        now = glfwGetTime();
+    }
+    while (glfwGetTime() < nextFrameTime) {
+        std::this_thread::yield();
+    }
+    nextFrameTime += frameInterval;
+}
+
+void FramePacer::latchCamera(Camera &camera, double time) {
+    if (!lateLatching) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(latchMutex);
+    latchedCamera = camera;
+    latchedTime = time;
+}
+
+bool FramePacer::lateLatch(FrameSnapshot &frame) {
+    std::lock_guard<std::mutex> lock(latchMutex);
+    if (latchedTime <= frame.inputTime) {
+        return false;
+    }
+    frame.camera = latchedCamera;
+    frame.inputTime = latchedTime;
+    frame.view = frame.camera.getView();
+    frame.projection = frame.camera.getProjection();
+    return true;
+}
+
+void FramePacer::markPresent(double inputTime) {
+    if (!queriesCreated) {
+        for (PresentQuery &present : presents) {
+            glGenQueries(1, &present.query);
+        }
+        queriesCreated = true;
+    }
+
+    // Read back the presents the GPU has passed, oldest first:
+    for (int i = 1; i <= PACING_PRESENT_QUERIES; ++i) {
+        PresentQuery &present = presents[(presentIndex + i) % PACING_PRESENT_QUERIES];
+        if (!present.pending) {
+            continue;
+        }
+        GLint available = 0;
+        glGetQueryObjectiv(present.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 gpuTime = 0;
+            glGetQueryObjectui64v(present.query, GL_QUERY_RESULT, &gpuTime);
+            double presentTime = (double) gpuTime / 1.0e9 + present.clockOffset;
+            addLatency((float) ((presentTime - present.inputTime) * 1000.0));
+            present.pending = false;
+        }
+    }
+
+    // Time this present with the next query, dropping the one it still holds:
+    presentIndex = (presentIndex + 1) % PACING_PRESENT_QUERIES;
+    PresentQuery &present = presents[presentIndex];
+    if (present.pending) {
+        ++droppedPresents;
+    }
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    present.clockOffset = glfwGetTime() - (double) gpuNow / 1.0e9;
+    present.inputTime = inputTime;
+    present.pending = true;
+    glQueryCounter(present.query, GL_TIMESTAMP);
+}
+
+void FramePacer::addLatency(float ms) {
+    latencies[latencyCount % PACING_LATENCY_SAMPLES] = ms;
+    ++latencyCount;
+    latencySum += ms;
+    latencyMax = std::max(latencyMax, ms);
+}
+
+float FramePacer::getAverageLatencyMs() const {
+    int count = std::min(latencyCount, PACING_LATENCY_SAMPLES);
+    if (count == 0) {
+        return 0.0f;
+    }
+    float sum = 0.0f;
+    for (int i = 0; i < count; ++i) {
+        sum += latencies[i];
+    }
+    return sum / (float) count;
+}
+
+float FramePacer::getPercentileLatencyMs(float percentile) const {
+    int count = std::min(latencyCount, PACING_LATENCY_SAMPLES);
+    if (count == 0) {
+        return 0.0f;
+    }
+    float sorted[PACING_LATENCY_SAMPLES];
+    std::copy(latencies, latencies + count, sorted);
+    int rank = std::min(count - 1, (int) (percentile / 100.0f * (float) count));
+    std::nth_element(sorted, sorted + rank, sorted + count);
+    return sorted[rank];
+}
+
+void FramePacer::printReport() const {
+    if (latencyCount == 0) {
+        return;
+    }
+    printf("INFO: Input-to-present latency over %d frames: average %.2f ms, max %.2f ms (last %d: 95th percentile "
+           "%.2f ms); %llu presents not timed\n", latencyCount, latencySum / latencyCount, latencyMax,
+           std::min(latencyCount, PACING_LATENCY_SAMPLES), getPercentileLatencyMs(95.0f), droppedPresents);
+}
@@ -0,0 +1,95 @@
+#ifndef FRAMEPACING_H
+#define FRAMEPACING_H
+
+#include <chrono>
+#include <mutex>
+#include "opengl.h"
+#include "camera.h"
+#include "framequeue.h"
+
+// Presents timed at once; a present whose timestamp isn't back by the time its query is reused is dropped:
+const int PACING_PRESENT_QUERIES = 4;
+
+// Latest presents the latency average and percentile cover:
+const int PACING_LATENCY_SAMPLES = 240;
+
+// Left of a frame-cap wait that is spun rather than slept, since sleeps overshoot:
+const double PACING_SPIN_SECONDS = 0.001;
+
+// Paces frames and measures how long input takes to reach the screen. All times are on the GLFW clock.
+//
+// The main thread waits for the frame cap (if any) before it samples input, so input is as fresh as possible when
+// the frame is built, and keeps handling events while it waits. With late latching it also publishes the camera
+// every time input moves it; the render thread swaps that newest camera into a frame just before submitting it,
+// which takes the time the frame spent queued and built out of the camera's latency (objects are still culled
+// with the camera the frame was built with). The input-to-present latency of a frame runs from the sampling of
+// the input it shows to a GPU timestamp taken after its buffer swap, read back a few frames later so it never
+// stalls. It doesn't include the display's own scanout delay.
+class FramePacer {
+public:
+    FramePacer();
+
+    // Releases the timestamp queries; call on the context thread.
+    void destroy();
+
+    // Caps the frame rate at fps frames per second (0 for none):
+    void setFrameCap(double fps);
+
+    void setLateLatching(bool enabled) { lateLatching = enabled; }
+
+    bool isLateLatching() const { return lateLatching; }
+
+    // Main thread: waits until the next frame of the cap is due, handling events meanwhile.
+    void waitForNextFrame();
+
+    // Main thread: records the camera as moved by input at time, for late latching (does nothing without it).
+    void latchCamera(Camera &camera, double time);
+
+    // Render thread: swaps the camera last latched into the frame, if newer than the frame's input, with its
+    // view and projection. Returns false if the frame already had the newest camera.
+    bool lateLatch(FrameSnapshot &frame);
+
+    // Context thread, right after the swap: times the present of a frame whose input was sampled at inputTime,
+    // and reads back the presents timed before that have finished.
+    void markPresent(double inputTime);
+
+    // Input-to-present latency of the latest presents, in milliseconds (0 until the first is read back):
+    float getAverageLatencyMs() const;
+
+    float getPercentileLatencyMs(float percentile) const;
+
+    // Prints the latency over the whole run.
+    void printReport() const;
+
+private:
+    struct PresentQuery {
+        GLuint query;
+        double inputTime;
+        double clockOffset; // CPU time minus GPU time, in seconds
+        bool pending;
+    };
+
+    void addLatency(float ms);
+
+    double frameInterval; // seconds, 0 for no cap
+    double nextFrameTime;
+    bool lateLatching;
+
+    std::mutex latchMutex; // guards the latched camera, which the main thread writes and the render thread reads
+    Camera latchedCamera;
+    double latchedTime;
+
+    PresentQuery presents[PACING_PRESENT_QUERIES];
+    int presentIndex;
+    bool queriesCreated;
+    float latencies[PACING_LATENCY_SAMPLES];
+    int latencyCount;
+    double latencySum; // over the whole run
+    float latencyMax;
+    unsigned long long droppedPresents;
+};
+
+// The application's frame pacer:
+extern FramePacer framePacer;
+
+#endif //FRAMEPACING_H
@@ -0,0 +1,105 @@
+#include "framequeue.h"
+
+#include <algorithm>
+#include <chrono>
+
+FrameQueue::FrameQueue(int latency) {
+    latency = std::max(1, std::min(latency, MAX_FRAME_LATENCY));
+    for (int i = 0; i <= latency; ++i) {
+        slots.emplace_back(new FrameSnapshot());
+        slots.back()->number = 0;
+    }
+    states.assign(slots.size(), SLOT_FREE);
+    published = 0;
+    dropped = 0;
+    waitMs = 0.0;
+    closed = false;
+}
+
+FrameSnapshot *FrameQueue::beginWrite() {
+    return tryBeginWrite(-1.0);
+}
+
+FrameSnapshot *FrameQueue::tryBeginWrite(double timeoutMs) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto freeSlot = [this]() { return std::find(states.begin(), states.end(), SLOT_FREE); };
+    if (freeSlot() == states.end() && !closed) {
+        auto start = std::chrono::high_resolution_clock::now();
+        auto ready = [&]() { return closed || freeSlot() != states.end(); };
+        if (timeoutMs < 0.0) {
+            slotFreed.wait(lock, ready);
+        } else {
+            slotFreed.wait_for(lock, std::chrono::duration<double, std::milli>(timeoutMs), ready);
+        }
+        waitMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+    if (closed || freeSlot() == states.end()) {
+        return nullptr;
+    }
+    size_t slot = freeSlot() - states.begin();
+    states[slot] = SLOT_WRITING;
+    return slots[slot].get();
+}
+
+void FrameQueue::publish(FrameSnapshot *frame) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (slots[i].get() == frame) {
+            frame->number = ++published;
+            states[i] = SLOT_PUBLISHED;
+        }
+    }
+    framePublished.notify_one();
+}
+
+FrameSnapshot *FrameQueue::acquire() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // The snapshot drawn last is done with:
+    for (SlotState &state : states) {
+        if (state == SLOT_RENDERING) {
+            state = SLOT_FREE;
+            slotFreed.notify_one();
+        }
+    }
+    framePublished.wait(lock, [this]() {
+        return closed || std::find(states.begin(), states.end(), SLOT_PUBLISHED) != states.end();
+    });
+    if (closed) {
+        return nullptr;
+    }
+
+    // Take the newest and free the older ones:
+    int newest = -1;
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (states[i] == SLOT_PUBLISHED && (newest < 0 || slots[i]->number > slots[newest]->number)) {
+            newest = (int) i;
+        }
+    }
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (states[i] == SLOT_PUBLISHED && (int) i != newest) {
+            states[i] = SLOT_FREE;
+            ++dropped;
+            slotFreed.notify_one();
+        }
+    }
+    states[newest] = SLOT_RENDERING;
+    return slots[newest].get();
+}
+
+void FrameQueue::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    slotFreed.notify_all();
+    framePublished.notify_all();
+}
+
+unsigned long long FrameQueue::getDroppedCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return dropped;
+}
+
+double FrameQueue::getWaitMs() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return waitMs;
+}
@@ -0,0 +1,80 @@
+#ifndef FRAMEQUEUE_H
+#define FRAMEQUEUE_H
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "camera.h"
+#include "drawlist.h"
+
+// Most frames the main thread may run ahead of the render thread:
+const int MAX_FRAME_LATENCY = 4;
+
+// Everything the render thread needs of a frame, produced by the main thread after input and simulation, so
+// the two never share scene state while both run:
+struct FrameSnapshot {
+    DrawList drawList;     // the objects in view, resolved to draws
+    Camera camera;         // as it was after input
+    glm::mat4 view;        // of the camera, which late latching may replace (the draw list keeps the one culled with)
+    glm::mat4 projection;
+    double inputTime;      // when the input the camera follows was sampled, on the GLFW clock
+    int width;             // of the window, in pixels
+    int height;
+    float frameMs;         // since the previous snapshot, for the HUD graph
+    bool showHud;
+    bool screenMirror;     // the screen mirror state the objects are drawn in
+    unsigned long long number; // counts snapshots from 1
+};
+
+// Snapshots passed from the main thread to the render thread, in latency + 1 slots: the render thread draws one
+// while the main thread fills another, and up to latency - 1 more wait. The render thread always takes the
+// newest and drops older ones, so the screen never lags behind input by more than needed. Neither side waits
+// for the other, except the main thread once latency snapshots are published and unrendered.
+class FrameQueue {
+public:
+    explicit FrameQueue(int latency);
+
+    // Main thread: a snapshot to fill, waiting while every slot is taken. Null once the queue is closed.
+    FrameSnapshot *beginWrite();
+
+    // Main thread: like beginWrite, but gives up and returns null if no slot frees up within timeoutMs, so the
+    // caller can handle events meanwhile.
+    FrameSnapshot *tryBeginWrite(double timeoutMs);
+
+    // Main thread: hands the filled snapshot to the render thread.
+    void publish(FrameSnapshot *frame);
+
+    // Render thread: the newest published snapshot, waiting for one, and releases the one acquired before.
+    // Null once the queue is closed.
+    FrameSnapshot *acquire();
+
+    // Wakes both sides and makes them stop:
+    void close();
+
+    // Snapshots the render thread skipped for newer ones:
+    unsigned long long getDroppedCount();
+
+    // Milliseconds the main thread waited at the latency limit:
+    double getWaitMs();
+
+private:
+    enum SlotState {
+        SLOT_FREE,
+        SLOT_WRITING,
+        SLOT_PUBLISHED,
+        SLOT_RENDERING
+    };
+
+    std::vector<std::unique_ptr<FrameSnapshot>> slots;
+    std::vector<SlotState> states;
+    unsigned long long published;
+    unsigned long long dropped;
+    double waitMs;
+    bool closed;
+    std::mutex mutex;
+    std::condition_variable slotFreed;
+    std::condition_variable framePublished;
+};
+
+#endif //FRAMEQUEUE_H
@@ -0,0 +1,486 @@
+#include "gpuculling.h"
+#include "drawlist.h"
+#include "renderstats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+GpuCulling gpuCulling;
+
+GpuCulling::GpuCulling() {
+    enabled = false;
+    occlusion = true;
+    coneCulling = true;
+    useCount = false;
+    cullShader = nullptr;
+    meshletShader = nullptr;
+    pyramidShader = nullptr;
+    meshletBatches = 0;
+    maxMeshletGroups = 1;
+    objectCount = 0;
+    commandCount = 0;
+    partsChanged = false;
+    instanceBuffer = 0;
+    partBuffer = 0;
+    materialBuffer = 0;
+    batchBuffer = 0;
+    commandBuffer = 0;
+    countBuffer = 0;
+    levelBuffer = 0;
+    objectBuffer = 0;
+    meshletBuffer = 0;
+    workBuffer = 0;
+    for (GLuint &buffer : statsBuffers) {
+        buffer = 0;
+    }
+    bufferBytes = 0;
+    pyramid = 0;
+    pyramidWidth = 0;
+    pyramidHeight = 0;
+    pyramidLevels = 0;
+    pyramidSize = glm::vec2(0.0f);
+    pyramidViewProjection = glm::mat4(1.0f);
+    pyramidValid = false;
+    culls = 0;
+    for (GLuint &value : lastStats) {
+        value = 0;
+    }
+}
+
+bool GpuCulling::isSupported() {
+    return GLEW_VERSION_4_3;
+}
+
+void GpuCulling::addVariant(ShaderSources &sources) {
+    Shader::addPreamble(sources, "#define GPU_DRIVEN\n", "shader/gpudriven.glsl");
+}
+
+void GpuCulling::setBindings(Shader *shader) {
+    shader->setStorageBinding("Instances", GPU_INSTANCE_BINDING);
+    shader->setStorageBinding("Parts", GPU_PART_BINDING);
+    shader->setStorageBinding("Materials", GPU_MATERIAL_BINDING);
+}
+
+bool GpuCulling::init() {
+    // The object and meshlet passes are one source:
+    ShaderSources sources;
+    Shader::readCompute(sources, "shader/cull.comp");
+    ShaderSources meshletSources = sources;
+    Shader::addPreamble(sources, "", "shader/gpudriven.glsl");
+    Shader::addPreamble(meshletSources, "#define MESHLET_PASS\n", "shader/gpudriven.glsl");
+    cullShader = new Shader();
+    cullShader->compile(sources);
+    meshletShader = new Shader();
+    meshletShader->compile(meshletSources);
+    cullShader->finish();
+    meshletShader->finish();
+    pyramidShader = new Shader("shader/hiz.comp");
+    if (cullShader->ID == 0 || meshletShader->ID == 0 || pyramidShader->ID == 0) {
+        printf("ERROR: Failed to init the GPU culling shaders!\n");
+        return false;
+    }
+    for (Shader *shader : {cullShader, meshletShader}) {
+        setBindings(shader);
+        shader->setStorageBinding("Batches", GPU_BATCH_BINDING);
+        shader->setStorageBinding("Commands", GPU_COMMAND_BINDING);
+        shader->setStorageBinding("Counts", GPU_COUNT_BINDING);
+        shader->setStorageBinding("Levels", GPU_LEVEL_BINDING);
+        shader->setStorageBinding("Stats", GPU_STATS_BINDING);
+        shader->setStorageBinding("Meshlets", GPU_MESHLET_BINDING);
+        shader->setStorageBinding("MeshletWork", GPU_MESHLET_WORK_BINDING);
+    }
+    GLint maxGroups = 65535;
+    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &maxGroups);
+    maxMeshletGroups = (GLuint) std::max(maxGroups, 1);
+
+    // Without the count on the GPU, every object keeps a slot in its part's batches
+    useCount = GLEW_VERSION_4_6 || GLEW_ARB_indirect_parameters;
+    return true;
+}
+
+void GpuCulling::destroy() {
+    for (GLuint *buffer : {&instanceBuffer, &partBuffer, &materialBuffer, &batchBuffer, &commandBuffer,
+                           &countBuffer, &levelBuffer, &objectBuffer, &meshletBuffer, &workBuffer}) {
+        glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    glDeleteBuffers(GPU_CULLING_READBACK, statsBuffers);
+    memoryStats.bufferBytes -= bufferBytes;
+    bufferBytes = 0;
+    if (pyramid != 0) {
+        glDeleteTextures(1, &pyramid);
+        memoryStats.textureBytes -= (long long) pyramidWidth * pyramidHeight * 4 * 4 / 3;
+        pyramid = 0;
+    }
+    for (Shader **shader : {&cullShader, &meshletShader, &pyramidShader}) {
+        if (*shader != nullptr) {
+            (*shader)->destroy();
+            delete *shader;
+            *shader = nullptr;
+        }
+    }
+}
+
+int GpuCulling::addPart(Model *model, Shader *shader, const glm::mat4 &transform, const glm::mat4 &normalMatrix) {
+    const LodSelector &lod = model->getLodSelector();
+    const Material *material = model->getMaterial();
+    GpuPart part = {};
+    part.transform = transform;
+    part.normalMatrix = normalMatrix;
+    glm::vec3 center;
+    float radius;
+    model->getBoundingSphere(center, radius);
+    part.sphere = glm::vec4(center, radius);
+    part.specular = glm::vec4(material->specular, material->shininess);
+    part.levelCount = (GLuint) std::max(lod.getLevelCount(), 1);
+    part.sectors = (GLuint) lod.getSectors();
+    part.visible = 1;
+    part.lodShape = glm::vec4(lod.getRadius(), lod.getBoundingRadius(), 0.0f, 0.0f);
+    parts.push_back(part);
+    partShaders.push_back(shader);
+    partModels.push_back(model);
+    return (int) parts.size() - 1;
+}
+
+void GpuCulling::addInstance(const glm::mat4 &transform, const glm::mat4 &normalMatrix,
+                             const unsigned char *materials) {
+    GpuInstance instance = {};
+    instance.transform = transform;
+    instance.normalMatrix = normalMatrix;
+    for (int i = 0; i < GPU_INSTANCE_MATERIALS; ++i) {
+        GLuint material = materials != nullptr ? materials[i] : GPU_OWN_MATERIAL;
+        instance.materials[i / 4] |= material << (8 * (i % 4));
+    }
+    instances.push_back(instance);
+}
+
+bool GpuCulling::upload() {
+    if (parts.empty() || instances.empty()) {
+        printf("ERROR: The GPU-driven scene has no objects\n");
+        return false;
+    }
+    objectCount = (GLuint) (parts.size() * instances.size());
+
+    // A batch per part and level, each with a command for every instance, or for every meshlet of every
+    // instance if its mesh has meshlets and the count is read on the GPU:
+    batches.clear();
+    batchDraws.clear();
+    meshlets.clear();
+    meshletBatches = 0;
+    commandCount = 0;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        Model *model = partModels[i];
+        if (model->isTessellated()) {
+            printf("ERROR: GPU culling can't draw the tessellated model %s\n", model->getName());
+            return false;
+        }
+        parts[i].firstBatch = (GLuint) batches.size();
+        for (int level = 0; level < (int) parts[i].levelCount; ++level) {
+            const Mesh *mesh = model->getLodMesh(level);
+            GpuBatch batch = {};
+            batch.indexed = mesh->nIndices > 0 ? 1 : 0;
+            batch.count = batch.indexed ? mesh->nIndices : mesh->nVertices;
+            batch.firstCommand = commandCount;
+            auto capacity = (GLuint) instances.size();
+            size_t meshletCommands = mesh->meshlets.size() * instances.size();
+            if (useCount && !mesh->meshlets.empty() && meshletCommands <= GPU_MESHLET_MAX_COMMANDS) {
+                batch.meshletCount = (GLuint) mesh->meshlets.size();
+                batch.firstMeshlet = (GLuint) meshlets.size();
+                meshlets.insert(meshlets.end(), mesh->meshlets.begin(), mesh->meshlets.end());
+                capacity = (GLuint) meshletCommands;
+                ++meshletBatches;
+            }
+            batches.push_back(batch);
+            float normalMap = model->getMaterial()->useNormalMap ? 1.0f : 0.0f;
+            batchDraws.push_back({model, partShaders[i], (int) i, level, capacity,
+                                  glm::vec4(mesh->positionScale, mesh->packed ? 1.0f : 0.0f),
+                                  glm::vec4(mesh->positionOffset, normalMap)});
+            commandCount += capacity;
+        }
+    }
+    if (materials.empty()) {
+        materials.emplace_back(0.0f);
+    }
+
+    createBuffer(instanceBuffer, sizeof(GpuInstance) * instances.size(), instances.data());
+    createBuffer(partBuffer, sizeof(GpuPart) * parts.size(), parts.data());
+    createBuffer(materialBuffer, sizeof(glm::vec4) * materials.size(), materials.data());
+    createBuffer(batchBuffer, sizeof(GpuBatch) * batches.size(), batches.data());
+    createBuffer(commandBuffer, (GLsizeiptr) INDIRECT_COMMAND_STRIDE * commandCount, nullptr);
+    createBuffer(countBuffer, sizeof(GLuint) * batches.size(), nullptr);
+    std::vector<GLuint> values(objectCount, 0);
+    createBuffer(levelBuffer, sizeof(GLuint) * objectCount, values.data());
+    for (GLuint i = 0; i < objectCount; ++i) {
+        values[i] = i;
+    }
+    createBuffer(objectBuffer, sizeof(GLuint) * objectCount, values.data());
+    createBuffer(meshletBuffer, sizeof(Meshlet) * meshlets.size(), meshlets.data());
+    createBuffer(workBuffer, sizeof(GLuint) * 4 + sizeof(GLuint) * 2 * (meshletBatches > 0 ? objectCount : 0),
+                 nullptr);
+    for (GLuint &buffer : statsBuffers) {
+        GLuint zero[GPU_CULLING_STATS] = {};
+        createBuffer(buffer, sizeof(zero), zero);
+    }
+
+    // Commands of culled objects draw nothing until the first cull
+    std::vector<GLuint> commands((size_t) commandCount * 5, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(GLuint) * commands.size(), commands.data());
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    // The base instance of a draw is its object; an instanced attribute that counts up reads it in every mesh
+    for (const BatchDraw &draw : batchDraws) {
+        glBindVertexArray(draw.model->getLodMesh(draw.level)->vao);
+        glBindBuffer(GL_ARRAY_BUFFER, objectBuffer);
+        glVertexAttribIPointer(GPU_OBJECT_ATTRIBUTE, 1, GL_UNSIGNED_INT, sizeof(GLuint), nullptr);
+        glVertexAttribDivisor(GPU_OBJECT_ATTRIBUTE, 1);
+        glEnableVertexAttribArray(GPU_OBJECT_ATTRIBUTE);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    printf("INFO: GPU-driven scene of %u objects (%d parts x %d instances) in %d batches (%d of %d meshlets), "
+           "%.1f MB of buffers; draw counts %s\n", objectCount, (int) parts.size(), (int) instances.size(),
+           (int) batches.size(), meshletBatches, (int) meshlets.size(), (double) bufferBytes / 1048576.0,
+           useCount ? "read on the GPU" : "unavailable, culled draws stay");
+    return true;
+}
+
+void GpuCulling::createBuffer(GLuint &buffer, GLsizeiptr size, const void *data) {
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max(size, (GLsizeiptr) sizeof(GLuint)), data, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    GLint64 bytes = getBufferSize(buffer);
+    memoryStats.bufferBytes += bytes;
+    bufferBytes += bytes;
+}
+
+void GpuCulling::setPartVisible(int part, bool visible) {
+    GLuint value = visible ? 1 : 0;
+    if (parts[part].visible != value) {
+        parts[part].visible = value;
+        partsChanged = true;
+    }
+}
+
+void GpuCulling::readStats(int slot) {
+    // Written GPU_CULLING_READBACK frames ago, so the GPU is done with it
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsBuffers[slot]);
+    if (culls >= GPU_CULLING_READBACK) {
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(lastStats), lastStats);
+    }
+    GLuint zero = 0;
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuCulling::cull(const glm::mat4 &view, const glm::mat4 &projection, int viewportHeight) {
+    if (objectCount == 0) {
+        return;
+    }
+    if (partsChanged) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, partBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GpuPart) * parts.size(), parts.data());
+        partsChanged = false;
+    }
+    int slot = (int) (culls % GPU_CULLING_READBACK);
+    readStats(slot);
+    if (useCount) {
+        GLuint zero = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, countBuffer);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    }
+    if (meshletBatches > 0) {
+        GLuint work[4] = {0, 1, 1, 0};
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, workBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(work), work);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    ++culls;
+
+    GLuint buffers[] = {instanceBuffer, partBuffer, materialBuffer, batchBuffer, commandBuffer, countBuffer,
+                        levelBuffer, statsBuffers[slot], meshletBuffer, workBuffer};
+    for (GLuint binding = 0; binding < sizeof(buffers) / sizeof(buffers[0]); ++binding) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffers[binding]);
+    }
+
+    Frustum frustum;
+    frustum.set(projection * view);
+    cullShader->use();
+    cullShader->setUint("partCount", (unsigned int) parts.size());
+    cullShader->setUint("objectCount", objectCount);
+    cullShader->setBool("compact", useCount);
+    cullShader->setUint("maxMeshletGroups", maxMeshletGroups);
+    cullShader->setBool("useCulling", DrawList::useCulling);
+    glUniform4fv(glGetUniformLocation(cullShader->ID, "frustum"), 6, &frustum.planes[0][0]);
+    cullShader->setMat4("view", view);
+    cullShader->setMat4("projection", projection);
+    cullShader->setFloat("viewportHeight", (float) viewportHeight);
+    cullShader->setBool("useLod", LodSelector::enabled);
+    cullShader->setFloat("lodPixels", LodSelector::targetSegmentPixels);
+    cullShader->setFloat("lodHysteresis", LodSelector::hysteresis);
+    cullShader->setBool("useOcclusion", occlusion && pyramidValid);
+    cullShader->setInt("depthPyramid", 0);
+    cullShader->setMat4("pyramidViewProjection", pyramidViewProjection);
+    cullShader->setVec2("pyramidSize", pyramidSize);
+    cullShader->setInt("pyramidLevels", pyramidLevels);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, pyramid);
+    glDispatchCompute((objectCount + GPU_CULLING_GROUP_SIZE - 1) / GPU_CULLING_GROUP_SIZE, 1, 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // The meshlets of the objects queued, as many work groups as the object pass asked for
+    if (meshletBatches > 0) {
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+        glm::mat4 camera = glm::inverse(view);
+        meshletShader->use();
+        meshletShader->setUint("partCount", (unsigned int) parts.size());
+        meshletShader->setBool("useCulling", DrawList::useCulling);
+        glUniform4fv(glGetUniformLocation(meshletShader->ID, "frustum"), 6, &frustum.planes[0][0]);
+        meshletShader->setVec3("cameraPosition", glm::vec3(camera[3]));
+        meshletShader->setVec3("viewDirection", -glm::vec3(camera[2]));
+        meshletShader->setBool("orthographic", projection[3][3] == 1.0f);
+        meshletShader->setBool("useCones", coneCulling);
+        glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, workBuffer);
+        glDispatchComputeIndirect(0);
+        glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+    }
+
+    // The draws read the commands and counts, and the vertex shaders the scene
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GpuCulling::draw(const std::function<void(Shader *)> &prepare) {
+    if (objectCount == 0) {
+        return;
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_INSTANCE_BINDING, instanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_PART_BINDING, partBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_MATERIAL_BINDING, materialBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    if (useCount) {
+        glBindBuffer(GL_PARAMETER_BUFFER_ARB, countBuffer);
+    }
+
+    Shader *current = nullptr;
+    for (size_t i = 0; i < batchDraws.size(); ++i) {
+        const BatchDraw &batch = batchDraws[i];
+        if (parts[batch.part].visible == 0) {
+            continue;
+        }
+        if (batch.shader != current) {
+            current = batch.shader;
+            current->use();
+            current->setUint("partCount", (unsigned int) parts.size());
+            prepare(current);
+        }
+        current->setVec4("meshPositionScale", batch.positionScale);
+        current->setVec4("meshPositionOffset", batch.positionOffset);
+
+        // The model binds its textures and its mesh issues the batch's commands
+        IndirectDraws draws = {(GLintptr) INDIRECT_COMMAND_STRIDE * batches[i].firstCommand,
+                               (GLsizei) batch.commandCapacity, useCount, (GLintptr) (sizeof(GLuint) * i)};
+        Mesh::indirect = &draws;
+        batch.model->renderLod(batch.level);
+        Mesh::indirect = nullptr;
+    }
+    renderStats.triangles += lastStats[3];
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    if (useCount) {
+        glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+    }
+}
+
+GLuint GpuCulling::getPyramid(int width, int height) {
+    // Level 0 at half the depth buffer's size, rounded up to powers of two so every level halves exactly
+    int levelWidth = 1;
+    int levelHeight = 1;
+    while (levelWidth < (width + 1) / 2) {
+        levelWidth *= 2;
+    }
+    while (levelHeight < (height + 1) / 2) {
+        levelHeight *= 2;
+    }
+    if (pyramid != 0 && levelWidth == pyramidWidth && levelHeight == pyramidHeight) {
+        return pyramid;
+    }
+    if (pyramid != 0) {
+        glDeleteTextures(1, &pyramid);
+        memoryStats.textureBytes -= (long long) pyramidWidth * pyramidHeight * 4 * 4 / 3;
+    }
+    pyramidWidth = levelWidth;
+    pyramidHeight = levelHeight;
+    int levels = 1;
+    while ((std::max(levelWidth, levelHeight) >> levels) > 0) {
+        ++levels;
+    }
+    glGenTextures(1, &pyramid);
+    glBindTexture(GL_TEXTURE_2D, pyramid);
+    glTexStorage2D(GL_TEXTURE_2D, levels, GL_R32F, levelWidth, levelHeight);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    memoryStats.textureBytes += (long long) pyramidWidth * pyramidHeight * 4 * 4 / 3;
+    pyramidValid = false;
+    return pyramid;
+}
+
+void GpuCulling::buildPyramid(GLuint depth, int width, int height, const glm::mat4 &viewProjection) {
+    if (pyramid == 0 || (width + 1) / 2 > pyramidWidth || (height + 1) / 2 > pyramidHeight) {
+        return;
+    }
+    pyramidShader->use();
+    pyramidShader->setInt("depth", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, depth);
+
+    // Each level from the one before, until a single texel holds the farthest depth of all
+    int sourceWidth = std::max(width, 1);
+    int sourceHeight = std::max(height, 1);
+    int level = 0;
+    while (true) {
+        int targetWidth = (sourceWidth + 1) / 2;
+        int targetHeight = (sourceHeight + 1) / 2;
+        glBindImageTexture(0, pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        if (level > 0) {
+            glBindImageTexture(1, pyramid, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        }
+        pyramidShader->setBool("fromDepth", level == 0);
+        glUniform2i(glGetUniformLocation(pyramidShader->ID, "sourceSize"), sourceWidth, sourceHeight);
+        glUniform2i(glGetUniformLocation(pyramidShader->ID, "targetSize"), targetWidth, targetHeight);
+        glDispatchCompute((GLuint) (targetWidth + 7) / 8, (GLuint) (targetHeight + 7) / 8, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        if (targetWidth == 1 && targetHeight == 1) {
+            break;
+        }
+        sourceWidth = targetWidth;
+        sourceHeight = targetHeight;
+        ++level;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // The next cull samples it
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    pyramidLevels = level + 1;
+    pyramidSize = glm::vec2((float) ((width + 1) / 2), (float) ((height + 1) / 2));
+    pyramidViewProjection = viewProjection;
+    pyramidValid = true;
+}
+
+void GpuCulling::printReport() const {
+    if (!enabled || objectCount == 0) {
+        return;
+    }
+    printf("INFO: GPU culling of %u objects in %d batches: the last cull read back drew %u, %u were outside the "
+           "view and %u occluded%s\n", objectCount, (int) batches.size(), lastStats[2], lastStats[0], lastStats[1],
+           occlusion ? "" : " (occlusion culling off)");
+    if (meshletBatches > 0) {
+        printf("INFO: Of the meshlets of the objects drawn, %u were outside the view and %u faced away%s\n",
+               lastStats[4], lastStats[5], coneCulling ? "" : " (cone culling off)");
+    }
+}
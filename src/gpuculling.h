@@ -0,0 +1,241 @@
+#ifndef GPUCULLING_H
+#define GPUCULLING_H
+
+#include <functional>
+#include <vector>
+#include "model.h"
+#include "shader.h"
+
+// Objects the cull shader handles per work group:
+const int GPU_CULLING_GROUP_SIZE = 64;
+
+// Parts of an instance that can take a material of the palette, a byte each; the others draw their own:
+const int GPU_INSTANCE_MATERIALS = 16;
+
+// Material index meaning "the part's own material":
+const unsigned char GPU_OWN_MATERIAL = 255;
+
+// Shader storage bindings of the scene (read by the GPU-driven variants of the scene shaders too) and of the
+// cull shader's own buffers:
+const GLuint GPU_INSTANCE_BINDING = 0;
+const GLuint GPU_PART_BINDING = 1;
+const GLuint GPU_MATERIAL_BINDING = 2;
+const GLuint GPU_BATCH_BINDING = 3;
+const GLuint GPU_COMMAND_BINDING = 4;
+const GLuint GPU_COUNT_BINDING = 5;
+const GLuint GPU_LEVEL_BINDING = 6;
+const GLuint GPU_STATS_BINDING = 7;
+const GLuint GPU_MESHLET_BINDING = 8;
+const GLuint GPU_MESHLET_WORK_BINDING = 9;
+
+// Vertex attribute of the meshes drawn that holds the draw's object, from its base instance:
+const GLuint GPU_OBJECT_ATTRIBUTE = 5;
+
+// Frames before the statistics of a cull are read back, so reading them never waits for the GPU:
+const int GPU_CULLING_READBACK = 3;
+
+// Statistics of a cull: objects outside the view, occluded and drawn, triangles drawn, meshlets outside the
+// view and facing away:
+const int GPU_CULLING_STATS = 6;
+
+// Most commands the meshlets of a batch may take (one per meshlet of every instance); batches that would need
+// more draw whole meshes:
+const GLuint GPU_MESHLET_MAX_COMMANDS = 1u << 20;
+
+// An instance of the parts, as gpudriven.glsl reads it (std430):
+struct GpuInstance {
+    glm::mat4 transform;
+    glm::mat4 normalMatrix; // inverse transpose of transform, in the upper 3x3
+    GLuint materials[GPU_INSTANCE_MATERIALS / 4]; // a byte per part: palette index or GPU_OWN_MATERIAL
+};
+
+// A part of every instance: its model, where it sits in the instance and how its levels of detail are chosen:
+struct GpuPart {
+    glm::mat4 transform;
+    glm::mat4 normalMatrix;
+    glm::vec4 sphere;     // object space bounding sphere: center, radius
+    glm::vec4 specular;   // own material; w: shininess
+    GLuint firstBatch;
+    GLuint levelCount;
+    GLuint sectors;       // of level 0 (see LodSelector)
+    GLuint visible;
+    glm::vec4 lodShape;   // radius of the circle level 0 splits into sectors, bounding radius of the chain
+};
+
+// A part at one level of detail, drawn with one multi-draw from its region of the commands:
+struct GpuBatch {
+    GLuint count;         // indices, or vertices if the mesh has none
+    GLuint first;
+    GLuint baseVertex;
+    GLuint indexed;
+    GLuint firstCommand;
+    GLuint meshletCount;  // 0 if it draws whole meshes
+    GLuint firstMeshlet;
+    GLuint padding;
+};
+
+// GPU-driven culling and draw submission. The objects of the scene live in shader storage buffers, and every frame
+// a compute shader culls them against the view frustum and against the depth pyramid of the last frame (Hi-Z
+// occlusion), picks their levels of detail and compacts the draws that remain into the indirect commands of
+// their batch, counting them. A batch is one part at one level of detail; the context thread issues one
+// glMultiDrawElementsIndirectCount per batch that has objects, reading the count from the GPU (GL 4.6 or
+// ARB_indirect_parameters), so its work per frame doesn't grow with the number of objects. Without the count,
+// every object keeps a slot in the batches of its part and the culled ones draw no instances.
+//
+// Meshes with meshlets (see Mesh::useMeshlets) are culled further, with the count only: objects in view are
+// queued for a second pass, which runs a work group per object and culls its meshlets against the frustum and
+// by their normal cones, drawing each meshlet left as a command of its own, so back-facing and off-screen
+// clusters never reach vertex shading.
+//
+// The scene is a grid of instances of the same parts, like the stress scene (a single instance holds the scene
+// objects otherwise). Draws find their object through their base instance, which an instanced vertex attribute
+// of every mesh drawn reads (GPU_OBJECT_ATTRIBUTE), and the GPU-driven variants of the scene shaders (see
+// addVariant) load it from the buffers. The depth pyramid keeps the farthest depth of every 2x2 texels of the
+// level before; it is built after the main pass and tested against the next frame from the camera it was
+// built with, so an object that comes out from behind another may show a frame late. Needs GL 4.3.
+class GpuCulling {
+public:
+    GpuCulling();
+
+    // Whether the context can run it (compute shaders and shader storage buffers of GL 4.3):
+    static bool isSupported();
+
+    // Makes sources, read with Shader::read, compile into the GPU-driven variant of a scene shader:
+    static void addVariant(ShaderSources &sources);
+
+    // Reads the scene's storage blocks from their bindings; call on every variant once compiled.
+    static void setBindings(Shader *shader);
+
+    void setEnabled(bool enabled) { this->enabled = enabled; }
+
+    bool isEnabled() const { return enabled; }
+
+    // Test objects against the depth of the last frame too (on by default):
+    void setOcclusion(bool occlusion) { this->occlusion = occlusion; }
+
+    // Cull the meshlets of meshes that have them by their normal cones too (on by default):
+    void setConeCulling(bool coneCulling) { this->coneCulling = coneCulling; }
+
+    // Compiles the cull and depth pyramid shaders; call on the context thread. Returns false if it fails.
+    bool init();
+
+    void destroy();
+
+    // Adds a part drawn with shader (a GPU-driven variant) in every instance, placed within the instance by
+    // transform; returns its index. Tessellated models aren't supported.
+    int addPart(Model *model, Shader *shader, const glm::mat4 &transform, const glm::mat4 &normalMatrix);
+
+    // Adds an instance of the parts, with the palette index of the first GPU_INSTANCE_MATERIALS parts' materials
+    // (null: their own):
+    void addInstance(const glm::mat4 &transform, const glm::mat4 &normalMatrix, const unsigned char *materials);
+
+    // The materials instances pick from (specular color, w: shininess):
+    void setMaterials(const std::vector<glm::vec4> &palette) { materials = palette; }
+
+    // Creates the buffers of the parts and instances added, and lets their meshes read the object of a draw.
+    // Returns false if the scene is empty or has a tessellated part.
+    bool upload();
+
+    int getPartCount() const { return (int) parts.size(); }
+
+    // Whether a part is drawn at all, e.g. in the screen mirror state; culls from now on see it.
+    void setPartVisible(int part, bool visible);
+
+    // Culls every object for a view, filling the batches every pass of the frame draws.
+    void cull(const glm::mat4 &view, const glm::mat4 &projection, int viewportHeight);
+
+    // Draws the batches of visible parts; prepare is called with each shader once it is in use, to set its
+    // uniforms for the pass.
+    void draw(const std::function<void(Shader *)> &prepare);
+
+    // The depth pyramid, sized for depth buffers up to width x height; a new size drops the last frame's.
+    GLuint getPyramid(int width, int height);
+
+    int getPyramidWidth() const { return pyramidWidth; }
+
+    int getPyramidHeight() const { return pyramidHeight; }
+
+    // Builds the pyramid from the lower left width x height texels of depth, rendered with viewProjection. The
+    // pyramid must have been sized for them with getPyramid.
+    void buildPyramid(GLuint depth, int width, int height, const glm::mat4 &viewProjection);
+
+    // Of the cull GPU_CULLING_READBACK frames back:
+    unsigned int getDrawnCount() const { return lastStats[2]; }
+
+    unsigned int getCulledCount() const { return lastStats[0] + lastStats[1]; }
+
+    unsigned int getCulledMeshletCount() const { return lastStats[4] + lastStats[5]; }
+
+    // Prints the scene and what the last cull read back did with it.
+    void printReport() const;
+
+private:
+    // A batch's model, level and the uniforms its mesh needs:
+    struct BatchDraw {
+        Model *model;
+        Shader *shader;
+        int part;
+        int level;
+        GLuint commandCapacity;
+        glm::vec4 positionScale;  // w: 1 if normals are packed
+        glm::vec4 positionOffset; // w: 1 if the material has a normal map
+    };
+
+    void createBuffer(GLuint &buffer, GLsizeiptr size, const void *data);
+
+    // Reads back the statistics of the slot the next cull writes, then clears it:
+    void readStats(int slot);
+
+    bool enabled;
+    bool occlusion;
+    bool coneCulling;
+    bool useCount;
+    Shader *cullShader;
+    Shader *meshletShader;
+    Shader *pyramidShader;
+
+    // The scene, on the CPU until upload:
+    std::vector<GpuPart> parts;
+    std::vector<Shader *> partShaders;
+    std::vector<Model *> partModels;
+    std::vector<GpuInstance> instances;
+    std::vector<glm::vec4> materials;
+    std::vector<GpuBatch> batches;
+    std::vector<BatchDraw> batchDraws;
+    std::vector<Meshlet> meshlets;  // of every batch that draws them, in order
+    int meshletBatches;
+    GLuint maxMeshletGroups;
+    GLuint objectCount;
+    GLuint commandCount;
+    bool partsChanged;
+
+    GLuint instanceBuffer;
+    GLuint partBuffer;
+    GLuint materialBuffer;
+    GLuint batchBuffer;
+    GLuint commandBuffer;  // 5 values per command
+    GLuint countBuffer;    // commands per batch, for the draws' counts
+    GLuint levelBuffer;    // level drawn last per object
+    GLuint objectBuffer;   // 0, 1, 2, ... for GPU_OBJECT_ATTRIBUTE
+    GLuint meshletBuffer;
+    GLuint workBuffer;     // the meshlet pass's dispatch, then the objects it culls
+    GLuint statsBuffers[GPU_CULLING_READBACK];
+    GLint64 bufferBytes;
+
+    // The depth pyramid: level 0 has a power of two texels per side, at least half the depth buffer's
+    GLuint pyramid;
+    int pyramidWidth;
+    int pyramidHeight;
+    int pyramidLevels;        // levels built, down to the one of a single texel of depth
+    glm::vec2 pyramidSize;    // texels of level 0 holding depth
+    glm::mat4 pyramidViewProjection;
+    bool pyramidValid;
+
+    unsigned long long culls;
+    GLuint lastStats[GPU_CULLING_STATS];
+};
+
+// The application's GPU-driven culling:
+extern GpuCulling gpuCulling;
+
+#endif //GPUCULLING_H
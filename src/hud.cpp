@@ -0,0 +1,318 @@
+#include "hud.h"
+#include "profiler.h"
+#include "renderstats.h"
+#include "framepacing.h"
+#include "dynamicresolution.h"
+
+#include <cstdio>
+#include <cstddef>
+#include <algorithm>
+
+// 5x7 glyphs of printable ASCII, one byte per column, least significant bit at the top:
+static const unsigned char FONT_GLYPHS[HUD_FONT_GLYPHS * 5] = {
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x5F, 0x00, 0x00, 0x00, 0x07, 0x00, 0x07, 0x00, // space ! "
+        0x14, 0x7F, 0x14, 0x7F, 0x14, 0x24, 0x2A, 0x7F, 0x2A, 0x12, 0x23, 0x13, 0x08, 0x64, 0x62, // # $ %
+        0x36, 0x49, 0x55, 0x22, 0x50, 0x00, 0x05, 0x03, 0x00, 0x00, 0x00, 0x1C, 0x22, 0x41, 0x00, // & ' (
+        0x00, 0x41, 0x22, 0x1C, 0x00, 0x08, 0x2A, 0x1C, 0x2A, 0x08, 0x08, 0x08, 0x3E, 0x08, 0x08, // ) * +
+        0x00, 0x50, 0x30, 0x00, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x60, 0x60, 0x00, 0x00, // , - .
+        0x20, 0x10, 0x08, 0x04, 0x02, 0x3E, 0x51, 0x49, 0x45, 0x3E, 0x00, 0x42, 0x7F, 0x40, 0x00, // / 0 1
+        0x42, 0x61, 0x51, 0x49, 0x46, 0x21, 0x41, 0x45, 0x4B, 0x31, 0x18, 0x14, 0x12, 0x7F, 0x10, // 2 3 4
+        0x27, 0x45, 0x45, 0x45, 0x39, 0x3C, 0x4A, 0x49, 0x49, 0x30, 0x01, 0x71, 0x09, 0x05, 0x03, // 5 6 7
+        0x36, 0x49, 0x49, 0x49, 0x36, 0x06, 0x49, 0x49, 0x29, 0x1E, 0x00, 0x36, 0x36, 0x00, 0x00, // 8 9 :
+        0x00, 0x56, 0x36, 0x00, 0x00, 0x08, 0x14, 0x22, 0x41, 0x00, 0x14, 0x14, 0x14, 0x14, 0x14, // ; < =
+        0x00, 0x41, 0x22, 0x14, 0x08, 0x02, 0x01, 0x51, 0x09, 0x06, 0x32, 0x49, 0x79, 0x41, 0x3E, // > ? @
+        0x7E, 0x11, 0x11, 0x11, 0x7E, 0x7F, 0x49, 0x49, 0x49, 0x36, 0x3E, 0x41, 0x41, 0x41, 0x22, // A B C
+        0x7F, 0x41, 0x41, 0x22, 0x1C, 0x7F, 0x49, 0x49, 0x49, 0x41, 0x7F, 0x09, 0x09, 0x01, 0x01, // D E F
+        0x3E, 0x41, 0x41, 0x51, 0x32, 0x7F, 0x08, 0x08, 0x08, 0x7F, 0x00, 0x41, 0x7F, 0x41, 0x00, // G H I
+        0x20, 0x40, 0x41, 0x3F, 0x01, 0x7F, 0x08, 0x14, 0x22, 0x41, 0x7F, 0x40, 0x40, 0x40, 0x40, // J K L
+        0x7F, 0x02, 0x04, 0x02, 0x7F, 0x7F, 0x04, 0x08, 0x10, 0x7F, 0x3E, 0x41, 0x41, 0x41, 0x3E, // M N O
+        0x7F, 0x09, 0x09, 0x09, 0x06, 0x3E, 0x41, 0x51, 0x21, 0x5E, 0x7F, 0x09, 0x19, 0x29, 0x46, // P Q R
+        0x46, 0x49, 0x49, 0x49, 0x31, 0x01, 0x01, 0x7F, 0x01, 0x01, 0x3F, 0x40, 0x40, 0x40, 0x3F, // S T U
+        0x1F, 0x20, 0x40, 0x20, 0x1F, 0x7F, 0x20, 0x18, 0x20, 0x7F, 0x63, 0x14, 0x08, 0x14, 0x63, // V W X
+        0x03, 0x04, 0x78, 0x04, 0x03, 0x61, 0x51, 0x49, 0x45, 0x43, 0x00, 0x7F, 0x41, 0x41, 0x00, // Y Z [
+        0x02, 0x04, 0x08, 0x10, 0x20, 0x00, 0x41, 0x41, 0x7F, 0x00, 0x04, 0x02, 0x01, 0x02, 0x04, // \ ] ^
+        0x40, 0x40, 0x40, 0x40, 0x40, 0x00, 0x01, 0x02, 0x04, 0x00, 0x20, 0x54, 0x54, 0x54, 0x78, // _ ` a
+        0x7F, 0x48, 0x44, 0x44, 0x38, 0x38, 0x44, 0x44, 0x44, 0x20, 0x38, 0x44, 0x44, 0x48, 0x7F, // b c d
+        0x38, 0x54, 0x54, 0x54, 0x18, 0x08, 0x7E, 0x09, 0x01, 0x02, 0x0C, 0x52, 0x52, 0x52, 0x3E, // e f g
+        0x7F, 0x08, 0x04, 0x04, 0x78, 0x00, 0x44, 0x7D, 0x40, 0x00, 0x20, 0x40, 0x44, 0x3D, 0x00, // h i j
+        0x7F, 0x10, 0x28, 0x44, 0x00, 0x00, 0x41, 0x7F, 0x40, 0x00, 0x7C, 0x04, 0x18, 0x04, 0x78, // k l m
+        0x7C, 0x08, 0x04, 0x04, 0x78, 0x38, 0x44, 0x44, 0x44, 0x38, 0x7C, 0x14, 0x14, 0x14, 0x08, // n o p
+        0x08, 0x14, 0x14, 0x18, 0x7C, 0x7C, 0x08, 0x04, 0x04, 0x08, 0x48, 0x54, 0x54, 0x54, 0x20, // q r s
+        0x04, 0x3F, 0x44, 0x40, 0x20, 0x3C, 0x40, 0x40, 0x20, 0x7C, 0x1C, 0x20, 0x40, 0x20, 0x1C, // t u v
+        0x3C, 0x40, 0x30, 0x40, 0x3C, 0x44, 0x28, 0x10, 0x28, 0x44, 0x0C, 0x50, 0x50, 0x50, 0x3C, // w x y
+        0x44, 0x64, 0x54, 0x4C, 0x44, 0x00, 0x08, 0x36, 0x41, 0x00, 0x00, 0x00, 0x7F, 0x00, 0x00, // z { |
+        0x00, 0x41, 0x36, 0x08, 0x00, 0x08, 0x04, 0x08, 0x10, 0x08, // } ~
+};
+
+// Atlas layout: one row of cells, the glyphs followed by the filled cell:
+static const int ATLAS_CELLS = HUD_FONT_GLYPHS + 1;
+static const int ATLAS_WIDTH = ATLAS_CELLS * HUD_CELL_WIDTH;
+
+// Frame time at the top of the graph, and the 60 and 30 FPS marks:
+static const float GRAPH_MAX_MS = 50.0f;
+static const float GRAPH_HEIGHT = 64.0f;
+static const float TARGET_MS = 1000.0f / 60.0f;
+static const float SLOW_MS = 1000.0f / 30.0f;
+
+static const unsigned char PANEL_COLOR[4] = {0, 0, 0, 160};
+static const unsigned char TEXT_COLOR[4] = {255, 255, 255, 255};
+static const unsigned char DIM_COLOR[4] = {150, 150, 150, 255};
+static const unsigned char MARK_COLOR[4] = {255, 255, 255, 60};
+static const unsigned char FAST_COLOR[4] = {60, 220, 60, 255};
+static const unsigned char SLOW_COLOR[4] = {230, 200, 40, 255};
+static const unsigned char JANK_COLOR[4] = {230, 50, 40, 255};
+
+Hud::Hud() {
+    shader = nullptr;
+    vao = 0;
+    vbo = 0;
+    fontTexture = 0;
+    std::fill(frameTimes, frameTimes + HUD_GRAPH_FRAMES, 0.0f);
+    frameTimeIndex = 0;
+    visible = false;
+}
+
+bool Hud::init() {
+    shader = new Shader("shader/hud.vs", "shader/hud.frag");
+    if (shader->ID == 0) {
+        printf("ERROR: Failed to init HUD!\n");
+        return false;
+    }
+
+    // Expand the glyphs into a coverage atlas:
+    std::vector<unsigned char> atlas(ATLAS_WIDTH * HUD_CELL_HEIGHT, 0);
+    for (int glyph = 0; glyph < HUD_FONT_GLYPHS; ++glyph) {
+        for (int column = 0; column < 5; ++column) {
+            unsigned char bits = FONT_GLYPHS[glyph * 5 + column];
+            for (int row = 0; row < 7; ++row) {
+                if (bits & (1 << row)) {
+                    atlas[row * ATLAS_WIDTH + glyph * HUD_CELL_WIDTH + column] = 255;
+                }
+            }
+        }
+    }
+    for (int row = 0; row < HUD_CELL_HEIGHT; ++row) {
+        for (int column = 0; column < HUD_CELL_WIDTH; ++column) {
+            atlas[row * ATLAS_WIDTH + HUD_FONT_GLYPHS * HUD_CELL_WIDTH + column] = 255;
+        }
+    }
+
+    glGenTextures(1, &fontTexture);
+    glBindTexture(GL_TEXTURE_2D, fontTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, HUD_CELL_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE,
+                 atlas.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    memoryStats.textureBytes += (long long) atlas.size();
+
+    // Vertex buffer, refilled every frame:
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * HUD_MAX_QUADS * 6, nullptr, GL_STREAM_DRAW);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, x));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void *) offsetof(Vertex, color));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+    memoryStats.bufferBytes += (long long) sizeof(Vertex) * HUD_MAX_QUADS * 6;
+
+    vertices.reserve(HUD_MAX_QUADS * 6);
+    return true;
+}
+
+void Hud::destroy() {
+    if (vbo != 0) {
+        memoryStats.textureBytes -= ATLAS_WIDTH * HUD_CELL_HEIGHT;
+        memoryStats.bufferBytes -= (long long) sizeof(Vertex) * HUD_MAX_QUADS * 6;
+    }
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteTextures(1, &fontTexture);
+    vao = 0;
+    vbo = 0;
+    fontTexture = 0;
+    if (shader != nullptr) {
+        shader->destroy();
+        delete shader;
+        shader = nullptr;
+    }
+}
+
+void Hud::addFrameTime(float ms) {
+    frameTimes[frameTimeIndex] = ms;
+    frameTimeIndex = (frameTimeIndex + 1) % HUD_GRAPH_FRAMES;
+}
+
+void Hud::addQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1,
+                  const unsigned char *color) {
+    if (vertices.size() + 6 > (size_t) HUD_MAX_QUADS * 6) {
+        return;
+    }
+    Vertex corners[4] = {
+            {x0, y0, u0, v0, {color[0], color[1], color[2], color[3]}},
+            {x1, y0, u1, v0, {color[0], color[1], color[2], color[3]}},
+            {x1, y1, u1, v1, {color[0], color[1], color[2], color[3]}},
+            {x0, y1, u0, v1, {color[0], color[1], color[2], color[3]}},
+    };
+    const int order[6] = {0, 1, 2, 0, 2, 3};
+    for (int corner : order) {
+        vertices.push_back(corners[corner]);
+    }
+}
+
+void Hud::addRect(float x0, float y0, float x1, float y1, const unsigned char *color) {
+    // Sample the middle of the filled cell:
+    float u = ((float) (HUD_FONT_GLYPHS * HUD_CELL_WIDTH) + 0.5f * HUD_CELL_WIDTH) / (float) ATLAS_WIDTH;
+    addQuad(x0, y0, x1, y1, u, 0.5f, u, 0.5f, color);
+}
+
+float Hud::addText(float x, float y, const char *text, const unsigned char *color) {
+    const float width = HUD_CELL_WIDTH * HUD_SCALE;
+    const float height = HUD_CELL_HEIGHT * HUD_SCALE;
+    float start = x;
+    for (const char *c = text; *c != '\0'; ++c) {
+        int glyph = (unsigned char) *c - HUD_FONT_FIRST;
+        if (glyph > 0 && glyph < HUD_FONT_GLYPHS) {
+            float u0 = (float) (glyph * HUD_CELL_WIDTH) / (float) ATLAS_WIDTH;
+            float u1 = (float) ((glyph + 1) * HUD_CELL_WIDTH) / (float) ATLAS_WIDTH;
+            addQuad(x, y, x + width, y + height, u0, 0.0f, u1, 1.0f, color);
+        }
+        x += width;
+    }
+    return x - start;
+}
+
+// Formats a count with a k or M suffix:
+static void formatCount(char *buffer, size_t size, unsigned long long count) {
+    if (count >= 10000000ULL) {
+        snprintf(buffer, size, "%.1fM", (double) count / 1.0e6);
+    } else if (count >= 10000ULL) {
+        snprintf(buffer, size, "%.1fk", (double) count / 1.0e3);
+    } else {
+        snprintf(buffer, size, "%llu", count);
+    }
+}
+
+void Hud::render(int width, int height) {
+    if (!visible || shader == nullptr) {
+        return;
+    }
+    // Counters of the scene, before the HUD's own binds:
+    RenderStats stats = renderStats;
+
+    const float lineHeight = (HUD_CELL_HEIGHT + 2) * HUD_SCALE;
+    const float margin = 8.0f;
+    const float panelWidth = std::max((float) HUD_GRAPH_FRAMES, 34.0f * HUD_CELL_WIDTH * HUD_SCALE);
+    float x = margin + 6.0f;
+    float y = margin + 6.0f;
+    char line[128];
+    char triangles[16];
+
+    // Panel behind the FPS line, graph, pass table, three counter lines, the latency and the resolution line:
+    const std::vector<ScopeTiming> &cpuTimings = profiler.getCpuTimings();
+    const std::vector<ScopeTiming> &gpuTimings = profiler.getGpuTimings();
+    float panelHeight = 16.0f + GRAPH_HEIGHT + lineHeight * (float) (7 + gpuTimings.size());
+    vertices.clear();
+    addRect(margin, margin, margin + panelWidth + 12.0f, margin + panelHeight, PANEL_COLOR);
+
+    // Frame time, averaged over the graph:
+    float sum = 0.0f;
+    float worst = 0.0f;
+    for (float ms : frameTimes) {
+        sum += ms;
+        worst = std::max(worst, ms);
+    }
+    float average = sum / HUD_GRAPH_FRAMES;
+    snprintf(line, sizeof(line), "%5.1f FPS %6.2f ms  max %6.2f", average > 0.0f ? 1000.0f / average : 0.0f,
+             average, worst);
+    addText(x, y, line, TEXT_COLOR);
+    y += lineHeight;
+
+    // Frame-time graph, oldest frame on the left, with the 60 and 30 FPS marks:
+    float graphBottom = y + GRAPH_HEIGHT;
+    for (int i = 0; i < HUD_GRAPH_FRAMES; ++i) {
+        float ms = frameTimes[(frameTimeIndex + i) % HUD_GRAPH_FRAMES];
+        float barHeight = std::min(ms / GRAPH_MAX_MS, 1.0f) * GRAPH_HEIGHT;
+        const unsigned char *color = ms <= TARGET_MS ? FAST_COLOR : ms <= SLOW_MS ? SLOW_COLOR : JANK_COLOR;
+        addRect(x + (float) i, graphBottom - barHeight, x + (float) (i + 1), graphBottom, color);
+    }
+    for (float mark : {TARGET_MS, SLOW_MS}) {
+        float markY = graphBottom - mark / GRAPH_MAX_MS * GRAPH_HEIGHT;
+        addRect(x, markY, x + (float) HUD_GRAPH_FRAMES, markY + 1.0f, MARK_COLOR);
+    }
+    y = graphBottom + 6.0f;
+
+    // CPU and GPU time of every pass the GPU timed:
+    addText(x, y, "pass              cpu ms  gpu ms", DIM_COLOR);
+    y += lineHeight;
+    for (const ScopeTiming &gpu : gpuTimings) {
+        double cpuMs = 0.0;
+        for (const ScopeTiming &cpu : cpuTimings) {
+            if (cpu.name == gpu.name) {
+                cpuMs = cpu.ms;
+                break;
+            }
+        }
+        snprintf(line, sizeof(line), "%-16.16s %7.2f %7.2f", gpu.name.c_str(), cpuMs, gpu.ms);
+        addText(x, y, line, TEXT_COLOR);
+        y += lineHeight;
+    }
+
+    // Render counters and memory:
+    formatCount(triangles, sizeof(triangles), stats.triangles);
+    snprintf(line, sizeof(line), "draws %u  tris %s  patches %llu", stats.drawCalls, triangles, stats.patches);
+    addText(x, y, line, TEXT_COLOR);
+    y += lineHeight;
+    snprintf(line, sizeof(line), "programs %u  textures %u  culled %u", stats.programBinds, stats.textureBinds,
+             stats.culledObjects);
+    addText(x, y, line, TEXT_COLOR);
+    y += lineHeight;
+    snprintf(line, sizeof(line), "memory  tex %.1f MB  buf %.1f MB", (double) memoryStats.textureBytes / 1048576.0,
+             (double) memoryStats.bufferBytes / 1048576.0);
+    addText(x, y, line, TEXT_COLOR);
+    y += lineHeight;
+    snprintf(line, sizeof(line), "latency %.1f ms  p95 %.1f ms", framePacer.getAverageLatencyMs(),
+             framePacer.getPercentileLatencyMs(95.0f));
+    addText(x, y, line, TEXT_COLOR);
+    y += lineHeight;
+    if (dynamicResolution.isEnabled()) {
+        snprintf(line, sizeof(line), "res %dx%d %.0f%%  gpu %.1f/%.1f", dynamicResolution.getRenderWidth(),
+                 dynamicResolution.getRenderHeight(), 100.0f * dynamicResolution.getScale(),
+                 profiler.getGpuFrameMs(), dynamicResolution.getTargetMs());
+    } else {
+        snprintf(line, sizeof(line), "res %dx%d  gpu %.1f ms", width, height, profiler.getGpuFrameMs());
+    }
+    addText(x, y, line, TEXT_COLOR);
+
+    // Orphan the buffer so the driver doesn't wait on last frame's draw, then upload:
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * HUD_MAX_QUADS * 6, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Vertex) * vertices.size(), vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Blend over the frame, in one draw call:
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    shader->use();
+    shader->setVec2("screenSize", (float) width, (float) height);
+    shader->setInt("font", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, fontTexture);
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei) vertices.size());
+    glBindVertexArray(0);
+
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+}
@@ -0,0 +1,73 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <vector>
+#include "opengl.h"
+#include "shader.h"
+
+// Font atlas: printable ASCII in 6x8 pixel cells (5x7 glyphs plus spacing) and one filled cell for solid quads:
+const int HUD_FONT_FIRST = 32;
+const int HUD_FONT_GLYPHS = 95;
+const int HUD_CELL_WIDTH = 6;
+const int HUD_CELL_HEIGHT = 8;
+
+// Screen pixels per font pixel:
+const int HUD_SCALE = 2;
+
+// Frames shown by the frame-time graph, one pixel column each:
+const int HUD_GRAPH_FRAMES = 240;
+
+// Capacity of the vertex buffer; quads past it are dropped:
+const int HUD_MAX_QUADS = 4096;
+
+// Performance overlay: a frame-time graph, CPU and GPU time per pass (from the profiler), the frame's render
+// counters, the GPU memory in use, the input-to-present latency (from the frame pacer) and the resolution the
+// scene renders at with the frame's GPU time. Everything is batched into one dynamic vertex buffer and drawn with
+// a single draw call; text comes from a built-in bitmap font.
+class Hud {
+public:
+    Hud();
+
+    // Creates the shader, font texture and vertex buffer. Returns false if the shader fails to build.
+    bool init();
+
+    void destroy();
+
+    void toggle() { visible = !visible; }
+
+    bool isVisible() const { return visible; }
+
+    void setVisible(bool visible) { this->visible = visible; }
+
+    // Adds the time since the previous frame to the graph:
+    void addFrameTime(float ms);
+
+    // Draws the overlay over the bound framebuffer, which is width x height pixels:
+    void render(int width, int height);
+
+private:
+    struct Vertex {
+        float x, y; // pixels from the top left
+        float u, v;
+        unsigned char color[4];
+    };
+
+    void addQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1,
+                 const unsigned char *color);
+
+    void addRect(float x0, float y0, float x1, float y1, const unsigned char *color);
+
+    // Adds a line of text; returns its width in pixels.
+    float addText(float x, float y, const char *text, const unsigned char *color);
+
+    Shader *shader;
+    GLuint vao;
+    GLuint vbo;
+    GLuint fontTexture;
+    std::vector<Vertex> vertices;
+    float frameTimes[HUD_GRAPH_FRAMES];
+    int frameTimeIndex;
+    bool visible;
+};
+
+#endif //HUD_H
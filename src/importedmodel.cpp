@@ -0,0 +1,80 @@
+#include "importedmodel.h"
+
+#include <cstdio>
+
+ImportedModel::ImportedModel() {
+    tangents = false;
+}
+
+// Loads a texture of an imported material from its file or from the image embedded in the model:
+static bool loadImportedTexture(Texture &texture, const ImportedTexture &imported, GLfloat filterMin) {
+    if (!imported.path.empty()) {
+        if (!texture.load(imported.path.c_str(), 1, GL_TEXTURE_2D, filterMin, GL_LINEAR)) {
+            printf("ERROR: Failed to load %s\n", imported.path.c_str());
+            return false;
+        }
+        return true;
+    }
+    if (!texture.loadFromMemory(imported.encoded.data(), (int) imported.encoded.size(), 1, GL_TEXTURE_2D,
+                                filterMin, GL_LINEAR)) {
+        printf("ERROR: Failed to decode an embedded texture\n");
+        return false;
+    }
+    return true;
+}
+
+bool ImportedModel::init(const ModelImporter &importer, size_t part) {
+    if (part >= importer.getMeshes().size()) {
+        return false;
+    }
+    const ImportedMesh &imported = importer.getMeshes()[part];
+    const ImportedMaterial &material = importer.getMaterial(imported);
+
+    // Diffuse texture, or the material's color as a single texel:
+    if (!material.diffuse.exists() || !loadImportedTexture(mesh.material.diffuse, material.diffuse, GL_NEAREST)) {
+        glm::vec3 color = glm::clamp(material.color, 0.0f, 1.0f) * 255.0f + 0.5f;
+        mesh.material.diffuse.createSolid((unsigned char) color.r, (unsigned char) color.g, (unsigned char) color.b);
+    }
+    mesh.textured = true;
+
+    // The importer adds tangents to the meshes of materials with a normal map:
+    tangents = imported.floatsPerVertex == MESH_TANGENT_VERTEX_FLOATS;
+    if (tangents && loadImportedTexture(mesh.material.normal, material.normal, GL_LINEAR_MIPMAP_LINEAR)) {
+        mesh.material.useNormalMap = true;
+    }
+    mesh.material.setSpecular(material.specular);
+    mesh.material.setShininess(material.shininess);
+
+    mesh.totalUVs = imported.getVertexCount();
+    mesh.totalNormals = imported.getVertexCount();
+    mesh.upload(imported.vertices.data(), imported.getVertexCount(), imported.floatsPerVertex,
+                imported.indices.data(), (unsigned int) imported.indices.size());
+    return true;
+}
+
+void ImportedModel::render() {
+    glEnableVertexAttribArray(0); // vertices
+    glEnableVertexAttribArray(1); // normals
+    glEnableVertexAttribArray(2); // uvs
+    if (tangents) {
+        glEnableVertexAttribArray(3); // tangents
+        glEnableVertexAttribArray(4); // bitangents
+    }
+
+    if (mesh.textured) {
+        mesh.material.diffuse.bind();
+    }
+    if (mesh.material.useNormalMap) {
+        mesh.material.normal.bindNormalMap();
+    }
+
+    mesh.draw(GL_TRIANGLES);
+
+    glDisableVertexAttribArray(0);
+    glDisableVertexAttribArray(1);
+    glDisableVertexAttribArray(2);
+    if (tangents) {
+        glDisableVertexAttribArray(3);
+        glDisableVertexAttribArray(4);
+    }
+}
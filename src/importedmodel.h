@@ -0,0 +1,21 @@
+#ifndef IMPORTEDMODEL_H
+#define IMPORTEDMODEL_H
+
+#include "model.h"
+#include "importer.h"
+
+// One mesh of a model read by ModelImporter (the triangles of one material), drawn like the built-in shapes.
+class ImportedModel : public Model {
+public:
+    ImportedModel();
+
+    // Uploads mesh part of an imported model and creates its material's textures:
+    bool init(const ModelImporter &importer, size_t part);
+
+    void render() override;
+
+private:
+    bool tangents; // Indicates whether the vertices carry a tangent frame (MESH_TANGENT_VERTEX_FLOATS).
+};
+
+#endif //IMPORTEDMODEL_H
@@ -0,0 +1,168 @@
+#include "importer.h"
+#include "vertexformat.h"
+#include "jobs.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+
+ModelImporter::ModelImporter() {
+    defaultMaterial = {"default", {}, {}, glm::vec3(0.8f, 0.8f, 0.8f), glm::vec3(0.5f, 0.5f, 0.5f), 32.0f};
+    bytesRead = 0;
+    threads = 1;
+}
+
+std::string directoryOf(const std::string &path) {
+    size_t separator = path.find_last_of("/\\");
+    return separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+}
+
+bool ModelImporter::load(const char *path, int threads) {
+    meshes.clear();
+    materials.clear();
+    bytesRead = 0;
+    this->threads = threads > 0 ? threads : jobs.getThreadCount();
+
+    std::string extension = path;
+    extension = extension.substr(std::min(extension.size(), extension.find_last_of('.') + 1));
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+    if (extension == "obj") {
+        return loadObj(path);
+    } else if (extension == "gltf" || extension == "glb") {
+        return loadGltf(path);
+    }
+    printf("ERROR: %s is not an OBJ or glTF model\n", path);
+    return false;
+}
+
+const ImportedMaterial &ModelImporter::getMaterial(const ImportedMesh &mesh) const {
+    if (mesh.material < 0 || mesh.material >= (int) materials.size()) {
+        return defaultMaterial;
+    }
+    return materials[mesh.material];
+}
+
+unsigned int ModelImporter::getVertexCount() const {
+    unsigned int count = 0;
+    for (const ImportedMesh &mesh : meshes) {
+        count += mesh.getVertexCount();
+    }
+    return count;
+}
+
+unsigned int ModelImporter::getTriangleCount() const {
+    unsigned int count = 0;
+    for (const ImportedMesh &mesh : meshes) {
+        count += (unsigned int) (mesh.indices.size() / 3);
+    }
+    return count;
+}
+
+void ModelImporter::runParallel(int taskCount, int threads, const std::function<void(int)> &task) {
+    if (threads <= 0) {
+        threads = jobs.getThreadCount();
+    }
+    threads = std::min(threads, taskCount);
+    if (threads <= 1) {
+        for (int i = 0; i < taskCount; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    // One job per thread; each takes the next task until none are left, which balances tasks of uneven size:
+    std::atomic<int> next(0);
+    jobs.parallelFor(threads, 1, [&](int, int) {
+        for (int i = next++; i < taskCount; i = next++) {
+            task(i);
+        }
+    });
+}
+
+void ModelImporter::computeNormals(ImportedMesh &mesh, size_t vertexBegin, size_t vertexEnd, size_t indexBegin,
+                                   size_t indexEnd) {
+    int stride = mesh.floatsPerVertex;
+    float *vertices = mesh.vertices.data();
+    for (size_t i = vertexBegin; i < vertexEnd; ++i) {
+        vertices[i * stride + 3] = vertices[i * stride + 4] = vertices[i * stride + 5] = 0.0f;
+    }
+
+    // Sum the area weighted face normals at each corner, then normalize:
+    for (size_t i = indexBegin; i + 2 < indexEnd; i += 3) {
+        float *a = vertices + (size_t) mesh.indices[i] * stride;
+        float *b = vertices + (size_t) mesh.indices[i + 1] * stride;
+        float *c = vertices + (size_t) mesh.indices[i + 2] * stride;
+        glm::vec3 normal = glm::cross(glm::make_vec3(b) - glm::make_vec3(a), glm::make_vec3(c) - glm::make_vec3(a));
+        for (float *v : {a, b, c}) {
+            v[3] += normal.x;
+            v[4] += normal.y;
+            v[5] += normal.z;
+        }
+    }
+    for (size_t i = vertexBegin; i < vertexEnd; ++i) {
+        float *v = vertices + i * stride;
+        glm::vec3 normal = glm::make_vec3(v + 3);
+        float length = glm::length(normal);
+        normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        v[3] = normal.x;
+        v[4] = normal.y;
+        v[5] = normal.z;
+    }
+}
+
+void ModelImporter::computeTangents(ImportedMesh &mesh) {
+    if (mesh.floatsPerVertex != MESH_TANGENT_VERTEX_FLOATS) {
+        return;
+    }
+    const int stride = MESH_TANGENT_VERTEX_FLOATS;
+    float *vertices = mesh.vertices.data();
+    size_t vertexCount = mesh.getVertexCount();
+    for (size_t i = 0; i < vertexCount; ++i) {
+        std::fill(vertices + i * stride + 8, vertices + i * stride + 14, 0.0f);
+    }
+
+    // Sum the uv gradients of the faces around each vertex (tangent in 8..10, bitangent in 11..13):
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        float *v[3] = {vertices + (size_t) mesh.indices[i] * stride, vertices + (size_t) mesh.indices[i + 1] * stride,
+                       vertices + (size_t) mesh.indices[i + 2] * stride};
+        glm::vec3 edge1 = glm::make_vec3(v[1]) - glm::make_vec3(v[0]);
+        glm::vec3 edge2 = glm::make_vec3(v[2]) - glm::make_vec3(v[0]);
+        glm::vec2 deltaUv1 = glm::make_vec2(v[1] + 6) - glm::make_vec2(v[0] + 6);
+        glm::vec2 deltaUv2 = glm::make_vec2(v[2] + 6) - glm::make_vec2(v[0] + 6);
+        float determinant = deltaUv1.x * deltaUv2.y - deltaUv2.x * deltaUv1.y;
+        if (std::abs(determinant) < 1e-12f) {
+            continue;
+        }
+        glm::vec3 tangent = (edge1 * deltaUv2.y - edge2 * deltaUv1.y) / determinant;
+        glm::vec3 bitangent = (edge2 * deltaUv1.x - edge1 * deltaUv2.x) / determinant;
+        for (float *corner : v) {
+            for (int k = 0; k < 3; ++k) {
+                corner[8 + k] += tangent[k];
+                corner[11 + k] += bitangent[k];
+            }
+        }
+    }
+
+    // Orthogonalize against the normal (Gram-Schmidt), keeping the handedness of the uv mapping:
+    for (size_t i = 0; i < vertexCount; ++i) {
+        float *v = vertices + i * stride;
+        glm::vec3 normal = glm::make_vec3(v + 3);
+        glm::vec3 tangent = glm::make_vec3(v + 8);
+        tangent -= normal * glm::dot(normal, tangent);
+        if (glm::length(tangent) < 1e-8f) {
+            // No uv gradient: any direction perpendicular to the normal
+            tangent = glm::cross(normal, std::abs(normal.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0));
+        }
+        tangent = glm::normalize(tangent);
+        glm::vec3 bitangent = glm::cross(normal, tangent);
+        if (glm::dot(bitangent, glm::make_vec3(v + 11)) < 0.0f) {
+            bitangent = -bitangent;
+        }
+        for (int k = 0; k < 3; ++k) {
+            v[8 + k] = tangent[k];
+            v[11 + k] = bitangent[k];
+        }
+    }
+}
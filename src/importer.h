@@ -0,0 +1,95 @@
+#ifndef IMPORTER_H
+#define IMPORTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "geometry.h"
+
+// A texture of an imported material: a file to load or an image file embedded in the model (PNG, JPEG).
+struct ImportedTexture {
+    std::string path;
+    std::vector<unsigned char> encoded;
+
+    bool exists() const { return !path.empty() || !encoded.empty(); }
+};
+
+// Material of imported meshes, in the terms of Material:
+struct ImportedMaterial {
+    std::string name;
+    ImportedTexture diffuse;
+    ImportedTexture normal;
+    glm::vec3 color;     // diffuse color, used when there is no diffuse texture
+    glm::vec3 specular;
+    float shininess;
+};
+
+// All triangles of a model that share a material, in the engine's interleaved float layout: MESH_VERTEX_FLOATS
+// per vertex, or MESH_TANGENT_VERTEX_FLOATS with a tangent frame when the material has a normal map.
+struct ImportedMesh {
+    int material; // index into getMaterials(), -1 for the default material
+    int floatsPerVertex;
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+
+    unsigned int getVertexCount() const { return (unsigned int) (vertices.size() / floatsPerVertex); }
+};
+
+// Imports Wavefront OBJ (with MTL materials) and glTF 2.0 models (.glb, or .gltf with .bin buffers).
+//
+// Files are memory-mapped and parsed by several threads: an OBJ is cut into chunks at line boundaries which
+// are parsed side by side, then the faces are split evenly between the threads to build the vertices. glTF
+// accessors are converted in ranges written straight into the final arrays. Output arrays are sized up front
+// or grow geometrically, so nothing is allocated per vertex. Node transforms are baked into the vertices and
+// primitives are merged by material, so a model becomes one mesh per material.
+class ModelImporter {
+public:
+    ModelImporter();
+
+    // Imports a model, picking the format from the extension. threads = 0 uses every thread of the job pool.
+    bool load(const char *path, int threads = 0);
+
+    const std::vector<ImportedMesh> &getMeshes() const { return meshes; }
+
+    const std::vector<ImportedMaterial> &getMaterials() const { return materials; }
+
+    // Returns the material of a mesh, or the default material:
+    const ImportedMaterial &getMaterial(const ImportedMesh &mesh) const;
+
+    // Bytes read from the model file and its buffers:
+    size_t getBytesRead() const { return bytesRead; }
+
+    unsigned int getVertexCount() const;
+
+    unsigned int getTriangleCount() const;
+
+    // Runs task(0 .. taskCount - 1) on up to threads threads of the job pool (0 = all of them):
+    static void runParallel(int taskCount, int threads, const std::function<void(int)> &task);
+
+private:
+    bool loadObj(const char *path);
+
+    bool loadMtl(const std::string &path);
+
+    bool loadGltf(const char *path);
+
+    // Fills smooth normals of vertices [vertexBegin, vertexEnd) from the triangles indices[indexBegin, indexEnd):
+    static void computeNormals(ImportedMesh &mesh, size_t vertexBegin, size_t vertexEnd, size_t indexBegin,
+                               size_t indexEnd);
+
+    // Fills the tangent frame of meshes that carry one, from their uvs:
+    static void computeTangents(ImportedMesh &mesh);
+
+    std::vector<ImportedMesh> meshes;
+    std::vector<ImportedMaterial> materials;
+    ImportedMaterial defaultMaterial;
+    size_t bytesRead;
+    int threads;
+};
+
+// Returns the directory part of a path, with its trailing separator:
+std::string directoryOf(const std::string &path);
+
+#endif //IMPORTER_H
@@ -0,0 +1,501 @@
+#include "importer.h"
+#include "mappedfile.h"
+#include "json.h"
+#include "vertexformat.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+
+// Binary glTF container: a header, then a JSON chunk and an optional binary chunk:
+const uint32_t GLB_MAGIC = 0x46546c67; // "glTF"
+const uint32_t GLB_CHUNK_JSON = 0x4e4f534a; // "JSON"
+const uint32_t GLB_CHUNK_BIN = 0x004e4942; // "BIN\0"
+
+// Accessor component types and the primitive mode of triangle lists:
+const int GLTF_BYTE = 5120;
+const int GLTF_UNSIGNED_BYTE = 5121;
+const int GLTF_SHORT = 5122;
+const int GLTF_UNSIGNED_SHORT = 5123;
+const int GLTF_UNSIGNED_INT = 5125;
+const int GLTF_FLOAT = 5126;
+const int GLTF_TRIANGLES = 4;
+
+// Deepest node hierarchy followed, which also stops cycles:
+const int GLTF_MAX_NODE_DEPTH = 64;
+
+// Elements converted per task:
+const size_t GLTF_JOB_ELEMENTS = 64 * 1024;
+
+struct GltfBuffer {
+    const unsigned char *data;
+    size_t size;
+};
+
+// Where the elements of an accessor are and how to read them:
+struct GltfAccessor {
+    const unsigned char *data;
+    size_t stride;
+    size_t count;
+    int componentType;
+    int components;
+    bool normalized;
+};
+
+// A primitive placed by a node, and where its vertices and indices go in the mesh of its material:
+struct GltfDraw {
+    GltfAccessor positions;
+    GltfAccessor normals;
+    GltfAccessor texCoords;
+    GltfAccessor indices;
+    glm::mat4 transform;
+    glm::mat3 normalTransform;
+    bool flipWinding; // mirroring transforms turn the triangles inside out
+    size_t mesh;
+    size_t vertexBase;
+    size_t indexBase;
+    size_t indexCount;
+};
+
+// A range of the vertices or indices of a draw, converted by one task:
+struct GltfJob {
+    size_t draw;
+    size_t begin;
+    size_t end;
+    bool indices;
+};
+
+static int componentSize(int componentType) {
+    switch (componentType) {
+        case GLTF_BYTE:
+        case GLTF_UNSIGNED_BYTE:
+            return 1;
+        case GLTF_SHORT:
+        case GLTF_UNSIGNED_SHORT:
+            return 2;
+        case GLTF_UNSIGNED_INT:
+        case GLTF_FLOAT:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+static int componentCount(const std::string &type) {
+    if (type == "SCALAR") {
+        return 1;
+    } else if (type == "VEC2") {
+        return 2;
+    } else if (type == "VEC3") {
+        return 3;
+    } else if (type == "VEC4") {
+        return 4;
+    }
+    return 0;
+}
+
+// Looks up an accessor and checks that it lies within its buffer. Sparse accessors are not supported.
+static bool getAccessor(const JsonValue &gltf, const std::vector<GltfBuffer> &buffers, const JsonValue &index,
+                        GltfAccessor &accessor) {
+    const JsonValue &json = gltf["accessors"][index.getInt(-1)];
+    const JsonValue &view = gltf["bufferViews"][json["bufferView"].getInt(-1)];
+    int buffer = view["buffer"].getInt(-1);
+    if (json.isNull() || view.isNull() || json.has("sparse") || buffer < 0 || buffer >= (int) buffers.size()) {
+        return false;
+    }
+    accessor.componentType = json["componentType"].getInt();
+    accessor.components = componentCount(json["type"].getString());
+    accessor.normalized = json["normalized"].getBool();
+    accessor.count = json["count"].getSize();
+    size_t elementSize = (size_t) componentSize(accessor.componentType) * accessor.components;
+    accessor.stride = view.has("byteStride") ? view["byteStride"].getSize() : elementSize;
+
+    size_t viewOffset = view["byteOffset"].getSize();
+    size_t viewLength = view["byteLength"].getSize();
+    size_t offset = json["byteOffset"].getSize();
+    if (elementSize == 0 || accessor.stride < elementSize || viewOffset > buffers[buffer].size ||
+        viewLength > buffers[buffer].size - viewOffset) {
+        return false;
+    }
+    if (accessor.count > 0 && (offset > viewLength || (accessor.count - 1) > (viewLength - offset) / accessor.stride ||
+                               (accessor.count - 1) * accessor.stride + elementSize > viewLength - offset)) {
+        return false;
+    }
+    accessor.data = buffers[buffer].data + viewOffset + offset;
+    return true;
+}
+
+// Reads component c of element i as a float, applying the normalization of integer types:
+static inline float readFloat(const GltfAccessor &accessor, size_t i, int c) {
+    const unsigned char *p = accessor.data + i * accessor.stride;
+    switch (accessor.componentType) {
+        case GLTF_FLOAT: {
+            float value;
+            memcpy(&value, p + c * 4, 4);
+            return value;
+        }
+        case GLTF_UNSIGNED_BYTE:
+            return accessor.normalized ? p[c] / 255.0f : p[c];
+        case GLTF_BYTE:
+            return accessor.normalized ? std::max(((signed char) p[c]) / 127.0f, -1.0f) : (signed char) p[c];
+        case GLTF_UNSIGNED_SHORT: {
+            unsigned short value;
+            memcpy(&value, p + c * 2, 2);
+            return accessor.normalized ? value / 65535.0f : value;
+        }
+        case GLTF_SHORT: {
+            short value;
+            memcpy(&value, p + c * 2, 2);
+            return accessor.normalized ? std::max(value / 32767.0f, -1.0f) : value;
+        }
+        default:
+            return 0.0f;
+    }
+}
+
+static inline unsigned int readIndex(const GltfAccessor &accessor, size_t i) {
+    const unsigned char *p = accessor.data + i * accessor.stride;
+    if (accessor.componentType == GLTF_UNSIGNED_BYTE) {
+        return *p;
+    } else if (accessor.componentType == GLTF_UNSIGNED_SHORT) {
+        unsigned short value;
+        memcpy(&value, p, 2);
+        return value;
+    }
+    unsigned int value;
+    memcpy(&value, p, 4);
+    return value;
+}
+
+// Decodes %XX escapes of a relative URI into a path:
+static std::string uriToPath(const std::string &uri) {
+    std::string path;
+    for (size_t i = 0; i < uri.size(); ++i) {
+        if (uri[i] == '%' && i + 2 < uri.size()) {
+            path += (char) strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        } else {
+            path += uri[i];
+        }
+    }
+    return path;
+}
+
+// Returns the transform of a node relative to its parent:
+static glm::mat4 nodeTransform(const JsonValue &node) {
+    glm::mat4 transform(1.0f);
+    const JsonValue &matrix = node["matrix"];
+    if (matrix.size() == 16) {
+        for (int i = 0; i < 16; ++i) {
+            transform[i / 4][i % 4] = (float) matrix[i].getNumber();
+        }
+        return transform;
+    }
+    const JsonValue &t = node["translation"];
+    const JsonValue &r = node["rotation"];
+    const JsonValue &s = node["scale"];
+    if (t.size() == 3) {
+        transform = glm::translate(glm::vec3(t[0].getNumber(), t[1].getNumber(), t[2].getNumber()));
+    }
+    if (r.size() == 4) {
+        transform *= glm::toMat4(glm::quat((float) r[3].getNumber(), (float) r[0].getNumber(),
+                                           (float) r[1].getNumber(), (float) r[2].getNumber()));
+    }
+    if (s.size() == 3) {
+        transform *= glm::scale(glm::vec3(s[0].getNumber(), s[1].getNumber(), s[2].getNumber()));
+    }
+    return transform;
+}
+
+// Appends the primitives of a node and its children to draws, placed by their accumulated transforms:
+static bool placeNode(const JsonValue &gltf, const std::vector<GltfBuffer> &buffers, int nodeIndex,
+                      const glm::mat4 &parent, int depth, std::vector<GltfDraw> &draws,
+                      std::vector<int> &drawMaterials) {
+    const JsonValue &node = gltf["nodes"][nodeIndex];
+    if (node.isNull() || depth > GLTF_MAX_NODE_DEPTH) {
+        return false;
+    }
+    glm::mat4 transform = parent * nodeTransform(node);
+
+    const JsonValue &primitives = gltf["meshes"][node["mesh"].getInt(-1)]["primitives"];
+    for (size_t i = 0; i < primitives.size(); ++i) {
+        const JsonValue &primitive = primitives[i];
+        if (primitive["mode"].getInt(GLTF_TRIANGLES) != GLTF_TRIANGLES) {
+            continue; // points and lines are not drawn
+        }
+        GltfDraw draw = {};
+        const JsonValue &attributes = primitive["attributes"];
+        if (!getAccessor(gltf, buffers, attributes["POSITION"], draw.positions) || draw.positions.components != 3 ||
+            draw.positions.componentType != GLTF_FLOAT) {
+            printf("ERROR: A primitive has invalid positions\n");
+            return false;
+        }
+        if (attributes.has("NORMAL") && (!getAccessor(gltf, buffers, attributes["NORMAL"], draw.normals) ||
+                                         draw.normals.components != 3 || draw.normals.count != draw.positions.count)) {
+            printf("ERROR: A primitive has invalid normals\n");
+            return false;
+        }
+        if (attributes.has("TEXCOORD_0") &&
+            (!getAccessor(gltf, buffers, attributes["TEXCOORD_0"], draw.texCoords) ||
+             draw.texCoords.components != 2 || draw.texCoords.count != draw.positions.count)) {
+            printf("ERROR: A primitive has invalid texture coordinates\n");
+            return false;
+        }
+        if (primitive.has("indices") &&
+            (!getAccessor(gltf, buffers, primitive["indices"], draw.indices) || draw.indices.components != 1 ||
+             draw.indices.componentType == GLTF_FLOAT || draw.indices.componentType == GLTF_BYTE ||
+             draw.indices.componentType == GLTF_SHORT)) {
+            printf("ERROR: A primitive has invalid indices\n");
+            return false;
+        }
+        draw.indexCount = draw.indices.data != nullptr ? draw.indices.count : draw.positions.count;
+        draw.indexCount -= draw.indexCount % 3;
+        draw.transform = transform;
+        draw.normalTransform = glm::transpose(glm::inverse(glm::mat3(transform)));
+        draw.flipWinding = glm::determinant(glm::mat3(transform)) < 0.0f;
+        draws.push_back(draw);
+        drawMaterials.push_back(primitive["material"].getInt(-1));
+    }
+
+    const JsonValue &children = node["children"];
+    for (size_t i = 0; i < children.size(); ++i) {
+        if (!placeNode(gltf, buffers, children[i].getInt(-1), transform, depth + 1, draws, drawMaterials)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ModelImporter::loadGltf(const char *path) {
+    MappedFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+    bytesRead += file.size();
+    std::string directory = directoryOf(path);
+
+    // A binary container holds the JSON and the first buffer; otherwise the file is the JSON:
+    const char *jsonText = (const char *) file.data();
+    size_t jsonLength = file.size();
+    GltfBuffer binaryChunk = {nullptr, 0};
+    uint32_t header[5];
+    if (file.size() >= sizeof(header) && memcpy(header, file.data(), sizeof(header)) && header[0] == GLB_MAGIC) {
+        if (header[1] != 2 || header[2] > file.size() || header[4] != GLB_CHUNK_JSON ||
+            header[3] > file.size() - sizeof(header)) {
+            printf("ERROR: %s is not a valid binary glTF 2.0 file\n", path);
+            return false;
+        }
+        jsonText = (const char *) file.data() + sizeof(header);
+        jsonLength = header[3];
+        size_t binaryOffset = sizeof(header) + ((jsonLength + 3) & ~(size_t) 3);
+        uint32_t chunk[2];
+        if (binaryOffset + sizeof(chunk) <= header[2]) {
+            memcpy(chunk, file.data() + binaryOffset, sizeof(chunk));
+            if (chunk[1] == GLB_CHUNK_BIN && chunk[0] <= header[2] - binaryOffset - sizeof(chunk)) {
+                binaryChunk = {file.data() + binaryOffset + sizeof(chunk), chunk[0]};
+            }
+        }
+    }
+    JsonValue gltf;
+    if (!gltf.parse(jsonText, jsonLength)) {
+        printf("ERROR: Failed to parse %s\n", path);
+        return false;
+    }
+    if (gltf["asset"]["version"].getString().compare(0, 2, "2.") != 0) {
+        printf("ERROR: %s is not a glTF 2.0 file\n", path);
+        return false;
+    }
+
+    // Map the buffers (a buffer without a uri is the binary chunk):
+    const JsonValue &bufferList = gltf["buffers"];
+    std::vector<std::unique_ptr<MappedFile>> bufferFiles;
+    std::vector<GltfBuffer> buffers;
+    for (size_t i = 0; i < bufferList.size(); ++i) {
+        const std::string &uri = bufferList[i]["uri"].getString();
+        size_t length = bufferList[i]["byteLength"].getSize();
+        if (uri.empty()) {
+            buffers.push_back({binaryChunk.data, std::min(length, binaryChunk.size)});
+        } else if (uri.compare(0, 5, "data:") == 0) {
+            printf("ERROR: %s: Embedded data URIs are not supported, use .glb or .bin buffers\n", path);
+            return false;
+        } else {
+            bufferFiles.emplace_back(new MappedFile());
+            std::string bufferPath = directory + uriToPath(uri);
+            if (!bufferFiles.back()->open(bufferPath.c_str())) {
+                return false;
+            }
+            bytesRead += bufferFiles.back()->size();
+            buffers.push_back({bufferFiles.back()->data(), std::min(length, bufferFiles.back()->size())});
+        }
+    }
+
+    // Materials, with their textures as files next to the model or images embedded in a buffer:
+    auto texture = [&](const JsonValue &info) {
+        ImportedTexture result;
+        const JsonValue &image = gltf["images"][gltf["textures"][info["index"].getInt(-1)]["source"].getInt(-1)];
+        if (image.has("uri") && image["uri"].getString().compare(0, 5, "data:") != 0) {
+            result.path = directory + uriToPath(image["uri"].getString());
+        } else if (image.has("bufferView")) {
+            const JsonValue &view = gltf["bufferViews"][image["bufferView"].getInt(-1)];
+            int buffer = view["buffer"].getInt(-1);
+            size_t offset = view["byteOffset"].getSize();
+            size_t length = view["byteLength"].getSize();
+            if (buffer >= 0 && buffer < (int) buffers.size() && offset <= buffers[buffer].size &&
+                length <= buffers[buffer].size - offset) {
+                result.encoded.assign(buffers[buffer].data + offset, buffers[buffer].data + offset + length);
+            }
+        }
+        return result;
+    };
+    const JsonValue &materialList = gltf["materials"];
+    for (size_t i = 0; i < materialList.size(); ++i) {
+        const JsonValue &json = materialList[i];
+        const JsonValue &pbr = json["pbrMetallicRoughness"];
+        ImportedMaterial material = defaultMaterial;
+        material.name = json["name"].getString();
+        if (material.name.empty()) {
+            material.name = "material" + std::to_string(i);
+        }
+        const JsonValue &color = pbr["baseColorFactor"];
+        material.color = glm::vec3(color[0].getNumber(1.0), color[1].getNumber(1.0), color[2].getNumber(1.0));
+        material.diffuse = texture(pbr["baseColorTexture"]);
+        material.normal = texture(json["normalTexture"]);
+
+        // Blinn-Phong terms of the metallic-roughness model: the roughness sets the highlight's size and
+        // strength, metals tint it with their color:
+        float roughness = (float) pbr["roughnessFactor"].getNumber(1.0);
+        float metallic = (float) pbr["metallicFactor"].getNumber(1.0);
+        material.specular = glm::mix(glm::vec3(0.04f), material.color, metallic) * (1.0f - roughness * 0.75f);
+        float alpha = std::max(roughness * roughness, 0.01f);
+        material.shininess = glm::clamp(2.0f / (alpha * alpha) - 2.0f, 1.0f, 256.0f);
+        materials.push_back(material);
+    }
+
+    // Place the primitives of the scene's node tree (or of every root node without a scene):
+    std::vector<GltfDraw> draws;
+    std::vector<int> drawMaterials;
+    std::vector<int> roots;
+    const JsonValue &scene = gltf["scenes"][gltf["scene"].getInt(0)];
+    if (!scene.isNull()) {
+        for (size_t i = 0; i < scene["nodes"].size(); ++i) {
+            roots.push_back(scene["nodes"][i].getInt(-1));
+        }
+    } else {
+        const JsonValue &nodes = gltf["nodes"];
+        std::vector<bool> isChild(nodes.size(), false);
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            for (size_t c = 0; c < nodes[i]["children"].size(); ++c) {
+                size_t child = (size_t) nodes[i]["children"][c].getInt(-1);
+                if (child < isChild.size()) {
+                    isChild[child] = true;
+                }
+            }
+        }
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (!isChild[i]) {
+                roots.push_back((int) i);
+            }
+        }
+    }
+    for (int root : roots) {
+        if (!placeNode(gltf, buffers, root, glm::mat4(1.0f), 0, draws, drawMaterials)) {
+            printf("ERROR: Failed to read the meshes of %s\n", path);
+            return false;
+        }
+    }
+
+    // Give every draw its range in the mesh of its material and size the meshes:
+    std::map<int, size_t> meshIds;
+    for (size_t i = 0; i < draws.size(); ++i) {
+        int material = drawMaterials[i] < (int) materials.size() ? drawMaterials[i] : -1;
+        auto found = meshIds.find(material);
+        if (found == meshIds.end()) {
+            found = meshIds.insert({material, meshes.size()}).first;
+            int floatsPerVertex = material >= 0 && materials[material].normal.exists() ? MESH_TANGENT_VERTEX_FLOATS
+                                                                                       : MESH_VERTEX_FLOATS;
+            meshes.push_back({material, floatsPerVertex, {}, {}});
+        }
+        ImportedMesh &mesh = meshes[found->second];
+        draws[i].mesh = found->second;
+        draws[i].vertexBase = mesh.getVertexCount();
+        draws[i].indexBase = mesh.indices.size();
+        mesh.vertices.resize(mesh.vertices.size() + draws[i].positions.count * mesh.floatsPerVertex);
+        mesh.indices.resize(mesh.indices.size() + draws[i].indexCount);
+    }
+
+    // Convert vertices and indices in ranges, straight into the meshes:
+    std::vector<GltfJob> jobs;
+    for (size_t i = 0; i < draws.size(); ++i) {
+        for (size_t begin = 0; begin < draws[i].positions.count; begin += GLTF_JOB_ELEMENTS) {
+            jobs.push_back({i, begin, std::min(begin + GLTF_JOB_ELEMENTS, draws[i].positions.count), false});
+        }
+        for (size_t begin = 0; begin < draws[i].indexCount; begin += GLTF_JOB_ELEMENTS * 3) {
+            jobs.push_back({i, begin, std::min(begin + GLTF_JOB_ELEMENTS * 3, draws[i].indexCount), true});
+        }
+    }
+    std::atomic<bool> valid(true);
+    runParallel((int) jobs.size(), threads, [&](int j) {
+        const GltfJob &job = jobs[j];
+        const GltfDraw &draw = draws[job.draw];
+        ImportedMesh &mesh = meshes[draw.mesh];
+        if (job.indices) {
+            unsigned int *indices = mesh.indices.data() + draw.indexBase;
+            for (size_t i = job.begin; i < job.end; i += 3) {
+                unsigned int corners[3];
+                for (int k = 0; k < 3; ++k) {
+                    corners[k] = draw.indices.data != nullptr ? readIndex(draw.indices, i + k) : (unsigned int) (i + k);
+                    if (corners[k] >= draw.positions.count) {
+                        valid = false;
+                        corners[k] = 0;
+                    }
+                }
+                if (draw.flipWinding) {
+                    std::swap(corners[1], corners[2]);
+                }
+                for (int k = 0; k < 3; ++k) {
+                    indices[i + k] = corners[k] + (unsigned int) draw.vertexBase;
+                }
+            }
+            return;
+        }
+        for (size_t i = job.begin; i < job.end; ++i) {
+            float *v = mesh.vertices.data() + (draw.vertexBase + i) * mesh.floatsPerVertex;
+            glm::vec3 position = glm::vec3(draw.transform * glm::vec4(readFloat(draw.positions, i, 0),
+                                                                      readFloat(draw.positions, i, 1),
+                                                                      readFloat(draw.positions, i, 2), 1.0f));
+            memcpy(v, &position, sizeof(position));
+            if (draw.normals.data != nullptr) {
+                glm::vec3 normal = draw.normalTransform * glm::vec3(readFloat(draw.normals, i, 0),
+                                                                    readFloat(draw.normals, i, 1),
+                                                                    readFloat(draw.normals, i, 2));
+                float length = glm::length(normal);
+                normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+                memcpy(v + 3, &normal, sizeof(normal));
+            }
+            // glTF puts the uv origin at the top left; images are flipped on load, so flip v too:
+            if (draw.texCoords.data != nullptr) {
+                v[6] = readFloat(draw.texCoords, i, 0);
+                v[7] = 1.0f - readFloat(draw.texCoords, i, 1);
+            }
+        }
+    });
+    if (!valid) {
+        printf("ERROR: %s: An index refers to a vertex that does not exist\n", path);
+        meshes.clear();
+        return false;
+    }
+
+    // Primitives without normals get smooth ones, then normal mapped meshes get their tangents:
+    runParallel((int) draws.size(), threads, [&](int i) {
+        const GltfDraw &draw = draws[i];
+        if (draw.normals.data == nullptr) {
+            computeNormals(meshes[draw.mesh], draw.vertexBase, draw.vertexBase + draw.positions.count,
+                           draw.indexBase, draw.indexBase + draw.indexCount);
+        }
+    });
+    runParallel((int) meshes.size(), threads, [&](int i) { computeTangents(meshes[i]); });
+    return true;
+}
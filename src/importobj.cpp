@@ -0,0 +1,643 @@
+#include "importer.h"
+#include "mappedfile.h"
+#include "vertexformat.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+// Chunks and face jobs per thread, so threads that finish early pick up more:
+const int OBJ_TASKS_PER_THREAD = 4;
+
+// Smallest chunk of the file and smallest face job worth a task:
+const size_t OBJ_MIN_CHUNK_BYTES = 256 * 1024;
+const uint32_t OBJ_MIN_JOB_FACES = 16 * 1024;
+
+// Set in ObjCorner::relative for indices that count back from the chunk's own elements (negative OBJ indices)
+// until the chunk's place in the file is known:
+const uint32_t OBJ_RELATIVE_POSITION = 1;
+const uint32_t OBJ_RELATIVE_TEX_COORD = 2;
+const uint32_t OBJ_RELATIVE_NORMAL = 4;
+
+// A face corner, with 0-based indices (-1 if absent):
+struct ObjCorner {
+    int32_t position;
+    int32_t texCoord;
+    int32_t normal;
+    uint32_t relative;
+};
+
+// A usemtl line; it applies from face on:
+struct ObjMaterialChange {
+    uint32_t face;
+    std::string name;
+};
+
+// A range of lines parsed by one task, and what it found there:
+struct ObjChunk {
+    const char *begin;
+    const char *end;
+    std::vector<float> positions;
+    std::vector<float> texCoords;
+    std::vector<float> normals;
+    std::vector<ObjCorner> corners;
+    std::vector<uint32_t> faces; // first corner of each face
+    std::vector<ObjMaterialChange> materialChanges;
+    std::vector<std::string> libraries;
+    bool missingNormals;
+    const char *error; // start of the first invalid line, or null
+
+    // Where the chunk's elements start in the whole file, and the material in use at its start:
+    int32_t positionBase;
+    int32_t texCoordBase;
+    int32_t normalBase;
+    int startMaterial;
+
+    uint32_t getFaceCount() const { return (uint32_t) faces.size(); }
+
+    uint32_t getFaceEnd(uint32_t face) const {
+        return face + 1 < faces.size() ? faces[face + 1] : (uint32_t) corners.size();
+    }
+};
+
+// The vertices of one material built by a face job:
+struct ObjJobMesh {
+    int material;
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    size_t vertexBase; // where they go in the merged mesh
+    size_t indexBase;
+};
+
+// A range of faces of a chunk, turned into vertices by one task:
+struct ObjJob {
+    int chunk;
+    uint32_t faceBegin;
+    uint32_t faceEnd;
+    std::vector<ObjJobMesh> meshes;
+};
+
+// Key of a deduplicated vertex; mesh is the ObjJobMesh it belongs to:
+struct ObjVertexKey {
+    int32_t position;
+    int32_t texCoord;
+    int32_t normal;
+    int32_t mesh;
+    unsigned int index;
+};
+
+static inline const char *skipSpaces(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        ++p;
+    }
+    return p;
+}
+
+static inline const char *skipLine(const char *p, const char *end) {
+    const char *newline = (const char *) memchr(p, '\n', end - p);
+    return newline != nullptr ? newline + 1 : end;
+}
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Parses a signed integer, advancing p:
+static inline bool parseInt(const char *&p, const char *end, int &value) {
+    bool negative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+')) {
+        ++p;
+    }
+    if (p == end || !isDigit(*p)) {
+        return false;
+    }
+    int result = 0;
+    while (p < end && isDigit(*p)) {
+        result = result * 10 + (*p++ - '0');
+    }
+    value = negative ? -result : result;
+    return true;
+}
+
+// Parses a decimal float, advancing p. Mantissa digits are gathered as an integer and scaled once, which is
+// exact for the short numbers exporters write and much faster than strtof:
+static inline bool parseFloat(const char *&p, const char *end, float &value) {
+    static const double POWERS_OF_TEN[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                           1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    p = skipSpaces(p, end);
+    bool negative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+')) {
+        ++p;
+    }
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    for (; p < end && isDigit(*p); ++p, ++digits) {
+        if (mantissa < 1000000000000000000ull) {
+            mantissa = mantissa * 10 + (*p - '0');
+        } else {
+            ++exponent;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && isDigit(*p); ++p, ++digits) {
+            if (mantissa < 1000000000000000000ull) {
+                mantissa = mantissa * 10 + (*p - '0');
+                --exponent;
+            }
+        }
+    }
+    if (digits == 0) {
+        return false;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        int power;
+        if (!parseInt(p, end, power)) {
+            return false;
+        }
+        exponent += power;
+    }
+    double result = (double) mantissa;
+    if (exponent < 0) {
+        result = -exponent <= 22 ? result / POWERS_OF_TEN[-exponent] : result * std::pow(10.0, exponent);
+    } else if (exponent > 0) {
+        result = exponent <= 22 ? result * POWERS_OF_TEN[exponent] : result * std::pow(10.0, exponent);
+    }
+    value = (float) (negative ? -result : result);
+    return true;
+}
+
+// Parses up to count floats of a v, vt or vn line into values; the first minimum are required:
+static bool parseFloats(const char *&p, const char *end, std::vector<float> &values, int count, int minimum) {
+    for (int i = 0; i < count; ++i) {
+        float value = 0.0f;
+        const char *start = p;
+        if (!parseFloat(p, end, value)) {
+            if (i < minimum) {
+                return false;
+            }
+            p = start;
+        }
+        values.push_back(value);
+    }
+    return true;
+}
+
+// Turns a 1-based OBJ index into a 0-based one; negative indices count back from the elements seen so far:
+static bool resolveIndex(int index, size_t count, int32_t &resolved, uint32_t &relative, uint32_t flag) {
+    if (index > 0) {
+        resolved = index - 1;
+    } else if (index < 0) {
+        resolved = (int32_t) count + index;
+        relative |= flag;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Adds the chunk's base to a relative index; returns false if the index is out of range (-1, absent, is fine):
+static inline bool resolveBase(int32_t &index, bool relative, int32_t base, int32_t count) {
+    if (relative) {
+        index += base;
+        return index >= 0 && index < count;
+    }
+    return index < count;
+}
+
+// Parses the corners of an f line:
+static bool parseFace(const char *&p, const char *end, ObjChunk &chunk) {
+    chunk.faces.push_back((uint32_t) chunk.corners.size());
+    while (true) {
+        p = skipSpaces(p, end);
+        if (p == end || *p == '\n' || *p == '\r' || *p == '#') {
+            break;
+        }
+        ObjCorner corner = {-1, -1, -1, 0};
+        int index;
+        if (!parseInt(p, end, index) ||
+            !resolveIndex(index, chunk.positions.size() / 3, corner.position, corner.relative,
+                          OBJ_RELATIVE_POSITION)) {
+            return false;
+        }
+        if (p < end && *p == '/') {
+            ++p;
+            if (p < end && *p != '/') {
+                if (!parseInt(p, end, index) ||
+                    !resolveIndex(index, chunk.texCoords.size() / 2, corner.texCoord, corner.relative,
+                                  OBJ_RELATIVE_TEX_COORD)) {
+                    return false;
+                }
+            }
+            if (p < end && *p == '/') {
+                ++p;
+                if (!parseInt(p, end, index) ||
+                    !resolveIndex(index, chunk.normals.size() / 3, corner.normal, corner.relative,
+                                  OBJ_RELATIVE_NORMAL)) {
+                    return false;
+                }
+            }
+        }
+        chunk.missingNormals = chunk.missingNormals || corner.normal < 0;
+        chunk.corners.push_back(corner);
+    }
+    return chunk.corners.size() - chunk.faces.back() >= 3;
+}
+
+// Returns the rest of the line, without trailing whitespace:
+static std::string restOfLine(const char *p, const char *end) {
+    p = skipSpaces(p, end);
+    const char *lineEnd = p;
+    while (lineEnd < end && *lineEnd != '\n' && *lineEnd != '#') {
+        ++lineEnd;
+    }
+    while (lineEnd > p && isspace((unsigned char) lineEnd[-1])) {
+        --lineEnd;
+    }
+    return std::string(p, lineEnd);
+}
+
+static void parseChunk(ObjChunk &chunk) {
+    // Reserve for a typical mix of lines so the arrays rarely grow:
+    size_t bytes = chunk.end - chunk.begin;
+    chunk.positions.reserve(bytes / 24);
+    chunk.corners.reserve(bytes / 12);
+    chunk.faces.reserve(bytes / 40);
+
+    const char *p = chunk.begin;
+    const char *end = chunk.end;
+    while (p < end) {
+        const char *line = p;
+        p = skipSpaces(p, end);
+        bool valid = true;
+        if (end - p >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+            p += 2;
+            valid = parseFloats(p, end, chunk.positions, 3, 3);
+        } else if (end - p >= 3 && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t')) {
+            p += 3;
+            valid = parseFloats(p, end, chunk.texCoords, 2, 1);
+        } else if (end - p >= 3 && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t')) {
+            p += 3;
+            valid = parseFloats(p, end, chunk.normals, 3, 3);
+        } else if (end - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+            p += 2;
+            valid = parseFace(p, end, chunk);
+        } else if (end - p >= 7 && memcmp(p, "usemtl", 6) == 0 && isspace((unsigned char) p[6])) {
+            chunk.materialChanges.push_back({chunk.getFaceCount(), restOfLine(p + 6, end)});
+        } else if (end - p >= 7 && memcmp(p, "mtllib", 6) == 0 && isspace((unsigned char) p[6])) {
+            chunk.libraries.push_back(restOfLine(p + 6, end));
+        }
+        // Everything else (comments, groups, smoothing groups, lines, points) doesn't change the mesh
+        if (!valid) {
+            chunk.error = line;
+            return;
+        }
+        p = skipLine(p, end);
+    }
+}
+
+// Cuts [begin, end) into about count chunks that start at line boundaries:
+static std::vector<ObjChunk> splitChunks(const char *begin, const char *end, int count) {
+    std::vector<ObjChunk> chunks;
+    size_t chunkBytes = std::max(OBJ_MIN_CHUNK_BYTES, (size_t) (end - begin) / count + 1);
+    const char *p = begin;
+    while (p < end) {
+        ObjChunk chunk = {};
+        chunk.begin = p;
+        p = (size_t) (end - p) > chunkBytes ? skipLine(p + chunkBytes, end) : end;
+        chunk.end = p;
+        chunks.push_back(std::move(chunk));
+    }
+    return chunks;
+}
+
+// Hash of a vertex key for the deduplication table:
+static inline uint32_t hashKey(int32_t position, int32_t texCoord, int32_t normal, int32_t mesh) {
+    uint32_t hash = (uint32_t) position * 73856093u;
+    hash ^= (uint32_t) texCoord * 19349663u;
+    hash ^= (uint32_t) normal * 83492791u;
+    hash ^= (uint32_t) mesh * 2654435761u;
+    return hash ^ (hash >> 15);
+}
+
+bool ModelImporter::loadObj(const char *path) {
+    MappedFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+    bytesRead += file.size();
+    const char *text = (const char *) file.data();
+    const char *textEnd = text + file.size();
+
+    // 1. Parse chunks of lines side by side:
+    std::vector<ObjChunk> chunks = splitChunks(text, textEnd, threads * OBJ_TASKS_PER_THREAD);
+    runParallel((int) chunks.size(), threads, [&](int i) { parseChunk(chunks[i]); });
+    for (const ObjChunk &chunk : chunks) {
+        if (chunk.error != nullptr) {
+            std::string line = restOfLine(chunk.error, textEnd);
+            printf("ERROR: %s: Invalid line at byte %zu: %s\n", path, (size_t) (chunk.error - text), line.c_str());
+            return false;
+        }
+    }
+
+    // Materials of every library the file names:
+    std::string directory = directoryOf(path);
+    for (const ObjChunk &chunk : chunks) {
+        for (const std::string &library : chunk.libraries) {
+            loadMtl(directory + library);
+        }
+    }
+    std::map<std::string, int> materialIds;
+    for (size_t i = 0; i < materials.size(); ++i) {
+        materialIds[materials[i].name] = (int) i;
+    }
+    auto materialId = [&](const std::string &name) {
+        auto found = materialIds.find(name);
+        return found != materialIds.end() ? found->second : -1;
+    };
+
+    // 2. Place the chunks in the file: where their elements start and the material in use at their start:
+    int32_t positionCount = 0;
+    int32_t texCoordCount = 0;
+    int32_t normalCount = 0;
+    int material = -1;
+    bool missingNormals = false;
+    for (ObjChunk &chunk : chunks) {
+        chunk.positionBase = positionCount;
+        chunk.texCoordBase = texCoordCount;
+        chunk.normalBase = normalCount;
+        chunk.startMaterial = material;
+        positionCount += (int32_t) (chunk.positions.size() / 3);
+        texCoordCount += (int32_t) (chunk.texCoords.size() / 2);
+        normalCount += (int32_t) (chunk.normals.size() / 3);
+        if (!chunk.materialChanges.empty()) {
+            material = materialId(chunk.materialChanges.back().name);
+        }
+        missingNormals = missingNormals || chunk.missingNormals;
+    }
+
+    // Gather the elements into whole-file arrays:
+    std::vector<float> positions((size_t) positionCount * 3);
+    std::vector<float> texCoords((size_t) texCoordCount * 2);
+    std::vector<float> normals((size_t) normalCount * 3);
+    runParallel((int) chunks.size(), threads, [&](int i) {
+        ObjChunk &chunk = chunks[i];
+        std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionBase * 3);
+        std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + chunk.texCoordBase * 2);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalBase * 3);
+        std::vector<float>().swap(chunk.positions);
+        std::vector<float>().swap(chunk.texCoords);
+        std::vector<float>().swap(chunk.normals);
+
+        // Negative indices become absolute now that the bases are known, and every index is checked:
+        for (ObjCorner &corner : chunk.corners) {
+            bool valid = resolveBase(corner.position, corner.relative & OBJ_RELATIVE_POSITION, chunk.positionBase,
+                                     positionCount) && corner.position >= 0;
+            valid = resolveBase(corner.texCoord, corner.relative & OBJ_RELATIVE_TEX_COORD, chunk.texCoordBase,
+                                texCoordCount) && valid;
+            valid = resolveBase(corner.normal, corner.relative & OBJ_RELATIVE_NORMAL, chunk.normalBase,
+                                normalCount) && valid;
+            if (!valid) {
+                chunk.error = chunk.begin;
+            }
+        }
+    });
+    for (const ObjChunk &chunk : chunks) {
+        if (chunk.error != nullptr) {
+            printf("ERROR: %s: A face refers to a vertex that does not exist\n", path);
+            return false;
+        }
+    }
+
+    // Corners without a normal use the smooth normal of their position (area weighted face normals):
+    std::vector<float> positionNormals;
+    if (missingNormals) {
+        positionNormals.assign(positions.size(), 0.0f);
+        for (const ObjChunk &chunk : chunks) {
+            for (uint32_t face = 0; face < chunk.getFaceCount(); ++face) {
+                const ObjCorner *corners = chunk.corners.data() + chunk.faces[face];
+                uint32_t cornerCount = chunk.getFaceEnd(face) - chunk.faces[face];
+                for (uint32_t k = 1; k + 1 < cornerCount; ++k) {
+                    int32_t ids[3] = {corners[0].position, corners[k].position, corners[k + 1].position};
+                    glm::vec3 a = glm::make_vec3(&positions[ids[0] * 3]);
+                    glm::vec3 normal = glm::cross(glm::make_vec3(&positions[ids[1] * 3]) - a,
+                                                  glm::make_vec3(&positions[ids[2] * 3]) - a);
+                    for (int32_t id : ids) {
+                        positionNormals[id * 3] += normal.x;
+                        positionNormals[id * 3 + 1] += normal.y;
+                        positionNormals[id * 3 + 2] += normal.z;
+                    }
+                }
+            }
+        }
+        for (size_t i = 0; i < positionNormals.size(); i += 3) {
+            glm::vec3 normal = glm::make_vec3(&positionNormals[i]);
+            float length = glm::length(normal);
+            normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+            positionNormals[i] = normal.x;
+            positionNormals[i + 1] = normal.y;
+            positionNormals[i + 2] = normal.z;
+        }
+    }
+
+    // 3. Split the faces evenly into jobs; each builds deduplicated vertices per material. Jobs don't share
+    // their tables, so a vertex used on both sides of a job boundary is stored twice (under 1% on large files):
+    size_t faceCount = 0;
+    for (const ObjChunk &chunk : chunks) {
+        faceCount += chunk.getFaceCount();
+    }
+    uint32_t jobFaces = (uint32_t) std::max<size_t>(OBJ_MIN_JOB_FACES,
+                                                    faceCount / (threads * OBJ_TASKS_PER_THREAD) + 1);
+    std::vector<ObjJob> jobs;
+    for (int i = 0; i < (int) chunks.size(); ++i) {
+        for (uint32_t face = 0; face < chunks[i].getFaceCount(); face += jobFaces) {
+            jobs.push_back({i, face, std::min(face + jobFaces, chunks[i].getFaceCount()), {}});
+        }
+    }
+
+    runParallel((int) jobs.size(), threads, [&](int j) {
+        ObjJob &job = jobs[j];
+        const ObjChunk &chunk = chunks[job.chunk];
+
+        // The material in use at the first face:
+        int material = chunk.startMaterial;
+        size_t change = 0;
+        for (; change < chunk.materialChanges.size() && chunk.materialChanges[change].face <= job.faceBegin;
+               ++change) {
+            material = materialId(chunk.materialChanges[change].name);
+        }
+
+        // Open addressing table of the vertices built so far, grown at half load:
+        std::vector<uint32_t> slots(1024, 0);
+        std::vector<ObjVertexKey> keys;
+        keys.reserve((chunk.faces[job.faceEnd - 1] - chunk.faces[job.faceBegin]) / 2 + 16);
+
+        int meshIndex = -1;
+        for (uint32_t face = job.faceBegin; face < job.faceEnd; ++face) {
+            for (; change < chunk.materialChanges.size() && chunk.materialChanges[change].face <= face; ++change) {
+                material = materialId(chunk.materialChanges[change].name);
+            }
+            if (meshIndex < 0 || job.meshes[meshIndex].material != material) {
+                meshIndex = -1;
+                for (size_t m = 0; m < job.meshes.size(); ++m) {
+                    meshIndex = job.meshes[m].material == material ? (int) m : meshIndex;
+                }
+                if (meshIndex < 0) {
+                    meshIndex = (int) job.meshes.size();
+                    job.meshes.push_back({material, {}, {}, 0, 0});
+                }
+            }
+            ObjJobMesh &mesh = job.meshes[meshIndex];
+            int floatsPerVertex = material >= 0 && materials[material].normal.exists() ? MESH_TANGENT_VERTEX_FLOATS
+                                                                                       : MESH_VERTEX_FLOATS;
+
+            const ObjCorner *corners = chunk.corners.data() + chunk.faces[face];
+            uint32_t cornerCount = chunk.getFaceEnd(face) - chunk.faces[face];
+            unsigned int firstIndex = 0;
+            unsigned int previousIndex = 0;
+            for (uint32_t k = 0; k < cornerCount; ++k) {
+                const ObjCorner &corner = corners[k];
+
+                // Find or add the vertex:
+                if (keys.size() * 2 >= slots.size()) {
+                    slots.assign(slots.size() * 2, 0);
+                    for (size_t i = 0; i < keys.size(); ++i) {
+                        const ObjVertexKey &key = keys[i];
+                        uint32_t slot = hashKey(key.position, key.texCoord, key.normal, key.mesh) &
+                                        (uint32_t) (slots.size() - 1);
+                        while (slots[slot] != 0) {
+                            slot = (slot + 1) & (uint32_t) (slots.size() - 1);
+                        }
+                        slots[slot] = (uint32_t) i + 1;
+                    }
+                }
+                uint32_t slot = hashKey(corner.position, corner.texCoord, corner.normal, meshIndex) &
+                                (uint32_t) (slots.size() - 1);
+                unsigned int index = 0;
+                bool found = false;
+                while (slots[slot] != 0) {
+                    const ObjVertexKey &key = keys[slots[slot] - 1];
+                    if (key.position == corner.position && key.texCoord == corner.texCoord &&
+                        key.normal == corner.normal && key.mesh == meshIndex) {
+                        index = key.index;
+                        found = true;
+                        break;
+                    }
+                    slot = (slot + 1) & (uint32_t) (slots.size() - 1);
+                }
+                if (!found) {
+                    index = (unsigned int) (mesh.vertices.size() / floatsPerVertex);
+                    slots[slot] = (uint32_t) keys.size() + 1;
+                    keys.push_back({corner.position, corner.texCoord, corner.normal, meshIndex, index});
+
+                    size_t base = mesh.vertices.size();
+                    mesh.vertices.resize(base + floatsPerVertex, 0.0f);
+                    float *v = mesh.vertices.data() + base;
+                    memcpy(v, &positions[(size_t) corner.position * 3], 3 * sizeof(float));
+                    const float *normal = corner.normal >= 0 ? &normals[(size_t) corner.normal * 3]
+                                                             : &positionNormals[(size_t) corner.position * 3];
+                    memcpy(v + 3, normal, 3 * sizeof(float));
+                    if (corner.texCoord >= 0) {
+                        memcpy(v + 6, &texCoords[(size_t) corner.texCoord * 2], 2 * sizeof(float));
+                    }
+                }
+
+                // Fan triangulation of polygons:
+                if (k == 0) {
+                    firstIndex = index;
+                } else if (k >= 2) {
+                    mesh.indices.push_back(firstIndex);
+                    mesh.indices.push_back(previousIndex);
+                    mesh.indices.push_back(index);
+                }
+                previousIndex = index;
+            }
+        }
+    });
+
+    // 4. Merge the jobs' meshes by material, in job order:
+    std::map<int, size_t> meshIds;
+    for (ObjJob &job : jobs) {
+        for (ObjJobMesh &jobMesh : job.meshes) {
+            auto found = meshIds.find(jobMesh.material);
+            if (found == meshIds.end()) {
+                found = meshIds.insert({jobMesh.material, meshes.size()}).first;
+                int floatsPerVertex = jobMesh.material >= 0 && materials[jobMesh.material].normal.exists()
+                                      ? MESH_TANGENT_VERTEX_FLOATS : MESH_VERTEX_FLOATS;
+                meshes.push_back({jobMesh.material, floatsPerVertex, {}, {}});
+            }
+            ImportedMesh &mesh = meshes[found->second];
+            jobMesh.vertexBase = mesh.vertices.size();
+            jobMesh.indexBase = mesh.indices.size();
+            mesh.vertices.resize(mesh.vertices.size() + jobMesh.vertices.size());
+            mesh.indices.resize(mesh.indices.size() + jobMesh.indices.size());
+        }
+    }
+    runParallel((int) jobs.size(), threads, [&](int j) {
+        for (ObjJobMesh &jobMesh : jobs[j].meshes) {
+            ImportedMesh &mesh = meshes[meshIds.at(jobMesh.material)];
+            std::copy(jobMesh.vertices.begin(), jobMesh.vertices.end(), mesh.vertices.begin() + jobMesh.vertexBase);
+            unsigned int vertexBase = (unsigned int) (jobMesh.vertexBase / mesh.floatsPerVertex);
+            unsigned int *indices = mesh.indices.data() + jobMesh.indexBase;
+            for (size_t i = 0; i < jobMesh.indices.size(); ++i) {
+                indices[i] = jobMesh.indices[i] + vertexBase;
+            }
+        }
+    });
+    runParallel((int) meshes.size(), threads, [&](int i) { computeTangents(meshes[i]); });
+    return true;
+}
+
+bool ModelImporter::loadMtl(const std::string &path) {
+    std::ifstream in(path);
+    if (!in) {
+        printf("WARNING: Failed to open the material library %s\n", path.c_str());
+        return false;
+    }
+    in.seekg(0, std::ios::end);
+    bytesRead += (size_t) in.tellg();
+    in.seekg(0);
+
+    // Texture paths are the last word of their line, after any options:
+    std::string directory = directoryOf(path);
+    auto texturePath = [&](std::istringstream &line) {
+        std::string word;
+        std::string last;
+        while (line >> word) {
+            last = word;
+        }
+        return last.empty() ? last : directory + last;
+    };
+
+    std::string text;
+    while (std::getline(in, text)) {
+        std::istringstream line(text.substr(0, text.find('#')));
+        std::string keyword;
+        if (!(line >> keyword)) {
+            continue;
+        }
+        if (keyword == "newmtl") {
+            ImportedMaterial material = defaultMaterial;
+            line >> material.name;
+            materials.push_back(material);
+        } else if (materials.empty()) {
+            continue;
+        } else if (keyword == "Kd") {
+            line >> materials.back().color.r >> materials.back().color.g >> materials.back().color.b;
+        } else if (keyword == "Ks") {
+            line >> materials.back().specular.r >> materials.back().specular.g >> materials.back().specular.b;
+        } else if (keyword == "Ns") {
+            line >> materials.back().shininess;
+            materials.back().shininess = std::max(1.0f, materials.back().shininess);
+        } else if (keyword == "map_Kd") {
+            materials.back().diffuse.path = texturePath(line);
+        } else if (keyword == "map_Bump" || keyword == "map_bump" || keyword == "bump" || keyword == "norm") {
+            materials.back().normal.path = texturePath(line);
+        }
+    }
+    return true;
+}
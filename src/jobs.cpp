@@ -0,0 +1,230 @@
+#include "jobs.h"
+
+#include <algorithm>
+
+JobSystem jobs;
+
+// The worker running this thread, from 1 (0 outside the pool):
+static thread_local int workerIndex = 0;
+
+JobDeque::JobDeque() : top(0), bottom(0) {
+    for (auto &job : jobs) {
+        job.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+bool JobDeque::push(Job *job) {
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= JOB_DEQUE_CAPACITY) {
+        return false;
+    }
+    jobs[b % JOB_DEQUE_CAPACITY].store(job, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+Job *JobDeque::pop() {
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+    if (t > b) {
+        // Empty:
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    Job *job = jobs[b % JOB_DEQUE_CAPACITY].load(std::memory_order_relaxed);
+    if (t == b) {
+        // The last job, which a thief may be taking too; whoever moves top gets it:
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            job = nullptr;
+        }
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job *JobDeque::steal() {
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+    if (t >= b) {
+        return nullptr;
+    }
+    Job *job = jobs[t % JOB_DEQUE_CAPACITY].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    return job;
+}
+
+JobSystem::JobSystem() : sharedCount(0), queuedJobs(0), sleepingWorkers(0), started(false), stopping(false) {
+}
+
+JobSystem::~JobSystem() {
+    stop();
+}
+
+void JobSystem::start(int threads) {
+    std::lock_guard<std::mutex> lock(startMutex);
+    if (started.load()) {
+        return;
+    }
+    if (threads <= 0) {
+        threads = (int) std::max(1u, std::thread::hardware_concurrency());
+    }
+    stopping = false;
+    for (int i = 1; i < threads; ++i) {
+        deques.emplace_back(new JobDeque());
+    }
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(&JobSystem::runWorker, this, i);
+    }
+    started = true;
+}
+
+void JobSystem::stop() {
+    std::lock_guard<std::mutex> lock(startMutex);
+    if (!started.load()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> sleepLock(sleepMutex);
+        stopping = true;
+    }
+    wakeWorkers.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    deques.clear();
+    started = false;
+}
+
+void JobSystem::ensureStarted() {
+    if (!started.load(std::memory_order_acquire)) {
+        start(0);
+    }
+}
+
+int JobSystem::getThreadCount() {
+    ensureStarted();
+    return (int) workers.size() + 1;
+}
+
+int JobSystem::getWorkerIndex() {
+    return workerIndex;
+}
+
+void JobSystem::submit(const std::function<void()> &work, JobCounter *counter) {
+    ensureStarted();
+    Job *job = new Job{work, counter};
+    if (counter != nullptr) {
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // A worker keeps its jobs, where others steal them. The job never runs here, so callers may hold locks:
+    if (workerIndex == 0 || !deques[workerIndex - 1]->push(job)) {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        sharedJobs.push_back(job);
+        sharedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Either a worker going to sleep sees the job, or this sees the sleeping worker:
+    queuedJobs.fetch_add(1);
+    if (sleepingWorkers.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wakeWorkers.notify_one();
+    }
+}
+
+Job *JobSystem::take(int worker) {
+    Job *job = nullptr;
+    if (worker > 0) {
+        job = deques[worker - 1]->pop();
+    }
+    if (job == nullptr && sharedCount.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        if (!sharedJobs.empty()) {
+            job = sharedJobs.front();
+            sharedJobs.pop_front();
+            sharedCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Steal from the other workers in turn, starting after this one so thieves spread out:
+    int dequeCount = (int) deques.size();
+    for (int i = 0; job == nullptr && i < dequeCount; ++i) {
+        int victim = (worker + i) % dequeCount;
+        if (victim != worker - 1) {
+            job = deques[victim]->steal();
+        }
+    }
+    if (job != nullptr) {
+        queuedJobs.fetch_sub(1);
+    }
+    return job;
+}
+
+void JobSystem::run(Job *job) {
+    job->work();
+    if (job->counter != nullptr) {
+        job->counter->pending.fetch_sub(1, std::memory_order_release);
+    }
+    delete job;
+}
+
+void JobSystem::runWorker(int worker) {
+    workerIndex = worker;
+    int idleRounds = 0;
+    while (!stopping.load()) {
+        Job *job = take(worker);
+        if (job != nullptr) {
+            run(job);
+            idleRounds = 0;
+        } else if (++idleRounds < JOB_SPIN_ROUNDS) {
+            std::this_thread::yield();
+        } else {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepingWorkers.fetch_add(1);
+            wakeWorkers.wait(lock, [this]() { return stopping.load() || queuedJobs.load() > 0; });
+            sleepingWorkers.fetch_sub(1);
+            idleRounds = 0;
+        }
+    }
+}
+
+void JobSystem::wait(JobCounter &counter) {
+    while (!counter.isDone()) {
+        Job *job = take(workerIndex);
+        if (job != nullptr) {
+            run(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::parallelFor(int count, int grain, const std::function<void(int, int)> &body) {
+    if (count <= 0) {
+        return;
+    }
+    int threads = getThreadCount();
+    if (grain <= 0) {
+        grain = std::max(1, count / (threads * 4));
+    }
+    if (threads == 1 || grain >= count) {
+        body(0, count);
+        return;
+    }
+
+    // Queue every chunk but the first, which this thread runs before it helps with the rest:
+    JobCounter counter;
+    for (int begin = grain; begin < count; begin += grain) {
+        int end = std::min(count, begin + grain);
+        submit([&body, begin, end]() { body(begin, end); }, &counter);
+    }
+    body(0, grain);
+    wait(counter);
+}
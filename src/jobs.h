@@ -0,0 +1,120 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Jobs a worker's deque holds; further jobs it submits go to the shared queue:
+const int JOB_DEQUE_CAPACITY = 4096;
+
+// Idle rounds (a failed take, then a yield) before a worker goes to sleep:
+const int JOB_SPIN_ROUNDS = 64;
+
+// Counts unfinished jobs; submit them with it, then wait on it like a fence.
+class JobCounter {
+public:
+    JobCounter() : pending(0) {}
+
+    bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<int> pending;
+};
+
+struct Job {
+    std::function<void()> work;
+    JobCounter *counter; // may be null
+};
+
+// A Chase-Lev work-stealing deque of fixed size (memory orders after Le et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models"). Only its owner pushes and pops, at the bottom, newest first; any thread
+// steals from the top, oldest first, so thieves take the big early jobs and rarely contend with the owner.
+class JobDeque {
+public:
+    JobDeque();
+
+    // Owner only; returns false if the deque is full:
+    bool push(Job *job);
+
+    // Owner only; null if empty:
+    Job *pop();
+
+    // Any thread; null if empty or another thread took the job first:
+    Job *steal();
+
+private:
+    std::atomic<int64_t> top;
+    std::atomic<int64_t> bottom;
+    std::atomic<Job *> jobs[JOB_DEQUE_CAPACITY];
+};
+
+// The engine's pool of worker threads. Each worker has its own deque: jobs it submits go there and it runs them
+// first, while idle workers steal from the others, so fan-out work (parallelFor, jobs that submit jobs) spreads
+// over every core without a shared queue. Threads outside the pool (the main thread, startup tasks) submit to a
+// shared queue and run jobs while they wait, so they count as one of the threads.
+class JobSystem {
+public:
+    JobSystem();
+
+    ~JobSystem();
+
+    // Starts threads - 1 workers (every hardware thread for 0). Jobs submitted before start the pool with every
+    // hardware thread. Does nothing if the pool runs.
+    void start(int threads);
+
+    // Joins the workers; no jobs may be left. start may be called again, e.g. with another thread count.
+    void stop();
+
+    // The workers plus the thread that waits:
+    int getThreadCount();
+
+    // The worker running this thread, from 1, or 0 outside the pool:
+    static int getWorkerIndex();
+
+    // Queues a job, which never runs on this thread before submit returns, so callers may hold locks. counter,
+    // if any, counts it until it has run.
+    void submit(const std::function<void()> &work, JobCounter *counter = nullptr);
+
+    // Runs jobs until the counter's have all finished:
+    void wait(JobCounter &counter);
+
+    // Calls body(begin, end) over [0, count) in chunks of grain items (0 picks about four chunks per thread) on
+    // every thread of the pool, the calling one included, and returns once all have finished.
+    void parallelFor(int count, int grain, const std::function<void(int, int)> &body);
+
+private:
+    void ensureStarted();
+
+    // A job from this worker's deque, the shared queue or another worker's deque; null if there is none:
+    Job *take(int worker);
+
+    void run(Job *job);
+
+    void runWorker(int worker);
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<JobDeque>> deques; // one per worker, from worker 1 at index 0
+    std::deque<Job *> sharedJobs;
+    std::mutex sharedMutex;
+    std::atomic<int> sharedCount;
+    std::atomic<int> queuedJobs; // jobs submitted and not taken yet, which keeps workers awake
+    std::atomic<int> sleepingWorkers;
+    std::mutex sleepMutex;
+    std::condition_variable wakeWorkers;
+    std::mutex startMutex;
+    std::atomic<bool> started;
+    std::atomic<bool> stopping;
+};
+
+extern JobSystem jobs;
+
+#endif //JOBS_H
@@ -0,0 +1,293 @@
+#include "json.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Deepest nesting accepted, so malformed input can't overflow the stack:
+const int JSON_MAX_DEPTH = 256;
+
+// Recursive descent over the document text:
+class JsonParser {
+public:
+    JsonParser(const char *text, size_t length) : begin(text), p(text), end(text + length) {}
+
+    bool parseDocument(JsonValue &value) {
+        bool valid = parseValue(value, 0);
+        skipWhitespace();
+        if (!valid || p != end) {
+            printf("ERROR: JSON syntax error at offset %d\n", (int) (p - begin));
+            return false;
+        }
+        return true;
+    }
+
+private:
+    void skipWhitespace() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+            ++p;
+        }
+    }
+
+    bool match(const char *literal) {
+        size_t length = strlen(literal);
+        if ((size_t) (end - p) < length || memcmp(p, literal, length) != 0) {
+            return false;
+        }
+        p += length;
+        return true;
+    }
+
+    bool parseValue(JsonValue &value, int depth) {
+        skipWhitespace();
+        if (p == end || depth > JSON_MAX_DEPTH) {
+            return false;
+        }
+        switch (*p) {
+            case '{':
+                return parseObject(value, depth);
+            case '[':
+                return parseArray(value, depth);
+            case '"':
+                value.type = JsonValue::JSON_STRING;
+                return parseString(value.string);
+            case 't':
+                value.type = JsonValue::JSON_BOOL;
+                value.boolean = true;
+                return match("true");
+            case 'f':
+                value.type = JsonValue::JSON_BOOL;
+                value.boolean = false;
+                return match("false");
+            case 'n':
+                value.type = JsonValue::JSON_NULL;
+                return match("null");
+            default:
+                return parseNumber(value);
+        }
+    }
+
+    bool parseObject(JsonValue &value, int depth) {
+        value.type = JsonValue::JSON_OBJECT;
+        ++p;
+        skipWhitespace();
+        if (p < end && *p == '}') {
+            ++p;
+            return true;
+        }
+        while (true) {
+            skipWhitespace();
+            value.keys.emplace_back();
+            value.elements.emplace_back();
+            if (p == end || *p != '"' || !parseString(value.keys.back())) {
+                return false;
+            }
+            skipWhitespace();
+            if (p == end || *p++ != ':' || !parseValue(value.elements.back(), depth + 1)) {
+                return false;
+            }
+            skipWhitespace();
+            if (p == end) {
+                return false;
+            }
+            if (*p == '}') {
+                ++p;
+                return true;
+            }
+            if (*p++ != ',') {
+                return false;
+            }
+        }
+    }
+
+    bool parseArray(JsonValue &value, int depth) {
+        value.type = JsonValue::JSON_ARRAY;
+        ++p;
+        skipWhitespace();
+        if (p < end && *p == ']') {
+            ++p;
+            return true;
+        }
+        while (true) {
+            value.elements.emplace_back();
+            if (!parseValue(value.elements.back(), depth + 1)) {
+                return false;
+            }
+            skipWhitespace();
+            if (p == end) {
+                return false;
+            }
+            if (*p == ']') {
+                ++p;
+                return true;
+            }
+            if (*p++ != ',') {
+                return false;
+            }
+        }
+    }
+
+    // Reads 4 hex digits of a \u escape:
+    bool parseHex(unsigned int &code) {
+        if (end - p < 4) {
+            return false;
+        }
+        code = 0;
+        for (int i = 0; i < 4; ++i, ++p) {
+            char c = *p;
+            code <<= 4;
+            if (c >= '0' && c <= '9') {
+                code |= c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                code |= c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                code |= c - 'A' + 10;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void appendUtf8(std::string &out, unsigned int code) {
+        if (code < 0x80) {
+            out += (char) code;
+        } else if (code < 0x800) {
+            out += (char) (0xc0 | (code >> 6));
+            out += (char) (0x80 | (code & 0x3f));
+        } else if (code < 0x10000) {
+            out += (char) (0xe0 | (code >> 12));
+            out += (char) (0x80 | ((code >> 6) & 0x3f));
+            out += (char) (0x80 | (code & 0x3f));
+        } else {
+            out += (char) (0xf0 | (code >> 18));
+            out += (char) (0x80 | ((code >> 12) & 0x3f));
+            out += (char) (0x80 | ((code >> 6) & 0x3f));
+            out += (char) (0x80 | (code & 0x3f));
+        }
+    }
+
+    bool parseString(std::string &out) {
+        ++p;
+        while (p < end && *p != '"') {
+            if (*p != '\\') {
+                out += *p++;
+                continue;
+            }
+            if (++p == end) {
+                return false;
+            }
+            char escape = *p++;
+            switch (escape) {
+                case '"':
+                case '\\':
+                case '/':
+                    out += escape;
+                    break;
+                case 'b':
+                    out += '\b';
+                    break;
+                case 'f':
+                    out += '\f';
+                    break;
+                case 'n':
+                    out += '\n';
+                    break;
+                case 'r':
+                    out += '\r';
+                    break;
+                case 't':
+                    out += '\t';
+                    break;
+                case 'u': {
+                    unsigned int code;
+                    if (!parseHex(code)) {
+                        return false;
+                    }
+                    // A high surrogate combines with the low surrogate escape after it:
+                    unsigned int low;
+                    if (code >= 0xd800 && code < 0xdc00 && match("\\u") && parseHex(low) && low >= 0xdc00 &&
+                        low < 0xe000) {
+                        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                    }
+                    appendUtf8(out, code);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        if (p == end) {
+            return false;
+        }
+        ++p;
+        return true;
+    }
+
+    bool parseNumber(JsonValue &value) {
+        // strtod needs a terminated string; numbers are short, so copy the candidate characters:
+        char buffer[64];
+        size_t length = 0;
+        while (p + length < end && length < sizeof(buffer) - 1 && strchr("+-0123456789.eE", p[length])) {
+            buffer[length] = p[length];
+            ++length;
+        }
+        buffer[length] = '\0';
+        char *numberEnd;
+        value.number = strtod(buffer, &numberEnd);
+        if (length == 0 || numberEnd != buffer + length) {
+            return false;
+        }
+        value.type = JsonValue::JSON_NUMBER;
+        p += length;
+        return true;
+    }
+
+    const char *begin;
+    const char *p;
+    const char *end;
+};
+
+JsonValue::JsonValue() {
+    type = JSON_NULL;
+    boolean = false;
+    number = 0.0;
+}
+
+bool JsonValue::parse(const char *text, size_t length) {
+    *this = JsonValue();
+    JsonParser parser(text, length);
+    return parser.parseDocument(*this);
+}
+
+// Returned for missing elements and members:
+static const JsonValue NULL_VALUE;
+
+const JsonValue &JsonValue::operator[](size_t index) const {
+    if (type != JSON_ARRAY || index >= elements.size()) {
+        return NULL_VALUE;
+    }
+    return elements[index];
+}
+
+const JsonValue &JsonValue::operator[](const char *key) const {
+    if (type == JSON_OBJECT) {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (keys[i] == key) {
+                return elements[i];
+            }
+        }
+    }
+    return NULL_VALUE;
+}
+
+void writeJsonString(FILE *file, const std::string &s) {
+    fputc('"', file);
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            fputc('\\', file);
+        }
+        fputc((unsigned char) c < 0x20 ? ' ' : c, file);
+    }
+    fputc('"', file);
+}
@@ -0,0 +1,65 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// A parsed JSON value. Objects keep their members in file order and look keys up linearly, which suits the
+// small documents it reads (glTF headers); bulk data lives in binary buffers next to them.
+class JsonValue {
+public:
+    enum Type {
+        JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT
+    };
+
+    JsonValue();
+
+    // Parses a document, replacing this value. Returns false and prints the offset of a syntax error.
+    bool parse(const char *text, size_t length);
+
+    Type getType() const { return type; }
+
+    bool isNull() const { return type == JSON_NULL; }
+
+    bool getBool(bool fallback = false) const { return type == JSON_BOOL ? boolean : fallback; }
+
+    double getNumber(double fallback = 0.0) const { return type == JSON_NUMBER ? number : fallback; }
+
+    int getInt(int fallback = 0) const { return type == JSON_NUMBER ? (int) number : fallback; }
+
+    // Returns a count or byte offset; negative numbers read as 0:
+    size_t getSize() const { return type == JSON_NUMBER && number > 0.0 ? (size_t) number : 0; }
+
+    // Returns the string, or an empty one if this is not a string:
+    const std::string &getString() const { return string; }
+
+    // Elements of an array or members of an object:
+    size_t size() const { return elements.size(); }
+
+    // Returns an array element, or a null value if out of range or not an array:
+    const JsonValue &operator[](size_t index) const;
+
+    const JsonValue &operator[](int index) const { return (*this)[(size_t) index]; }
+
+    // Returns an object member, or a null value if missing or not an object:
+    const JsonValue &operator[](const char *key) const;
+
+    bool has(const char *key) const { return !(*this)[key].isNull(); }
+
+private:
+    friend class JsonParser;
+
+    Type type;
+    bool boolean;
+    double number;
+    std::string string;
+    std::vector<JsonValue> elements;
+    std::vector<std::string> keys; // one per element of an object
+};
+
+// Writes s as a JSON string (control characters become spaces):
+void writeJsonString(FILE *file, const std::string &s);
+
+#endif //JSON_H
@@ -0,0 +1,191 @@
+#include "ktxfile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+static const unsigned char KTX_IDENTIFIER[12] = {0xab, 0x4b, 0x54, 0x58, 0x20, 0x31, 0x31, 0xbb, 0x0d, 0x0a, 0x1a,
+                                                 0x0a};
+const uint32_t KTX_ENDIANNESS = 0x04030201;
+
+// Levels are stored with the first row at the bottom:
+static const char KTX_ORIENTATION[] = "KTXorientation\0S=r,T=u";
+
+struct KtxHeader {
+    unsigned char identifier[12];
+    uint32_t endianness;
+    uint32_t glType;              // 0 for compressed formats
+    uint32_t glTypeSize;          // 1 for compressed formats
+    uint32_t glFormat;            // 0 for compressed formats
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;          // 0 for 2D textures
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+uint32_t getCompressedBlockBytes(GLenum internalFormat) {
+    switch (internalFormat) {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+            return 8;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_RG_RGTC2:
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+uint32_t getCompressedLevelSize(GLenum internalFormat, uint32_t width, uint32_t height) {
+    return ((width + KTX_BLOCK_SIZE - 1) / KTX_BLOCK_SIZE) * ((height + KTX_BLOCK_SIZE - 1) / KTX_BLOCK_SIZE) *
+           getCompressedBlockBytes(internalFormat);
+}
+
+// Base format of a compressed format, as KTX records it:
+static GLenum getBaseInternalFormat(GLenum internalFormat) {
+    switch (internalFormat) {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+            return GL_RGB;
+        case GL_COMPRESSED_RG_RGTC2:
+            return GL_RG;
+        default:
+            return GL_RGBA;
+    }
+}
+
+KtxFile::KtxFile() {
+    internalFormat = GL_NONE;
+    width = 0;
+    height = 0;
+}
+
+bool KtxFile::open(const char *path, bool mustExist) {
+    close();
+    if (!file.open(path, mustExist)) {
+        return false;
+    }
+    if (!parse(file.data(), file.size())) {
+        printf("ERROR: %s is not a supported KTX texture\n", path);
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool KtxFile::openMemory(const unsigned char *bytes, size_t size, const char *name) {
+    close();
+    if (!parse(bytes, size)) {
+        printf("ERROR: %s is not a supported KTX texture\n", name);
+        close();
+        return false;
+    }
+    return true;
+}
+
+void KtxFile::close() {
+    file.close();
+    levels.clear();
+    internalFormat = GL_NONE;
+    width = 0;
+    height = 0;
+}
+
+bool KtxFile::parse(const unsigned char *bytes, size_t size) {
+    KtxHeader header;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, bytes, sizeof(header));
+    if (memcmp(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0 ||
+        header.endianness != KTX_ENDIANNESS || header.glType != 0 || header.glFormat != 0 ||
+        getCompressedBlockBytes(header.glInternalFormat) == 0 || header.pixelWidth == 0 || header.pixelHeight == 0 ||
+        header.pixelDepth != 0 || header.numberOfArrayElements != 0 || header.numberOfFaces != 1 ||
+        header.numberOfMipmapLevels == 0 || header.numberOfMipmapLevels > 32 ||
+        header.bytesOfKeyValueData > size - sizeof(header)) {
+        return false;
+    }
+    internalFormat = header.glInternalFormat;
+    width = header.pixelWidth;
+    height = header.pixelHeight;
+
+    // Each level is its size followed by its blocks; block sizes keep every level 4-byte aligned:
+    size_t offset = sizeof(header) + header.bytesOfKeyValueData;
+    for (uint32_t i = 0; i < header.numberOfMipmapLevels; ++i) {
+        KtxLevel level;
+        level.width = std::max(1u, width >> i);
+        level.height = std::max(1u, height >> i);
+        if (offset + sizeof(uint32_t) > size) {
+            return false;
+        }
+        memcpy(&level.size, bytes + offset, sizeof(uint32_t));
+        offset += sizeof(uint32_t);
+        if (level.size != getCompressedLevelSize(internalFormat, level.width, level.height) ||
+            level.size > size - offset) {
+            return false;
+        }
+        level.data = bytes + offset;
+        offset += level.size;
+        levels.push_back(level);
+    }
+    return true;
+}
+
+bool KtxFile::write(const char *path, GLenum internalFormat, uint32_t width, uint32_t height,
+                    const std::vector<std::vector<unsigned char>> &levels) {
+    // The orientation key, padded to 4 bytes:
+    uint32_t keyValueSize = sizeof(KTX_ORIENTATION);
+    uint32_t keyValuePadding = (4 - keyValueSize % 4) % 4;
+
+    KtxHeader header = {};
+    memcpy(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+    header.endianness = KTX_ENDIANNESS;
+    header.glTypeSize = 1;
+    header.glInternalFormat = internalFormat;
+    header.glBaseInternalFormat = getBaseInternalFormat(internalFormat);
+    header.pixelWidth = width;
+    header.pixelHeight = height;
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = (uint32_t) levels.size();
+    header.bytesOfKeyValueData = sizeof(uint32_t) + keyValueSize + keyValuePadding;
+
+    // Assemble the file in memory so it is written with one call:
+    std::vector<unsigned char> bytes((const unsigned char *) &header, (const unsigned char *) &header + sizeof(header));
+    bytes.insert(bytes.end(), (const unsigned char *) &keyValueSize, (const unsigned char *) &keyValueSize + 4);
+    bytes.insert(bytes.end(), KTX_ORIENTATION, KTX_ORIENTATION + keyValueSize);
+    bytes.resize(bytes.size() + keyValuePadding, 0);
+    for (const std::vector<unsigned char> &level : levels) {
+        auto size = (uint32_t) level.size();
+        bytes.insert(bytes.end(), (const unsigned char *) &size, (const unsigned char *) &size + 4);
+        bytes.insert(bytes.end(), level.begin(), level.end());
+    }
+
+    FILE *out = fopen(path, "wb");
+    if (out == nullptr) {
+        printf("ERROR: Failed to write %s\n", path);
+        return false;
+    }
+    bool written = fwrite(bytes.data(), 1, bytes.size(), out) == bytes.size();
+    written = fclose(out) == 0 && written;
+    if (!written) {
+        printf("ERROR: Failed to write %s\n", path);
+    }
+    return written;
+}
+
+std::string getKtxPath(const char *image) {
+    std::string path = image;
+    size_t dot = path.find_last_of('.');
+    if (dot != std::string::npos && path.find_first_of("/\\", dot) == std::string::npos) {
+        path.resize(dot);
+    }
+    return path + ".ktx";
+}
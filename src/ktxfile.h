@@ -0,0 +1,71 @@
+#ifndef KTXFILE_H
+#define KTXFILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "opengl.h"
+#include "mappedfile.h"
+
+// Compressed formats are stored in 4x4 texel blocks:
+const uint32_t KTX_BLOCK_SIZE = 4;
+
+// One mip level of a KTX file, pointing into the mapped file (or the memory it was read from):
+struct KtxLevel {
+    const unsigned char *data;
+    uint32_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+// A KTX 1.1 file holding a block compressed 2D texture (BC1, BC3, BC5 or BC7) with its whole mip chain.
+//
+// The levels are stored bottom row first, the way OpenGL expects them (the file says so with the
+// KTXorientation key "S=r,T=u"), so they can be uploaded straight from the mapping.
+class KtxFile {
+public:
+    KtxFile();
+
+    // Maps a file and checks its header and levels. A missing file is only an error if mustExist is set.
+    bool open(const char *path, bool mustExist = true);
+
+    // Reads a KTX file already in memory, such as an asset pack entry. The levels point into bytes, which
+    // must outlive this object; name is only used in errors.
+    bool openMemory(const unsigned char *bytes, size_t size, const char *name);
+
+    void close();
+
+    GLenum getInternalFormat() const { return internalFormat; }
+
+    uint32_t getWidth() const { return width; }
+
+    uint32_t getHeight() const { return height; }
+
+    uint32_t getLevelCount() const { return (uint32_t) levels.size(); }
+
+    const KtxLevel &getLevel(uint32_t level) const { return levels[level]; }
+
+    // Writes a texture whose levels are already compressed in internalFormat, from level 0 down:
+    static bool write(const char *path, GLenum internalFormat, uint32_t width, uint32_t height,
+                      const std::vector<std::vector<unsigned char>> &levels);
+
+private:
+    bool parse(const unsigned char *bytes, size_t size);
+
+    MappedFile file;
+    GLenum internalFormat;
+    uint32_t width;
+    uint32_t height;
+    std::vector<KtxLevel> levels;
+};
+
+// Returns the bytes per 4x4 block of a supported compressed format, 0 for any other format:
+uint32_t getCompressedBlockBytes(GLenum internalFormat);
+
+// Returns the size of a level of a compressed format:
+uint32_t getCompressedLevelSize(GLenum internalFormat, uint32_t width, uint32_t height);
+
+// Returns the path of the KTX file baked from an image: the image's path with a .ktx extension.
+std::string getKtxPath(const char *image);
+
+#endif //KTXFILE_H
@@ -0,0 +1,89 @@
+#include "lod.h"
+
+#include <cmath>
+#include <algorithm>
+
+// Coarsest sector and stack counts that still read as the shape:
+const int MIN_LOD_SECTORS = 6;
+const int MIN_LOD_SPHERE_STACKS = 4;
+const int MIN_LOD_CYLINDER_STACKS = 1;
+const int MIN_LOD_TORUS_STACKS = 6;
+
+bool LodSelector::enabled = true;
+float LodSelector::targetSegmentPixels = 8.0f;
+float LodSelector::hysteresis = 0.25f;
+
+// Halves count, but not below minimum (and never raises it):
+static int halve(int count, int minimum) {
+    return std::min(count, std::max(count / 2, minimum));
+}
+
+std::vector<MeshParams> buildLodChain(const MeshParams &params, int maxLevels) {
+    int minStacks = MIN_LOD_CYLINDER_STACKS;
+    if (params.shape == MESH_SPHERE) {
+        minStacks = MIN_LOD_SPHERE_STACKS;
+    } else if (params.shape == MESH_TORUS) {
+        minStacks = MIN_LOD_TORUS_STACKS;
+    }
+
+    std::vector<MeshParams> chain(1, params);
+    while ((int) chain.size() < maxLevels) {
+        MeshParams next = chain.back();
+        next.sectors = halve(next.sectors, MIN_LOD_SECTORS);
+        next.stacks = halve(next.stacks, minStacks);
+        if (next.sectors == chain.back().sectors && next.stacks == chain.back().stacks) {
+            break;
+        }
+        chain.push_back(next);
+    }
+    return chain;
+}
+
+float projectedLength(const glm::vec3 &center, float boundingRadius, float length, const glm::mat4 &view,
+                      const glm::mat4 &projection, int viewportHeight) {
+    // projection[1][1] maps view space height to NDC (which spans 2 across the viewport height):
+    float pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+    if (projection[3][3] == 1.0f) {
+        return length * pixelsPerUnit; // orthographic, no perspective divide
+    }
+
+    float depth = -(view * glm::vec4(center, 1.0f)).z - boundingRadius;
+    if (depth <= 0.0f) {
+        return 1e9f;
+    }
+    return length * pixelsPerUnit / depth;
+}
+
+LodSelector::LodSelector() {
+    levelCount = 1;
+    sectors = 0;
+    radius = 0.0f;
+    boundingRadius = 0.0f;
+}
+
+void LodSelector::setChain(int levelCount, int sectors, float radius, float boundingRadius) {
+    this->levelCount = levelCount;
+    this->sectors = sectors;
+    this->radius = radius;
+    this->boundingRadius = boundingRadius;
+}
+
+int LodSelector::choose(const glm::vec3 &center, float scale, int current, const glm::mat4 &view,
+                        const glm::mat4 &projection, int viewportHeight) const {
+    if (!enabled || levelCount <= 1) {
+        return 0;
+    }
+
+    // Sectors the circle needs on screen, and the (fractional) level halving down to that:
+    float circumference = projectedLength(center, boundingRadius * scale, 2.0f * (float) PI * radius * scale,
+                                          view, projection, viewportHeight);
+    float neededSectors = std::max(circumference / targetSegmentPixels, 1.0f);
+    float ideal = std::log2((float) sectors / neededSectors);
+    ideal = std::min(std::max(ideal, 0.0f), (float) (levelCount - 1));
+
+    current = std::min(std::max(current, 0), levelCount - 1);
+    if (std::fabs(ideal - (float) current) > 0.5f + hysteresis) {
+        return (int) std::lround(ideal);
+    }
+    return current;
+}
@@ -0,0 +1,56 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <vector>
+#include "geometry.h"
+#include "meshgen.h"
+
+// Maximum number of levels in a LOD chain, level 0 included:
+const int MAX_LOD_LEVELS = 5;
+
+// Parameters of every level of a LOD chain: level 0 is params and each next level halves the sector and
+// stack counts, until neither can be halved without losing the shape.
+std::vector<MeshParams> buildLodChain(const MeshParams &params, int maxLevels = MAX_LOD_LEVELS);
+
+// Length in pixels of a world space length seen at the point of a bounding sphere nearest to the camera.
+// Returns a huge size when the camera is inside the sphere.
+float projectedLength(const glm::vec3 &center, float boundingRadius, float length, const glm::mat4 &view,
+                      const glm::mat4 &projection, int viewportHeight);
+
+// Selects the level of a LOD chain from the object's size on screen. The chain is described by a circle
+// that level 0 splits into a number of sectors; the selected level keeps sectors near targetSegmentPixels
+// long on screen, so the triangle count follows screen coverage rather than object count. The level only
+// changes once the ideal level is more than half a level plus hysteresis away, which avoids popping back
+// and forth at a threshold.
+class LodSelector {
+public:
+    LodSelector();
+
+    // Describes the chain (in model space):
+    void setChain(int levelCount, int sectors, float radius, float boundingRadius);
+
+    // Returns the level for an object's position and largest scale factor, with hysteresis around current, the
+    // level it drew last. Changes nothing, so it can run on any thread.
+    int choose(const glm::vec3 &center, float scale, int current, const glm::mat4 &view,
+               const glm::mat4 &projection, int viewportHeight) const;
+
+    int getLevelCount() const { return levelCount; }
+
+    int getSectors() const { return sectors; }
+
+    float getRadius() const { return radius; }
+
+    float getBoundingRadius() const { return boundingRadius; }
+
+    static bool enabled; // Always draw level 0 when off.
+    static float targetSegmentPixels; // On-screen length of a sector the selection aims for.
+    static float hysteresis; // Fraction of a level the ideal level must overshoot before switching.
+
+private:
+    int levelCount;
+    int sectors;
+    float radius;
+    float boundingRadius;
+};
+
+#endif //LOD_H
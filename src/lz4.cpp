@@ -0,0 +1,144 @@
+#include "lz4.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Shortest match, and the format's rules for the end of a block: the last 5 bytes are literals and the last
+// match starts at least 12 bytes before the end.
+const size_t LZ4_MIN_MATCH = 4;
+const size_t LZ4_LAST_LITERALS = 5;
+const size_t LZ4_MATCH_FIND_LIMIT = 12;
+const size_t LZ4_MAX_OFFSET = 65535;
+
+// Match finder: positions of earlier 4-byte sequences by hash:
+const int LZ4_HASH_BITS = 16;
+
+static uint32_t read32(const unsigned char *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Writes the extra bytes of a length that doesn't fit the token's 4 bits:
+static unsigned char *writeLength(unsigned char *out, size_t length) {
+    for (; length >= 255; length -= 255) {
+        *out++ = 255;
+    }
+    *out++ = (unsigned char) length;
+    return out;
+}
+
+// Writes a sequence: literals [anchor, anchor + literals), then a match (unless matchLength is 0, which
+// marks the last sequence).
+static unsigned char *writeSequence(unsigned char *out, const unsigned char *anchor, size_t literals,
+                                    size_t offset, size_t matchLength) {
+    unsigned char *token = out++;
+    *token = (unsigned char) ((literals >= 15 ? 15 : literals) << 4);
+    if (literals >= 15) {
+        out = writeLength(out, literals - 15);
+    }
+    memcpy(out, anchor, literals);
+    out += literals;
+    if (matchLength == 0) {
+        return out;
+    }
+    *out++ = (unsigned char) offset;
+    *out++ = (unsigned char) (offset >> 8);
+    size_t length = matchLength - LZ4_MIN_MATCH;
+    *token |= (unsigned char) (length >= 15 ? 15 : length);
+    if (length >= 15) {
+        out = writeLength(out, length - 15);
+    }
+    return out;
+}
+
+size_t lz4CompressBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+size_t lz4Compress(const unsigned char *in, size_t size, unsigned char *out) {
+    unsigned char *start = out;
+    size_t anchor = 0;
+    if (size > LZ4_MATCH_FIND_LIMIT) {
+        std::vector<uint32_t> table((size_t) 1 << LZ4_HASH_BITS, UINT32_MAX);
+        size_t matchStartLimit = size - LZ4_MATCH_FIND_LIMIT;
+        size_t matchEndLimit = size - LZ4_LAST_LITERALS;
+
+        // Greedy: take the most recent earlier position with the same 4 bytes, extended as far as it goes:
+        for (size_t i = 0; i < matchStartLimit;) {
+            uint32_t sequence = read32(in + i);
+            uint32_t hash = (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+            uint32_t candidate = table[hash];
+            table[hash] = (uint32_t) i;
+            if (candidate == UINT32_MAX || i - candidate > LZ4_MAX_OFFSET || read32(in + candidate) != sequence) {
+                ++i;
+                continue;
+            }
+            size_t length = LZ4_MIN_MATCH;
+            while (i + length < matchEndLimit && in[candidate + length] == in[i + length]) {
+                ++length;
+            }
+            out = writeSequence(out, in + anchor, i - anchor, i - candidate, length);
+            i += length;
+            anchor = i;
+        }
+    }
+    out = writeSequence(out, in + anchor, size - anchor, 0, 0);
+    return (size_t) (out - start);
+}
+
+// Reads the extra bytes of a length whose token nibble is 15:
+static bool readLength(const unsigned char *in, size_t inSize, size_t &position, size_t &length) {
+    unsigned char byte;
+    do {
+        if (position >= inSize) {
+            return false;
+        }
+        byte = in[position++];
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool lz4Decompress(const unsigned char *in, size_t inSize, unsigned char *out, size_t outSize) {
+    size_t ip = 0, op = 0;
+    while (ip < inSize) {
+        unsigned char token = in[ip++];
+        size_t literals = token >> 4;
+        if (literals == 15 && !readLength(in, inSize, ip, literals)) {
+            return false;
+        }
+        if (literals > inSize - ip || literals > outSize - op) {
+            return false;
+        }
+        memcpy(out + op, in + ip, literals);
+        ip += literals;
+        op += literals;
+
+        // The last sequence has no match:
+        if (ip == inSize) {
+            return op == outSize;
+        }
+        if (inSize - ip < 2) {
+            return false;
+        }
+        size_t offset = in[ip] | ((size_t) in[ip + 1] << 8);
+        ip += 2;
+        size_t length = token & 15;
+        if ((length == 15 && !readLength(in, inSize, ip, length)) || offset == 0 || offset > op) {
+            return false;
+        }
+        length += LZ4_MIN_MATCH;
+        if (length > outSize - op) {
+            return false;
+        }
+        // Matches may overlap their own output (runs), so copy forward byte by byte:
+        const unsigned char *match = out + op - offset;
+        for (size_t i = 0; i < length; ++i) {
+            out[op + i] = match[i];
+        }
+        op += length;
+    }
+    return false;
+}
@@ -0,0 +1,19 @@
+#ifndef LZ4_H
+#define LZ4_H
+
+#include <cstddef>
+
+// LZ4 block format (no frame header): sequences of literals and back references within 64 KB. Decoding is
+// a few copies per sequence, far faster than reading the same bytes uncompressed from disk.
+
+// Largest compressed size of size bytes (incompressible input grows slightly):
+size_t lz4CompressBound(size_t size);
+
+// Compresses size bytes into out, which must hold lz4CompressBound(size) bytes. Returns the compressed size.
+size_t lz4Compress(const unsigned char *in, size_t size, unsigned char *out);
+
+// Decompresses a block that expands to exactly outSize bytes. Returns false on malformed input, without
+// reading or writing out of bounds.
+bool lz4Decompress(const unsigned char *in, size_t inSize, unsigned char *out, size_t outSize);
+
+#endif //LZ4_H
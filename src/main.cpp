@@ -1,6 +1,11 @@
 
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <map>
+#include <thread>
 #include "main.h"
 #include "cylinder.h"
 #include "plane.h"
@@ -10,6 +15,28 @@
 #include "skybox.h"
 #include "torus.h"
 #include "pyramid.h"
+#include "sphere.h"
+#include "benchmark.h"
+#include "framebenchmark.h"
+#include "renderstats.h"
+#include "profiler.h"
+#include "hud.h"
+#include "stressscene.h"
+#include "scenefile.h"
+#include "importedmodel.h"
+#include "texturebake.h"
+#include "ktxfile.h"
+#include "assetpack.h"
+#include "startup.h"
+#include "jobs.h"
+#include "drawlist.h"
+#include "framequeue.h"
+#include "framepacing.h"
+#include "ringbuffer.h"
+#include "transformbatch.h"
+#include "dynamicresolution.h"
+#include "framegraph.h"
+#include "gpuculling.h"
 
 // Include the standard namespace for convenience
 using namespace std;
@@ -19,6 +46,22 @@ const char* const WINDOW_TITLE = "Final Project Rui";
 const int WINDOW_WIDTH = 800;
 const int WINDOW_HEIGHT = 600;
 
+// Declare the current window size (the defaults above unless resized or set with --size)
+int windowWidth = WINDOW_WIDTH;
+int windowHeight = WINDOW_HEIGHT;
+
+// Declare the headless benchmark settings: frames to measure (0 runs interactively), JSON output path and
+// the context creation API ("native", "egl" or "osmesa")
+int benchmarkFrames = 0;
+const char* benchmarkOutput = "benchmark.json";
+const char* contextApi = "native";
+
+// Declare the path of the Chrome trace written on exit (null when not tracing)
+const char* traceOutput = nullptr;
+
+// Declare the desk setups tiled by the stress scene (0 draws the single hand-placed desk)
+int stressInstances = 0;
+
 // Declare a GLFWwindow pointer for the main window
 GLFWwindow* gWindow = nullptr;
 
@@ -41,227 +84,406 @@ bool screenMirror = true;
 Shader* lights;
 Shader* normalmap;
 
+// Declare pointers for the GPU-driven variants of those shaders, which load the object of a draw from the scene
+// buffers of the GPU culling (null unless --gpu-culling is given)
+Shader* lightsGpu = nullptr;
+Shader* normalmapGpu = nullptr;
+
+// Declare a pointer for the Shader that evaluates tessellated analytic surfaces (null when unused)
+Shader* surface = nullptr;
+
+// Declare the on-screen length of a tessellated patch segment
+float tessellationPixels = 8.0f;
+
+// Declare the size in pixels of the target the pass being drawn renders to, which the tessellation aims its
+// segment length at
+glm::vec2 passViewport;
+
 // Declare a DirectionalLight object for the sun
 DirectionalLight sun;
 
-// Declare a struct for the computer monitor components
-struct ComputerMonitor {
-    Cube* shell;
-    Cube* screen;
-    Cube* scene;
-    Cube* stand;
-    Cube* base;
-};
+// Declare the scene description loaded at startup (text or compiled binary form)
+const char* sceneFile = "scenes/desk.scene";
+
+// Declare the threads that import model files (0 uses every hardware thread)
+int importThreads = 0;
 
-// Declare a pointer for the desk object (a Plane)
-Plane* desk;
+// Declare the threads of the job pool, including the main thread (0 uses every hardware thread)
+int jobThreads = 0;
 
-// Declare instances of the Computer and ComputerMonitor structs
-ComputerMonitor computerMonitor;
+// Declare whether a render thread draws the frames the main thread prepares (off with --no-render-thread, and
+// for benchmarks, which time whole frames) and how many frames the main thread may run ahead of it
+bool useRenderThread = true;
+int frameLatency = 2;
 
-// Declare a pointer for the can object (a Cylinder)
-Cylinder* can;
+// Declare the milliseconds the main thread waits for a free snapshot before it handles events again
+const double SNAPSHOT_WAIT_MS = 1.0;
 
-Cylinder* canTop;
+// Declare the swap interval: vertical blanks per buffer swap (-1 keeps the driver's default)
+int swapInterval = -1;
 
-Cylinder* leg1;
-Cylinder* leg2;
-Cylinder* leg3;
-Cylinder* leg4;
+// Declare whether the startup tasks all run on the main thread, and the path of the startup timeline written
+// once the first frame is shown (null for none)
+bool serialStartup = false;
+const char* startupReport = nullptr;
 
-Torus* ring;
+// Declare a struct for a scene object: its model, the shader it is drawn with and its SCENE_MIRROR_* flags
+struct SceneObject {
+    Model* model;
+    Shader* shader;
+    unsigned int flags;
+};
 
-Pyramid* pyramid;
+// Declare the objects of the scene, in drawing order
+vector<SceneObject> sceneObjects;
+
+// Declare the placements of the scene objects, gathered from their models every frame, and the world and normal
+// matrices composed from them in batches (see buildDrawList)
+TransformBatch sceneTransforms;
+vector<glm::mat4> sceneWorld;
+vector<glm::mat4> sceneNormals;
+
+// Declare the level of detail each scene object drew last, which its next choice keeps hysteresis around (stress
+// instances keep their own, see buildDrawList)
+vector<unsigned char> sceneLevels;
+
+// Declare the state of the scene file while the startup tasks load it (see loadScene)
+struct SceneLoad {
+    const char* path;
+    SceneFile file;
+    vector<Model*> models; // the primitive of each entry, built on a worker
+    vector<ModelImporter*> importers; // or its model file, imported on a worker
+    vector<vector<SceneObject>> objects; // the objects each entry becomes
+    map<string, int> images; // the task reading each image ahead of its upload
+    int window; // the tasks the uploads wait for
+    vector<int> shaders;
+    int framebuffer;
+    vector<int> buildDependencies; // the tasks the mesh builds wait for
+    int done; // the task that adds the objects to the scene
+    double readMs; // time spent reading the file
+};
 
-// Declare a pointer for the framebuffer texture
+// Declare a pointer for the texture the monitor screen shows, which the monitor pass renders into at the size
+// of the window, and the model of the screen with its SCENE_MIRROR_* flags
 Texture* frameBuffer;
+Model* monitorScreen = nullptr;
+unsigned int monitorScreenFlags = 0;
+
+// Declare the frame graph the passes of every frame are described in (see addFramePasses)
+FrameGraph frameGraph;
 
 SkyBox* skyBox;
 
+// Declare the performance overlay, toggled with 'H' (shown from the start with --hud)
+Hud* hud;
+bool showHud = false;
+
+// Declare a pointer for the stress scene (null unless --stress is given)
+StressScene* stressScene = nullptr;
+
+// Declare the ring buffer the per-object data of every draw is written into, and the bytes of a frame's region
+// it starts with (it grows to fit the draw list)
+RingBuffer objectRing;
+const GLsizeiptr OBJECT_RING_REGION = 1 << 20;
+
 /**
  * @brief Main function that sets up and renders a 3D scene in an OpenGL window.
  *
  * This function initializes the application with the given command line arguments,
- * creates camera, lights, shaders, and objects for the scene, sets up textures, materials,
- * and positions for the objects, and enters the main render loop. Inside the loop,
+ * creates camera, lights, shaders, and the objects of the scene file with their textures,
+ * materials, and positions (as a graph of startup tasks, see runStartup), and enters the
+ * main render loop. Once the first frame is shown the startup report is printed. Inside the loop,
  * it processes user input, updates frame time, renders the scene to a framebuffer
  * and the window, polls for window events, and swaps buffers. After the loop,
  * it cleans up and destroys objects, shaders, and textures, and terminates GLFW.
+ * With --benchmark, the window is hidden, the camera flies a scripted path for a
+ * fixed number of frames, and the frame statistics are written as JSON. With --trace,
+ * the profiler's CPU and GPU scopes are written as a Chrome trace on exit.
  *
  * @param argc The number of command line arguments
  * @param argv An array of command line argument strings
  * @return int EXIT_SUCCESS if the application runs successfully; EXIT_FAILURE otherwise
  */
 int main(int argc, char* argv[]) {
-    // Initialize the application with the given arguments
-    // If initialization fails, return an error
-    if (!initialize(argc, argv, &gWindow)) {
-        return EXIT_FAILURE;
+    // The startup timeline starts here
+    StartupGraph startup;
+
+    // Command line benchmarks that don't need a window:
+    if (argc > 1 && strcmp(argv[1], "--bench-mesh") == 0) {
+        return runMeshBenchmark();
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-meshopt") == 0) {
+        return runMeshOptBenchmark();
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-jobs") == 0) {
+        return runJobBenchmark();
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-transforms") == 0) {
+        return runTransformBenchmark();
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-import") == 0) {
+        return runImportBenchmark(argc > 2 ? argv[2] : nullptr);
+    }
+    if (argc > 1 && strcmp(argv[1], "--bake-textures") == 0) {
+        return bakeSceneTextures(argc > 2 ? argv[2] : sceneFile) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (argc > 2 && strcmp(argv[1], "--bake-texture") == 0) {
+        TextureCompression compression = TEXTURE_AUTO;
+        if (argc > 3 && !parseTextureCompression(argv[3], compression)) {
+            printf("ERROR: Unknown texture compression %s (bc1, bc3, bc5, bc7 or auto)\n", argv[3]);
+            return EXIT_FAILURE;
+        }
+        return bakeTexture(argv[2], getKtxPath(argv[2]).c_str(), compression) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (argc > 3 && strcmp(argv[1], "--build-pack") == 0) {
+        std::vector<std::string> files(argv + 3, argv + argc);
+        return AssetPack::write(argv[2], files) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (argc > 3 && strcmp(argv[1], "--compile-scene") == 0) {
+        SceneFile scene;
+        return scene.load(argv[2]) && scene.writeBinary(argv[3]) ? EXIT_SUCCESS : EXIT_FAILURE;
     }
 
-    // Create objects and shaders for the scene
+    // Command line options:
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--packed-vertices") == 0) {
+            Mesh::usePackedVertices = true;
+        } else if (strcmp(argv[i], "--no-meshopt") == 0) {
+            Mesh::optimizeMeshes = false;
+        } else if (strcmp(argv[i], "--no-mesh-cache") == 0) {
+            MeshCache::enabled = false;
+        } else if (strcmp(argv[i], "--mesh-cache") == 0 && i + 1 < argc) {
+            MeshCache::directory = argv[++i];
+        } else if (strcmp(argv[i], "--no-compressed-textures") == 0) {
+            Texture::useCompressedTextures = false;
+        } else if (strcmp(argv[i], "--pack") == 0 && i + 1 < argc) {
+            if (!AssetPack::mounted.open(argv[++i])) {
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--import-threads") == 0 && i + 1 < argc) {
+            importThreads = max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--job-threads") == 0 && i + 1 < argc) {
+            jobThreads = max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--serial-startup") == 0) {
+            serialStartup = true;
+        } else if (strcmp(argv[i], "--startup-report") == 0 && i + 1 < argc) {
+            startupReport = argv[++i];
+        } else if (strcmp(argv[i], "--no-render-thread") == 0) {
+            useRenderThread = false;
+        } else if (strcmp(argv[i], "--frame-latency") == 0 && i + 1 < argc) {
+            frameLatency = max(1, min(atoi(argv[++i]), MAX_FRAME_LATENCY));
+        } else if (strcmp(argv[i], "--swap-interval") == 0 && i + 1 < argc) {
+            swapInterval = max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--fps-cap") == 0 && i + 1 < argc) {
+            framePacer.setFrameCap(atof(argv[++i]));
+        } else if (strcmp(argv[i], "--late-latch") == 0) {
+            framePacer.setLateLatching(true);
+        } else if (strcmp(argv[i], "--dynamic-resolution") == 0) {
+            dynamicResolution.setEnabled(true);
+        } else if (strcmp(argv[i], "--resolution-scale") == 0 && i + 1 < argc) {
+            float minScale = 0.0f;
+            float maxScale = 0.0f;
+            if (sscanf(argv[++i], "%f,%f", &minScale, &maxScale) == 2 && minScale > 0.0f && maxScale > 0.0f) {
+                dynamicResolution.setScaleRange(minScale, maxScale);
+            }
+        } else if (strcmp(argv[i], "--gpu-target-ms") == 0 && i + 1 < argc) {
+            dynamicResolution.setTargetMs(max(1.0f, (float) atof(argv[++i])));
+        } else if (strcmp(argv[i], "--sharpness") == 0 && i + 1 < argc) {
+            dynamicResolution.setSharpness((float) atof(argv[++i]));
+        } else if (strcmp(argv[i], "--gpu-culling") == 0) {
+            gpuCulling.setEnabled(true);
+        } else if (strcmp(argv[i], "--no-occlusion") == 0) {
+            gpuCulling.setOcclusion(false);
+        } else if (strcmp(argv[i], "--meshlets") == 0) {
+            Mesh::useMeshlets = true;
+        } else if (strcmp(argv[i], "--no-cone-culling") == 0) {
+            gpuCulling.setConeCulling(false);
+        } else if (strcmp(argv[i], "--no-culling") == 0) {
+            DrawList::useCulling = false;
+        } else if (strcmp(argv[i], "--no-lod") == 0) {
+            LodSelector::enabled = false;
+        } else if (strcmp(argv[i], "--lod-pixels") == 0 && i + 1 < argc) {
+            LodSelector::targetSegmentPixels = max(1.0f, (float) atof(argv[++i]));
+        } else if (strcmp(argv[i], "--tessellation") == 0) {
+            Model::useTessellation = true;
+        } else if (strcmp(argv[i], "--tess-pixels") == 0 && i + 1 < argc) {
+            tessellationPixels = max(1.0f, (float) atof(argv[++i]));
+        } else if (strcmp(argv[i], "--benchmark") == 0) {
+            benchmarkFrames = 1000;
+            if (i + 1 < argc && atoi(argv[i + 1]) > 0) {
+                benchmarkFrames = atoi(argv[++i]);
+            }
+        } else if (strcmp(argv[i], "--benchmark-out") == 0 && i + 1 < argc) {
+            benchmarkOutput = argv[++i];
+        } else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+            sceneFile = argv[++i];
+        } else if (strcmp(argv[i], "--stress") == 0 && i + 1 < argc) {
+            stressInstances = max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--hud") == 0) {
+            showHud = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceOutput = argv[++i];
+        } else if (strcmp(argv[i], "--context") == 0 && i + 1 < argc) {
+            contextApi = argv[++i];
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            int width = 0;
+            int height = 0;
+            if (sscanf(argv[++i], "%dx%d", &width, &height) == 2 && width > 0 && height > 0) {
+                windowWidth = width;
+                windowHeight = height;
+            }
+        }
+    }
+
+    // Start the job workers, then create the camera, the window, shaders, textures and objects of the scene
+    jobs.start(jobThreads);
     camera = new Camera(glm::vec3(0.0f, 0.0f, 3.0f));
-    lights = new Shader("shader/lights.vs", "shader/lights.frag");
-    normalmap = new Shader("shader/normalmap.vs", "shader/normalmap.frag");
-    
-    desk = new Plane(4.0f, 2.5f);
-    
-    computerMonitor.shell = new Cube(2.1f, 0.9f, 0.1f);
-    computerMonitor.screen = new Cube(2.0f, 0.8f, 0.05f);
-    computerMonitor.scene = new Cube(2.0f, 0.8f, 0.05f);
-    computerMonitor.stand = new Cube(0.5f, 0.6f, 0.1f);
-    computerMonitor.base = new Cube(1.0f, 0.1f, 0.4f);
-    
-    can = new Cylinder(0.2f, 0.2f, 0.6f);
-    canTop = new Cylinder(0.2f, 0.2f, 0.01f);
-
-    leg1 = new Cylinder(0.08f, 0.08f, 3.0f); // set desired radius for legs
-    leg1->setRotation(100.0f, 0.0f, 0.0f);
-
-    leg2 = new Cylinder(0.08f, 0.08f, 3.0f); // set desired radius for legs
-    leg2->setRotation(100.0f, 0.0f, 0.0f);
-    
-    leg3 = new Cylinder(0.08f, 0.08f, 3.0f); // set desired radius for legs
-    leg3->setRotation(80.0f, 0.0f, 0.0f);
-    
-    leg4 = new Cylinder(0.08f, 0.08f, 3.0f); // set desired radius for legs
-    leg4->setRotation(80.0f, 0.0f, 0.0f);
-
-    // Define the scaling factors
-    float scaleX = 0.1f;
-    float scaleY = 0.1f;
-    float scaleZ = 0.1f;
-
-    // Create a Torus object with smaller dimensions
-    ring = new Torus(20, 20, 0.3f * scaleX, 0.15f * scaleY);
-    
-    // Pyramid
-    float baseLength = 2.0f;
-    float height = baseLength / 1.618f;
-    pyramid = new Pyramid(baseLength, height);
-
-
-    skyBox = new SkyBox();
-
-    // Set up textures, materials, and positions for the scene objects
-    frameBuffer = new Texture();
-    frameBuffer->create(0, 1, GL_TEXTURE_2D, GL_NEAREST, GL_LINEAR, false, GL_COLOR_ATTACHMENT0);
-    
-    desk->init("images/desk_texture.jpg");
-    
-    computerMonitor.shell->init("images/computer_monitor_texture.jpg");
-    computerMonitor.screen->initBuffer(frameBuffer);
-    computerMonitor.stand->init("images/computer_monitor_texture.jpg");
-    computerMonitor.base->init("images/computer_monitor_texture.jpg");
-    
-    can->init("images/cup_texture.png");
-    canTop->init("images/can_top.png");
-    
-    desk->setPosition(0.0f, -2.0f, -5.0f);
-    
-    computerMonitor.shell->setPosition(0.0f, -0.6f, -5.0f);
-    computerMonitor.screen->setPosition(0.0f, -0.6f, -4.94f);
-    computerMonitor.scene->setPosition(0.0f, -0.6f, -4.94f);
-    computerMonitor.stand->setPosition(0.0f, -1.5f, -5.2f);
-    computerMonitor.base->setPosition(0.0f, -2.0f, -5.0f);
-
-    leg1->init("images/desk_texture.jpg");
-    leg2->init("images/desk_texture.jpg");
-    leg3->init("images/desk_texture.jpg");
-    leg4->init("images/desk_texture.jpg");
-
-    ring->init("images/ring_texture.jpg");
-
-    pyramid->init("images/pyramid_texture.jpg");
-    
-    can->setPosition(-2.8f, -1.6f - 0.05f, -4.2f);
-    can->setRotation(90.0f, 90.0f, 0.0f);
-    canTop->setPosition(-2.8f, -1.3f - 0.05f, -4.2f);
-    canTop->setRotation(90.0f, 0.0f, 0.0f);
-    
-    computerMonitor.shell->getMaterial()->setShininess(32.0f);
-    computerMonitor.stand->getMaterial()->setShininess(64.0f);
-    computerMonitor.base->getMaterial()->setShininess(64.0f);
-    desk->getMaterial()->setShininess(32.0f);
-    can->getMaterial()->setShininess(15.0f);
-    canTop->getMaterial()->setShininess(50.0f);
-
-    leg1->setPosition(3.0f, -3.5f, -7.0f);  // back right corner
-    leg2->setPosition(-3.0f, -3.5f, -7.00f);   // front right corner
-    leg3->setPosition(-3.0f, -3.5f, -3.00f);  // back left corner
-    leg4->setPosition(3.0f, -3.5f, -3.00f);    // back right corner
-
-    ring->setPosition(1.6f, -1.8f - 0.158f, -4.0f);
-    ring->setRotation(-90.0f, 0.0f, 0.0f);
-
-    pyramid->setPosition(2.9f, -1.39f, -6.5f);
-
-    // Init SkyBox:
-    skyBox->init("images/skybox");
+    camera->setAspect((float) windowWidth / (float) windowHeight);
+    if (!runStartup(startup, argc, argv)) {
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
 
     // Initialize the OpenGL window background color and enable sRGB
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glEnable(GL_FRAMEBUFFER_SRGB);
 
-    // Main render loop
-    while (!glfwWindowShouldClose(gWindow)) {
-        // Process user input
-        processInput(gWindow);
+    // In benchmark mode the camera flies a scripted path instead of following input
+    FrameBenchmark* benchmark = nullptr;
+    CameraPath cameraPath = CameraPath::deskFlyby();
+    if (benchmarkFrames > 0) {
+        benchmark = new FrameBenchmark(benchmarkFrames);
+    }
 
-        // Update frame time
-        auto currentFrame = (float)glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+    // With --trace, every profiler scope until exit goes into a Chrome trace
+    if (traceOutput != nullptr) {
+        profiler.startCapture();
+    }
 
-        // Render the scene to a framebuffer
-        frameBuffer->bindAsRenderTarget();
-        renderScene();
+    // Main loop: the main thread handles input and simulation and fills a snapshot of every frame, which a render
+    // thread that owns the context draws, up to frameLatency frames behind. Without a render thread (and for
+    // benchmarks) each snapshot is drawn at once on the main thread, in lockstep.
+    bool startupReportWritten = true;
+    if (useRenderThread && benchmark == nullptr) {
+        FrameQueue frames(frameLatency);
+        glfwMakeContextCurrent(nullptr);
+        std::thread renderThread([&frames, &startup, &startupReportWritten]() {
+            glfwMakeContextCurrent(gWindow);
+            bool startupReported = false;
+            for (FrameSnapshot* frame = frames.acquire(); frame != nullptr; frame = frames.acquire()) {
+                profiler.beginFrame();
+                {
+                    PROFILE_SCOPE("frame");
+                    renderFrame(*frame);
+                }
+                profiler.endFrame();
+
+                // Report the startup once its first frame is on screen
+                if (!startupReported) {
+                    startupReportWritten = reportStartup(startup);
+                    startupReported = true;
+                }
+            }
+            glfwMakeContextCurrent(nullptr);
+        });
+
+        while (!glfwWindowShouldClose(gWindow)) {
+            // Wait for the frame cap, then for a free snapshot, handling events throughout so late latching
+            // sees the camera move
+            framePacer.waitForNextFrame();
+            FrameSnapshot* frame = frames.tryBeginWrite(SNAPSHOT_WAIT_MS);
+            while (frame == nullptr) {
+                glfwPollEvents();
+                frame = frames.tryBeginWrite(SNAPSHOT_WAIT_MS);
+            }
+            updateFrame(*frame, nullptr, cameraPath);
+            frames.publish(frame);
+        }
+        frames.close();
+        renderThread.join();
+        glfwMakeContextCurrent(gWindow);
+        printf("INFO: Render thread skipped %llu older frames; input waited %.1f ms at the frame latency limit\n",
+               frames.getDroppedCount(), frames.getWaitMs());
+    } else {
+        FrameQueue frames(1);
+        bool startupReported = false;
+        while (!glfwWindowShouldClose(gWindow)) {
+            if (benchmark != nullptr && benchmark->finished()) {
+                break;
+            }
+            framePacer.waitForNextFrame();
+            profiler.beginFrame();
+            {
+                PROFILE_SCOPE("frame");
+                FrameSnapshot* frame = frames.beginWrite();
+                updateFrame(*frame, benchmark, cameraPath);
+                frames.publish(frame);
+                if (framePacer.isLateLatching()) {
+                    // Catch the input that came in while the frame was built
+                    PROFILE_SCOPE("events");
+                    glfwPollEvents();
+                }
+                renderFrame(*frames.acquire());
+            }
+            profiler.endFrame();
+
+            if (benchmark != nullptr) {
+                benchmark->endFrame();
+            }
+
+            // Report the startup once its first frame is on screen
+            if (!startupReported) {
+                startupReportWritten = reportStartup(startup);
+                startupReported = true;
+            }
+        }
+    }
 
-        // Render the scene to the window
-        bindWindowRenderTarget();
-        renderScene();
+    framePacer.printReport();
+    dynamicResolution.printReport();
+    gpuCulling.printReport();
+    frameGraph.printReport();
+
+    // Write the benchmark results
+    bool benchmarkWritten = true;
+    if (benchmark != nullptr) {
+        benchmarkWritten = benchmark->writeJson(benchmarkOutput, contextApi, windowWidth, windowHeight,
+                                                max(stressInstances, 1));
+        benchmark->destroy();
+        delete benchmark;
+    }
 
-        // Poll for window events and swap buffers
-        glfwPollEvents();
-        glfwSwapBuffers(gWindow);
+    // Write the trace
+    bool traceWritten = true;
+    if (traceOutput != nullptr) {
+        traceWritten = profiler.writeTrace(traceOutput);
     }
+    profiler.destroy();
+    framePacer.destroy();
+    printf("INFO: Object ring buffer (%s) waited %.1f ms for the GPU; %llu allocations didn't fit\n",
+           objectRing.isPersistent() ? "persistent" : "orphaned", objectRing.getStallMs(),
+           objectRing.getOverflowCount());
+    objectRing.destroy();
 
     // Clean up and destroy objects, shaders, and textures
-    desk->destroy();
-    delete desk;
-    computerMonitor.shell->destroy();
-    delete computerMonitor.shell;
-    computerMonitor.screen->destroy();
-    delete computerMonitor.screen;
-    computerMonitor.scene->destroy();
-    delete computerMonitor.scene;
-    computerMonitor.stand->destroy();
-    delete computerMonitor.stand;
-    computerMonitor.base->destroy();
-    delete computerMonitor.base;
-    can->destroy();
-    delete can;
-    canTop->destroy();
-    delete canTop;
-
-    leg1->destroy();
-    delete leg1;
-    leg2->destroy();
-    delete leg2;
-    leg3->destroy();
-    delete leg3;
-    leg4->destroy();
-    delete leg4;
-
-    ring->destroy();
-    delete ring;
-
-    pyramid->destroy();
-    delete pyramid;
+    for (SceneObject& object : sceneObjects) {
+        object.model->destroy();
+        delete object.model;
+    }
+    sceneObjects.clear();
 
     skyBox->destroy();
     delete skyBox;
 
+    hud->destroy();
+    delete hud;
+
+    dynamicResolution.destroy();
+    gpuCulling.destroy();
+
+    delete stressScene;
+
+    frameGraph.destroy();
     frameBuffer->destroy();
     delete frameBuffer;
 
@@ -269,11 +491,17 @@ int main(int argc, char* argv[]) {
     delete lights;
     normalmap->destroy();
     delete normalmap;
+    for (Shader* shader : {lightsGpu, normalmapGpu, surface}) {
+        if (shader != nullptr) {
+            shader->destroy();
+            delete shader;
+        }
+    }
     delete camera;
 
     // Terminate GLFW and exit the application
     glfwTerminate();
-    exit(EXIT_SUCCESS);
+    exit(benchmarkWritten && traceWritten && startupReportWritten ? EXIT_SUCCESS : EXIT_FAILURE);
 }
 
 
@@ -293,8 +521,19 @@ bool initialize(int argc, char* argv[], GLFWwindow** window) {
 #endif
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
+    // Benchmarks run in a hidden window, optionally on an EGL or OSMesa context (OSMesa renders on the CPU
+    // through llvmpipe, so the benchmark also runs on machines without a GPU)
+    if (benchmarkFrames > 0) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    }
+    if (strcmp(contextApi, "egl") == 0) {
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    } else if (strcmp(contextApi, "osmesa") == 0) {
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    }
+
     // Create a new GLFW window
-    *window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, nullptr, nullptr);
+    *window = glfwCreateWindow(windowWidth, windowHeight, WINDOW_TITLE, nullptr, nullptr);
     // If window creation fails, print an error and terminate GLFW
     if (*window == nullptr) {
         std::cout << "Failed to create GLFW window" << std::endl;
@@ -314,6 +553,13 @@ bool initialize(int argc, char* argv[], GLFWwindow** window) {
     // Disable the cursor for the window
     glfwSetInputMode(*window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
+    // Benchmarks measure rendering, not the display's refresh rate
+    if (benchmarkFrames > 0) {
+        glfwSwapInterval(0);
+    } else if (swapInterval >= 0) {
+        glfwSwapInterval(swapInterval);
+    }
+
     // Enable experimental features and initialize the GLEW library
     glewExperimental = GL_TRUE;
     GLenum GlewInitResult = glewInit();
@@ -327,14 +573,543 @@ bool initialize(int argc, char* argv[], GLFWwindow** window) {
     // Print the current OpenGL version
     cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << endl;
 
+    // Let the driver compile shaders on its own threads while the startup goes on
+    if (Shader::enableParallelCompile()) {
+        cout << "INFO: Compiling shaders in parallel (KHR_parallel_shader_compile)" << endl;
+    }
+
     // Return true if initialization is successful
     return true;
 }
 
+/**
+ * @brief Runs everything the first frame needs as a graph of startup tasks (see StartupGraph).
+ *
+ * Worker tasks read the shader sources, the scene file and the images (see Texture::prefetch), build the meshes
+ * (see Model::prepare) and import the model files while this thread creates the window. Context tasks on this
+ * thread then compile the shaders and upload each object as soon as what it needs is ready. With
+ * KHR_parallel_shader_compile the compiles run on the driver's threads and are only waited for at the end.
+ *
+ * @param graph The graph to run, created at the start of main so that its timeline starts there.
+ * @param argc The number of command line arguments
+ * @param argv An array of command line argument strings
+ * @return bool true if every task succeeded; false if the window or the scene can't be created
+ */
+bool runStartup(StartupGraph& graph, int argc, char* argv[]) {
+    SceneLoad scene;
+    scene.path = sceneFile;
+    ShaderSources lightsSources;
+    ShaderSources normalmapSources;
+    ShaderSources surfaceSources;
+    ShaderSources lightsGpuSources;
+    ShaderSources normalmapGpuSources;
+
+    // The window and context come first on this thread; the CPU work doesn't wait for them
+    scene.window = graph.add("create window", STARTUP_CONTEXT, [&]() {
+        if (!initialize(argc, argv, &gWindow)) {
+            return false;
+        }
+
+        // Tessellated curved surfaces need OpenGL 4.0:
+        if (Model::useTessellation && !tessellationSupported()) {
+            printf("WARNING: Tessellation shaders are not supported, drawing meshes instead\n");
+            Model::useTessellation = false;
+        }
+
+        // GPU culling needs compute shaders (OpenGL 4.3) and draws no tessellated surfaces:
+        if (gpuCulling.isEnabled() && !GpuCulling::isSupported()) {
+            printf("WARNING: Compute shaders are not supported, culling on the CPU instead\n");
+            gpuCulling.setEnabled(false);
+        } else if (gpuCulling.isEnabled() && Model::useTessellation) {
+            printf("WARNING: GPU culling can't draw tessellated surfaces, culling on the CPU instead\n");
+            gpuCulling.setEnabled(false);
+        }
+        if (Mesh::useMeshlets && !gpuCulling.isEnabled()) {
+            printf("WARNING: Meshlets are only culled with --gpu-culling, drawing whole meshes\n");
+        }
+        return true;
+    });
+
+    // Read the shader sources on workers and compile them once the context exists
+    int readLights = graph.add("read shader/lights.*", STARTUP_WORKER, [&]() {
+        Shader::read(lightsSources, "shader/lights.vs", "shader/lights.frag");
+        return true;
+    });
+    int readNormalmap = graph.add("read shader/normalmap.*", STARTUP_WORKER, [&]() {
+        Shader::read(normalmapSources, "shader/normalmap.vs", "shader/normalmap.frag");
+        return true;
+    });
+    scene.shaders.push_back(graph.add("compile lights", STARTUP_CONTEXT, [&]() {
+        lights = new Shader();
+        lights->compile(lightsSources);
+        return true;
+    }, {scene.window, readLights}));
+    scene.shaders.push_back(graph.add("compile normalmap", STARTUP_CONTEXT, [&]() {
+        normalmap = new Shader();
+        normalmap->compile(normalmapSources);
+        return true;
+    }, {scene.window, readNormalmap}));
+
+    // The GPU-driven variants, if asked for; the context may still turn GPU culling off, which drops them
+    vector<int> gpuTasks;
+    if (gpuCulling.isEnabled()) {
+        int readLightsGpu = graph.add("read shader/lights.* (gpu-driven)", STARTUP_WORKER, [&]() {
+            Shader::read(lightsGpuSources, "shader/lights.vs", "shader/lights.frag");
+            GpuCulling::addVariant(lightsGpuSources);
+            return true;
+        });
+        int readNormalmapGpu = graph.add("read shader/normalmap.* (gpu-driven)", STARTUP_WORKER, [&]() {
+            Shader::read(normalmapGpuSources, "shader/normalmap.vs", "shader/normalmap.frag");
+            GpuCulling::addVariant(normalmapGpuSources);
+            return true;
+        });
+        gpuTasks.push_back(graph.add("compile gpu-driven shaders", STARTUP_CONTEXT, [&]() {
+            if (gpuCulling.isEnabled()) {
+                lightsGpu = new Shader();
+                lightsGpu->compile(lightsGpuSources);
+                normalmapGpu = new Shader();
+                normalmapGpu->compile(normalmapGpuSources);
+            }
+            return true;
+        }, {scene.window, readLightsGpu, readNormalmapGpu}));
+        gpuTasks.push_back(graph.add("create gpu culling", STARTUP_CONTEXT, []() {
+            if (gpuCulling.isEnabled() && !gpuCulling.init()) {
+                gpuCulling.setEnabled(false);
+            }
+            return true;
+        }, {scene.window}));
+    }
+
+    // Whether the context supports tessellation is only known once it exists, and decides how meshes are built
+    if (Model::useTessellation) {
+        int readSurface = graph.add("read shader/surface.*", STARTUP_WORKER, [&]() {
+            Shader::read(surfaceSources, "shader/surface.vs", "shader/lights.frag", nullptr, "shader/surface.tesc",
+                         "shader/surface.tese");
+            return true;
+        });
+        scene.shaders.push_back(graph.add("compile surface", STARTUP_CONTEXT, [&]() {
+            if (Model::useTessellation) {
+                surface = new Shader();
+                surface->compile(surfaceSources);
+            }
+            return true;
+        }, {scene.window, readSurface}));
+        scene.buildDependencies.push_back(scene.window);
+    }
+
+    // Set up the framebuffer texture the monitor screen shows
+    scene.framebuffer = graph.add("create framebuffer", STARTUP_CONTEXT, []() {
+        frameBuffer = new Texture();
+        frameBuffer->createRenderTexture(windowWidth, windowHeight);
+        return true;
+    }, {scene.window});
+
+    // Init SkyBox from images read ahead:
+    vector<int> skyBoxDependencies = {scene.window};
+    for (const string& image : SkyBox::getImagePaths("images/skybox")) {
+        skyBoxDependencies.push_back(prefetchImage(graph, scene, image));
+    }
+    int skyBoxTask = graph.add("create skybox", STARTUP_CONTEXT, []() {
+        skyBox = new SkyBox();
+        skyBox->init("images/skybox");
+        return true;
+    }, skyBoxDependencies);
+
+    // Create the ring buffer for per-object data, aligned for uniform buffer bindings
+    int ringTask = graph.add("create object ring", STARTUP_CONTEXT, []() {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        objectRing.init(GL_UNIFORM_BUFFER, OBJECT_RING_REGION, alignment);
+        return true;
+    }, {scene.window});
+
+    // Compile the upscale of the dynamic resolution, if it is on
+    int upscaleTask = graph.add("create upscale", STARTUP_CONTEXT, []() {
+        if (dynamicResolution.isEnabled() && !dynamicResolution.init()) {
+            dynamicResolution.setEnabled(false);
+        }
+        return true;
+    }, {scene.window});
+
+    // Init the performance overlay
+    int hudTask = graph.add("create hud", STARTUP_CONTEXT, []() {
+        hud = new Hud();
+        hud->init();
+        hud->setVisible(showHud);
+        return true;
+    }, {scene.window});
+
+    // Create the scene objects with their textures, materials, and positions: reading the file adds a task per
+    // object, which the task adding them to the scene waits for
+    int sceneTask = graph.add(string("read ") + scene.path, STARTUP_WORKER, [&]() {
+        return loadScene(graph, scene);
+    });
+    scene.done = graph.add("add scene objects", STARTUP_CONTEXT, [&]() {
+        return finishScene(scene);
+    }, {sceneTask});
+
+    // Hand the scene to the GPU culling once it is complete
+    if (gpuCulling.isEnabled()) {
+        vector<int> dependencies = gpuTasks;
+        dependencies.push_back(scene.done);
+        gpuTasks.push_back(graph.add("upload gpu scene", STARTUP_CONTEXT, []() {
+            if (gpuCulling.isEnabled() && !uploadGpuScene()) {
+                gpuCulling.setEnabled(false);
+            }
+            return true;
+        }, dependencies));
+    }
+
+    // Last, wait for the shader compiles the driver ran meanwhile
+    vector<int> everything = scene.shaders;
+    everything.insert(everything.end(), {scene.framebuffer, skyBoxTask, ringTask, upscaleTask, hudTask, scene.done});
+    everything.insert(everything.end(), gpuTasks.begin(), gpuTasks.end());
+    graph.add("finish shaders", STARTUP_CONTEXT, []() {
+        for (Shader* shader : {lights, normalmap, surface}) {
+            if (shader != nullptr) {
+                shader->finish();
+                shader->setBlockBinding("ObjectData", OBJECT_DATA_BINDING);
+            }
+        }
+        for (Shader* shader : {lightsGpu, normalmapGpu}) {
+            if (shader != nullptr) {
+                shader->finish();
+                GpuCulling::setBindings(shader);
+            }
+        }
+        return true;
+    }, everything);
+
+    bool succeeded = graph.run(serialStartup);
+    Texture::releasePrefetched();
+    return succeeded;
+}
+
+/**
+ * @brief Adds a task that reads an image ahead of its upload (see Texture::prefetch), once per file.
+ *
+ * @param graph The startup graph.
+ * @param scene The scene being loaded, which keeps the image tasks.
+ * @param path The image file.
+ * @return int the task reading the image
+ */
+int prefetchImage(StartupGraph& graph, SceneLoad& scene, const string& path) {
+    auto found = scene.images.find(path);
+    if (found != scene.images.end()) {
+        return found->second;
+    }
+    int task = graph.add("read " + path, STARTUP_WORKER, [path]() {
+        // An image that can't be read is reported when its texture is loaded
+        Texture::prefetch(path.c_str());
+        return true;
+    });
+    scene.images[path] = task;
+    return task;
+}
+
+/**
+ * @brief Reads a scene file and adds the startup tasks that create its objects.
+ *
+ * The file is loaded in either form (see SceneFile): the text form is parsed, the binary form is mapped and
+ * read in place. Every object gets a worker task that builds its primitive or imports its model file, worker
+ * tasks that read its textures, and a context task that uploads it once those and the shaders are done.
+ *
+ * @param graph The startup graph.
+ * @param scene The scene to load; its path and the tasks the objects wait for are set.
+ * @return bool true if the file was loaded; false if it can't be read or an object uses a missing texture
+ */
+bool loadScene(StartupGraph& graph, SceneLoad& scene) {
+    auto start = chrono::high_resolution_clock::now();
+    if (!scene.file.load(scene.path)) {
+        return false;
+    }
+    scene.readMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+    uint32_t objectCount = scene.file.getObjectCount();
+    scene.models.assign(objectCount, nullptr);
+    scene.importers.assign(objectCount, nullptr);
+    scene.objects.resize(objectCount);
+    for (uint32_t i = 0; i < objectCount; ++i) {
+        const ScenePrimitive& primitive = scene.file.getPrimitive(i);
+        const SceneMaterial& material = scene.file.getMaterial(i);
+        string name = scene.file.getName(i);
+
+        // The upload waits for the context, the shaders, the textures and the mesh
+        vector<int> dependencies = scene.shaders;
+        dependencies.push_back(scene.window);
+        if (material.diffuse == SCENE_FRAMEBUFFER_TEXTURE) {
+            dependencies.push_back(scene.framebuffer);
+        } else if (material.diffuse != SCENE_NO_TEXTURE && primitive.type != SCENE_MODEL) {
+            const char* texture = scene.file.getTexture(material.diffuse);
+            if (texture == nullptr) {
+                printf("ERROR: Object %s in %s uses a missing texture\n", name.c_str(), scene.path);
+                return false;
+            }
+            dependencies.push_back(prefetchImage(graph, scene, texture));
+        }
+        const char* normalMap = scene.file.getTexture(material.normal);
+        if (normalMap != nullptr && primitive.type != SCENE_MODEL) {
+            dependencies.push_back(prefetchImage(graph, scene, normalMap));
+        }
+        if (primitive.type == SCENE_MODEL) {
+            dependencies.push_back(graph.add(string("import ") + scene.file.getModelPath(i), STARTUP_WORKER,
+                                             [&scene, i]() { return importSceneModel(scene, i); }));
+        } else {
+            dependencies.push_back(graph.add("build " + name, STARTUP_WORKER,
+                                             [&scene, i]() { return buildSceneModel(scene, i); },
+                                             scene.buildDependencies));
+        }
+
+        int upload = graph.add("upload " + name, STARTUP_CONTEXT, [&scene, i]() {
+            return uploadSceneObject(scene, i);
+        }, dependencies);
+        graph.addDependency(scene.done, upload);
+    }
+    return true;
+}
+
+/**
+ * @brief Creates the primitive of a scene object and builds its meshes (see Model::prepare), on a worker.
+ *
+ * @param scene The scene being loaded.
+ * @param i The object.
+ * @return bool true if the primitive was created; false if it is unknown
+ */
+bool buildSceneModel(SceneLoad& scene, uint32_t i) {
+    const ScenePrimitive& primitive = scene.file.getPrimitive(i);
+    const float* size = primitive.size;
+
+    // Segment counts of 0 keep the primitive's default
+    auto segments = [](int32_t count, int fallback) { return count > 0 ? (int) count : fallback; };
+
+    // Create the primitive
+    Model* model;
+    switch (primitive.type) {
+        case SCENE_CUBE:
+            model = new Cube(size[0], size[1], size[2]);
+            break;
+        case SCENE_PLANE:
+            model = new Plane(size[0], size[1]);
+            break;
+        case SCENE_PYRAMID:
+            model = new Pyramid(size[0], size[1]);
+            break;
+        case SCENE_CYLINDER:
+            model = new Cylinder(size[0], size[1], size[2], segments(primitive.segments[0], 36),
+                                 segments(primitive.segments[1], 1));
+            break;
+        case SCENE_SPHERE:
+            model = new Sphere(size[0], segments(primitive.segments[0], 36), segments(primitive.segments[1], 18));
+            break;
+        case SCENE_TORUS:
+            model = new Torus(segments(primitive.segments[0], 10), segments(primitive.segments[1], 20), size[0],
+                              size[1]);
+            break;
+        default:
+            printf("ERROR: Object %s in %s has an unknown primitive\n", scene.file.getName(i), scene.path);
+            return false;
+    }
+    model->setName(scene.file.getName(i));
+    model->prepare();
+    scene.models[i] = model;
+    return true;
+}
+
+/**
+ * @brief Imports the model file of a scene object with ModelImporter on importThreads threads, on a worker.
+ *
+ * @param scene The scene being loaded.
+ * @param i The object.
+ * @return bool true if the model was imported; false if the file can't be read
+ */
+bool importSceneModel(SceneLoad& scene, uint32_t i) {
+    const char* path = scene.file.getModelPath(i);
+    auto start = chrono::high_resolution_clock::now();
+    auto* importer = new ModelImporter();
+    scene.importers[i] = importer;
+    if (!importer->load(path, importThreads)) {
+        printf("ERROR: Failed to import %s (object %s)\n", path, scene.file.getName(i));
+        return false;
+    }
+    double importMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    printf("INFO: Imported %s: %u vertices, %u triangles in %d meshes, %.2f ms parsing (%.1f MB/s)\n", path,
+           importer->getVertexCount(), importer->getTriangleCount(), (int) importer->getMeshes().size(), importMs,
+           importer->getBytesRead() / (importMs * 1000.0));
+    return true;
+}
+
+/**
+ * @brief Uploads a scene object built on a worker and places it, on the context thread.
+ *
+ * A primitive gets its texture (or the monitor's framebuffer), normal map, position, rotation, scale, specular
+ * material and shader from the file. An imported model becomes one object per mesh (the triangles of one
+ * material) named "name/material", which keep the model's own materials and are drawn with the normal map
+ * shader if their material has a normal map.
+ *
+ * @param scene The scene being loaded.
+ * @param i The object.
+ * @return bool true if the object was created; false if it can't show the framebuffer
+ */
+bool uploadSceneObject(SceneLoad& scene, uint32_t i) {
+    const ScenePrimitive& primitive = scene.file.getPrimitive(i);
+    const SceneTransform& transform = scene.file.getTransform(i);
+    const SceneMaterial& material = scene.file.getMaterial(i);
+    const char* name = scene.file.getName(i);
+    vector<SceneObject>& objects = scene.objects[i];
+
+    // Model files become one object per material
+    if (primitive.type == SCENE_MODEL) {
+        ModelImporter* importer = scene.importers[i];
+        for (size_t j = 0; j < importer->getMeshes().size(); ++j) {
+            auto* model = new ImportedModel();
+            string partName = string(name) + "/" + importer->getMaterial(importer->getMeshes()[j]).name;
+            model->setName(partName.c_str());
+            if (!model->init(*importer, j)) {
+                printf("WARNING: Failed to initialize object %s\n", partName.c_str());
+            }
+            objects.push_back({model, model->getMaterial()->useNormalMap ? normalmap : lights, material.flags});
+            model->setPosition(transform.position[0], transform.position[1], transform.position[2]);
+            model->setRotation(transform.rotation[0], transform.rotation[1], transform.rotation[2]);
+            model->setScale(transform.scale[0], transform.scale[1], transform.scale[2]);
+        }
+        delete importer;
+        scene.importers[i] = nullptr;
+        return true;
+    }
+
+    Model* model = scene.models[i];
+    objects.push_back({model, material.shader == SCENE_SHADER_NORMALMAP ? normalmap : lights, material.flags});
+
+    // Initialize it with its texture; objects without one are placeholders that draw nothing
+    if (material.diffuse == SCENE_FRAMEBUFFER_TEXTURE) {
+        if (primitive.type != SCENE_CUBE) {
+            printf("ERROR: Only cubes can show the framebuffer (object %s in %s)\n", name, scene.path);
+            return false;
+        }
+        static_cast<Cube*>(model)->initBuffer(frameBuffer);
+        monitorScreen = model;
+        monitorScreenFlags = material.flags;
+    } else if (material.diffuse != SCENE_NO_TEXTURE) {
+        const char* texture = scene.file.getTexture(material.diffuse);
+        if (!model->init(texture)) {
+            printf("WARNING: Failed to initialize object %s with %s\n", name, texture);
+        }
+    }
+    const char* normalMap = scene.file.getTexture(material.normal);
+    if (normalMap != nullptr) {
+        model->loadNormalMap(normalMap);
+    }
+
+    // Place it and set its material
+    model->setPosition(transform.position[0], transform.position[1], transform.position[2]);
+    model->setRotation(transform.rotation[0], transform.rotation[1], transform.rotation[2]);
+    model->setScale(transform.scale[0], transform.scale[1], transform.scale[2]);
+    model->getMaterial()->setSpecular(material.specular[0], material.specular[1], material.specular[2]);
+    model->getMaterial()->setShininess(material.shininess);
+    return true;
+}
+
+/**
+ * @brief Appends the uploaded objects of a scene file to the scene, in file order, and tiles them with --stress.
+ *
+ * @param scene The loaded scene.
+ * @return bool true if the scene was set up; false if the stress scene can't be generated
+ */
+bool finishScene(SceneLoad& scene) {
+    size_t firstObject = sceneObjects.size();
+    for (const vector<SceneObject>& objects : scene.objects) {
+        sceneObjects.insert(sceneObjects.end(), objects.begin(), objects.end());
+    }
+    printf("INFO: Loaded %u objects from %s (%.2f ms reading the file)\n", scene.file.getObjectCount(), scene.path,
+           scene.readMs);
+    if (MeshCache::enabled) {
+        printf("INFO: Mesh cache: %d meshes loaded, %d generated and written to %s\n", MeshCache::hits,
+               MeshCache::misses, MeshCache::directory.c_str());
+    }
+
+    // Tile the scene for scaling tests, drawing its objects as shared prototypes around the first one
+    if (stressInstances > 0 && sceneObjects.size() > firstObject) {
+        TransformBatch placements;
+        placements.resize(sceneObjects.size() - firstObject);
+        for (size_t i = firstObject; i < sceneObjects.size(); ++i) {
+            Model* model = sceneObjects[i].model;
+            placements.set(i - firstObject, model->getPosition(), model->getRotation(), model->getScale());
+        }
+        vector<StressPart> parts(placements.size());
+        vector<glm::mat4> world(parts.size()), normals(parts.size());
+        composeTransforms(placements, 0, parts.size(), world.data(), normals.data());
+        for (size_t i = 0; i < parts.size(); ++i) {
+            parts[i] = {sceneObjects[firstObject + i].model, sceneObjects[firstObject + i].shader, world[i],
+                        normals[i]};
+        }
+        stressScene = new StressScene();
+        if (!stressScene->generate(parts, stressInstances, sceneObjects[firstObject].model->getPosition())) {
+            return false;
+        }
+        printf("INFO: Stress scene of %d desk setups, %d objects\n", stressInstances,
+               (int) stressScene->getObjectCount());
+    }
+    return true;
+}
+
+/**
+ * @brief Hands the scene to the GPU culling as parts and instances, and uploads it (see GpuCulling::upload).
+ *
+ * The stress scene's parts and desk setups become the parts and instances, with its materials as the palette.
+ * Otherwise every scene object is a part of a single instance, placed where its model is now: objects the GPU
+ * culls don't move. Parts are drawn with the GPU-driven variant of their shader.
+ *
+ * @return bool true if the scene was uploaded; false if it is empty or has a tessellated model
+ */
+bool uploadGpuScene() {
+    auto variant = [](Shader* shader) { return shader == normalmap ? normalmapGpu : lightsGpu; };
+    if (stressScene != nullptr) {
+        for (const StressPart& part : stressScene->getParts()) {
+            gpuCulling.addPart(part.model, variant(part.shader), part.transform, part.normalMatrix);
+        }
+        vector<glm::vec4> palette(STRESS_MATERIALS);
+        for (int i = 0; i < STRESS_MATERIALS; ++i) {
+            const StressMaterial& material = stressScene->getMaterial((unsigned char) i);
+            palette[i] = glm::vec4(material.specular, material.shininess);
+        }
+        gpuCulling.setMaterials(palette);
+        for (const StressInstance& instance : stressScene->getInstances()) {
+            gpuCulling.addInstance(instance.transform, instance.normalMatrix, instance.materials);
+        }
+    } else {
+        TransformBatch placements;
+        placements.resize(sceneObjects.size());
+        for (size_t i = 0; i < sceneObjects.size(); ++i) {
+            Model* model = sceneObjects[i].model;
+            placements.set(i, model->getPosition(), model->getRotation(), model->getScale());
+        }
+        vector<glm::mat4> world(sceneObjects.size()), normals(sceneObjects.size());
+        composeTransforms(placements, 0, placements.size(), world.data(), normals.data());
+        for (size_t i = 0; i < sceneObjects.size(); ++i) {
+            gpuCulling.addPart(sceneObjects[i].model, variant(sceneObjects[i].shader), world[i], normals[i]);
+        }
+        gpuCulling.addInstance(glm::mat4(1.0f), glm::mat4(1.0f), nullptr);
+    }
+    return gpuCulling.upload();
+}
+
+
+// Function to check if an object with the given SCENE_MIRROR_* flags is drawn in the given screen mirror state
+bool isVisible(unsigned int flags, bool mirror) {
+    if (flags & SCENE_MIRROR_ON) {
+        return mirror;
+    }
+    if (flags & SCENE_MIRROR_OFF) {
+        return !mirror;
+    }
+    return true;
+}
+
 // Function to process user input from the keyboard
 void processInput(GLFWwindow* window) {
-    // Variable to track whether the 'P' key is pressed
+    // Variables to track whether the 'P' and 'H' keys are pressed
     static bool p_pressed = false;
+    static bool h_pressed = false;
 
     // Close the window if the 'ESC' key is pressed
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
@@ -378,6 +1153,15 @@ void processInput(GLFWwindow* window) {
         p_pressed = false;
     }
 
+    // Toggle the performance overlay when the 'H' key is pressed and released
+    if (!h_pressed && glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS) {
+        showHud = !showHud;
+        h_pressed = true;
+    }
+    else if (h_pressed && glfwGetKey(window, GLFW_KEY_H) == GLFW_RELEASE) {
+        h_pressed = false;
+    }
+
     // Toggle screen mirror state when the '1' and '2' keys are pressed
     if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS) {
         screenMirror = false;
@@ -403,17 +1187,256 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
 
         // Process the mouse movement for the camera
         camera->ProcessMouseMovement(offsetX, offsetY);
+        framePacer.latchCamera(*camera, glfwGetTime());
     }
 }
 
 
 void scrollCallback(GLFWwindow *window, double xoffset, double yoffset) {
     camera->ProcessMouseScroll((float) yoffset);
+    framePacer.latchCamera(*camera, glfwGetTime());
 }
 
 
 void resizeWindow(GLFWwindow *window, int width, int height) {
-    glViewport(0, 0, width, height);
+    // Minimized windows report a zero size, keep the last one
+    if (width > 0 && height > 0) {
+        windowWidth = width;
+        windowHeight = height;
+        camera->setAspect((float) width / (float) height);
+    }
+    // The render targets follow with the next frame drawn (see addFramePasses)
+}
+
+
+/**
+ * @brief Runs the main thread's part of a frame and fills its snapshot.
+ *
+ * This function handles pending events and processes input (or places the camera along the benchmark path),
+ * updates the frame time and builds the draw list of the frame, then copies the camera, window size and overlay
+ * state the render side needs, so it reads nothing the main thread goes on changing. Events are polled here,
+ * right before the frame is built, so the frame shows the freshest input.
+ *
+ * @param frame      The snapshot to fill.
+ * @param benchmark  The running benchmark, or null.
+ * @param cameraPath The camera path the benchmark flies.
+ */
+void updateFrame(FrameSnapshot& frame, FrameBenchmark* benchmark, const CameraPath& cameraPath) {
+    {
+        PROFILE_SCOPE("events");
+        glfwPollEvents();
+        frame.inputTime = glfwGetTime();
+    }
+
+    {
+        PROFILE_SCOPE("input");
+        if (benchmark != nullptr) {
+            benchmark->beginFrame();
+            cameraPath.apply(camera, benchmark->getPathTime());
+        } else {
+            // Process user input
+            processInput(gWindow);
+        }
+        framePacer.latchCamera(*camera, frame.inputTime);
+    }
+
+    {
+        // Update frame time
+        PROFILE_SCOPE("update");
+        auto currentFrame = (float)glfwGetTime();
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+        frame.frameMs = deltaTime * 1000.0f;
+    }
+
+    {
+        // Cull the objects and resolve their draws on the job pool, once for both passes
+        PROFILE_SCOPE("build draw list");
+        buildDrawList(frame.drawList);
+    }
+
+    frame.camera = *camera;
+    frame.view = frame.drawList.getView();
+    frame.projection = frame.drawList.getProjection();
+    frame.width = windowWidth;
+    frame.height = windowHeight;
+    frame.showHud = showHud;
+    frame.screenMirror = screenMirror;
+}
+
+
+/**
+ * @brief Draws a frame from its snapshot on the thread that owns the context and presents it.
+ *
+ * With late latching, the camera input moved last replaces the frame's first. The per-object data of the draws
+ * is written into the object ring on the job pool, which every pass reads, then the passes of the frame run
+ * from the frame graph (see addFramePasses) and the buffers are swapped, timing the input-to-present latency.
+ *
+ * @param frame The snapshot to draw.
+ */
+void renderFrame(FrameSnapshot& frame) {
+    renderStats.reset();
+    renderStats.culledObjects = frame.drawList.getCulledCount();
+    hud->setVisible(frame.showHud);
+    hud->addFrameTime(frame.frameMs);
+    dynamicResolution.update(profiler.getGpuFrameMs());
+
+    if (framePacer.isLateLatching()) {
+        PROFILE_SCOPE("late latch");
+        framePacer.lateLatch(frame);
+    }
+
+    {
+        // Write the transforms and materials of the draws straight into the ring buffer
+        PROFILE_SCOPE("object data");
+        GLsizeiptr stride = objectRing.getAlignedSize(sizeof(ObjectUniforms));
+        objectRing.beginFrame(stride * frame.drawList.getPacketCount());
+        frame.drawList.writeObjects(objectRing);
+        objectRing.flush();
+    }
+
+    if (gpuCulling.isEnabled()) {
+        // Cull the scene on the GPU for the camera of the frame, after late latching, once for both passes
+        PROFILE_SCOPE("gpu culling");
+        PROFILE_GPU_SCOPE("gpu culling");
+        for (int i = 0; i < gpuCulling.getPartCount(); ++i) {
+            gpuCulling.setPartVisible(i, isVisible(sceneObjects[i].flags, frame.screenMirror));
+        }
+        gpuCulling.cull(frame.view, frame.projection, frame.height);
+        renderStats.culledObjects = gpuCulling.getCulledCount();
+    }
+
+    {
+        // Describe the passes, then run the ones the window needs
+        PROFILE_SCOPE("frame graph");
+        frameGraph.reset();
+        addFramePasses(frame);
+        if (frameGraph.compile()) {
+            frameGraph.execute();
+        }
+    }
+    objectRing.endFrame();
+
+    {
+        // Swap buffers
+        PROFILE_SCOPE("present");
+        glfwSwapBuffers(gWindow);
+        framePacer.markPresent(frame.inputTime);
+    }
+}
+
+
+/**
+ * @brief Adds the passes of a frame and their render targets to the frame graph.
+ *
+ * The monitor pass renders the scene into the texture the monitor screen shows, which follows the size of the
+ * window, with a transient depth buffer. It only runs if the main pass reads that texture, i.e. if the screen is
+ * in view. The main pass renders the scene into the window, or with dynamic resolution into a transient target
+ * at a scale that follows the GPU time of earlier frames, which the upscale pass sharpens into the window. With
+ * GPU culling the main pass renders into a transient target too (copied into the window by the present pass
+ * unless it is upscaled), so the depth pyramid pass can build the next frame's occlusion test from its depth,
+ * and the screen counts as in view unless the screen mirror state hides it. The performance overlay, if shown,
+ * goes on top. The graph culls and orders the passes and lets the transient targets share memory.
+ *
+ * @param frame The snapshot of the frame.
+ */
+void addFramePasses(FrameSnapshot& frame) {
+    int window = frameGraph.importWindow(frame.width, frame.height);
+    frameGraph.markOutput(window);
+
+    // The monitor screen shows what the camera sees, at the size and aspect of the window
+    if (frameBuffer->getWidth() != frame.width || frameBuffer->getHeight() != frame.height) {
+        frameBuffer->resize(frame.width, frame.height);
+    }
+    int monitor = frameGraph.importTexture("monitor", frameBuffer->getID(), frame.width, frame.height);
+    int monitorDepth = frameGraph.createTexture("monitor depth", {frame.width, frame.height, GL_DEPTH_COMPONENT24});
+    frameGraph.addPass("monitor pass", {}, {monitor, monitorDepth}, [&frame](FrameGraph&) {
+        passViewport = glm::vec2(frame.width, frame.height);
+        renderScene(frame);
+    });
+    vector<int> sceneReads;
+    bool gpuDriven = gpuCulling.isEnabled();
+    if (monitorScreen != nullptr && (gpuDriven ? isVisible(monitorScreenFlags, frame.screenMirror)
+                                               : frame.drawList.draws(monitorScreen))) {
+        sceneReads.push_back(monitor);
+    }
+
+    if (dynamicResolution.isEnabled() || gpuDriven) {
+        // Render at the current scale into the corner of a target the size of the window at the largest one (sRGB
+        // like the window, so the upscale filters linear colors)
+        int width = frame.width;
+        int height = frame.height;
+        if (dynamicResolution.isEnabled()) {
+            dynamicResolution.setWindowSize(frame.width, frame.height);
+            width = dynamicResolution.getTargetWidth();
+            height = dynamicResolution.getTargetHeight();
+        }
+        int sceneColor = frameGraph.createTexture("scene color", {width, height, GL_SRGB8_ALPHA8});
+        int sceneDepth = frameGraph.createTexture("scene depth", {width, height, GL_DEPTH_COMPONENT24});
+        int mainPass = frameGraph.addPass("main pass", sceneReads, {sceneColor, sceneDepth}, [&frame](FrameGraph&) {
+            passViewport = glm::vec2(frame.width, frame.height);
+            if (dynamicResolution.isEnabled()) {
+                passViewport = glm::vec2(dynamicResolution.getRenderWidth(), dynamicResolution.getRenderHeight());
+            }
+            glViewport(0, 0, (GLsizei) passViewport.x, (GLsizei) passViewport.y);
+            renderScene(frame);
+        });
+        if (dynamicResolution.isEnabled()) {
+            frameGraph.addPass("upscale", {sceneColor}, {window}, [sceneColor](FrameGraph& graph) {
+                dynamicResolution.resolve(graph.getTexture(sceneColor));
+            });
+        } else {
+            // Both are sRGB: copy the encoded colors as they are
+            frameGraph.addPass("present", {sceneColor}, {window}, [mainPass, &frame](FrameGraph& graph) {
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, graph.getPassFramebuffer(mainPass));
+                glDisable(GL_FRAMEBUFFER_SRGB);
+                glBlitFramebuffer(0, 0, frame.width, frame.height, 0, 0, frame.width, frame.height,
+                                  GL_COLOR_BUFFER_BIT, GL_NEAREST);
+                glEnable(GL_FRAMEBUFFER_SRGB);
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+            });
+        }
+
+        // The farthest depth of every block of the frame, which the next frame's cull tests objects against
+        if (gpuDriven) {
+            GLuint texture = gpuCulling.getPyramid(width, height);
+            int pyramid = frameGraph.importTexture("depth pyramid", texture, gpuCulling.getPyramidWidth(),
+                                                   gpuCulling.getPyramidHeight());
+            frameGraph.markOutput(pyramid);
+            frameGraph.addPass("depth pyramid", {sceneDepth}, {pyramid}, [sceneDepth, &frame](FrameGraph& graph) {
+                glm::ivec2 size(frame.width, frame.height);
+                if (dynamicResolution.isEnabled()) {
+                    size = glm::ivec2(dynamicResolution.getRenderWidth(), dynamicResolution.getRenderHeight());
+                }
+                gpuCulling.buildPyramid(graph.getTexture(sceneDepth), size.x, size.y,
+                                        frame.projection * frame.view);
+            });
+        }
+    } else {
+        frameGraph.addPass("main pass", sceneReads, {window}, [&frame](FrameGraph&) {
+            passViewport = glm::vec2(frame.width, frame.height);
+            renderScene(frame);
+        });
+    }
+
+    if (hud->isVisible()) {
+        frameGraph.addPass("hud", {}, {window}, [&frame](FrameGraph&) {
+            hud->render(frame.width, frame.height);
+        });
+    }
+}
+
+
+/**
+ * @brief Closes the startup timeline once the first frame is on screen and reports it.
+ *
+ * @param graph The startup graph.
+ * @return bool false if the startup report was requested and couldn't be written; true otherwise
+ */
+bool reportStartup(StartupGraph& graph) {
+    graph.markFirstFrame();
+    graph.printReport();
+    return startupReport == nullptr || graph.writeReport(startupReport);
 }
 
 
@@ -421,12 +1444,13 @@ void resizeWindow(GLFWwindow *window, int width, int height) {
  * @brief Renders the scene with all its objects and applies the appropriate shaders.
  *
  * This function sets the background color, clears the color and depth buffers, and toggles
- * depth testing and face culling settings. It then renders the objects in the scene using
- * their corresponding shaders. The computer monitor's screen or scene is rendered based on
- * the screen mirror state. Finally, it renders the rest of the objects in the scene with
- * their respective shaders.
+ * depth testing and face culling settings. It then submits the draw list of the frame, built
+ * ahead by buildDrawList, which holds the objects of the scene (or the stress scene) that are
+ * in view, with their shaders and the screen mirror state applied.
+ *
+ * @param frame The snapshot of the frame.
  */
-void renderScene() {
+void renderScene(FrameSnapshot& frame) {
     // Set the background color and clear the color and depth buffers
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -435,93 +1459,181 @@ void renderScene() {
     glDisable(GL_DEPTH_TEST);
     glDisable(GL_CULL_FACE);
 
-    skyBox->render(camera);
+    {
+        PROFILE_SCOPE("skybox");
+        PROFILE_GPU_SCOPE("skybox");
+        skyBox->render(&frame.camera);
+    }
 
     // Enable depth testing and face culling
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
 
-    // Render the objects in the scene using their corresponding shaders
-    render(desk, lights);
-    render(computerMonitor.shell, normalmap);
+    PROFILE_SCOPE("submit draw list");
+    submitDrawList(frame);
+}
 
-    // Render the computer monitor screen or scene based on the screen mirror state
-    if (screenMirror) {
-        render(computerMonitor.screen, lights);
-    }
-    else {
-        render(computerMonitor.scene, lights);
-    }
 
-    // Render the rest of the objects in the scene with their respective shaders
-    render(computerMonitor.stand, normalmap);
-    render(computerMonitor.base, normalmap);
-    render(can, lights);
-    render(canTop, lights);
-    render(leg1, lights);
-    render(leg2, lights);
-    render(leg3, lights);
-    render(leg4, lights);
+/**
+ * @brief Builds the draw list of the frame on the job pool.
+ *
+ * Chunks of objects are culled against the camera's frustum, and the objects in view get their model and normal
+ * matrices, material, level of detail and shader in a packet. Each chunk of scene objects first composes its
+ * matrices in one batch from the models' placements, on the widest SIMD kernel the CPU has. Tessellated models
+ * are drawn with the surface shader, which evaluates their analytic surface on the GPU. The stress scene adds
+ * every part of every desk setup from its prototype model, with the instance's transform and material. Parts
+ * follow the screen mirror state like the scene objects they were made from. Every object keeps the level it
+ * drew last (sceneLevels, or the instance's levels), so the hysteresis of its next choice doesn't depend on other
+ * instances of its model.
+ *
+ * @param drawList The draw list to fill.
+ */
+void buildDrawList(DrawList& drawList) {
+    drawList.begin(camera->getView(), camera->getProjection(), windowHeight);
 
-    render(ring, lights);
+    // The GPU culls and places the objects itself (see renderFrame)
+    if (gpuCulling.isEnabled()) {
+        return;
+    }
 
-    render(pyramid, lights);
+    if (stressScene != nullptr) {
+        const vector<StressPart>& parts = stressScene->getParts();
+        vector<StressInstance>& instances = stressScene->getInstances();
+        drawList.build((int) instances.size(), [&](int begin, int end, vector<DrawPacket>& packets) {
+            for (int j = begin; j < end; ++j) {
+                StressInstance& instance = instances[j];
+                for (size_t i = 0; i < parts.size(); ++i) {
+                    if (!isVisible(sceneObjects[i].flags, screenMirror)) {
+                        continue;
+                    }
+                    Model* model = parts[i].model;
+                    Shader* shader = model->isTessellated() ? surface : parts[i].shader;
+                    glm::mat4 m = instance.transform * parts[i].transform;
+                    glm::mat4 n = instance.normalMatrix * parts[i].normalMatrix;
+                    unsigned char& level = instance.levels[i];
+                    if (instance.materials[i] == STRESS_OWN_MATERIAL) {
+                        Material* material = model->getMaterial();
+                        drawList.add(model, shader, m, n, material->specular, material->shininess, level, packets);
+                    } else {
+                        const StressMaterial& material = stressScene->getMaterial(instance.materials[i]);
+                        drawList.add(model, shader, m, n, material.specular, material.shininess, level, packets);
+                    }
+                }
+            }
+        });
+    } else {
+        sceneTransforms.resize(sceneObjects.size());
+        sceneWorld.resize(sceneObjects.size());
+        sceneNormals.resize(sceneObjects.size());
+        sceneLevels.resize(sceneObjects.size());
+        drawList.build((int) sceneObjects.size(), [&](int begin, int end, vector<DrawPacket>& packets) {
+            for (int i = begin; i < end; ++i) {
+                Model* model = sceneObjects[i].model;
+                sceneTransforms.set(i, model->getPosition(), model->getRotation(), model->getScale());
+            }
+            composeTransforms(sceneTransforms, begin, end, &sceneWorld[begin], &sceneNormals[begin]);
+            for (int i = begin; i < end; ++i) {
+                const SceneObject& object = sceneObjects[i];
+                if (isVisible(object.flags, screenMirror)) {
+                    Model* model = object.model;
+                    Material* material = model->getMaterial();
+                    drawList.add(model, model->isTessellated() ? surface : object.shader, sceneWorld[i],
+                                 sceneNormals[i], material->specular, material->shininess, sceneLevels[i], packets);
+                }
+            }
+        });
+    }
 }
 
 
-
 /**
- * @brief Renders a 3D model with the specified shader, applying material properties, lighting, and transformations.
+ * @brief Issues the GL calls of every packet in the draw list, in order.
  *
- * This function takes a pointer to a Model object and a pointer to a Shader object. It sets the shader program as
- * active and computes the model matrix (M) by combining scaling, rotation, and translation matrices. The function
- * then sets the model, view, and projection matrices in the shader. If the model has a material, the function sets
- * the material properties in the shader, including whether the material uses a normal map.
+ * Programs are only bound when the shader changes between packets, and the uniforms that are the same for the
+ * whole frame (texture units, view and projection, the directional light, camera and tessellation settings) are
+ * set once per program and pass. Per-object data comes from the object ring, one buffer binding per draw.
  *
- * The shader is also updated with the directional light properties, camera position, and light position. Finally,
- * the function calls the render() method on the model to draw it using the specified shader.
+ * @param frame The snapshot of the frame.
+ */
+void submitDrawList(FrameSnapshot& frame) {
+    Shader* current = nullptr;
+    vector<Shader*> prepared;
+    if (gpuCulling.isEnabled()) {
+        gpuCulling.draw([&frame, &prepared](Shader* shader) {
+            if (find(prepared.begin(), prepared.end(), shader) == prepared.end()) {
+                setFrameUniforms(shader, frame);
+                prepared.push_back(shader);
+            }
+        });
+        return;
+    }
+    for (const vector<DrawPacket>& chunk : frame.drawList.getChunks()) {
+        for (const DrawPacket& packet : chunk) {
+            if (packet.shader != current) {
+                current = packet.shader;
+                current->use();
+                if (find(prepared.begin(), prepared.end(), current) == prepared.end()) {
+                    setFrameUniforms(current, frame);
+                    prepared.push_back(current);
+                }
+            }
+            submit(packet);
+        }
+    }
+}
+
+
+/**
+ * @brief Sets the uniforms that every draw of a frame shares on the bound shader.
  *
- * @param model  A pointer to the Model object to be rendered.
- * @param shader A pointer to the Shader object to be used for rendering the model.
+ * @param shader A pointer to the Shader object in use.
+ * @param frame  The snapshot of the frame.
  */
-void render(Model* model, Shader* shader) {
-    // Use the specified shader program
-    shader->use();
-
-    // Compute the model matrix (M) by combining scaling, rotation, and translation matrices
-    glm::mat4 scale, rotation, translation, m;
-    glm::quat rotationQuat;
-    scale = glm::scale(glm::vec3(model->getScale()));
-    rotationQuat = glm::quat(model->getRotation());
-    rotation = glm::toMat4(rotationQuat);
-    translation = glm::translate(model->getPosition());
-    m = translation * rotation * scale;
-
-    // Set the model, view, and projection matrices in the shader
-    shader->setMat4("model", m);
-    shader->setMat4("view", camera->getView());
-    shader->setMat4("projection", camera->getProjection());
-
-    // Set the material properties in the shader if the model has a material
-    Material* material = model->getMaterial();
-    if (model->hasMaterial()) {
-        shader->setInt("material.diffuse", 0);
-        shader->setInt("material.normal", 1);
-        shader->setVec3("material.specular", material->specular);
-        shader->setFloat("material.shininess", material->shininess);
-    }
-
-    // Set the shader properties related to normal maps, lighting, and camera
-    shader->setBool("material.hasNormalMap", material->useNormalMap);
+void setFrameUniforms(Shader* shader, FrameSnapshot& frame) {
+    // Set the texture units of the material
+    shader->setInt("material.diffuse", 0);
+    shader->setInt("material.normal", 1);
+
+    // Set the view and projection matrices in the shader
+    shader->setMat4("view", frame.view);
+    shader->setMat4("projection", frame.projection);
+
+    // Set the shader properties related to lighting and the camera
     shader->setVec3("dirLight.direction", sun.direction);
     shader->setVec3("dirLight.ambient", sun.ambient);
     shader->setVec3("dirLight.diffuse", sun.diffuse);
     shader->setVec3("dirLight.specular", sun.specular);
-    shader->setVec3("viewPos", camera->getPosition());
+    shader->setVec3("viewPos", frame.camera.getPosition());
     shader->setVec3("lightPos", sun.direction);
 
-    // Render the model using the specified shader
-    model->render();
+    // Set the on-screen segment length the tessellation aims for
+    if (shader == surface) {
+        shader->setVec2("viewportSize", passViewport);
+        shader->setFloat("edgePixels", tessellationPixels);
+    }
+}
+
+
+/**
+ * @brief Draws one packet of the draw list with its shader, which is bound already.
+ *
+ * This function binds the packet's ObjectData uniform block, written into the object ring ahead of the passes:
+ * its model and normal matrices, the specular color and shininess of the packet (so instances can vary them),
+ * whether the material uses a normal map, the dequantization of the packet's mesh and, for tessellated models,
+ * the analytic surface. It then calls the renderLod() method on the model to draw the packet's level of detail.
+ *
+ * @param packet The packet to draw.
+ */
+void submit(const DrawPacket& packet) {
+    Model* model = packet.model;
+
+    // Bind the model matrix, material and vertex dequantization written for the draw (see DrawList::writeObjects)
+    glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_DATA_BINDING, objectRing.getBuffer(), packet.objectData,
+                      sizeof(ObjectUniforms));
+
+    // Render the level of detail picked in the build phase using the specified shader; the model isn't changed,
+    // so the main thread can build the next frame's draws from it meanwhile
+    model->renderLod(packet.lod);
 }
 
 
@@ -537,11 +1649,3 @@ void focusCallback(GLFWwindow* window, int focused) {
         windowFocused = false;
     }
 }
-
-// Function to bind the window framebuffer as the render target
-void bindWindowRenderTarget() {
-    // Bind the default framebuffer (window) for rendering
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-    // Set the viewport to the size of the window
-    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
-}
@@ -3,6 +3,15 @@
 
 #include "model.h"
 #include "shader.h"
+#include "scenefile.h"
+#include "startup.h"
+#include "drawlist.h"
+#include "framequeue.h"
+#include "framebenchmark.h"
+
+#include <string>
+
+struct SceneLoad;
 
 // Prototypes:
 bool initialize(int, char *[], GLFWwindow **window);
@@ -17,10 +26,40 @@ void scrollCallback(GLFWwindow *window, double xoffset, double yoffset);
 
 void focusCallback(GLFWwindow *window, int focused);
 
-void renderScene();
+bool runStartup(StartupGraph &graph, int argc, char *argv[]);
+
+int prefetchImage(StartupGraph &graph, SceneLoad &scene, const std::string &path);
+
+bool loadScene(StartupGraph &graph, SceneLoad &scene);
+
+bool buildSceneModel(SceneLoad &scene, uint32_t i);
+
+bool importSceneModel(SceneLoad &scene, uint32_t i);
+
+bool uploadSceneObject(SceneLoad &scene, uint32_t i);
+
+bool finishScene(SceneLoad &scene);
+
+bool uploadGpuScene();
+
+bool isVisible(unsigned int flags, bool mirror);
+
+void updateFrame(FrameSnapshot &frame, FrameBenchmark *benchmark, const CameraPath &cameraPath);
+
+void renderFrame(FrameSnapshot &frame);
+
+void addFramePasses(FrameSnapshot &frame);
+
+bool reportStartup(StartupGraph &graph);
+
+void renderScene(FrameSnapshot &frame);
+
+void buildDrawList(DrawList &drawList);
+
+void submitDrawList(FrameSnapshot &frame);
 
-void render(Model *model, Shader *shader);
+void setFrameUniforms(Shader *shader, FrameSnapshot &frame);
 
-void bindWindowRenderTarget();
+void submit(const DrawPacket &packet);
 
 #endif //MAIN_H
@@ -0,0 +1,113 @@
+#include "mappedfile.h"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() {
+    bytes = nullptr;
+    length = 0;
+#ifdef _WIN32
+    file = INVALID_HANDLE_VALUE;
+    mapping = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const char *path, bool mustExist) {
+    close();
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        if (mustExist) {
+            printf("ERROR: Failed to open %s\n", path);
+        }
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        printf("ERROR: %s is empty\n", path);
+        close();
+        return false;
+    }
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping != nullptr) {
+        bytes = (const unsigned char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+    if (bytes == nullptr) {
+        printf("ERROR: Failed to map %s\n", path);
+        close();
+        return false;
+    }
+    length = (size_t) fileSize.QuadPart;
+    return true;
+}
+
+void MappedFile::close() {
+    if (bytes != nullptr) {
+        UnmapViewOfFile(bytes);
+    }
+    if (mapping != nullptr) {
+        CloseHandle(mapping);
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+    }
+    bytes = nullptr;
+    length = 0;
+    file = INVALID_HANDLE_VALUE;
+    mapping = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const char *path, bool mustExist) {
+    close();
+    int descriptor = ::open(path, O_RDONLY);
+    if (descriptor < 0) {
+        if (mustExist) {
+            printf("ERROR: Failed to open %s\n", path);
+        }
+        return false;
+    }
+    struct stat status = {};
+    if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+        printf("ERROR: %s is empty\n", path);
+        ::close(descriptor);
+        return false;
+    }
+    // The mapping keeps the file referenced, so the descriptor can go right away:
+    void *view = mmap(nullptr, (size_t) status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor);
+    if (view == MAP_FAILED) {
+        printf("ERROR: Failed to map %s\n", path);
+        return false;
+    }
+    bytes = (const unsigned char *) view;
+    length = (size_t) status.st_size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (bytes != nullptr) {
+        munmap((void *) bytes, length);
+    }
+    bytes = nullptr;
+    length = 0;
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+
+// A read-only memory mapping of a whole file (mmap, or MapViewOfFile on Windows). Pages are read on first
+// touch, so opening is cheap whatever the file's size, and data can be used in place without copying.
+class MappedFile {
+public:
+    MappedFile();
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Maps the file, closing any previous mapping. Returns false if it can't be opened or is empty; a missing
+    // file is only reported as an error if mustExist is set.
+    bool open(const char *path, bool mustExist = true);
+
+    void close();
+
+    bool isOpen() const { return bytes != nullptr; }
+
+    const unsigned char *data() const { return bytes; }
+
+    size_t size() const { return length; }
+
+private:
+    const unsigned char *bytes;
+    size_t length;
+#ifdef _WIN32
+    void *file;
+    void *mapping;
+#endif
+};
+
+#endif //MAPPEDFILE_H
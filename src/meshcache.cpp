@@ -0,0 +1,202 @@
+#include "meshcache.h"
+#include "vertexformat.h"
+#include "model.h"
+#include "lod.h"
+#include "assetpack.h"
+
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+bool MeshCache::enabled = true;
+std::string MeshCache::directory = "cache";
+int MeshCache::hits = 0;
+int MeshCache::misses = 0;
+
+uint32_t MeshLayout::getVertexStride() const {
+    if (packed) {
+        return floatsPerVertex == MESH_TANGENT_VERTEX_FLOATS ? PACKED_TANGENT_VERTEX_STRIDE : PACKED_VERTEX_STRIDE;
+    }
+    return floatsPerVertex * sizeof(float);
+}
+
+uint32_t MeshLayout::getIndexBytes() const {
+    return indexCount * (indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int));
+}
+
+// FNV-1a over the bytes of a value:
+template<typename T>
+static void hashValue(uint64_t &hash, const T &value) {
+    const auto *bytes = (const unsigned char *) &value;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+}
+
+uint64_t MeshCache::getKey(const MeshParams &params) {
+    uint64_t hash = 14695981039346656037ull;
+    hashValue(hash, MESH_CACHE_VERSION);
+    hashValue(hash, (int32_t) params.shape);
+    hashValue(hash, params.sectors);
+    hashValue(hash, params.stacks);
+    hashValue(hash, params.radius);
+    hashValue(hash, params.topRadius);
+    hashValue(hash, params.height);
+    hashValue(hash, MAX_LOD_LEVELS);
+    hashValue(hash, Mesh::usePackedVertices);
+    hashValue(hash, Mesh::optimizeMeshes);
+    hashValue(hash, Mesh::useMeshlets);
+    return hash;
+}
+
+std::string MeshCache::getPath(uint64_t key) {
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.mesh", (unsigned long long) key);
+    return directory + name;
+}
+
+// Checks that size bytes at offset lie within the file and start on the section alignment:
+static bool validRange(uint32_t offset, uint32_t size, size_t fileSize) {
+    return offset % MESH_CACHE_ALIGNMENT == 0 && offset <= fileSize && size <= fileSize - offset;
+}
+
+MeshCache::MeshCache() {
+    bytes = nullptr;
+    length = 0;
+}
+
+bool MeshCache::open(uint64_t key) {
+    close();
+    std::string path = getPath(key);
+    AssetView asset = AssetPack::mounted.find(path.c_str());
+    if (asset.data != nullptr) {
+        bytes = asset.data;
+        length = asset.size;
+    } else if (file.open(path.c_str(), false)) {
+        bytes = file.data();
+        length = file.size();
+    } else {
+        return false;
+    }
+
+    // A file of another version or key is regenerated (and overwritten) by the caller:
+    size_t size = length;
+    bool valid = size >= sizeof(MeshCacheHeader) && memcmp(header()->magic, MESH_CACHE_MAGIC, 4) == 0 &&
+                 header()->version == MESH_CACHE_VERSION && header()->key[0] == (uint32_t) key &&
+                 header()->key[1] == (uint32_t) (key >> 32) && header()->fileSize == size &&
+                 header()->levelCount > 0 && header()->levelCount <= MAX_LOD_LEVELS &&
+                 sizeof(MeshCacheHeader) + header()->levelCount * sizeof(MeshCacheLevel) <= size;
+    for (uint32_t i = 0; valid && i < header()->levelCount; ++i) {
+        const MeshLayout &layout = levels()[i].layout;
+        valid = (layout.floatsPerVertex == MESH_VERTEX_FLOATS ||
+                 layout.floatsPerVertex == MESH_TANGENT_VERTEX_FLOATS) && layout.packed <= 1 &&
+                layout.vertexCount > 0 && layout.vertexCount < (1u << 24) && layout.indexCount < (1u << 28) &&
+                (layout.indexType == GL_UNSIGNED_SHORT || layout.indexType == GL_UNSIGNED_INT) &&
+                layout.meshletCount <= layout.indexCount / 3 &&
+                validRange(levels()[i].vertexOffset, layout.getVertexBytes(), size) &&
+                validRange(levels()[i].indexOffset, layout.getIndexBytes(), size) &&
+                validRange(levels()[i].meshletOffset, layout.meshletCount * (uint32_t) sizeof(Meshlet), size);
+    }
+    if (!valid) {
+        close();
+    }
+    return valid;
+}
+
+void MeshCache::close() {
+    file.close();
+    bytes = nullptr;
+    length = 0;
+}
+
+const void *MeshCache::getIndices(uint32_t level) const {
+    if (levels()[level].layout.indexCount == 0) {
+        return nullptr;
+    }
+    return bytes + levels()[level].indexOffset;
+}
+
+const Meshlet *MeshCache::getMeshlets(uint32_t level) const {
+    if (levels()[level].layout.meshletCount == 0) {
+        return nullptr;
+    }
+    return (const Meshlet *) (bytes + levels()[level].meshletOffset);
+}
+
+// Rounds offset up to the section alignment:
+static uint32_t alignSection(size_t offset) {
+    return (uint32_t) ((offset + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT);
+}
+
+bool MeshCache::write(uint64_t key, const std::vector<MeshData> &levels, const MeshCacheChain &chain) {
+    MeshCacheHeader header = {};
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = MESH_CACHE_VERSION;
+    header.key[0] = (uint32_t) key;
+    header.key[1] = (uint32_t) (key >> 32);
+    header.levelCount = (uint32_t) levels.size();
+    header.chain = chain;
+
+    // Lay out the level table, then every level's vertices, indices and meshlets:
+    std::vector<MeshCacheLevel> table(levels.size());
+    size_t offset = sizeof(MeshCacheHeader) + levels.size() * sizeof(MeshCacheLevel);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        table[i].layout = levels[i].layout;
+        table[i].optimization = levels[i].optimization;
+        table[i].vertexOffset = alignSection(offset);
+        table[i].indexOffset = alignSection(table[i].vertexOffset + levels[i].vertices.size());
+        table[i].meshletOffset = alignSection(table[i].indexOffset + levels[i].indices.size());
+        offset = table[i].meshletOffset + levels[i].meshlets.size() * sizeof(Meshlet);
+    }
+    header.fileSize = (uint32_t) offset;
+
+    // Assemble the file in memory so it is written with one call:
+    std::vector<unsigned char> bytes(offset, 0);
+    memcpy(bytes.data(), &header, sizeof(header));
+    memcpy(bytes.data() + sizeof(header), table.data(), table.size() * sizeof(MeshCacheLevel));
+    for (size_t i = 0; i < levels.size(); ++i) {
+        memcpy(bytes.data() + table[i].vertexOffset, levels[i].vertices.data(), levels[i].vertices.size());
+        if (!levels[i].indices.empty()) {
+            memcpy(bytes.data() + table[i].indexOffset, levels[i].indices.data(), levels[i].indices.size());
+        }
+        if (!levels[i].meshlets.empty()) {
+            memcpy(bytes.data() + table[i].meshletOffset, levels[i].meshlets.data(),
+                   levels[i].meshlets.size() * sizeof(Meshlet));
+        }
+    }
+
+    // Meshes may be prepared on several threads (see Model::prepare). If one of them has written the file
+    // already it is left alone, as another thread may have it mapped:
+    static std::mutex writeMutex;
+    std::lock_guard<std::mutex> lock(writeMutex);
+    MeshCache existing;
+    if (existing.open(key)) {
+        return true;
+    }
+
+    // The directory may already exist, any other failure shows when the file is opened:
+#ifdef _WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+    std::string path = getPath(key);
+    FILE *out = fopen(path.c_str(), "wb");
+    if (out == nullptr) {
+        printf("WARNING: Failed to write the mesh cache file %s\n", path.c_str());
+        return false;
+    }
+    bool written = fwrite(bytes.data(), 1, bytes.size(), out) == bytes.size();
+    written = fclose(out) == 0 && written;
+    if (!written) {
+        printf("WARNING: Failed to write the mesh cache file %s\n", path.c_str());
+        remove(path.c_str());
+    }
+    return written;
+}
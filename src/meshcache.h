@@ -0,0 +1,127 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "meshgen.h"
+#include "meshopt.h"
+#include "mappedfile.h"
+
+// Mesh cache files start with this tag and version. Bump the version whenever the generator, optimizer or
+// vertex packing change their output, so stale files are regenerated:
+const char MESH_CACHE_MAGIC[4] = {'M', 'S', 'H', 'B'};
+const uint32_t MESH_CACHE_VERSION = 3;
+
+// Vertex and index data of every level starts on this many bytes:
+const uint32_t MESH_CACHE_ALIGNMENT = 16;
+
+// How to read the buffers of a mesh as they are uploaded to the GPU:
+struct MeshLayout {
+    uint32_t vertexCount;
+    uint32_t indexCount;      // 0 for an unindexed triangle list
+    uint32_t indexType;       // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    uint32_t floatsPerVertex; // of the float layout the vertices came from
+    uint32_t packed;          // 1 if the vertices use the packed format (see vertexformat.h)
+    float positionScale[3];   // dequantization of packed positions
+    float positionOffset[3];
+    float boundsMin[3];       // object space bounding box
+    float boundsMax[3];
+    uint32_t meshletCount;    // 0 if the mesh has no meshlets (see buildMeshlets)
+
+    uint32_t getVertexStride() const;
+
+    uint32_t getVertexBytes() const { return vertexCount * getVertexStride(); }
+
+    uint32_t getIndexBytes() const;
+};
+
+// A mesh ready for upload (see Mesh::prepare): the exact bytes of its vertex and index buffers, and its meshlets.
+struct MeshData {
+    MeshLayout layout;
+    MeshOptimizationStats optimization;
+    std::vector<unsigned char> vertices;
+    std::vector<unsigned char> indices;
+    std::vector<Meshlet> meshlets;
+};
+
+// One level of detail in a cache file; offsets are in bytes from the start of the file.
+struct MeshCacheLevel {
+    MeshLayout layout;
+    MeshOptimizationStats optimization;
+    uint32_t vertexOffset;
+    uint32_t indexOffset;
+    uint32_t meshletOffset;
+};
+
+// The LOD selection parameters of a chain (see LodSelector::setChain):
+struct MeshCacheChain {
+    int32_t sectors;
+    float radius;
+    float boundingRadius;
+};
+
+struct MeshCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t key[2];      // low and high half of the key the file was written for
+    uint32_t levelCount;  // MeshCacheLevel[levelCount] follow the header
+    MeshCacheChain chain;
+    uint32_t fileSize;
+};
+
+// Cache of the GPU-ready buffers of parametric meshes, so the generator, optimizer and packing only run the
+// first time a mesh is used. Every mesh is one file named after its key, holding the interleaved vertices,
+// indices, meshlets, bounds and layout of each level of its LOD chain. Levels are aligned so a mapped file can be
+// handed to glBufferData as is. If an asset pack is mounted (see assetpack.h), files it holds are read from it.
+class MeshCache {
+public:
+    MeshCache();
+
+    // Returns the key of a parametric mesh uploaded with the current vertex settings (packing, optimization,
+    // meshlets):
+    static uint64_t getKey(const MeshParams &params);
+
+    // Returns the path of the file of a key:
+    static std::string getPath(uint64_t key);
+
+    // Maps the file of a key, or finds it in the mounted pack. Returns false if there is none or it is stale or
+    // invalid.
+    bool open(uint64_t key);
+
+    void close();
+
+    const MeshCacheChain &getChain() const { return header()->chain; }
+
+    uint32_t getLevelCount() const { return header()->levelCount; }
+
+    const MeshCacheLevel &getLevel(uint32_t level) const { return levels()[level]; }
+
+    const void *getVertices(uint32_t level) const { return bytes + levels()[level].vertexOffset; }
+
+    // Returns the level's indices, or null if it has none:
+    const void *getIndices(uint32_t level) const;
+
+    // Returns the level's meshlets, or null if it has none:
+    const Meshlet *getMeshlets(uint32_t level) const;
+
+    // Writes the levels of a mesh to the file of a key, creating the cache directory if needed. Safe to call
+    // from several threads; a valid file of the key is kept.
+    static bool write(uint64_t key, const std::vector<MeshData> &levels, const MeshCacheChain &chain);
+
+    static bool enabled; // Look meshes up in the cache and add the ones it misses (on by default).
+    static std::string directory; // Where the cache files live.
+    static int hits; // Meshes loaded from and written to the cache so far.
+    static int misses;
+
+private:
+    const MeshCacheHeader *header() const { return (const MeshCacheHeader *) bytes; }
+
+    const MeshCacheLevel *levels() const { return (const MeshCacheLevel *) (bytes + sizeof(MeshCacheHeader)); }
+
+    MappedFile file;
+    const unsigned char *bytes; // the mapped file or pack entry
+    size_t length;
+};
+
+#endif //MESHCACHE_H
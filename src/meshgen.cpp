@@ -0,0 +1,343 @@
+#include "meshgen.h"
+#include "jobs.h"
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+// Below this many vertices splitting the work into jobs costs more than it saves:
+const unsigned int PARALLEL_VERTEX_THRESHOLD = 65536;
+
+// Smallest band of rows handed to a job:
+const int MIN_ROWS_PER_THREAD = 16;
+
+void TrigTable::build(int steps, float start, float step) {
+    sines.resize(steps + 1);
+    cosines.resize(steps + 1);
+    for (int i = 0; i <= steps; ++i) {
+        float angle = start + (float) i * step;
+        sines[i] = sinf(angle);
+        cosines[i] = cosf(angle);
+    }
+}
+
+MeshGenerator::MeshGenerator(const MeshParams &params) : params(params) {
+    const float pi = acos(-1.0f);
+
+    // Same minimums as the primitive classes:
+    this->params.sectors = std::max(params.sectors, 3);
+    this->params.stacks = std::max(params.stacks, params.shape == MESH_SPHERE ? 2 : 1);
+
+    int sectors = this->params.sectors;
+    int stacks = this->params.stacks;
+    rows = stacks + 1;
+    columns = sectors + 1;
+    baseStartIndex = 0;
+    topStartIndex = 0;
+    sideNormalXY = 0.0f;
+    sideNormalZ = 0.0f;
+
+    columnTrig.build(sectors, 0.0f, 2.0f * pi / (float) sectors);
+
+    switch (params.shape) {
+        case MESH_SPHERE:
+            // From pi/2 (north pole) down to -pi/2 (south pole):
+            rowTrig.build(stacks, pi / 2.0f, -pi / (float) stacks);
+            vertexCount = rows * columns;
+            indexCount = sectors * (2 * stacks - 2) * 3; // 1 triangle per sector on the first and last stack
+            lineIndexCount = sectors * (4 * stacks - 2);
+            break;
+        case MESH_CYLINDER: {
+            // The side normal leans by the slope of the cone: tanA = (baseRadius - topRadius) / height
+            float zAngle = atan2(params.radius - params.topRadius, params.height);
+            sideNormalXY = cosf(zAngle);
+            sideNormalZ = sinf(zAngle);
+            vertexCount = rows * columns + 2 * (sectors + 1); // side grid + 2 caps (center + ring)
+            baseStartIndex = stacks * sectors * 6;
+            topStartIndex = baseStartIndex + sectors * 3;
+            indexCount = topStartIndex + sectors * 3;
+            lineIndexCount = sectors * (4 * stacks + 2);
+            break;
+        }
+        case MESH_TORUS:
+        default:
+            rowTrig.build(stacks, 0.0f, 2.0f * pi / (float) stacks);
+            vertexCount = rows * columns;
+            indexCount = stacks * sectors * 6;
+            lineIndexCount = 0;
+            break;
+    }
+}
+
+// Offset of the first index written for the triangle band between row and row + 1:
+unsigned int MeshGenerator::bandIndexOffset(int row) const {
+    if (params.shape == MESH_SPHERE) {
+        // The first band holds 1 triangle per sector, the others 2:
+        return row == 0 ? 0 : params.sectors * 3 * (1 + 2 * (row - 1));
+    }
+    return row * params.sectors * 6;
+}
+
+// Offset of the first line index written for the band between row and row + 1:
+unsigned int MeshGenerator::bandLineIndexOffset(int row) const {
+    if (params.shape == MESH_SPHERE) {
+        // The first band only has vertical lines:
+        return row == 0 ? 0 : params.sectors * (2 + 4 * (row - 1));
+    }
+    if (params.shape == MESH_CYLINDER) {
+        // The first band also closes the bottom ring:
+        return row == 0 ? 0 : params.sectors * (6 + 4 * (row - 1));
+    }
+    return 0;
+}
+
+template<typename Index>
+void MeshGenerator::generateRows(int rowBegin, int rowEnd, float *vertices, Index *indices, Index *lineIndices) const {
+    const int sectors = params.sectors;
+    const int stacks = params.stacks;
+    const float sectorsInv = 1.0f / (float) sectors;
+    const float stacksInv = 1.0f / (float) stacks;
+
+    // Vertices:
+    for (int i = rowBegin; i < rowEnd; ++i) {
+        float *v = vertices + (std::size_t) i * columns * MESH_VERTEX_FLOATS;
+
+        if (params.shape == MESH_SPHERE) {
+            // x = r * cos(u) * cos(v), y = r * cos(u) * sin(v), z = r * sin(u)
+            float cosU = rowTrig.cosines[i];
+            float sinU = rowTrig.sines[i];
+            float t = (float) i * stacksInv;
+            for (int j = 0; j < columns; ++j, v += MESH_VERTEX_FLOATS) {
+                float nx = cosU * columnTrig.cosines[j];
+                float ny = cosU * columnTrig.sines[j];
+                v[0] = params.radius * nx;
+                v[1] = params.radius * ny;
+                v[2] = params.radius * sinU;
+                v[3] = nx;
+                v[4] = ny;
+                v[5] = sinU;
+                v[6] = (float) j * sectorsInv;
+                v[7] = t;
+            }
+        } else if (params.shape == MESH_CYLINDER) {
+            float t = (float) i * stacksInv;
+            float z = -(params.height * 0.5f) + t * params.height;
+            float radius = params.radius + t * (params.topRadius - params.radius); // lerp
+            for (int j = 0; j < columns; ++j, v += MESH_VERTEX_FLOATS) {
+                float x = columnTrig.cosines[j];
+                float y = columnTrig.sines[j];
+                v[0] = x * radius;
+                v[1] = y * radius;
+                v[2] = z;
+                v[3] = x * sideNormalXY;
+                v[4] = y * sideNormalXY;
+                v[5] = sideNormalZ;
+                v[6] = (float) j * sectorsInv;
+                v[7] = 1.0f - t; // top-to-bottom
+            }
+        } else {
+            // The main ring angle is shared by the whole row, the tube angle by the whole column:
+            float cosMain = rowTrig.cosines[i];
+            float sinMain = rowTrig.sines[i];
+            float texV = (float) i * 2.0f * stacksInv;
+            for (int j = 0; j < columns; ++j, v += MESH_VERTEX_FLOATS) {
+                float cosTube = columnTrig.cosines[j];
+                float sinTube = columnTrig.sines[j];
+                float ring = params.radius + params.topRadius * cosTube;
+                v[0] = ring * cosMain;
+                v[1] = ring * sinMain;
+                v[2] = params.topRadius * sinTube;
+                v[3] = cosMain * cosTube;
+                v[4] = sinMain * cosTube;
+                v[5] = sinTube;
+                v[6] = (float) j * sectorsInv;
+                v[7] = texV;
+            }
+        }
+    }
+
+    // Triangle bands starting on these rows:
+    //  k1--k1+1
+    //  |  / |
+    //  | /  |
+    //  k2--k2+1
+    int bandEnd = std::min(rowEnd, stacks);
+    for (int i = rowBegin; i < bandEnd; ++i) {
+        Index *index = indices + bandIndexOffset(i);
+        Index *line = lineIndices != nullptr ? lineIndices + bandLineIndexOffset(i) : nullptr;
+        Index k1 = (Index) (i * columns);  // beginning of current row
+        Index k2 = (Index) (k1 + columns); // beginning of next row
+
+        for (int j = 0; j < sectors; ++j, ++k1, ++k2) {
+            if (params.shape == MESH_SPHERE) {
+                // 2 triangles per sector excluding first and last stacks
+                if (i != 0) {
+                    *index++ = k1;
+                    *index++ = k2;
+                    *index++ = k1 + 1;
+                }
+                if (i != stacks - 1) {
+                    *index++ = k1 + 1;
+                    *index++ = k2;
+                    *index++ = k2 + 1;
+                }
+                if (line != nullptr) {
+                    *line++ = k1; // vertical lines for all stacks
+                    *line++ = k2;
+                    if (i != 0) { // horizontal lines except first stack
+                        *line++ = k1;
+                        *line++ = k1 + 1;
+                    }
+                }
+            } else if (params.shape == MESH_CYLINDER) {
+                *index++ = k1;
+                *index++ = k1 + 1;
+                *index++ = k2;
+                *index++ = k2;
+                *index++ = k1 + 1;
+                *index++ = k2 + 1;
+                if (line != nullptr) {
+                    *line++ = k1; // vertical lines
+                    *line++ = k2;
+                    *line++ = k2; // horizontal lines
+                    *line++ = k2 + 1;
+                    if (i == 0) {
+                        *line++ = k1;
+                        *line++ = k1 + 1;
+                    }
+                }
+            } else {
+                // Same winding as the triangle strip the torus used to draw:
+                *index++ = k1;
+                *index++ = k2;
+                *index++ = k1 + 1;
+                *index++ = k1 + 1;
+                *index++ = k2;
+                *index++ = k2 + 1;
+            }
+        }
+    }
+}
+
+// Base and top caps of a cylinder (center vertex + ring), appended after the side grid:
+template<typename Index>
+void MeshGenerator::generateCaps(float *vertices, Index *indices) const {
+    const int sectors = params.sectors;
+    unsigned int baseVertexIndex = rows * columns;
+    unsigned int topVertexIndex = baseVertexIndex + sectors + 1;
+
+    for (int cap = 0; cap < 2; ++cap) {
+        bool top = cap == 1;
+        unsigned int center = top ? topVertexIndex : baseVertexIndex;
+        float radius = top ? params.topRadius : params.radius;
+        float z = top ? params.height * 0.5f : -params.height * 0.5f;
+        float nz = top ? 1.0f : -1.0f;
+
+        float *v = vertices + (std::size_t) center * MESH_VERTEX_FLOATS;
+        v[0] = 0.0f;
+        v[1] = 0.0f;
+        v[2] = z;
+        v[3] = 0.0f;
+        v[4] = 0.0f;
+        v[5] = nz;
+        v[6] = 0.5f;
+        v[7] = 0.5f;
+        v += MESH_VERTEX_FLOATS;
+
+        for (int i = 0; i < sectors; ++i, v += MESH_VERTEX_FLOATS) {
+            float x = columnTrig.cosines[i];
+            float y = columnTrig.sines[i];
+            v[0] = x * radius;
+            v[1] = y * radius;
+            v[2] = z;
+            v[3] = 0.0f;
+            v[4] = 0.0f;
+            v[5] = nz;
+            v[6] = top ? x * 0.5f + 0.5f : -x * 0.5f + 0.5f; // flip horizontal on the base
+            v[7] = -y * 0.5f + 0.5f;
+        }
+
+        Index *index = indices + (top ? topStartIndex : baseStartIndex);
+        for (int i = 0; i < sectors; ++i) {
+            Index k = (Index) (center + 1 + i);
+            Index next = (Index) (i < sectors - 1 ? k + 1 : center + 1); // last triangle wraps around
+            *index++ = (Index) center;
+            *index++ = top ? k : next;
+            *index++ = top ? next : k;
+        }
+    }
+}
+
+void MeshGenerator::generate(float *vertices, unsigned int *indices, unsigned int *lineIndices,
+                             int threads) const {
+    generateImpl(vertices, indices, lineIndices, threads);
+}
+
+void MeshGenerator::generate(float *vertices, unsigned short *indices, int threads) const {
+    generateImpl<unsigned short>(vertices, indices, nullptr, threads);
+}
+
+template<typename Index>
+void MeshGenerator::generateImpl(float *vertices, Index *indices, Index *lineIndices, int threads) const {
+    if (threads <= 0) {
+        threads = 1;
+        if (vertexCount >= PARALLEL_VERTEX_THRESHOLD) {
+            threads = jobs.getThreadCount();
+        }
+    }
+    threads = std::max(1, std::min(threads, rows / MIN_ROWS_PER_THREAD));
+
+    // Split the grid into row bands, one job each; every band writes a disjoint range of the outputs:
+    int rowsPerThread = (rows + threads - 1) / threads;
+    if (threads == 1) {
+        generateRows(0, rows, vertices, indices, lineIndices);
+    } else {
+        jobs.parallelFor(rows, rowsPerThread, [&](int rowBegin, int rowEnd) {
+            generateRows(rowBegin, rowEnd, vertices, indices, lineIndices);
+        });
+    }
+
+    if (params.shape == MESH_CYLINDER) {
+        generateCaps(vertices, indices);
+    }
+}
+
+bool MeshGenerator::generateToBuffers(GLuint vbo, GLuint ibo, GLenum *indexType, int threads) const {
+    if (vertexCount == 0 || indexCount == 0) {
+        return false;
+    }
+    const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+    bool shortIndices = hasShortIndices();
+    GLsizeiptr indexSize = indexCount * (shortIndices ? sizeof(unsigned short) : sizeof(unsigned int));
+    *indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, getVertexSize(), nullptr, GL_STATIC_DRAW);
+    auto *vertices = (float *) glMapBufferRange(GL_ARRAY_BUFFER, 0, getVertexSize(), access);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize, nullptr, GL_STATIC_DRAW);
+    void *indices = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, indexSize, access);
+
+    bool mapped = vertices != nullptr && indices != nullptr;
+    if (mapped) {
+        if (shortIndices) {
+            generate(vertices, (unsigned short *) indices, threads);
+        } else {
+            generate(vertices, (unsigned int *) indices, nullptr, threads);
+        }
+    }
+
+    // Unmapping can fail if the driver lost the contents (e.g. a mode switch):
+    if (vertices != nullptr && glUnmapBuffer(GL_ARRAY_BUFFER) == GL_FALSE) {
+        mapped = false;
+    }
+    if (indices != nullptr && glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER) == GL_FALSE) {
+        mapped = false;
+    }
+    return mapped;
+}
+
+template void MeshGenerator::generateRows<unsigned int>(int, int, float *, unsigned int *, unsigned int *) const;
+
+template void MeshGenerator::generateRows<unsigned short>(int, int, float *, unsigned short *, unsigned short *) const;
@@ -0,0 +1,103 @@
+#ifndef MESHGEN_H
+#define MESHGEN_H
+
+#include <vector>
+#include "opengl.h"
+#include "vertexformat.h" // the generator writes the V/N/T float layout
+
+// Shapes understood by the parametric generator:
+enum MeshShape {
+    MESH_SPHERE, MESH_CYLINDER, MESH_TORUS
+};
+
+// Parameters of a parametric surface. Rows and columns of the vertex grid are:
+// - sphere  : stacks + 1 rows (latitude), sectors + 1 columns (longitude)
+// - cylinder: stacks + 1 rows (along z), sectors + 1 columns (slices), plus base and top caps
+// - torus   : stacks + 1 rows (main segments), sectors + 1 columns (tube segments)
+struct MeshParams {
+    MeshShape shape;
+    int sectors;
+    int stacks;
+    float radius;       // sphere radius, cylinder base radius, torus main radius
+    float topRadius;    // cylinder top radius, torus tube radius
+    float height;       // cylinder height
+};
+
+// Sine/cosine of evenly spaced angles: angle(i) = start + i * step, for i in [0, steps]
+class TrigTable {
+public:
+    void build(int steps, float start, float step);
+
+    std::vector<float> sines;
+    std::vector<float> cosines;
+};
+
+// Generates interleaved vertices and triangle indices for a parametric surface. The exact output
+// sizes are known up front, so callers allocate once (or map a GPU buffer) and the generator writes
+// every vertex exactly once. Sine and cosine are evaluated once per ring into trig tables and reused
+// for positions and normals. Large meshes are split into row bands generated as jobs (see jobs.h).
+class MeshGenerator {
+public:
+    explicit MeshGenerator(const MeshParams &params);
+
+    unsigned int getVertexCount() const { return vertexCount; }
+
+    unsigned int getIndexCount() const { return indexCount; }
+
+    unsigned int getLineIndexCount() const { return lineIndexCount; }
+
+    unsigned int getVertexSize() const { return vertexCount * MESH_VERTEX_STRIDE; }
+
+    unsigned int getIndexSize() const { return indexCount * sizeof(unsigned int); }
+
+    // Start of the base/top cap indices (cylinder only):
+    unsigned int getBaseStartIndex() const { return baseStartIndex; }
+
+    unsigned int getTopStartIndex() const { return topStartIndex; }
+
+    // True if every vertex index fits in 16 bits:
+    bool hasShortIndices() const { return vertexCount <= 65536; }
+
+    // Writes getVertexCount() * MESH_VERTEX_FLOATS floats and getIndexCount() indices.
+    // lineIndices may be null. threads = 0 picks a thread count from the mesh size.
+    void generate(float *vertices, unsigned int *indices, unsigned int *lineIndices = nullptr,
+                  int threads = 0) const;
+
+    // Same with 16-bit indices (requires hasShortIndices()):
+    void generate(float *vertices, unsigned short *indices, int threads = 0) const;
+
+    // Writes rows [rowBegin, rowEnd) of the grid, plus the triangle bands that start on those rows:
+    template<typename Index>
+    void generateRows(int rowBegin, int rowEnd, float *vertices, Index *indices, Index *lineIndices) const;
+
+    // Allocates the bound VAO's vertex and index buffers and generates straight into mapped memory.
+    // Indices are 16-bit when the vertex count allows; the chosen type is returned in indexType. Returns false
+    // if the mesh is empty or the buffers couldn't be mapped or lost their contents; they are undefined then.
+    bool generateToBuffers(GLuint vbo, GLuint ibo, GLenum *indexType, int threads = 0) const;
+
+private:
+    template<typename Index>
+    void generateImpl(float *vertices, Index *indices, Index *lineIndices, int threads) const;
+
+    template<typename Index>
+    void generateCaps(float *vertices, Index *indices) const;
+
+    unsigned int bandIndexOffset(int row) const;
+
+    unsigned int bandLineIndexOffset(int row) const;
+
+    MeshParams params;
+    int rows;
+    int columns;
+    unsigned int vertexCount;
+    unsigned int indexCount;
+    unsigned int lineIndexCount;
+    unsigned int baseStartIndex;
+    unsigned int topStartIndex;
+    TrigTable rowTrig;
+    TrigTable columnTrig;
+    float sideNormalXY;     // cylinder side normal: radial and z components
+    float sideNormalZ;
+};
+
+#endif //MESHGEN_H
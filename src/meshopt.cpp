@@ -0,0 +1,589 @@
+#include "meshopt.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+namespace {
+
+// Forsyth's scoring constants. The optimizer models a 32 entry LRU cache, which also does well on
+// the smaller FIFO caches of real hardware:
+const int FORSYTH_CACHE_SIZE = 32;
+const int FORSYTH_MAX_VALENCE = 32;
+const float CACHE_DECAY_POWER = 1.5f;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+
+// Score tables, indexed by cache position and remaining valence:
+struct ScoreTables {
+    float cache[FORSYTH_CACHE_SIZE];
+    float valence[FORSYTH_MAX_VALENCE + 1];
+
+    ScoreTables() {
+        for (int i = 0; i < FORSYTH_CACHE_SIZE; ++i) {
+            if (i < 3) {
+                cache[i] = LAST_TRIANGLE_SCORE; // the last triangle's vertices, whatever order they were added
+            } else {
+                float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                cache[i] = powf(1.0f - (i - 3) * scaler, CACHE_DECAY_POWER);
+            }
+        }
+        valence[0] = 0.0f;
+        for (int i = 1; i <= FORSYTH_MAX_VALENCE; ++i) {
+            valence[i] = VALENCE_BOOST_SCALE * powf((float) i, -VALENCE_BOOST_POWER);
+        }
+    }
+};
+
+float vertexScore(const ScoreTables &tables, int cachePosition, unsigned int remaining) {
+    if (remaining == 0) {
+        return -1.0f; // no triangles left to use this vertex
+    }
+    float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+    return score + tables.valence[std::min(remaining, (unsigned int) FORSYTH_MAX_VALENCE)];
+}
+
+// Returns the number of cache misses of a triangle list in a FIFO cache. Timestamps avoid storing the
+// cache itself: a vertex is in the cache if fewer than cacheSize misses happened since it was loaded.
+unsigned int countCacheMisses(const unsigned int *indices, unsigned int indexCount, unsigned int vertexCount,
+                              int cacheSize) {
+    std::vector<unsigned int> timestamps(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    unsigned int misses = 0;
+    for (unsigned int i = 0; i < indexCount; ++i) {
+        unsigned int v = indices[i];
+        if (time - timestamps[v] > (unsigned int) cacheSize) {
+            timestamps[v] = time++;
+            ++misses;
+        }
+    }
+    return misses;
+}
+
+glm::vec3 position(const float *vertices, int floatsPerVertex, unsigned int v) {
+    const float *p = vertices + (size_t) v * floatsPerVertex;
+    return glm::vec3(p[0], p[1], p[2]);
+}
+
+unsigned int hashVertex(const float *vertex, int floatsPerVertex) {
+    // FNV-1a over the float bits, with -0 hashed like 0 since they compare equal:
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < floatsPerVertex; ++i) {
+        unsigned int bits;
+        memcpy(&bits, &vertex[i], sizeof(bits));
+        if (bits == 0x80000000u) {
+            bits = 0;
+        }
+        for (int b = 0; b < 4; ++b) {
+            hash = (hash ^ ((bits >> (b * 8)) & 0xff)) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+bool equalVertices(const float *a, const float *b, int floatsPerVertex) {
+    for (int i = 0; i < floatsPerVertex; ++i) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Unit normal of a triangle, zero if it is degenerate:
+glm::vec3 triangleNormal(const float *vertices, int floatsPerVertex, const unsigned int *triangle) {
+    glm::vec3 a = position(vertices, floatsPerVertex, triangle[0]);
+    glm::vec3 b = position(vertices, floatsPerVertex, triangle[1]);
+    glm::vec3 c = position(vertices, floatsPerVertex, triangle[2]);
+    glm::vec3 normal = glm::cross(b - a, c - a);
+    float length = glm::length(normal);
+    return length > 1e-12f ? normal / length : glm::vec3(0.0f);
+}
+
+// Bounds of the triangles [first, end) as a meshlet:
+Meshlet makeMeshlet(const float *vertices, int floatsPerVertex, const unsigned int *indices, unsigned int first,
+                    unsigned int end) {
+    Meshlet meshlet = {};
+    meshlet.firstIndex = first * 3;
+    meshlet.indexCount = (end - first) * 3;
+
+    // Sphere around the center of the bounding box:
+    glm::vec3 boundsMin = position(vertices, floatsPerVertex, indices[first * 3]);
+    glm::vec3 boundsMax = boundsMin;
+    for (unsigned int i = first * 3; i < end * 3; ++i) {
+        glm::vec3 p = position(vertices, floatsPerVertex, indices[i]);
+        boundsMin = glm::min(boundsMin, p);
+        boundsMax = glm::max(boundsMax, p);
+    }
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    float radius = 0.0f;
+    for (unsigned int i = first * 3; i < end * 3; ++i) {
+        radius = std::max(radius, glm::length(position(vertices, floatsPerVertex, indices[i]) - center));
+    }
+
+    // Cone around the average normal, as wide as the furthest normal from it:
+    glm::vec3 normalSum(0.0f);
+    for (unsigned int t = first; t < end; ++t) {
+        normalSum += triangleNormal(vertices, floatsPerVertex, indices + t * 3);
+    }
+    float sumLength = glm::length(normalSum);
+    glm::vec3 axis = sumLength > 1e-6f ? normalSum / sumLength : glm::vec3(0.0f, 0.0f, 1.0f);
+    float minDot = sumLength > 1e-6f ? 1.0f : -1.0f;
+    for (unsigned int t = first; t < end; ++t) {
+        glm::vec3 normal = triangleNormal(vertices, floatsPerVertex, indices + t * 3);
+        if (normal != glm::vec3(0.0f)) {
+            minDot = std::min(minDot, glm::dot(axis, normal));
+        }
+    }
+    memcpy(meshlet.center, &center, sizeof(meshlet.center));
+    meshlet.radius = radius;
+    memcpy(meshlet.coneAxis, &axis, sizeof(meshlet.coneAxis));
+    meshlet.coneCutoff = minDot <= 0.0f ? 1.0f : sqrtf(std::max(0.0f, 1.0f - minDot * minDot));
+    return meshlet;
+}
+
+} // namespace
+
+VertexCacheStats analyzeVertexCache(const unsigned int *indices, unsigned int indexCount, unsigned int vertexCount,
+                                    int cacheSize) {
+    VertexCacheStats stats = {0.0f, 0.0f};
+    if (indexCount < 3 || vertexCount == 0) {
+        return stats;
+    }
+    unsigned int misses = countCacheMisses(indices, indexCount, vertexCount, cacheSize);
+    stats.acmr = (float) misses / (indexCount / 3);
+    stats.atvr = (float) misses / vertexCount;
+    return stats;
+}
+
+void weldVertices(const float *vertices, unsigned int vertexCount, int floatsPerVertex,
+                  const unsigned int *indices, unsigned int indexCount,
+                  std::vector<float> &outVertices, std::vector<unsigned int> &outIndices) {
+    const unsigned int empty = ~0u;
+
+    // Open addressing table of unique vertex numbers, at most half full:
+    unsigned int tableSize = 1;
+    while (tableSize < vertexCount * 2) {
+        tableSize *= 2;
+    }
+    std::vector<unsigned int> table(tableSize, empty);
+    std::vector<unsigned int> remap(vertexCount);
+
+    outVertices.clear();
+    outVertices.reserve((size_t) vertexCount * floatsPerVertex);
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+        const float *vertex = vertices + (size_t) v * floatsPerVertex;
+        unsigned int slot = hashVertex(vertex, floatsPerVertex) & (tableSize - 1);
+        while (table[slot] != empty &&
+               !equalVertices(&outVertices[(size_t) table[slot] * floatsPerVertex], vertex, floatsPerVertex)) {
+            slot = (slot + 1) & (tableSize - 1); // linear probing
+        }
+        if (table[slot] == empty) {
+            table[slot] = (unsigned int) (outVertices.size() / floatsPerVertex);
+            outVertices.insert(outVertices.end(), vertex, vertex + floatsPerVertex);
+        }
+        remap[v] = table[slot];
+    }
+
+    // Unindexed input is a triangle list of every vertex in order:
+    if (indices == nullptr) {
+        indexCount = vertexCount;
+    }
+    outIndices.resize(indexCount);
+    for (unsigned int i = 0; i < indexCount; ++i) {
+        outIndices[i] = remap[indices != nullptr ? indices[i] : i];
+    }
+}
+
+void optimizeVertexCache(std::vector<unsigned int> &indices, unsigned int vertexCount) {
+    static const ScoreTables tables;
+    const unsigned int none = ~0u;
+    unsigned int triangleCount = (unsigned int) (indices.size() / 3);
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Triangles using each vertex; emitted triangles are swapped out of the live part of each list:
+    std::vector<unsigned int> adjacencyStart(vertexCount + 1, 0);
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (unsigned int i = 0; i < triangleCount * 3; ++i) {
+        ++remaining[indices[i]];
+    }
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+        adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+    }
+    std::vector<unsigned int> adjacency(triangleCount * 3);
+    std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (unsigned int t = 0; t < triangleCount; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            adjacency[fill[indices[t * 3 + k]]++] = t;
+        }
+    }
+
+    // Initial scores:
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> scores(vertexCount);
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+        scores[v] = vertexScore(tables, -1, remaining[v]);
+    }
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    unsigned int bestTriangle = 0;
+    for (unsigned int t = 0; t < triangleCount; ++t) {
+        triangleScores[t] = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+        if (triangleScores[t] > triangleScores[bestTriangle]) {
+            bestTriangle = t;
+        }
+    }
+
+    std::vector<unsigned int> output(triangleCount * 3);
+    std::vector<unsigned int> cache, newCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+    unsigned int scanPosition = 0;
+
+    for (unsigned int emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+        if (bestTriangle == none) {
+            // Nothing in the cache touches a live triangle, restart from the next one in input order:
+            while (emitted[scanPosition]) {
+                ++scanPosition;
+            }
+            bestTriangle = scanPosition;
+        }
+
+        unsigned int a = indices[bestTriangle * 3];
+        unsigned int b = indices[bestTriangle * 3 + 1];
+        unsigned int c = indices[bestTriangle * 3 + 2];
+        output[emittedCount * 3] = a;
+        output[emittedCount * 3 + 1] = b;
+        output[emittedCount * 3 + 2] = c;
+        emitted[bestTriangle] = true;
+
+        // Remove the triangle from its vertices' live lists:
+        const unsigned int corners[3] = {a, b, c};
+        for (unsigned int v : corners) {
+            unsigned int *list = &adjacency[adjacencyStart[v]];
+            for (unsigned int i = 0; i < remaining[v]; ++i) {
+                if (list[i] == bestTriangle) {
+                    std::swap(list[i], list[remaining[v] - 1]);
+                    --remaining[v];
+                    break;
+                }
+            }
+        }
+
+        // Move the corners to the front of the LRU cache:
+        newCache.clear();
+        newCache.push_back(a);
+        newCache.push_back(b);
+        newCache.push_back(c);
+        for (unsigned int v : cache) {
+            if (v != a && v != b && v != c) {
+                newCache.push_back(v);
+            }
+        }
+
+        // Rescore the cached vertices (and the ones pushed out) and their live triangles:
+        for (size_t i = 0; i < newCache.size(); ++i) {
+            unsigned int v = newCache[i];
+            int newPosition = i < (size_t) FORSYTH_CACHE_SIZE ? (int) i : -1;
+            cachePosition[v] = newPosition;
+            float score = vertexScore(tables, newPosition, remaining[v]);
+            float delta = score - scores[v];
+            scores[v] = score;
+            for (unsigned int j = 0; j < remaining[v]; ++j) {
+                triangleScores[adjacency[adjacencyStart[v] + j]] += delta;
+            }
+        }
+        if (newCache.size() > (size_t) FORSYTH_CACHE_SIZE) {
+            newCache.resize(FORSYTH_CACHE_SIZE);
+        }
+        cache.swap(newCache);
+
+        // The next triangle is the best one using a cached vertex:
+        bestTriangle = none;
+        float bestScore = -1.0f;
+        for (unsigned int v : cache) {
+            for (unsigned int j = 0; j < remaining[v]; ++j) {
+                unsigned int t = adjacency[adjacencyStart[v] + j];
+                if (triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+    }
+
+    indices.swap(output);
+}
+
+void optimizeOverdraw(std::vector<unsigned int> &indices, const float *vertices, unsigned int vertexCount,
+                      int floatsPerVertex, float threshold) {
+    unsigned int triangleCount = (unsigned int) (indices.size() / 3);
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Hard boundaries: triangles that miss the cache with all three vertices, which is where the cache
+    // optimizer had to restart. Reordering whole clusters then costs (almost) nothing:
+    std::vector<unsigned int> hardBoundaries;
+    {
+        std::vector<unsigned int> timestamps(vertexCount, 0);
+        unsigned int time = VERTEX_CACHE_SIZE + 1;
+        for (unsigned int t = 0; t < triangleCount; ++t) {
+            int misses = 0;
+            for (int k = 0; k < 3; ++k) {
+                unsigned int v = indices[t * 3 + k];
+                if (time - timestamps[v] > (unsigned int) VERTEX_CACHE_SIZE) {
+                    timestamps[v] = time++;
+                    ++misses;
+                }
+            }
+            if (t == 0 || misses == 3) {
+                hardBoundaries.push_back(t);
+            }
+        }
+        hardBoundaries.push_back(triangleCount);
+    }
+
+    // Soft boundaries: split each hard cluster wherever the cache, restarted at the split, would still
+    // give an ACMR within threshold times that of the whole cluster:
+    std::vector<unsigned int> boundaries;
+    for (size_t h = 0; h + 1 < hardBoundaries.size(); ++h) {
+        unsigned int start = hardBoundaries[h];
+        unsigned int end = hardBoundaries[h + 1];
+        unsigned int clusterMisses = countCacheMisses(&indices[start * 3], (end - start) * 3, vertexCount,
+                                                      VERTEX_CACHE_SIZE);
+        float limit = threshold * clusterMisses / (end - start);
+
+        std::vector<unsigned int> timestamps(vertexCount, 0);
+        unsigned int time = VERTEX_CACHE_SIZE + 1;
+        unsigned int misses = 0;
+        unsigned int softStart = start;
+        boundaries.push_back(start);
+        for (unsigned int t = start; t < end; ++t) {
+            for (int k = 0; k < 3; ++k) {
+                unsigned int v = indices[t * 3 + k];
+                if (time - timestamps[v] > (unsigned int) VERTEX_CACHE_SIZE) {
+                    timestamps[v] = time++;
+                    ++misses;
+                }
+            }
+            if (t + 1 < end && (float) misses / (t + 1 - softStart) <= limit) {
+                boundaries.push_back(t + 1);
+                softStart = t + 1;
+                misses = 0;
+                time += VERTEX_CACHE_SIZE + 1; // flush the cache
+            }
+        }
+    }
+    boundaries.push_back(triangleCount);
+    size_t clusterCount = boundaries.size() - 1;
+
+    // Sort clusters by how much they face away from the mesh center, so outer surfaces draw first:
+    glm::vec3 meshCenter(0.0f);
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+        meshCenter += position(vertices, floatsPerVertex, v);
+    }
+    meshCenter /= (float) vertexCount;
+
+    std::vector<float> sortKeys(clusterCount);
+    for (size_t i = 0; i < clusterCount; ++i) {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (unsigned int t = boundaries[i]; t < boundaries[i + 1]; ++t) {
+            glm::vec3 p0 = position(vertices, floatsPerVertex, indices[t * 3]);
+            glm::vec3 p1 = position(vertices, floatsPerVertex, indices[t * 3 + 1]);
+            glm::vec3 p2 = position(vertices, floatsPerVertex, indices[t * 3 + 2]);
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0); // length is twice the area
+            float weight = glm::length(n);
+            centroid += (p0 + p1 + p2) * (weight / 3.0f);
+            normal += n;
+            area += weight;
+        }
+        float normalLength = glm::length(normal);
+        if (area > 0.0f && normalLength > 0.0f) {
+            sortKeys[i] = glm::dot(centroid / area - meshCenter, normal / normalLength);
+        } else {
+            sortKeys[i] = 0.0f; // degenerate cluster
+        }
+    }
+
+    std::vector<size_t> order(clusterCount);
+    for (size_t i = 0; i < clusterCount; ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](size_t a, size_t b) {
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for (size_t i : order) {
+        output.insert(output.end(), indices.begin() + boundaries[i] * 3, indices.begin() + boundaries[i + 1] * 3);
+    }
+    indices.swap(output);
+}
+
+void optimizeVertexFetch(std::vector<float> &vertices, std::vector<unsigned int> &indices, int floatsPerVertex) {
+    const unsigned int unused = ~0u;
+    unsigned int vertexCount = (unsigned int) (vertices.size() / floatsPerVertex);
+    std::vector<unsigned int> remap(vertexCount, unused);
+    std::vector<float> output;
+    output.reserve(vertices.size());
+
+    // Number vertices in order of first use, dropping the ones no triangle uses:
+    unsigned int next = 0;
+    for (unsigned int &index : indices) {
+        if (remap[index] == unused) {
+            remap[index] = next++;
+            const float *vertex = &vertices[(size_t) index * floatsPerVertex];
+            output.insert(output.end(), vertex, vertex + floatsPerVertex);
+        }
+        index = remap[index];
+    }
+    vertices.swap(output);
+}
+
+void optimizeMesh(const float *vertices, unsigned int vertexCount, int floatsPerVertex,
+                  const unsigned int *indices, unsigned int indexCount,
+                  std::vector<float> &outVertices, std::vector<unsigned int> &outIndices,
+                  MeshOptimizationStats *stats) {
+    weldVertices(vertices, vertexCount, floatsPerVertex, indices, indexCount, outVertices, outIndices);
+    unsigned int weldedCount = (unsigned int) (outVertices.size() / floatsPerVertex);
+
+    if (stats != nullptr) {
+        // Measure the input against the welded vertex count so ATVR is comparable before and after:
+        stats->verticesBefore = vertexCount;
+        if (indices != nullptr) {
+            stats->before = analyzeVertexCache(indices, indexCount, vertexCount);
+            stats->before.atvr = stats->before.acmr * (indexCount / 3) / weldedCount;
+        } else {
+            stats->before.acmr = 3.0f; // every corner is transformed
+            stats->before.atvr = (float) vertexCount / weldedCount;
+        }
+    }
+
+    // Each reordering step is kept only if it pays off in the simulated cache; small meshes (a single
+    // cylinder band, say) can already be in a better order than the optimizer's 32 entry LRU model finds:
+    unsigned int indexTotal = (unsigned int) outIndices.size();
+    std::vector<unsigned int> reordered = outIndices;
+    optimizeVertexCache(reordered, weldedCount);
+    float acmr = analyzeVertexCache(outIndices.data(), indexTotal, weldedCount).acmr;
+    float reorderedAcmr = analyzeVertexCache(reordered.data(), indexTotal, weldedCount).acmr;
+    if (reorderedAcmr < acmr) {
+        outIndices.swap(reordered);
+        acmr = reorderedAcmr;
+    }
+
+    const float overdrawThreshold = 1.05f;
+    reordered = outIndices;
+    optimizeOverdraw(reordered, outVertices.data(), weldedCount, floatsPerVertex, overdrawThreshold);
+    if (analyzeVertexCache(reordered.data(), indexTotal, weldedCount).acmr <= acmr * overdrawThreshold) {
+        outIndices.swap(reordered);
+    }
+
+    optimizeVertexFetch(outVertices, outIndices, floatsPerVertex);
+
+    if (stats != nullptr) {
+        stats->verticesAfter = (unsigned int) (outVertices.size() / floatsPerVertex);
+        stats->after = analyzeVertexCache(outIndices.data(), (unsigned int) outIndices.size(),
+                                          stats->verticesAfter);
+    }
+}
+
+void buildMeshlets(const float *vertices, unsigned int vertexCount, int floatsPerVertex,
+                   std::vector<unsigned int> &indices, std::vector<Meshlet> &meshlets) {
+    meshlets.clear();
+    auto triangleCount = (unsigned int) (indices.size() / 3);
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Triangles using each vertex:
+    std::vector<unsigned int> firstUse(vertexCount + 1, 0);
+    for (unsigned int index : indices) {
+        ++firstUse[index + 1];
+    }
+    for (unsigned int v = 0; v < vertexCount; ++v) {
+        firstUse[v + 1] += firstUse[v];
+    }
+    std::vector<unsigned int> uses(triangleCount * 3);
+    std::vector<unsigned int> filled(firstUse.begin(), firstUse.end() - 1);
+    for (unsigned int t = 0; t < triangleCount * 3; ++t) {
+        uses[filled[indices[t]]++] = t / 3;
+    }
+    std::vector<glm::vec3> normals(triangleCount);
+    for (unsigned int t = 0; t < triangleCount; ++t) {
+        normals[t] = triangleNormal(vertices, floatsPerVertex, &indices[t * 3]);
+    }
+
+    // Grow each meshlet from the first triangle left, adding the neighbour that brings the fewest new vertices
+    // (then the one closest to its normals) until it is full or no neighbour fits its cone:
+    std::vector<unsigned int> order;
+    order.reserve(indices.size());
+    std::vector<bool> assigned(triangleCount, false);
+    std::vector<unsigned int> owner(vertexCount, ~0u); // meshlet each vertex was last added to
+    std::vector<unsigned int> candidates;
+    unsigned int seed = 0;
+    while (seed < triangleCount) {
+        auto current = (unsigned int) meshlets.size();
+        unsigned int first = (unsigned int) order.size() / 3;
+        unsigned int meshletVertices = 0;
+        glm::vec3 normalSum(0.0f);
+        candidates.clear();
+        unsigned int next = seed;
+        while (next != ~0u) {
+            assigned[next] = true;
+            for (int k = 0; k < 3; ++k) {
+                unsigned int v = indices[next * 3 + k];
+                order.push_back(v);
+                if (owner[v] != current) {
+                    owner[v] = current;
+                    ++meshletVertices;
+                    candidates.insert(candidates.end(), uses.begin() + firstUse[v], uses.begin() + firstUse[v + 1]);
+                }
+            }
+            normalSum += normals[next];
+            if (order.size() / 3 - first >= MESHLET_MAX_TRIANGLES) {
+                break;
+            }
+
+            float sumLength = glm::length(normalSum);
+            glm::vec3 axis = sumLength > 1e-6f ? normalSum / sumLength : glm::vec3(0.0f);
+            next = ~0u;
+            unsigned int bestAdded = 4;
+            float bestDot = -2.0f;
+            size_t kept = 0;
+            for (unsigned int t : candidates) {
+                if (assigned[t]) {
+                    continue;
+                }
+                candidates[kept++] = t;
+                unsigned int added = 0;
+                for (int k = 0; k < 3; ++k) {
+                    unsigned int v = indices[t * 3 + k];
+                    bool repeated = (k > 0 && v == indices[t * 3]) || (k > 1 && v == indices[t * 3 + 1]);
+                    added += owner[v] != current && !repeated ? 1 : 0;
+                }
+                float dot = sumLength > 1e-6f ? glm::dot(axis, normals[t]) : 1.0f;
+                bool fits = meshletVertices + added <= MESHLET_MAX_VERTICES && dot >= MESHLET_CONE_SPLIT;
+                if (fits && (added < bestAdded || (added == bestAdded && dot > bestDot))) {
+                    next = t;
+                    bestAdded = added;
+                    bestDot = dot;
+                }
+            }
+            candidates.resize(kept);
+        }
+        unsigned int end = (unsigned int) order.size() / 3;
+        meshlets.push_back(makeMeshlet(vertices, floatsPerVertex, order.data(), first, end));
+        while (seed < triangleCount && assigned[seed]) {
+            ++seed;
+        }
+    }
+    indices.swap(order);
+}
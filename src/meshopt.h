@@ -0,0 +1,83 @@
+#ifndef MESHOPT_H
+#define MESHOPT_H
+
+#include <vector>
+
+// Post-transform cache size the optimizer targets and the analysis simulates (FIFO):
+const int VERTEX_CACHE_SIZE = 16;
+
+// Cache efficiency of an index buffer:
+// - ACMR: average cache miss ratio, transformed vertices per triangle (0.5 is ideal for grids, 3 is worst)
+// - ATVR: average transformed vertex ratio, transformed vertices per vertex (1 is ideal)
+struct VertexCacheStats {
+    float acmr;
+    float atvr;
+};
+
+// Vertices and triangles a meshlet holds at most, the sizes mesh shading hardware is built around:
+const unsigned int MESHLET_MAX_VERTICES = 64;
+const unsigned int MESHLET_MAX_TRIANGLES = 124;
+
+// Meshes with fewer triangles get no meshlets, one draw of the whole mesh costs less than culling its parts:
+const unsigned int MESHLET_MIN_TRIANGLES = 2 * MESHLET_MAX_TRIANGLES;
+
+// A meshlet is closed early once a triangle's normal is further than this (cosine) from the average normal of
+// the meshlet so far, which keeps the normal cones narrow enough to cull:
+const float MESHLET_CONE_SPLIT = 0.5f;
+
+// A cluster of consecutive triangles of an index buffer and the bounds its culling tests, laid out like the
+// Meshlet of shader/cull.comp (std430). All of its triangles face away from a viewer at p if
+// dot(center - p, coneAxis) >= coneCutoff * length(center - p) + radius.
+struct Meshlet {
+    float center[3];     // bounding sphere
+    float radius;
+    float coneAxis[3];   // average normal of its triangles
+    float coneCutoff;    // sine of the widest angle between a triangle's normal and the axis; 1 if there is no cone
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    unsigned int padding[2];
+};
+
+// Result of optimizeMesh:
+struct MeshOptimizationStats {
+    unsigned int verticesBefore;
+    unsigned int verticesAfter;
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+// Simulates a FIFO post-transform cache over a triangle list:
+VertexCacheStats analyzeVertexCache(const unsigned int *indices, unsigned int indexCount, unsigned int vertexCount,
+                                    int cacheSize = VERTEX_CACHE_SIZE);
+
+// Merges bit-identical vertices using a hash table. indices may be null for an unindexed triangle list.
+// Writes the unique vertices and the (new) triangle list indices.
+void weldVertices(const float *vertices, unsigned int vertexCount, int floatsPerVertex,
+                  const unsigned int *indices, unsigned int indexCount,
+                  std::vector<float> &outVertices, std::vector<unsigned int> &outIndices);
+
+// Reorders triangles for the post-transform cache (Forsyth's linear-speed optimizer):
+void optimizeVertexCache(std::vector<unsigned int> &indices, unsigned int vertexCount);
+
+// Reorders clusters of the cache-optimized triangles so outward facing clusters draw first, which cuts
+// overdraw while keeping ACMR within threshold times the cache-optimized value (Sander et al.):
+void optimizeOverdraw(std::vector<unsigned int> &indices, const float *vertices, unsigned int vertexCount,
+                      int floatsPerVertex, float threshold = 1.05f);
+
+// Reorders vertices in the order triangles first use them and remaps the indices:
+void optimizeVertexFetch(std::vector<float> &vertices, std::vector<unsigned int> &indices, int floatsPerVertex);
+
+// Runs the whole pipeline on a triangle list: weld + index, vertex cache, overdraw and vertex fetch.
+void optimizeMesh(const float *vertices, unsigned int vertexCount, int floatsPerVertex,
+                  const unsigned int *indices, unsigned int indexCount,
+                  std::vector<float> &outVertices, std::vector<unsigned int> &outIndices,
+                  MeshOptimizationStats *stats = nullptr);
+
+// Clusters a triangle list into meshlets of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES
+// triangles, each grown over neighbouring triangles of similar normals, and computes their bounding spheres and
+// normal cones. The triangles are reordered so every meshlet is a contiguous range of indices; within a meshlet
+// they keep their neighbours close, so the vertex cache still does well.
+void buildMeshlets(const float *vertices, unsigned int vertexCount, int floatsPerVertex,
+                   std::vector<unsigned int> &indices, std::vector<Meshlet> &meshlets);
+
+#endif //MESHOPT_H
@@ -1,6 +1,17 @@
 #include "model.h"
 #include "shader.h"
 #include "opengl.h" // texture loading
+#include "renderstats.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+bool Mesh::usePackedVertices = false;
+bool Mesh::optimizeMeshes = true;
+bool Mesh::useMeshlets = false;
+const IndirectDraws *Mesh::indirect = nullptr;
+bool Model::useTessellation = false;
 
 Mesh::Mesh() {
     // Initialize everything:
@@ -15,6 +26,15 @@ Mesh::Mesh() {
     nVertices = 0;
     totalUVs = 0;
     totalNormals = 0;
+    indexType = GL_UNSIGNED_INT;
+    patchVertices = 0;
+    packed = false;
+    positionScale = glm::vec3(1.0f, 1.0f, 1.0f);
+    positionOffset = glm::vec3(0.0f, 0.0f, 0.0f);
+    boundsMin = glm::vec3(0.0f, 0.0f, 0.0f);
+    boundsMax = glm::vec3(0.0f, 0.0f, 0.0f);
+    optimization = {};
+    bufferBytes = 0;
     textured = false;
 }
 
@@ -34,6 +54,192 @@ void Mesh::destroy() {
     glDeleteBuffers(1, &normalBuffer); // delete normal buffer
     glDeleteBuffers(1, &tangentBuffer); // delete tangent buffer
     glDeleteBuffers(1, &bitangentBuffer); // delete bitangent buffer
+    memoryStats.bufferBytes -= bufferBytes;
+    bufferBytes = 0;
+}
+
+void Mesh::upload(const float *vertices, unsigned int vertexCount, int floatsPerVertex,
+                  const unsigned int *indices, unsigned int indexCount) {
+    MeshData data;
+    prepare(vertices, vertexCount, floatsPerVertex, indices, indexCount, data);
+    optimization = data.optimization;
+    upload(data.layout, data.vertices.data(), data.indices.empty() ? nullptr : data.indices.data(),
+           data.meshlets.data());
+}
+
+void Mesh::prepare(const float *vertices, unsigned int vertexCount, int floatsPerVertex,
+                   const unsigned int *indices, unsigned int indexCount, MeshData &data) {
+    // Weld into an indexed list and reorder for the vertex cache, overdraw and vertex fetch:
+    std::vector<float> optimizedVertices;
+    std::vector<unsigned int> optimizedIndices;
+    data.optimization = {};
+    if (optimizeMeshes) {
+        optimizeMesh(vertices, vertexCount, floatsPerVertex, indices, indexCount, optimizedVertices,
+                     optimizedIndices, &data.optimization);
+        vertices = optimizedVertices.data();
+        vertexCount = (unsigned int) (optimizedVertices.size() / floatsPerVertex);
+        indices = optimizedIndices.data();
+        indexCount = (unsigned int) optimizedIndices.size();
+    }
+    if (indices == nullptr) {
+        indexCount = 0;
+    }
+
+    // Cluster dense meshes into meshlets, which reorders their triangles:
+    std::vector<unsigned int> clusteredIndices;
+    data.meshlets.clear();
+    if (useMeshlets && indexCount / 3 >= MESHLET_MIN_TRIANGLES) {
+        clusteredIndices.assign(indices, indices + indexCount);
+        buildMeshlets(vertices, vertexCount, floatsPerVertex, clusteredIndices, data.meshlets);
+        indices = clusteredIndices.data();
+    }
+
+    MeshLayout &layout = data.layout;
+    layout = {};
+    layout.vertexCount = vertexCount;
+    layout.indexCount = indexCount;
+    layout.floatsPerVertex = (uint32_t) floatsPerVertex;
+    layout.packed = usePackedVertices ? 1 : 0;
+    layout.meshletCount = (uint32_t) data.meshlets.size();
+
+    // Bounding box of the positions:
+    glm::vec3 boundsMin(0.0f, 0.0f, 0.0f);
+    glm::vec3 boundsMax(0.0f, 0.0f, 0.0f);
+    for (unsigned int i = 0; i < vertexCount; ++i) {
+        glm::vec3 position = glm::make_vec3(vertices + (std::size_t) i * floatsPerVertex);
+        boundsMin = i == 0 ? position : glm::min(boundsMin, position);
+        boundsMax = i == 0 ? position : glm::max(boundsMax, position);
+    }
+    memcpy(layout.boundsMin, &boundsMin, sizeof(layout.boundsMin));
+    memcpy(layout.boundsMax, &boundsMax, sizeof(layout.boundsMax));
+
+    // Vertex bytes:
+    glm::vec3 positionScale(1.0f, 1.0f, 1.0f);
+    glm::vec3 positionOffset(0.0f, 0.0f, 0.0f);
+    if (layout.packed) {
+        packVertices(vertices, vertexCount, floatsPerVertex, data.vertices, &positionScale, &positionOffset);
+    } else {
+        const auto *bytes = (const unsigned char *) vertices;
+        data.vertices.assign(bytes, bytes + sizeof(float) * floatsPerVertex * vertexCount);
+    }
+    memcpy(layout.positionScale, &positionScale, sizeof(layout.positionScale));
+    memcpy(layout.positionOffset, &positionOffset, sizeof(layout.positionOffset));
+
+    // Packed positions move by up to half a step (positionScale spans the bounds), so the meshlets' spheres grow
+    // by as much:
+    if (layout.packed) {
+        float halfStep = 0.5f * glm::length(positionScale) / PACKED_POSITION_STEPS;
+        for (Meshlet &meshlet : data.meshlets) {
+            meshlet.radius += halfStep;
+        }
+    }
+
+    // Index bytes (16-bit whenever every index fits):
+    layout.indexType = vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    data.indices.resize(layout.getIndexBytes());
+    if (layout.indexType == GL_UNSIGNED_SHORT) {
+        auto *shortIndices = (unsigned short *) data.indices.data();
+        for (unsigned int i = 0; i < indexCount; ++i) {
+            shortIndices[i] = (unsigned short) indices[i];
+        }
+    } else if (indexCount > 0) {
+        memcpy(data.indices.data(), indices, data.indices.size());
+    }
+}
+
+void Mesh::upload(const MeshLayout &layout, const void *vertices, const void *indices, const Meshlet *meshlets) {
+    nVertices = layout.vertexCount;
+    nIndices = indices != nullptr ? layout.indexCount : 0;
+    this->meshlets.clear();
+    if (meshlets != nullptr && nIndices > 0) {
+        this->meshlets.assign(meshlets, meshlets + layout.meshletCount);
+    }
+    indexType = layout.indexType;
+    packed = layout.packed != 0;
+    positionScale = glm::make_vec3(layout.positionScale);
+    positionOffset = glm::make_vec3(layout.positionOffset);
+    boundsMin = glm::make_vec3(layout.boundsMin);
+    boundsMax = glm::make_vec3(layout.boundsMax);
+
+    glGenVertexArrays(1, &vao); // create VAO
+    glBindVertexArray(vao); // bind VAO
+
+    // Vertex buffer:
+    glGenBuffers(1, &vbo); // create vertex buffer
+    glBindBuffer(GL_ARRAY_BUFFER, vbo); // bind VBO
+    glBufferData(GL_ARRAY_BUFFER, layout.getVertexBytes(), vertices, GL_STATIC_DRAW);
+    setVertexAttributes((int) layout.floatsPerVertex, packed);
+
+    // Index buffer:
+    if (nIndices > 0) {
+        glGenBuffers(1, &indexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, layout.getIndexBytes(), indices, GL_STATIC_DRAW);
+    }
+
+    glBindVertexArray(0); // unbind VAO
+    countMemory();
+}
+
+void Mesh::uploadPatches(const float *corners, unsigned int patchCount) {
+    nVertices = patchCount * PATCH_CORNERS;
+    nIndices = 0;
+    patchVertices = PATCH_CORNERS;
+    packed = false;
+    positionScale = glm::vec3(1.0f, 1.0f, 1.0f);
+    positionOffset = glm::vec3(0.0f, 0.0f, 0.0f);
+
+    glGenVertexArrays(1, &vao); // create VAO
+    glBindVertexArray(vao); // bind VAO
+
+    // Patch corners only carry their surface parameters, the surface is evaluated on the GPU:
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * PATCH_VERTEX_FLOATS * nVertices, corners, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, PATCH_VERTEX_FLOATS, GL_FLOAT, GL_FALSE, sizeof(float) * PATCH_VERTEX_FLOATS,
+                          nullptr);
+    glEnableVertexAttribArray(0);
+
+    glBindVertexArray(0); // unbind VAO
+    countMemory();
+}
+
+void Mesh::countMemory() {
+    GLint64 bytes = getBufferSize(vbo) + getBufferSize(indexBuffer) + getBufferSize(uvBuffer) +
+                    getBufferSize(normalBuffer) + getBufferSize(tangentBuffer) + getBufferSize(bitangentBuffer);
+    memoryStats.bufferBytes += bytes - bufferBytes;
+    bufferBytes = bytes;
+}
+
+void Mesh::draw(GLenum mode) const {
+    glBindVertexArray(vao); // activate the VBOs contained within the mesh's VAO
+    if (patchVertices > 0) {
+        glPatchParameteri(GL_PATCH_VERTICES, patchVertices);
+        mode = GL_PATCHES;
+    }
+    if (indirect != nullptr) {
+        // The commands say what to draw; only their count is known here, and only on the GPU if it is read there
+        auto commands = (const void *) indirect->commands;
+        if (nIndices > 0 && indirect->useCount) {
+            glMultiDrawElementsIndirectCountARB(mode, indexType, commands, indirect->count, indirect->maxCount,
+                                                INDIRECT_COMMAND_STRIDE);
+        } else if (nIndices > 0) {
+            glMultiDrawElementsIndirect(mode, indexType, commands, indirect->maxCount, INDIRECT_COMMAND_STRIDE);
+        } else if (indirect->useCount) {
+            glMultiDrawArraysIndirectCountARB(mode, commands, indirect->count, indirect->maxCount,
+                                              INDIRECT_COMMAND_STRIDE);
+        } else {
+            glMultiDrawArraysIndirect(mode, commands, indirect->maxCount, INDIRECT_COMMAND_STRIDE);
+        }
+        ++renderStats.drawCalls;
+    } else if (nIndices > 0) {
+        glDrawElements(mode, nIndices, indexType, nullptr);
+        renderStats.countDraw(mode, nIndices);
+    } else {
+        glDrawArrays(mode, 0, nVertices);
+        renderStats.countDraw(mode, nVertices);
+    }
+    glBindVertexArray(0); // unbind VAO
 }
 
 Model::Model() {
@@ -42,6 +248,12 @@ Model::Model() {
     position = glm::vec3(0.0f, 0.0f, 0.0f);
     rotation = glm::vec3(0.0f, 0.0f, 0.0f);
     scale = glm::vec3(1.0f, 1.0f, 1.0f);
+    surface = {};
+    tessellated = false;
+    name = "model";
+    chainPrepared = false;
+    chainKey = 0;
+    chainInfo = {};
 }
 
 bool Model::loadTexture(const char *filename) {
@@ -69,6 +281,13 @@ bool Model::loadNormalMap(const char *filename) {
 
 void Model::destroy() {
     mesh.destroy();
+    for (Mesh &lodMesh : lodMeshes) {
+        lodMesh.destroy();
+    }
+    lodMeshes.clear();
+    if (tessellated) {
+        patchMesh.destroy();
+    }
 }
 
 void Model::setPosition(float x, float y, float z) {
@@ -95,6 +314,18 @@ glm::vec3 Model::getScale() {
     return scale;
 }
 
+glm::mat4 Model::getTransform() {
+    return glm::translate(position) * glm::toMat4(glm::quat(rotation)) * glm::scale(scale);
+}
+
+void Model::setName(const char *name) {
+    this->name = name;
+}
+
+const char *Model::getName() {
+    return name.c_str();
+}
+
 bool Model::hasMaterial() {
     return mesh.textured;
 }
@@ -102,3 +333,131 @@ bool Model::hasMaterial() {
 Material *Model::getMaterial() {
     return &mesh.material;
 }
+
+Mesh *Model::getMesh() {
+    if (tessellated) {
+        return &patchMesh;
+    }
+    return &mesh;
+}
+
+const Mesh *Model::getLodMesh(int level) const {
+    if (tessellated) {
+        return &patchMesh;
+    }
+    if (level > 0 && level <= (int) lodMeshes.size()) {
+        return &lodMeshes[level - 1];
+    }
+    return &mesh;
+}
+
+int Model::chooseLod(const glm::mat4 &transform, int current, const glm::mat4 &view, const glm::mat4 &projection,
+                     int viewportHeight) const {
+    float maxScale = std::max(glm::length(glm::vec3(transform[0])),
+                              std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+    return lod.choose(glm::vec3(transform[3]), maxScale, current, view, projection, viewportHeight);
+}
+
+void Model::getBoundingSphere(glm::vec3 &center, float &radius) const {
+    // Patches have no positions until tessellated; this bound is loose, but holds for every surface shape:
+    if (tessellated) {
+        center = glm::vec3(0.0f);
+        radius = surface.radius + surface.topRadius + surface.height;
+        return;
+    }
+    center = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+    radius = glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f;
+}
+
+void Model::initLodChain(const MeshParams &params, int lodSectors, float lodRadius, float boundingRadius) {
+    std::vector<MeshParams> chain = buildLodChain(params);
+    lodMeshes.resize(chain.size() - 1);
+    for (size_t i = 1; i < chain.size(); ++i) {
+        MeshGenerator generator(chain[i]);
+        std::vector<float> vertices((size_t) generator.getVertexCount() * MESH_VERTEX_FLOATS);
+        std::vector<unsigned int> indices(generator.getIndexCount());
+        generator.generate(vertices.data(), indices.data());
+        lodMeshes[i - 1].upload(vertices.data(), generator.getVertexCount(), MESH_VERTEX_FLOATS, indices.data(),
+                                generator.getIndexCount());
+    }
+    lod.setChain((int) chain.size(), lodSectors, lodRadius, boundingRadius);
+}
+
+void Model::prepareMeshChain(const MeshParams &params, int lodSectors, float lodRadius, float boundingRadius) {
+    chainKey = MeshCache::getKey(params);
+    chainPrepared = true;
+    chainLevels.clear();
+
+    // Cached buffers are mapped, to go straight from the file to the GPU:
+    if (MeshCache::enabled && chainCache.open(chainKey)) {
+        chainInfo = chainCache.getChain();
+        return;
+    }
+
+    // Otherwise generate and prepare every level, keeping the buffers for the cache:
+    std::vector<MeshParams> chain = buildLodChain(params);
+    chainLevels.resize(chain.size());
+    for (size_t i = 0; i < chain.size(); ++i) {
+        MeshGenerator generator(chain[i]);
+        std::vector<float> vertices((size_t) generator.getVertexCount() * MESH_VERTEX_FLOATS);
+        std::vector<unsigned int> indices(generator.getIndexCount());
+        generator.generate(vertices.data(), indices.data());
+        Mesh::prepare(vertices.data(), generator.getVertexCount(), MESH_VERTEX_FLOATS, indices.data(),
+                      generator.getIndexCount(), chainLevels[i]);
+    }
+    chainInfo = {lodSectors, lodRadius, boundingRadius};
+    if (MeshCache::enabled) {
+        MeshCache::write(chainKey, chainLevels, chainInfo);
+    }
+}
+
+void Model::initMeshChain(const MeshParams &params, int lodSectors, float lodRadius, float boundingRadius) {
+    if (!chainPrepared || chainKey != MeshCache::getKey(params)) {
+        prepareMeshChain(params, lodSectors, lodRadius, boundingRadius);
+    }
+
+    // Upload the levels, from the mapped cache file or as generated:
+    bool cached = chainLevels.empty();
+    uint32_t levelCount = cached ? chainCache.getLevelCount() : (uint32_t) chainLevels.size();
+    lodMeshes.resize(levelCount - 1);
+    for (uint32_t i = 0; i < levelCount; ++i) {
+        Mesh &level = i == 0 ? mesh : lodMeshes[i - 1];
+        if (cached) {
+            level.upload(chainCache.getLevel(i).layout, chainCache.getVertices(i), chainCache.getIndices(i),
+                         chainCache.getMeshlets(i));
+            level.optimization = chainCache.getLevel(i).optimization;
+        } else {
+            level.upload(chainLevels[i].layout, chainLevels[i].vertices.data(), chainLevels[i].indices.data(),
+                         chainLevels[i].meshlets.data());
+            level.optimization = chainLevels[i].optimization;
+        }
+    }
+    lod.setChain((int) levelCount, chainInfo.sectors, chainInfo.radius, chainInfo.boundingRadius);
+    if (cached) {
+        ++MeshCache::hits;
+    } else if (MeshCache::enabled) {
+        ++MeshCache::misses;
+    }
+
+    // The buffers are on the GPU now:
+    chainCache.close();
+    chainLevels = std::vector<MeshData>();
+    chainPrepared = false;
+}
+
+bool Model::isTessellated() {
+    return tessellated;
+}
+
+const MeshParams &Model::getSurface() {
+    return surface;
+}
+
+void Model::initPatches(const MeshParams &params) {
+    std::vector<float> corners;
+    buildSurfacePatches(params.shape, corners);
+    unsigned int patchCount = (unsigned int) (corners.size() / (PATCH_CORNERS * PATCH_VERTEX_FLOATS));
+    patchMesh.uploadPatches(corners.data(), patchCount);
+    surface = params;
+    tessellated = true;
+}
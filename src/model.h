@@ -3,6 +3,25 @@
 
 #include "material.h"
 #include "geometry.h"
+#include "vertexformat.h"
+#include "meshopt.h"
+#include "lod.h"
+#include "tessellation.h"
+#include "meshcache.h"
+
+#include <string>
+#include <vector>
+
+// Indirect draws of a mesh, from the commands in the bound GL_DRAW_INDIRECT_BUFFER (see gpuculling.h):
+struct IndirectDraws {
+    GLintptr commands; // offset of the first command
+    GLsizei maxCount;
+    bool useCount;     // read how many there are from the bound GL_PARAMETER_BUFFER_ARB
+    GLintptr count;    // at this offset
+};
+
+// Bytes per indirect command: DrawElementsIndirectCommand, or DrawArraysIndirectCommand and a padding value.
+const GLsizei INDIRECT_COMMAND_STRIDE = 5 * sizeof(GLuint);
 
 // The Mesh class is responsible for storing OpenGL data related to a specific mesh.
 // It manages the VAOs, VBOs, and other related buffers needed for rendering the mesh.
@@ -13,6 +32,47 @@ public:
     // Releases resources allocated by the Mesh object.
     void destroy();
 
+    // Creates the VAO and uploads a triangle list of interleaved float vertices (MESH_VERTEX_FLOATS or
+    // MESH_TANGENT_VERTEX_FLOATS per vertex) and optional indices. If optimizeMeshes is set the triangles are
+    // welded, indexed and reordered first (see meshopt.h). Vertices are packed if usePackedVertices is set,
+    // and indices are stored as 16-bit whenever the vertex count allows.
+    void upload(const float *vertices, unsigned int vertexCount, int floatsPerVertex,
+                const unsigned int *indices = nullptr, unsigned int indexCount = 0);
+
+    // Creates the VAO and uploads buffers prepared earlier (see prepare), as they are: no welding, packing or
+    // index conversion. indices may be null if the layout has none, and meshlets if it has no meshlets.
+    void upload(const MeshLayout &layout, const void *vertices, const void *indices,
+                const Meshlet *meshlets = nullptr);
+
+    // Runs the CPU side of upload: optimizes, clusters into meshlets, packs and narrows the indices of a mesh
+    // into the exact bytes of its buffers, using the current vertex settings.
+    static void prepare(const float *vertices, unsigned int vertexCount, int floatsPerVertex,
+                        const unsigned int *indices, unsigned int indexCount, MeshData &data);
+
+    // Creates the VAO and uploads quad patches for the tessellation stages (PATCH_CORNERS corners of
+    // PATCH_VERTEX_FLOATS each, see tessellation.h).
+    void uploadPatches(const float *corners, unsigned int patchCount);
+
+    // Draws the whole mesh (indexed if it has indices). Patch meshes always draw GL_PATCHES.
+    void draw(GLenum mode = GL_TRIANGLES) const;
+
+    // Adds the size of the mesh's buffers to memoryStats; called once they are filled.
+    void countMemory();
+
+    // Use the packed vertex format (see vertexformat.h) for meshes uploaded from now on.
+    static bool usePackedVertices;
+
+    // Run the mesh optimizer on meshes uploaded from now on (on by default).
+    static bool optimizeMeshes;
+
+    // Cluster meshes of at least MESHLET_MIN_TRIANGLES triangles uploaded from now on into meshlets, which the
+    // GPU culling culls one by one (see gpuculling.h).
+    static bool useMeshlets;
+
+    // While set, draw issues these indirect draws of the mesh instead of drawing it once, so models draw
+    // through their usual render().
+    static const IndirectDraws *indirect;
+
     GLuint vao; // Vertex Array Object handle used to store the vertex attribute configuration.
     GLuint vbo; // Vertex Buffer Object handle for storing the mesh's vertex data.
     GLuint indexBuffer; // Index Buffer Object handle for storing indexed rendering data.
@@ -24,6 +84,16 @@ public:
     GLuint nVertices; // The number of vertices in the mesh.
     GLuint totalUVs; // The number of UV coordinates in the mesh.
     GLuint totalNormals; // The number of vertex normals in the mesh.
+    GLenum indexType; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+    GLint patchVertices; // Corners per patch of a patch mesh, 0 for triangles.
+    bool packed; // Indicates whether the vertices use the packed format.
+    glm::vec3 positionScale; // Dequantization of packed positions: position * scale + offset.
+    glm::vec3 positionOffset;
+    glm::vec3 boundsMin; // Object space bounding box of the vertices.
+    glm::vec3 boundsMax;
+    MeshOptimizationStats optimization; // Vertex counts and cache efficiency before and after optimizing.
+    std::vector<Meshlet> meshlets; // Clusters of its triangles, contiguous in the index buffer; empty if none.
+    GLint64 bufferBytes; // Size of the mesh's buffers, counted in memoryStats.
     Material material; // The material properties associated with the mesh.
     bool textured; // Indicates whether the mesh has a texture or not.
 };
@@ -34,15 +104,29 @@ class Model {
 public:
     Model();
 
+    // Scene objects are deleted through Model pointers, so derived members must be destroyed too.
+    virtual ~Model() = default;
+
     // Initializes the model. Derived classes should override this method.
     virtual bool init() { return false; };
 
+    // Initializes the model with a texture file. Derived classes should override this method.
+    virtual bool init(const char* /*filename*/) { return false; }
+
+    // Runs the CPU side of init ahead of it, on any thread: builds (or maps from the mesh cache) the buffers
+    // init then only uploads. Models with little to build do nothing.
+    virtual void prepare() {};
+
     // Releases resources allocated by the Model object.
     virtual void destroy();
 
     // Renders the model. Derived classes should implement this method.
     virtual void render() = 0;
 
+    // Renders one level of detail (see getLodMesh) without changing the model, so draws of different levels can
+    // be submitted from any thread. Models without a LOD chain render as render() does.
+    virtual void renderLod(int /*level*/) { render(); }
+
     // Loads a texture from a file and associates it with the model.
     bool loadTexture(const char* filename);
 
@@ -68,17 +152,80 @@ public:
     // Returns the model's scale along the x, y, and z axes in world space.
     glm::vec3 getScale();
 
+    // Returns the model matrix: translation * rotation * scale.
+    glm::mat4 getTransform();
+
+    // Sets the name the model is reported under (profiler scopes, statistics).
+    void setName(const char* name);
+
+    // Returns the model's name.
+    const char* getName();
+
     // Checks if the model has a material associated with it.
     bool hasMaterial();
 
     // Returns a pointer to the model's material.
     Material* getMaterial();
 
+    // Returns a pointer to the model's mesh: the patch mesh if tessellated, otherwise level 0.
+    Mesh* getMesh();
+
+    // Returns the mesh a level of detail draws: the patch mesh if tessellated. Doesn't change the model, so it can
+    // be called from any thread.
+    const Mesh *getLodMesh(int level) const;
+
+    // Checks if the model draws analytic surface patches (see tessellation.h).
+    bool isTessellated();
+
+    // Returns the parameters of the model's analytic surface (valid if tessellated).
+    const MeshParams &getSurface();
+
+    // Curved primitives initialized from now on draw tessellated patches instead of meshes.
+    static bool useTessellation;
+
+    // Returns the level of detail to draw from the model's size on screen (see LodSelector), placed by
+    // transform (getTransform, or an instance's own), with hysteresis around current, the level that object drew
+    // last. Doesn't change the model, so draws can be built on any thread.
+    int chooseLod(const glm::mat4 &transform, int current, const glm::mat4 &view, const glm::mat4 &projection,
+                  int viewportHeight) const;
+
+    // Returns an object space sphere around everything the model draws:
+    void getBoundingSphere(glm::vec3 &center, float &radius) const;
+
+    // Returns the selector of the model's level of detail, which describes its chain:
+    const LodSelector &getLodSelector() const { return lod; }
+
 protected:
+    // Uploads the coarser levels of a parametric mesh (see buildLodChain) into lodMeshes. Level 0 splits
+    // a circle of lodRadius into lodSectors; boundingRadius bounds the mesh around the model's origin.
+    void initLodChain(const MeshParams &params, int lodSectors, float lodRadius, float boundingRadius);
+
+    // Uploads every level of a parametric mesh: level 0 into mesh and the LOD chain (as initLodChain). The
+    // levels come from prepareMeshChain, called here unless prepare did already.
+    void initMeshChain(const MeshParams &params, int lodSectors, float lodRadius, float boundingRadius);
+
+    // Builds the levels initMeshChain uploads, without GL calls: if the mesh cache is enabled they are mapped
+    // from its file, or generated and written to it on a miss.
+    void prepareMeshChain(const MeshParams &params, int lodSectors, float lodRadius, float boundingRadius);
+
+    // Uploads the patch grid of an analytic surface, drawn instead of mesh from then on.
+    void initPatches(const MeshParams &params);
+
     Mesh mesh; // The Mesh object associated with the model.
+    std::vector<Mesh> lodMeshes; // Levels of detail 1 and up; level 0 is mesh, which owns the material.
+    LodSelector lod; // Picks the level of detail drawn.
+    Mesh patchMesh; // Surface patches for the tessellation stages (if tessellated).
+    MeshParams surface; // The analytic surface the patches are evaluated on.
+    bool tessellated; // Indicates whether the model draws patchMesh.
     glm::vec3 position; // The model's position in world space.
     glm::vec3 rotation; // The model's rotation around the x, y, and z axes in world space.
     glm::vec3 scale; // The model's scale along the x, y, and z axes in world space.
+    std::string name; // The name the model is reported under.
+    bool chainPrepared; // Indicates whether prepareMeshChain has built a chain that isn't uploaded yet:
+    uint64_t chainKey; // its mesh cache key,
+    MeshCache chainCache; // its cache file, if it was cached,
+    std::vector<MeshData> chainLevels; // or its generated levels,
+    MeshCacheChain chainInfo; // and its LOD selection parameters.
 };
 
 #endif //MODEL_H
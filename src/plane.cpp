@@ -1,15 +1,13 @@
 #include "plane.h"
 
+#include <vector>
+
 Plane::Plane(float width, float length) {
     this->width = width;
     this->length = length;
 }
 
-bool Plane::init(const char *filename) {
-    if (!loadTexture(filename)) {
-        return false;
-    }
-
+void Plane::buildVertices(std::vector<float> &vertices) const {
     // Vertex data
     GLfloat verts[] = {
             -width, 0, -length,
@@ -32,44 +30,37 @@ bool Plane::init(const char *filename) {
     };
 
     // Calculate normals:
-    mesh.totalNormals = 6; // one normal per vertex
-    glm::vec3 normals[6];
-    for (int i = 0; i < mesh.totalNormals; ++i) {
+    glm::vec3 normals[6]; // one normal per vertex
+    for (int i = 0; i < 6; ++i) {
         normals[i] = {0.0f, 1.0f, 0.0f}; // all normals facing straight up
     }
 
-    mesh.nVertices = sizeof(verts);
-
-    glGenVertexArrays(1, &mesh.vao); // create VAO
-    glBindVertexArray(mesh.vao); // bind VAO
-
-    // Vertex buffer:
-    glGenBuffers(1, &mesh.vbo); // create vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo); // bind VBO
-    glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW); // send vertex data to the GPU
-
-    // Create vertex attribute:
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void *) nullptr); // sizeof(float) * (3)
-    glEnableVertexAttribArray(0); // enable vertices
-
-    // Normal buffer:
-    glGenBuffers(1, &mesh.normalBuffer); // create normal buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.normalBuffer); // bind normal buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * mesh.totalNormals, normals,
-                 GL_STATIC_DRAW); // send normal data to GPU
-
-    // Create normal attribute:
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void *) nullptr); // sizeof(float) * (2)
-    glEnableVertexAttribArray(1); // enable normals
+    // Interleave V/N/T into one buffer:
+    const int totalVertices = 6;
+    vertices.resize(totalVertices * MESH_VERTEX_FLOATS);
+    for (int i = 0; i < totalVertices; ++i) {
+        float *v = &vertices[i * MESH_VERTEX_FLOATS];
+        v[0] = verts[i * 3];
+        v[1] = verts[i * 3 + 1];
+        v[2] = verts[i * 3 + 2];
+        v[3] = normals[i].x;
+        v[4] = normals[i].y;
+        v[5] = normals[i].z;
+        v[6] = uvs[i * 2];
+        v[7] = uvs[i * 2 + 1];
+    }
+}
 
-    // UV buffer:
-    glGenBuffers(1, &mesh.uvBuffer); // create UV buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.uvBuffer); // bind UV buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(uvs), uvs, GL_STATIC_DRAW); // send UV data to GPU
+bool Plane::init(const char *filename) {
+    if (!loadTexture(filename)) {
+        return false;
+    }
 
-    // Create UV attribute:
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void *) nullptr); // sizeof(float) * (2)
-    glEnableVertexAttribArray(2); // enable UVs
+    // Upload welds the corners the two triangles share:
+    std::vector<float> vertices;
+    buildVertices(vertices);
+    mesh.totalNormals = 6;
+    mesh.upload(vertices.data(), 6, MESH_VERTEX_FLOATS);
 
     return true;
 }
@@ -83,9 +74,7 @@ void Plane::render() {
         mesh.material.diffuse.bind();
     }
 
-    glBindVertexArray(mesh.vao); // activate the VBOs contained within the mesh's VAO
-    glDrawArrays(GL_TRIANGLES, 0, mesh.nVertices); // draw the plane
-    glBindVertexArray(0); // unbind vao
+    mesh.draw(GL_TRIANGLES); // draw the plane
 
     glDisableVertexAttribArray(0);
     glDisableVertexAttribArray(1);
@@ -3,6 +3,8 @@
 
 #include "model.h"
 
+#include <vector>
+
 class Plane : public Model {
 public:
     explicit Plane(float width = 5.0f, float length = 5.0f);
@@ -11,6 +13,9 @@ public:
 
     void render() override;
 
+    // Build the unindexed triangle list, MESH_VERTEX_FLOATS per vertex:
+    void buildVertices(std::vector<float> &vertices) const;
+
 private:
     float width;
     float length;
@@ -0,0 +1,204 @@
+#include "profiler.h"
+#include "json.h"
+
+#include <cstdio>
+
+Profiler profiler;
+
+thread_local std::vector<Profiler::OpenScope> Profiler::cpuStack;
+
+Profiler::Profiler() {
+    epoch = std::chrono::high_resolution_clock::now();
+    for (GpuFrame &frame : gpuFrames) {
+        frame.usedQueries = 0;
+        frame.clockOffset = 0.0;
+    }
+    gpuFrameMs = 0.0;
+    frameIndex = 0;
+    capturing = false;
+    frameThread = std::this_thread::get_id();
+}
+
+void Profiler::destroy() {
+    for (GpuFrame &frame : gpuFrames) {
+        if (!frame.queries.empty()) {
+            glDeleteQueries((GLsizei) frame.queries.size(), frame.queries.data());
+        }
+        frame.queries.clear();
+        frame.usedQueries = 0;
+        frame.scopes.clear();
+    }
+}
+
+void Profiler::startCapture() {
+    std::lock_guard<std::mutex> lock(cpuMutex);
+    events.clear();
+    capturing = true;
+}
+
+double Profiler::now() const {
+    return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - epoch).count();
+}
+
+// Merges a scope into the timings of a frame, so repeated scopes add up:
+static void addTiming(std::vector<ScopeTiming> &timings, const std::string &name, double ms) {
+    for (ScopeTiming &timing : timings) {
+        if (timing.name == name) {
+            timing.ms += ms;
+            return;
+        }
+    }
+    timings.push_back({name, ms});
+}
+
+void Profiler::addEvent(const std::string &name, double start, double duration, int depth, bool gpu) {
+    std::lock_guard<std::mutex> lock(cpuMutex);
+    if (!capturing) {
+        return;
+    }
+    if (events.size() >= PROFILER_MAX_EVENTS) {
+        printf("WARNING: Trace capture is full after %d events\n", (int) events.size());
+        capturing = false;
+        return;
+    }
+    events.push_back({name, start, duration, depth, gpu, gpu || std::this_thread::get_id() == frameThread});
+}
+
+void Profiler::beginFrame() {
+    // Reuse the oldest query set, reading the frame it timed first:
+    frameIndex = (frameIndex + 1) % PROFILER_GPU_FRAMES;
+    GpuFrame &frame = gpuFrames[frameIndex];
+    resolveGpuFrame(frame);
+    frame.usedQueries = 0;
+    frame.scopes.clear();
+    frame.openScopes.clear();
+
+    // Maps GPU timestamps onto the CPU timeline:
+    GLint64 gpuTime = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+    frame.clockOffset = now() - (double) gpuTime / 1.0e3;
+
+    std::lock_guard<std::mutex> lock(cpuMutex);
+    frameThread = std::this_thread::get_id();
+    cpuFrameTimings.clear();
+}
+
+void Profiler::endFrame() {
+    std::lock_guard<std::mutex> lock(cpuMutex);
+    cpuTimings.swap(cpuFrameTimings);
+}
+
+void Profiler::beginCpu(const char *name) {
+    cpuStack.push_back({name, now()});
+}
+
+void Profiler::endCpu() {
+    if (cpuStack.empty()) {
+        return;
+    }
+    const OpenScope &scope = cpuStack.back();
+    double duration = now() - scope.start;
+    {
+        std::lock_guard<std::mutex> lock(cpuMutex);
+        addTiming(cpuFrameTimings, scope.name, duration / 1.0e3);
+    }
+    addEvent(scope.name, scope.start, duration, (int) cpuStack.size() - 1, false);
+    cpuStack.pop_back();
+}
+
+GLuint Profiler::nextQuery(GpuFrame &frame) {
+    if (frame.usedQueries == frame.queries.size()) {
+        GLuint query = 0;
+        glGenQueries(1, &query);
+        frame.queries.push_back(query);
+    }
+    return frame.queries[frame.usedQueries++];
+}
+
+void Profiler::beginGpu(const char *name) {
+    GpuFrame &frame = gpuFrames[frameIndex];
+    GpuScope scope;
+    scope.name = name;
+    scope.depth = (int) frame.openScopes.size();
+    scope.beginQuery = nextQuery(frame);
+    scope.endQuery = 0;
+    glQueryCounter(scope.beginQuery, GL_TIMESTAMP);
+    frame.openScopes.push_back((int) frame.scopes.size());
+    frame.scopes.push_back(scope);
+}
+
+void Profiler::endGpu() {
+    GpuFrame &frame = gpuFrames[frameIndex];
+    if (frame.openScopes.empty()) {
+        return;
+    }
+    GpuScope &scope = frame.scopes[frame.openScopes.back()];
+    frame.openScopes.pop_back();
+    scope.endQuery = nextQuery(frame);
+    glQueryCounter(scope.endQuery, GL_TIMESTAMP);
+}
+
+void Profiler::resolveGpuFrame(GpuFrame &frame) {
+    if (frame.scopes.empty()) {
+        return;
+    }
+    // The last timestamp written is available only once every earlier one is:
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(frame.queries[frame.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return;
+    }
+
+    gpuTimings.clear();
+    gpuFrameMs = 0.0;
+    for (const GpuScope &scope : frame.scopes) {
+        if (scope.endQuery == 0) {
+            continue;
+        }
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(scope.beginQuery, GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(scope.endQuery, GL_QUERY_RESULT, &end);
+        double duration = (double) (end - begin) / 1.0e3;
+        addTiming(gpuTimings, scope.name, duration / 1.0e3);
+        if (scope.depth == 0) {
+            gpuFrameMs += duration / 1.0e3;
+        }
+        addEvent(scope.name, (double) begin / 1.0e3 + frame.clockOffset, duration, scope.depth, true);
+    }
+    frame.scopes.clear();
+}
+
+bool Profiler::writeTrace(const char *path) {
+    // Picks up the frames still in flight; they are old enough by now that this rarely waits:
+    glFinish();
+    for (int i = 1; i <= PROFILER_GPU_FRAMES; ++i) {
+        resolveGpuFrame(gpuFrames[(frameIndex + i) % PROFILER_GPU_FRAMES]);
+    }
+    std::lock_guard<std::mutex> lock(cpuMutex);
+    capturing = false;
+
+    FILE *file = fopen(path, "w");
+    if (file == nullptr) {
+        printf("ERROR: Failed to write %s\n", path);
+        return false;
+    }
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(file, "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, "
+                  "\"args\": {\"name\": \"CPU\"}},\n");
+    fprintf(file, "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 2, "
+                  "\"args\": {\"name\": \"GPU\"}},\n");
+    fprintf(file, "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 3, "
+                  "\"args\": {\"name\": \"CPU (main thread)\"}}");
+    for (const ProfileEvent &event : events) {
+        fprintf(file, ",\n  {\"name\": ");
+        writeJsonString(file, event.name);
+        fprintf(file, ", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                event.gpu ? "gpu" : "cpu", event.gpu ? 2 : (event.frameThread ? 1 : 3), event.start, event.duration);
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    printf("INFO: Trace of %d events written to %s\n", (int) events.size(), path);
+    return true;
+}
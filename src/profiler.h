@@ -0,0 +1,147 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "opengl.h"
+
+// GPU query sets in flight. A frame's queries are read back PROFILER_GPU_FRAMES frames later (when the GPU is
+// done with them) and dropped rather than waited on if they still aren't available, so reads never stall:
+const int PROFILER_GPU_FRAMES = 2;
+
+// Events kept by a trace capture before it stops recording:
+const size_t PROFILER_MAX_EVENTS = 1 << 20;
+
+// A timed scope, in microseconds since the profiler started:
+struct ProfileEvent {
+    std::string name;
+    double start;
+    double duration;
+    int depth; // nesting level within its timeline
+    bool gpu;
+    bool frameThread; // recorded on the thread that runs the frames (CPU scopes)
+};
+
+// Time of a scope in the last completed frame:
+struct ScopeTiming {
+    std::string name;
+    double ms;
+};
+
+// Records nested CPU scopes and GPU scopes (GL timestamp queries, which unlike GL_TIME_ELAPSED may nest) every
+// frame, keeps the timings of the last completed frame, and optionally captures every event into a Chrome
+// trace_event file (chrome://tracing, Perfetto) with the CPU and GPU timelines side by side.
+//
+// Frames and GPU scopes belong to the thread that owns the GL context. CPU scopes may be opened on any thread:
+// those of another thread (the main thread, when a render thread draws) count towards the frame open when they
+// end and get their own timeline in traces.
+class Profiler {
+public:
+    Profiler();
+
+    // Releases the GPU queries.
+    void destroy();
+
+    // Starts capturing events for writeTrace:
+    void startCapture();
+
+    bool isCapturing() const { return capturing; }
+
+    // Brackets a frame; beginFrame also reads back the GPU scopes of an earlier frame:
+    void beginFrame();
+
+    void endFrame();
+
+    void beginCpu(const char *name);
+
+    void endCpu();
+
+    void beginGpu(const char *name);
+
+    void endGpu();
+
+    // Timings of the last frame whose scopes completed:
+    const std::vector<ScopeTiming> &getCpuTimings() const { return cpuTimings; }
+
+    const std::vector<ScopeTiming> &getGpuTimings() const { return gpuTimings; }
+
+    // GPU time of the outermost scopes of that frame, in milliseconds, which leaves out the gaps the GPU waited:
+    double getGpuFrameMs() const { return gpuFrameMs; }
+
+    // Writes the captured events as trace_event JSON. Returns false if the file can't be written.
+    bool writeTrace(const char *path);
+
+private:
+    struct OpenScope {
+        std::string name;
+        double start;
+    };
+
+    struct GpuScope {
+        std::string name;
+        int depth;
+        GLuint beginQuery;
+        GLuint endQuery;
+    };
+
+    // Queries and scopes of one frame:
+    struct GpuFrame {
+        std::vector<GLuint> queries;
+        size_t usedQueries;
+        std::vector<GpuScope> scopes;
+        std::vector<int> openScopes;
+        double clockOffset; // CPU time minus GPU time, in microseconds
+    };
+
+    double now() const;
+
+    GLuint nextQuery(GpuFrame &frame);
+
+    void resolveGpuFrame(GpuFrame &frame);
+
+    void addEvent(const std::string &name, double start, double duration, int depth, bool gpu);
+
+    std::chrono::high_resolution_clock::time_point epoch;
+    static thread_local std::vector<OpenScope> cpuStack; // the open CPU scopes of each thread
+    std::mutex cpuMutex; // guards the CPU timings and events, which any thread adds to
+    std::thread::id frameThread;
+    std::vector<ScopeTiming> cpuFrameTimings;
+    std::vector<ScopeTiming> cpuTimings;
+    std::vector<ScopeTiming> gpuTimings;
+    double gpuFrameMs;
+    GpuFrame gpuFrames[PROFILER_GPU_FRAMES];
+    int frameIndex;
+    bool capturing;
+    std::vector<ProfileEvent> events;
+};
+
+// The application's profiler:
+extern Profiler profiler;
+
+// Times the enclosing block on the CPU timeline:
+class CpuProfileScope {
+public:
+    explicit CpuProfileScope(const char *name) { profiler.beginCpu(name); }
+
+    ~CpuProfileScope() { profiler.endCpu(); }
+};
+
+// Times the GL commands issued in the enclosing block on the GPU timeline:
+class GpuProfileScope {
+public:
+    explicit GpuProfileScope(const char *name) { profiler.beginGpu(name); }
+
+    ~GpuProfileScope() { profiler.endGpu(); }
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+// Instrumentation macros, one scope per line:
+#define PROFILE_SCOPE(name) CpuProfileScope PROFILE_CONCAT(cpuProfileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+
+#endif //PROFILER_H
@@ -1,15 +1,13 @@
 #include "pyramid.h"
 
+#include <vector>
+
 Pyramid::Pyramid(float width, float height) {
     this->width = width;
     this->height = height;
 }
 
-bool Pyramid::init(const char *filename) {
-    if (!loadTexture(filename)) {
-        return false;
-    }
-
+void Pyramid::buildVertices(std::vector<float> &vertices, std::vector<unsigned int> &indices) const {
     GLfloat pyramidVerts[] = {
             0.0f, height / 2, 0.0f, // top center
             -width / 2, -height / 2, width / 2, // bottom left
@@ -90,42 +88,35 @@ bool Pyramid::init(const char *filename) {
         }
     }
 
-    glGenVertexArrays(1, &mesh.vao); // create VAO
-    glBindVertexArray(mesh.vao); // bind VAO
-
-    // Vertex buffer:
-    glGenBuffers(1, &mesh.vbo); // create vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo); // bind VBO
-    glBufferData(GL_ARRAY_BUFFER, sizeof(pyramidVerts), pyramidVerts, GL_STATIC_DRAW); // send vertex data to the GPU
-
-    // Create vertex attribute:
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void *) nullptr); // sizeof(float) * (3)
-    glEnableVertexAttribArray(0); // enable vertices
-
-    // Index buffer:
-    mesh.nIndices = sizeof(pyramidIndices) / sizeof(pyramidIndices[0]);
-    glGenBuffers(1, &mesh.indexBuffer); // create index buffer
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer); // bind index buffer
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(pyramidIndices), pyramidIndices,
-                 GL_STATIC_DRAW); // send index data to GPU
-
-    // Normal buffer:
-    glGenBuffers(1, &mesh.normalBuffer); // create normal buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.normalBuffer); // bind normal buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertexNormals), vertexNormals, GL_STATIC_DRAW); // send normal data to GPU
+    // Interleave V/N/T into one buffer:
+    const int totalVertices = sizeof(pyramidVerts) / (sizeof(pyramidVerts[0]) * 3);
+    vertices.resize(totalVertices * MESH_VERTEX_FLOATS);
+    for (int i = 0; i < totalVertices; ++i) {
+        float *v = &vertices[i * MESH_VERTEX_FLOATS];
+        v[0] = pyramidVerts[i * 3];
+        v[1] = pyramidVerts[i * 3 + 1];
+        v[2] = pyramidVerts[i * 3 + 2];
+        v[3] = vertexNormals[i].x;
+        v[4] = vertexNormals[i].y;
+        v[5] = vertexNormals[i].z;
+        v[6] = pyramidUVs[i * 2];
+        v[7] = pyramidUVs[i * 2 + 1];
+    }
 
-    // Create normal attribute:
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void *) nullptr); // sizeof(float) * (2)
-    glEnableVertexAttribArray(1); // enable normals
+    const int totalIndices = sizeof(pyramidIndices) / sizeof(pyramidIndices[0]);
+    indices.assign(pyramidIndices, pyramidIndices + totalIndices);
+}
 
-    // UV buffer:
-    glGenBuffers(1, &mesh.uvBuffer); // create UV buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.uvBuffer); // bind UV buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(pyramidUVs), pyramidUVs, GL_STATIC_DRAW); // send UV data to GPU
+bool Pyramid::init(const char *filename) {
+    if (!loadTexture(filename)) {
+        return false;
+    }
 
-    // Create UV attribute:
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void *) nullptr); // sizeof(float) * (2)
-    glEnableVertexAttribArray(2); // enable UVs
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    buildVertices(vertices, indices);
+    mesh.upload(vertices.data(), (unsigned int) (vertices.size() / MESH_VERTEX_FLOATS), MESH_VERTEX_FLOATS,
+                indices.data(), (unsigned int) indices.size());
 
     return true;
 }
@@ -139,9 +130,7 @@ void Pyramid::render() {
         mesh.material.diffuse.bind(); // activate texture
     }
 
-    glBindVertexArray(mesh.vao); // activate the VBOs contained within the mesh's VAO
-    glDrawElements(GL_TRIANGLES, mesh.nIndices, GL_UNSIGNED_SHORT, nullptr); // draw the pyramid
-    glBindVertexArray(0); // unbind VAO:
+    mesh.draw(GL_TRIANGLES); // draw the pyramid
 
     glDisableVertexAttribArray(0);
     glDisableVertexAttribArray(1);
@@ -3,6 +3,8 @@
 
 #include "model.h"
 
+#include <vector>
+
 // Pyramid class:
 class Pyramid : public Model {
 public:
@@ -12,6 +14,9 @@ public:
 
     void render() override;
 
+    // Build the indexed triangle list, MESH_VERTEX_FLOATS per vertex:
+    void buildVertices(std::vector<float> &vertices, std::vector<unsigned int> &indices) const;
+
 private:
     float width;
     float height;
@@ -0,0 +1,42 @@
+#include "renderstats.h"
+
+RenderStats renderStats = {};
+MemoryStats memoryStats = {};
+
+void RenderStats::reset() {
+    drawCalls = 0;
+    triangles = 0;
+    patches = 0;
+    programBinds = 0;
+    textureBinds = 0;
+    culledObjects = 0;
+}
+
+void RenderStats::countDraw(GLenum mode, unsigned int count) {
+    ++drawCalls;
+    switch (mode) {
+        case GL_TRIANGLES:
+            triangles += count / 3;
+            break;
+        case GL_TRIANGLE_STRIP:
+        case GL_TRIANGLE_FAN:
+            triangles += count >= 3 ? count - 2 : 0;
+            break;
+        case GL_PATCHES:
+            patches += count / 4; // quad patches
+            break;
+        default:
+            break; // points and lines
+    }
+}
+
+GLint64 getBufferSize(GLuint buffer) {
+    if (buffer == 0) {
+        return 0;
+    }
+    GLint64 size = 0;
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    return size;
+}
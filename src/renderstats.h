@@ -0,0 +1,35 @@
+#ifndef RENDERSTATS_H
+#define RENDERSTATS_H
+
+#include "opengl.h"
+
+// Counters of the work submitted to OpenGL, reset at the start of every frame:
+struct RenderStats {
+    unsigned int drawCalls;
+    unsigned long long triangles; // triangles submitted (tessellated patches count as patches instead)
+    unsigned long long patches;
+    unsigned int programBinds;
+    unsigned int textureBinds;
+    unsigned int culledObjects; // objects skipped by visibility culling
+
+    void reset();
+
+    // Counts a draw call of count vertices (or indices) in mode:
+    void countDraw(GLenum mode, unsigned int count);
+};
+
+// Counters of the frame being rendered:
+extern RenderStats renderStats;
+
+// GPU memory held by textures and buffers, updated as they are created and destroyed:
+struct MemoryStats {
+    long long textureBytes;
+    long long bufferBytes;
+};
+
+extern MemoryStats memoryStats;
+
+// Returns the size of a buffer object in bytes (0 for no buffer):
+GLint64 getBufferSize(GLuint buffer);
+
+#endif //RENDERSTATS_H
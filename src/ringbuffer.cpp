@@ -0,0 +1,131 @@
+#include "ringbuffer.h"
+#include "renderstats.h"
+
+#include <algorithm>
+#include <chrono>
+
+RingBuffer::RingBuffer() : used(0), overflows(0) {
+    target = GL_UNIFORM_BUFFER;
+    buffer = 0;
+    regionSize = 0;
+    alignment = 1;
+    persistent = false;
+    mapped = nullptr;
+    for (GLsync &fence : fences) {
+        fence = nullptr;
+    }
+    region = 0;
+    stallMs = 0.0;
+}
+
+void RingBuffer::init(GLenum target, GLsizeiptr regionSize, GLsizeiptr alignment) {
+    this->target = target;
+    this->alignment = std::max<GLsizeiptr>(1, alignment);
+    persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+    create(regionSize);
+}
+
+void RingBuffer::create(GLsizeiptr size) {
+    regionSize = getAlignedSize(size);
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+    if (persistent) {
+        GLsizeiptr bytes = regionSize * RING_BUFFER_REGIONS;
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, bytes, nullptr, flags);
+        mapped = (unsigned char *) glMapBufferRange(target, 0, bytes, flags);
+        memoryStats.bufferBytes += bytes;
+    } else {
+        staging.resize(regionSize);
+        glBufferData(target, regionSize, nullptr, GL_STREAM_DRAW);
+        memoryStats.bufferBytes += regionSize;
+    }
+    glBindBuffer(target, 0);
+}
+
+void RingBuffer::release() {
+    if (buffer == 0) {
+        return;
+    }
+    for (int i = 0; i < RING_BUFFER_REGIONS; ++i) {
+        waitRegion(i);
+    }
+    if (mapped != nullptr) {
+        glBindBuffer(target, buffer);
+        glUnmapBuffer(target);
+        glBindBuffer(target, 0);
+        mapped = nullptr;
+    }
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+    memoryStats.bufferBytes -= persistent ? regionSize * RING_BUFFER_REGIONS : regionSize;
+}
+
+void RingBuffer::destroy() {
+    release();
+    staging.clear();
+    staging.shrink_to_fit();
+}
+
+void RingBuffer::waitRegion(int index) {
+    GLsync &fence = fences[index];
+    if (fence == nullptr) {
+        return;
+    }
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        auto start = std::chrono::high_resolution_clock::now();
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+        }
+        stallMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void RingBuffer::beginFrame(GLsizeiptr required) {
+    if (required > regionSize) {
+        // Grow by half again what this frame needs, so a slowly growing scene doesn't reallocate every frame:
+        release();
+        create(required + required / 2);
+    }
+    region = (region + 1) % RING_BUFFER_REGIONS;
+    if (persistent) {
+        waitRegion(region);
+    }
+    used = 0;
+}
+
+RingAllocation RingBuffer::allocate(GLsizeiptr size) {
+    GLsizeiptr aligned = getAlignedSize(size);
+    GLsizeiptr start = used.fetch_add(aligned);
+    if (start + aligned > regionSize) {
+        overflows.fetch_add(1);
+        return {nullptr, 0, 0};
+    }
+    if (persistent) {
+        GLintptr offset = regionSize * region + start;
+        return {mapped + offset, offset, size};
+    }
+    return {staging.data() + start, start, size};
+}
+
+void RingBuffer::flush() {
+    if (persistent) {
+        return;
+    }
+
+    // Orphan the buffer so the driver doesn't wait on the last frame's draws, then upload:
+    GLsizeiptr bytes = std::min(used.load(), regionSize);
+    glBindBuffer(target, buffer);
+    glBufferData(target, regionSize, nullptr, GL_STREAM_DRAW);
+    if (bytes > 0) {
+        glBufferSubData(target, 0, bytes, staging.data());
+    }
+    glBindBuffer(target, 0);
+}
+
+void RingBuffer::endFrame() {
+    if (persistent) {
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <atomic>
+#include <vector>
+#include "opengl.h"
+
+// Frames a ring buffer holds data for: the one being written and the two the GPU may still be reading.
+const int RING_BUFFER_REGIONS = 3;
+
+// Bytes of a frame's allocations; null data if the region had no room left:
+struct RingAllocation {
+    unsigned char *data;
+    GLintptr offset; // in the buffer, for glBindBufferRange and friends
+    GLsizeiptr size;
+};
+
+// Per-frame data for the GPU (uniform blocks, later indirect commands), written straight into a buffer.
+//
+// With buffer storage (GL 4.4 or ARB_buffer_storage) the buffer is mapped once, persistently and coherently, and
+// split into RING_BUFFER_REGIONS regions used in turn, one per frame. A fence after a frame's last draw guards
+// its region, and beginFrame waits on it before the region is written again, which only happens if the GPU is
+// frames behind. Allocations come from an atomic offset, so any thread may write its share of the frame, with no
+// GL calls, no driver copies and no implicit syncs. Without buffer storage, allocations go to system memory and
+// flush uploads them into a freshly orphaned buffer, once per frame.
+class RingBuffer {
+public:
+    RingBuffer();
+
+    // Creates the buffer for target with regionSize bytes per frame, whose allocations are aligned to alignment
+    // bytes (e.g. GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT). Call on the context thread.
+    void init(GLenum target, GLsizeiptr regionSize, GLsizeiptr alignment);
+
+    void destroy();
+
+    // Context thread: starts writing the next region, waiting for the GPU to finish the frame that used it last.
+    // The buffer grows, waiting for every frame, if the region is smaller than required bytes.
+    void beginFrame(GLsizeiptr required = 0);
+
+    // Any thread, between beginFrame and flush: size bytes of the frame's region.
+    RingAllocation allocate(GLsizeiptr size);
+
+    // Context thread, before the draws that read the frame's data. Uploads it without buffer storage.
+    void flush();
+
+    // Context thread, after the last draw that reads the frame's data: fences its region.
+    void endFrame();
+
+    GLuint getBuffer() const { return buffer; }
+
+    // size rounded up to the alignment, which allocations of size take up:
+    GLsizeiptr getAlignedSize(GLsizeiptr size) const { return (size + alignment - 1) / alignment * alignment; }
+
+    bool isPersistent() const { return persistent; }
+
+    // Milliseconds beginFrame waited for the GPU, and allocations that found no room:
+    double getStallMs() const { return stallMs; }
+
+    unsigned long long getOverflowCount() const { return overflows.load(); }
+
+private:
+    void create(GLsizeiptr regionSize);
+
+    void release();
+
+    // Waits for the fence of a region, if any:
+    void waitRegion(int region);
+
+    GLenum target;
+    GLuint buffer;
+    GLsizeiptr regionSize;
+    GLsizeiptr alignment;
+    bool persistent;
+    unsigned char *mapped;              // the whole buffer, if persistent
+    std::vector<unsigned char> staging; // the frame's data otherwise
+    GLsync fences[RING_BUFFER_REGIONS];
+    int region;
+    std::atomic<GLsizeiptr> used; // bytes allocated in the region
+    double stallMs;
+    std::atomic<unsigned long long> overflows;
+};
+
+#endif //RINGBUFFER_H
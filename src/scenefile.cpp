@@ -0,0 +1,300 @@
+#include "scenefile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <map>
+
+// Primitive keywords and the size values each takes:
+static const struct {
+    const char *keyword;
+    int sizes;
+} PRIMITIVES[SCENE_PRIMITIVE_TYPES] = {
+        {"cube",     3},
+        {"plane",    2},
+        {"pyramid",  2},
+        {"cylinder", 3},
+        {"sphere",   1},
+        {"torus",    2},
+        {"model",    0},
+};
+
+static const char *SHADER_NAMES[SCENE_SHADERS] = {"lights", "normalmap"};
+
+SceneFile::SceneFile() {
+    objectCount = 0;
+    textureCount = 0;
+    primitives = nullptr;
+    transforms = nullptr;
+    materials = nullptr;
+    names = nullptr;
+    textures = nullptr;
+    strings = nullptr;
+    stringsSize = 0;
+}
+
+const char *SceneFile::getString(uint32_t offset) const {
+    return offset < stringsSize ? strings + offset : "";
+}
+
+const char *SceneFile::getTexture(int32_t texture) const {
+    if (texture < 0 || (uint32_t) texture >= textureCount) {
+        return nullptr;
+    }
+    return getString(textures[texture]);
+}
+
+bool SceneFile::load(const char *path) {
+    if (!file.open(path)) {
+        return false;
+    }
+    if (file.size() >= sizeof(SCENE_FILE_MAGIC) && memcmp(file.data(), SCENE_FILE_MAGIC, 4) == 0) {
+        if (!mapBinary()) {
+            printf("ERROR: %s is not a valid version %u scene\n", path, SCENE_FILE_VERSION);
+            file.close();
+            return false;
+        }
+        return true;
+    }
+    file.close();
+    return parseText(path);
+}
+
+// Checks that an array of count elements of size bytes at offset lies within the file and is aligned:
+static bool validSection(uint32_t offset, uint32_t count, size_t size, size_t fileSize) {
+    return offset % SCENE_FILE_ALIGNMENT == 0 && offset <= fileSize && (uint64_t) count * size <= fileSize - offset;
+}
+
+bool SceneFile::mapBinary() {
+    if (file.size() < sizeof(SceneFileHeader)) {
+        return false;
+    }
+    const auto *header = (const SceneFileHeader *) file.data();
+    size_t size = file.size();
+    if (header->version != SCENE_FILE_VERSION || header->fileSize != size ||
+        !validSection(header->primitivesOffset, header->objectCount, sizeof(ScenePrimitive), size) ||
+        !validSection(header->transformsOffset, header->objectCount, sizeof(SceneTransform), size) ||
+        !validSection(header->materialsOffset, header->objectCount, sizeof(SceneMaterial), size) ||
+        !validSection(header->namesOffset, header->objectCount, sizeof(uint32_t), size) ||
+        !validSection(header->texturesOffset, header->textureCount, sizeof(uint32_t), size) ||
+        !validSection(header->stringsOffset, header->stringsSize, 1, size) || header->stringsSize == 0) {
+        return false;
+    }
+
+    // Strings are looked up by offset, so a terminated blob is enough to keep every lookup inside it:
+    strings = (const char *) file.data() + header->stringsOffset;
+    stringsSize = header->stringsSize;
+    if (strings[stringsSize - 1] != '\0') {
+        return false;
+    }
+    objectCount = header->objectCount;
+    textureCount = header->textureCount;
+    primitives = (const ScenePrimitive *) (file.data() + header->primitivesOffset);
+    transforms = (const SceneTransform *) (file.data() + header->transformsOffset);
+    materials = (const SceneMaterial *) (file.data() + header->materialsOffset);
+    names = (const uint32_t *) (file.data() + header->namesOffset);
+    textures = (const uint32_t *) (file.data() + header->texturesOffset);
+    return true;
+}
+
+void SceneFile::pointAtParsed() {
+    objectCount = (uint32_t) parsedPrimitives.size();
+    textureCount = (uint32_t) parsedTextures.size();
+    primitives = parsedPrimitives.data();
+    transforms = parsedTransforms.data();
+    materials = parsedMaterials.data();
+    names = parsedNames.data();
+    textures = parsedTextures.data();
+    strings = parsedStrings.data();
+    stringsSize = (uint32_t) parsedStrings.size() + 1; // with std::string's terminator
+}
+
+// Appends a null-terminated string to the blob and returns its offset:
+static uint32_t addString(std::string &strings, const std::string &s) {
+    auto offset = (uint32_t) strings.size();
+    strings += s;
+    strings += '\0';
+    return offset;
+}
+
+// Reads count floats, returning false if any is missing:
+static bool readFloats(std::istringstream &line, float *values, int count) {
+    for (int i = 0; i < count; ++i) {
+        if (!(line >> values[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SceneFile::parseText(const char *path) {
+    std::ifstream in(path);
+    if (!in) {
+        printf("ERROR: Failed to open %s\n", path);
+        return false;
+    }
+    parsedPrimitives.clear();
+    parsedTransforms.clear();
+    parsedMaterials.clear();
+    parsedNames.clear();
+    parsedTextures.clear();
+    parsedStrings.clear();
+
+    std::map<std::string, int32_t> textureIds;
+    std::vector<bool> hasPrimitive;
+    std::string text;
+    int lineNumber = 0;
+    while (std::getline(in, text)) {
+        ++lineNumber;
+        text = text.substr(0, text.find('#'));
+        std::istringstream line(text);
+        std::string keyword;
+        if (!(line >> keyword)) {
+            continue;
+        }
+
+        bool valid = true;
+        if (keyword == "texture") {
+            std::string id, texturePath;
+            valid = (bool) (line >> id >> texturePath) && textureIds.count(id) == 0;
+            if (valid) {
+                textureIds[id] = (int32_t) parsedTextures.size();
+                parsedTextures.push_back(addString(parsedStrings, texturePath));
+            }
+        } else if (keyword == "object") {
+            std::string name;
+            valid = (bool) (line >> name);
+            if (valid) {
+                parsedPrimitives.push_back({SCENE_CUBE, {0, 0}, {1.0f, 1.0f, 1.0f}, 0});
+                parsedTransforms.push_back({{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}});
+                parsedMaterials.push_back({SCENE_NO_TEXTURE, SCENE_NO_TEXTURE, SCENE_SHADER_LIGHTS, 0,
+                                           {0.5f, 0.5f, 0.5f}, 0.0f});
+                parsedNames.push_back(addString(parsedStrings, name));
+                hasPrimitive.push_back(false);
+            }
+        } else if (parsedPrimitives.empty()) {
+            printf("ERROR: %s:%d: '%s' outside of an object\n", path, lineNumber, keyword.c_str());
+            return false;
+        } else {
+            ScenePrimitive &primitive = parsedPrimitives.back();
+            SceneTransform &transform = parsedTransforms.back();
+            SceneMaterial &material = parsedMaterials.back();
+
+            uint32_t type = 0;
+            while (type < SCENE_PRIMITIVE_TYPES && keyword != PRIMITIVES[type].keyword) {
+                ++type;
+            }
+            if (type == SCENE_MODEL) {
+                std::string modelPath;
+                valid = (bool) (line >> modelPath);
+                primitive.type = type;
+                primitive.model = addString(parsedStrings, modelPath);
+                hasPrimitive.back() = true;
+            } else if (type < SCENE_PRIMITIVE_TYPES) {
+                primitive.type = type;
+                valid = readFloats(line, primitive.size, PRIMITIVES[type].sizes);
+                // Segment counts are optional:
+                if (valid && line >> primitive.segments[0]) {
+                    valid = (bool) (line >> primitive.segments[1]);
+                }
+                hasPrimitive.back() = true;
+            } else if (keyword == "position") {
+                valid = readFloats(line, transform.position, 3);
+            } else if (keyword == "rotation") {
+                valid = readFloats(line, transform.rotation, 3);
+            } else if (keyword == "scale") {
+                valid = readFloats(line, transform.scale, 3);
+            } else if (keyword == "specular") {
+                valid = readFloats(line, material.specular, 3);
+            } else if (keyword == "shininess") {
+                valid = readFloats(line, &material.shininess, 1);
+            } else if (keyword == "diffuse" || keyword == "normal") {
+                std::string id;
+                valid = (bool) (line >> id);
+                int32_t texture = SCENE_NO_TEXTURE;
+                if (id == "framebuffer" && keyword == "diffuse") {
+                    texture = SCENE_FRAMEBUFFER_TEXTURE;
+                } else if (id != "none") {
+                    auto found = textureIds.find(id);
+                    valid = valid && found != textureIds.end();
+                    texture = valid ? found->second : SCENE_NO_TEXTURE;
+                }
+                (keyword == "diffuse" ? material.diffuse : material.normal) = texture;
+            } else if (keyword == "shader") {
+                std::string shader;
+                valid = (bool) (line >> shader);
+                material.shader = SCENE_SHADERS;
+                for (uint32_t i = 0; i < SCENE_SHADERS; ++i) {
+                    if (shader == SHADER_NAMES[i]) {
+                        material.shader = i;
+                    }
+                }
+                valid = valid && material.shader != SCENE_SHADERS;
+            } else if (keyword == "mirror") {
+                std::string state;
+                valid = (bool) (line >> state) && (state == "on" || state == "off");
+                material.flags = state == "on" ? SCENE_MIRROR_ON : SCENE_MIRROR_OFF;
+            } else {
+                printf("ERROR: %s:%d: Unknown keyword '%s'\n", path, lineNumber, keyword.c_str());
+                return false;
+            }
+        }
+        if (!valid) {
+            printf("ERROR: %s:%d: Invalid '%s'\n", path, lineNumber, keyword.c_str());
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < hasPrimitive.size(); ++i) {
+        if (!hasPrimitive[i]) {
+            printf("ERROR: %s: Object '%s' has no primitive\n", path, parsedStrings.c_str() + parsedNames[i]);
+            return false;
+        }
+    }
+    pointAtParsed();
+    return true;
+}
+
+// Rounds offset up to the section alignment:
+static uint32_t alignSection(uint32_t offset) {
+    return (offset + SCENE_FILE_ALIGNMENT - 1) / SCENE_FILE_ALIGNMENT * SCENE_FILE_ALIGNMENT;
+}
+
+bool SceneFile::writeBinary(const char *path) const {
+    SceneFileHeader header = {};
+    memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(header.magic));
+    header.version = SCENE_FILE_VERSION;
+    header.objectCount = objectCount;
+    header.textureCount = textureCount;
+    header.primitivesOffset = alignSection(sizeof(SceneFileHeader));
+    header.transformsOffset = alignSection(header.primitivesOffset + objectCount * sizeof(ScenePrimitive));
+    header.materialsOffset = alignSection(header.transformsOffset + objectCount * sizeof(SceneTransform));
+    header.namesOffset = alignSection(header.materialsOffset + objectCount * sizeof(SceneMaterial));
+    header.texturesOffset = alignSection(header.namesOffset + objectCount * sizeof(uint32_t));
+    header.stringsOffset = alignSection(header.texturesOffset + textureCount * sizeof(uint32_t));
+    header.stringsSize = stringsSize;
+    header.fileSize = header.stringsOffset + stringsSize;
+
+    // Assemble the file in memory so it is written with one call:
+    std::vector<char> bytes(header.fileSize, 0);
+    memcpy(bytes.data(), &header, sizeof(header));
+    memcpy(bytes.data() + header.primitivesOffset, primitives, objectCount * sizeof(ScenePrimitive));
+    memcpy(bytes.data() + header.transformsOffset, transforms, objectCount * sizeof(SceneTransform));
+    memcpy(bytes.data() + header.materialsOffset, materials, objectCount * sizeof(SceneMaterial));
+    memcpy(bytes.data() + header.namesOffset, names, objectCount * sizeof(uint32_t));
+    memcpy(bytes.data() + header.texturesOffset, textures, textureCount * sizeof(uint32_t));
+    memcpy(bytes.data() + header.stringsOffset, strings, stringsSize);
+
+    FILE *out = fopen(path, "wb");
+    if (out == nullptr) {
+        printf("ERROR: Failed to write %s\n", path);
+        return false;
+    }
+    bool written = fwrite(bytes.data(), 1, bytes.size(), out) == bytes.size();
+    written = fclose(out) == 0 && written;
+    if (!written) {
+        printf("ERROR: Failed to write %s\n", path);
+    }
+    return written;
+}
@@ -0,0 +1,154 @@
+#ifndef SCENEFILE_H
+#define SCENEFILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mappedfile.h"
+
+// Binary scene files start with this tag and version:
+const char SCENE_FILE_MAGIC[4] = {'S', 'C', 'N', 'B'};
+const uint32_t SCENE_FILE_VERSION = 2;
+
+// Sections of a binary scene are aligned to this many bytes:
+const uint32_t SCENE_FILE_ALIGNMENT = 16;
+
+enum ScenePrimitiveType : uint32_t {
+    SCENE_CUBE,     // size: width, height, length
+    SCENE_PLANE,    // size: width, length
+    SCENE_PYRAMID,  // size: width, height
+    SCENE_CYLINDER, // size: base radius, top radius, height; segments: sectors, stacks
+    SCENE_SPHERE,   // size: radius; segments: sectors, stacks
+    SCENE_TORUS,    // size: main radius, tube radius; segments: main, tube
+    SCENE_MODEL,    // model file (OBJ or glTF, see importer.h), drawn as one object per material
+    SCENE_PRIMITIVE_TYPES
+};
+
+enum SceneShader : uint32_t {
+    SCENE_SHADER_LIGHTS,
+    SCENE_SHADER_NORMALMAP,
+    SCENE_SHADERS
+};
+
+// Texture references besides indices into the texture table:
+const int32_t SCENE_NO_TEXTURE = -1;
+const int32_t SCENE_FRAMEBUFFER_TEXTURE = -2; // the monitor's render-to-texture target
+
+// Object flags, for objects drawn only while the screen mirror is on or off:
+const uint32_t SCENE_MIRROR_ON = 1;
+const uint32_t SCENE_MIRROR_OFF = 2;
+
+// The arrays of a scene, one element per object. They are stored in the binary form exactly as laid out here.
+struct ScenePrimitive {
+    uint32_t type;
+    int32_t segments[2]; // 0 keeps the primitive's default
+    float size[3];
+    uint32_t model; // offset of the model path in the strings (SCENE_MODEL)
+};
+
+struct SceneTransform {
+    float position[3];
+    float rotation[3]; // degrees around x, y and z
+    float scale[3];
+};
+
+struct SceneMaterial {
+    int32_t diffuse; // texture index, SCENE_NO_TEXTURE or SCENE_FRAMEBUFFER_TEXTURE
+    int32_t normal;  // texture index or SCENE_NO_TEXTURE
+    uint32_t shader;
+    uint32_t flags;
+    float specular[3];
+    float shininess;
+};
+
+// Binary header; offsets are in bytes from the start of the file.
+struct SceneFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t objectCount;
+    uint32_t textureCount;
+    uint32_t primitivesOffset; // ScenePrimitive[objectCount]
+    uint32_t transformsOffset; // SceneTransform[objectCount]
+    uint32_t materialsOffset;  // SceneMaterial[objectCount]
+    uint32_t namesOffset;      // uint32_t[objectCount], offsets into the strings
+    uint32_t texturesOffset;   // uint32_t[textureCount], offsets into the strings
+    uint32_t stringsOffset;    // null-terminated strings
+    uint32_t stringsSize;
+    uint32_t fileSize;
+};
+
+// A scene description: the primitives, transforms and materials of its objects, and the texture paths they use.
+//
+// The text form is for authoring, one property per line (see scenes/desk.scene):
+//
+//     texture desk images/desk_texture.jpg
+//     object desk
+//         plane 4.0 2.5
+//         diffuse desk
+//         position 0.0 -2.0 -5.0
+//         shininess 32
+//     object lamp
+//         model models/lamp.glb
+//         position 1.0 -2.0 -5.0
+//
+// The binary form (--compile-scene) stores the same arrays flat behind a header; loading maps the file and
+// points at them, with no per-object parsing.
+class SceneFile {
+public:
+    SceneFile();
+
+    // Loads a scene in either form, telling them apart by the binary magic.
+    bool load(const char *path);
+
+    // Writes the scene in the binary form. Returns false if the file can't be written.
+    bool writeBinary(const char *path) const;
+
+    uint32_t getObjectCount() const { return objectCount; }
+
+    const ScenePrimitive &getPrimitive(uint32_t object) const { return primitives[object]; }
+
+    const SceneTransform &getTransform(uint32_t object) const { return transforms[object]; }
+
+    const SceneMaterial &getMaterial(uint32_t object) const { return materials[object]; }
+
+    const char *getName(uint32_t object) const { return getString(names[object]); }
+
+    // Returns the file of a SCENE_MODEL object:
+    const char *getModelPath(uint32_t object) const { return getString(primitives[object].model); }
+
+    // Returns the path of a texture index, or null if the index is out of range:
+    const char *getTexture(int32_t texture) const;
+
+private:
+    const char *getString(uint32_t offset) const;
+
+    bool parseText(const char *path);
+
+    bool mapBinary();
+
+    // Points the arrays at the parsed vectors:
+    void pointAtParsed();
+
+    uint32_t objectCount;
+    uint32_t textureCount;
+    const ScenePrimitive *primitives;
+    const SceneTransform *transforms;
+    const SceneMaterial *materials;
+    const uint32_t *names;
+    const uint32_t *textures;
+    const char *strings;
+    uint32_t stringsSize;
+
+    // Storage of the binary form:
+    MappedFile file;
+
+    // Storage of the text form:
+    std::vector<ScenePrimitive> parsedPrimitives;
+    std::vector<SceneTransform> parsedTransforms;
+    std::vector<SceneMaterial> parsedMaterials;
+    std::vector<uint32_t> parsedNames;
+    std::vector<uint32_t> parsedTextures;
+    std::string parsedStrings;
+};
+
+#endif //SCENEFILE_H
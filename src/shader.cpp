@@ -9,6 +9,125 @@ using namespace std;
 
 #include "shader.h"
 
+bool Shader::parallelCompile = false;
+
+static const GLenum STAGE_TYPES[SHADER_STAGES] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER,
+                                                   GL_TESS_CONTROL_SHADER, GL_TESS_EVALUATION_SHADER,
+                                                   GL_COMPUTE_SHADER};
+static const char *const STAGE_NAMES[SHADER_STAGES] = {"VERTEX", "FRAGMENT", "GEOMETRY", "TESS_CONTROL",
+                                                       "TESS_EVALUATION", "COMPUTE"};
+
+Shader::Shader() {
+    ID = 0;
+    for (unsigned int &stage : stages) {
+        stage = 0;
+    }
+}
+
+Shader::Shader(const char *vertexPath, const char *fragmentPath, const char *geometryPath,
+               const char *tessControlPath, const char *tessEvaluationPath) : Shader() {
+    ShaderSources sources;
+    read(sources, vertexPath, fragmentPath, geometryPath, tessControlPath, tessEvaluationPath);
+    compile(sources);
+    finish();
+}
+
+Shader::Shader(const char *computePath) : Shader() {
+    ShaderSources sources;
+    readCompute(sources, computePath);
+    compile(sources);
+    finish();
+}
+
+void Shader::read(ShaderSources &sources, const char *vertexPath, const char *fragmentPath,
+                  const char *geometryPath, const char *tessControlPath, const char *tessEvaluationPath) {
+    const char *paths[SHADER_STAGES] = {vertexPath, fragmentPath, geometryPath, tessControlPath,
+                                        tessEvaluationPath, nullptr};
+    for (int i = 0; i < SHADER_STAGES; ++i) {
+        sources.code[i] = readSource(paths[i], sources.storage[i]);
+    }
+}
+
+void Shader::readCompute(ShaderSources &sources, const char *computePath) {
+    read(sources, nullptr, nullptr);
+    sources.code[SHADER_STAGES - 1] = readSource(computePath, sources.storage[SHADER_STAGES - 1]);
+}
+
+void Shader::addPreamble(ShaderSources &sources, const char *defines, const char *includePath) {
+    string include;
+    AssetView included = readSource(includePath, include);
+    string preamble = defines;
+    if (included.data != nullptr) {
+        preamble.append((const char *) included.data, included.size);
+    }
+    if (!preamble.empty() && preamble.back() != '\n') {
+        preamble += '\n';
+    }
+    for (int i = 0; i < SHADER_STAGES; ++i) {
+        if (sources.code[i].data == nullptr) {
+            continue;
+        }
+
+        // The #version line must stay first; packed sources are copied, the pack is read-only
+        string code((const char *) sources.code[i].data, sources.code[i].size);
+        size_t lineEnd = code.compare(0, 8, "#version") == 0 ? code.find('\n') : string::npos;
+        size_t split = lineEnd == string::npos ? 0 : lineEnd + 1;
+        sources.storage[i] = code.substr(0, split) + preamble + code.substr(split);
+        sources.code[i].data = (const unsigned char *) sources.storage[i].data();
+        sources.code[i].size = sources.storage[i].size();
+    }
+}
+
+void Shader::compile(const ShaderSources &sources) {
+    // Compile every given stage and link them into the program; without parallel compiling each call waits
+    ID = glCreateProgram();
+    for (int i = 0; i < SHADER_STAGES; ++i) {
+        if (sources.code[i].data != nullptr) {
+            stages[i] = compileStage(STAGE_TYPES[i], sources.code[i]);
+            glAttachShader(ID, stages[i]);
+        }
+    }
+    glLinkProgram(ID);
+}
+
+bool Shader::isReady() const {
+    GLint done = GL_TRUE;
+    if (parallelCompile) {
+        glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &done);
+    }
+    return done == GL_TRUE;
+}
+
+void Shader::finish() {
+    // Querying the status waits for the compile and link to end
+    for (int i = 0; i < SHADER_STAGES; ++i) {
+        if (stages[i] != 0) {
+            checkCompileErrors(stages[i], STAGE_NAMES[i]);
+        }
+    }
+    checkCompileErrors(ID, "PROGRAM");
+
+    // Delete the shaders as they're linked into our program now and no longer needed:
+    for (unsigned int &stage : stages) {
+        if (stage != 0) {
+            glDeleteShader(stage);
+            stage = 0;
+        }
+    }
+}
+
+bool Shader::enableParallelCompile() {
+    // 0xFFFFFFFF lets the driver pick how many threads it compiles on
+    if (GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        parallelCompile = true;
+    } else if (GLEW_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        parallelCompile = true;
+    }
+    return parallelCompile;
+}
+
 void Shader::destroy() {
     glDeleteProgram(ID);
 }
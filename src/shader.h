@@ -2,6 +2,8 @@
 #define SHADER_H
 
 #include <glm/glm.hpp>
+#include "renderstats.h"
+#include "assetpack.h"
 
 #include <string>
 #include <fstream>
@@ -10,104 +12,65 @@
 
 GLuint LoadShaders(const char *vertex_file_path, const char *fragment_file_path);
 
+// Shader stages, in the order they are given (a compute program has the last one only):
+const int SHADER_STAGES = 6;
+
+// The source code of a program's stages, read ahead of compiling (see Shader::read). Packed sources point into
+// the asset pack and the others into storage; stages the program doesn't have are null.
+struct ShaderSources {
+    AssetView code[SHADER_STAGES];
+    std::string storage[SHADER_STAGES];
+};
+
 // Shader loader class:
 class Shader {
 public:
     unsigned int ID;
 
-    Shader(const char *vertexPath, const char *fragmentPath, const char *geometryPath = nullptr) {
-        // Retrieve the vertex/fragment source code from filePath:
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-
-        // Ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try {
-            // Open files:
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-
-            // Read file's buffer contents into streams:
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-
-            // Close file handlers:
-            vShaderFile.close();
-            fShaderFile.close();
-
-            // Convert stream into string:
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-
-            // If geometry shader path is present, also load a geometry shader:
-            if (geometryPath != nullptr) {
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
-        }
-        catch (std::ifstream::failure &e) {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-        }
-        const char *vShaderCode = vertexCode.c_str();
-        const char *fShaderCode = fragmentCode.c_str();
-        unsigned int vertex, fragment;
-
-        // Vertex shader:
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, nullptr);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-
-        // Fragment shader:
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, nullptr);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-
-        // If geometry shader is given, compile geometry shader:
-        unsigned int geometry = 0;
-        if (geometryPath != nullptr) {
-            const char *gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, nullptr);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
-        }
+    Shader();
 
-        // Create the shader program:
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if (geometryPath != nullptr) {
-            glAttachShader(ID, geometry);
-        }
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-
-        // Delete the shaders as they're linked into our program now and no longer needed:
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if (geometryPath != nullptr) {
-            glDeleteShader(geometry);
-        }
+    // Reads, compiles and links a program, waiting for the result:
+    Shader(const char *vertexPath, const char *fragmentPath, const char *geometryPath = nullptr,
+           const char *tessControlPath = nullptr, const char *tessEvaluationPath = nullptr);
 
-    }
+    // Reads, compiles and links a compute program, waiting for the result:
+    explicit Shader(const char *computePath);
+
+    // Reads the source code of the given stages, from the mounted pack or their files. Needs no GL context, so
+    // it can run on any thread.
+    static void read(ShaderSources &sources, const char *vertexPath, const char *fragmentPath,
+                     const char *geometryPath = nullptr, const char *tessControlPath = nullptr,
+                     const char *tessEvaluationPath = nullptr);
+
+    // Reads the source code of a compute program's one stage, like read:
+    static void readCompute(ShaderSources &sources, const char *computePath);
+
+    // Inserts defines and the source of includePath (if given) after the #version line of every stage read, so
+    // one source compiles into variants. Like read, it can run on any thread.
+    static void addPreamble(ShaderSources &sources, const char *defines, const char *includePath = nullptr);
+
+    // Compiles the stages and links the program. With parallelCompile the driver does both on its own threads
+    // and this returns at once, so other work (or other programs) can go on until finish.
+    void compile(const ShaderSources &sources);
+
+    // Checks whether compiling and linking are done, without waiting:
+    bool isReady() const;
+
+    // Reports compile and link errors (waiting for them if needed) and deletes the stages.
+    void finish();
+
+    // Lets the driver compile on its own threads if the context has KHR_parallel_shader_compile (or the ARB
+    // version), setting parallelCompile. Called once the context is current.
+    static bool enableParallelCompile();
+
+    static bool parallelCompile;
 
     void destroy();
 
     // Activate the shader:
     void use() {
         glUseProgram(ID);
+        ++renderStats.programBinds;
     }
 
     void setBool(const std::string &name, bool value) const {
@@ -118,6 +81,10 @@ public:
         glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
     }
 
+    void setUint(const std::string &name, unsigned int value) const {
+        glUniform1ui(glGetUniformLocation(ID, name.c_str()), value);
+    }
+
     void setFloat(const std::string &name, float value) const {
         glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
     }
@@ -158,7 +125,60 @@ public:
         glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
     }
 
+    // Reads the named uniform block from binding (if the program has the block):
+    void setBlockBinding(const std::string &name, GLuint binding) const {
+        GLuint index = glGetUniformBlockIndex(ID, name.c_str());
+        if (index != GL_INVALID_INDEX) {
+            glUniformBlockBinding(ID, index, binding);
+        }
+    }
+
+    // Reads and writes the named shader storage block at binding (if the program has the block):
+    void setStorageBinding(const std::string &name, GLuint binding) const {
+        GLuint index = glGetProgramResourceIndex(ID, GL_SHADER_STORAGE_BLOCK, name.c_str());
+        if (index != GL_INVALID_INDEX) {
+            glShaderStorageBlockBinding(ID, index, binding);
+        }
+    }
+
 private:
+    // Read a shader source: packed sources are used in place, others are read from their file into storage.
+    static AssetView readSource(const char *path, std::string &storage) {
+        AssetView source = {nullptr, 0};
+        if (path == nullptr) {
+            return source;
+        }
+        source = AssetPack::mounted.find(path);
+        if (source.data != nullptr) {
+            return source;
+        }
+        std::ifstream file;
+        file.exceptions(std::ifstream::failbit | std::ifstream::badbit); // ensure ifstream can throw exceptions
+        try {
+            file.open(path);
+            std::stringstream stream;
+            stream << file.rdbuf();
+            file.close();
+            storage = stream.str();
+        }
+        catch (std::ifstream::failure &e) {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+        }
+        source.data = (const unsigned char *) storage.data();
+        source.size = storage.size();
+        return source;
+    }
+
+    // Compile one shader stage; the length is passed, so the source needs no null terminator:
+    static unsigned int compileStage(GLenum type, const AssetView &code) {
+        const char *source = (const char *) code.data;
+        GLint length = (GLint) code.size;
+        unsigned int shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, &length);
+        glCompileShader(shader);
+        return shader;
+    }
+
     // Check for shader compilation/linking errors:
     static void checkCompileErrors(GLuint shader, const std::string &type) {
         GLint success;
@@ -179,6 +199,8 @@ private:
             }
         }
     }
+
+    unsigned int stages[SHADER_STAGES]; // compiled stages until finish, 0 for missing ones
 };
 
 #endif //SHADER_H
@@ -1,4 +1,5 @@
 #include "skybox.h"
+#include "renderstats.h"
 
 SkyBox::SkyBox() {
     vertexArrayID = 0;
@@ -11,6 +12,7 @@ void SkyBox::destroy() {
     glDeleteVertexArrays(1, &vertexArrayID);
     glDeleteBuffers(1, &vertexBuffer);
     glDeleteBuffers(1, &uvBuffer);
+    memoryStats.bufferBytes -= sizeof(glm::vec3) * 24 + sizeof(glm::vec2) * 24;
 
     // Free textures:
     for (auto& texture : textures) {
@@ -89,44 +91,31 @@ bool SkyBox::init(const char* directory) {
     // UV pointer:
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*) nullptr);
     glEnableVertexAttribArray(1); // enable UVs (not needed?)
+    memoryStats.bufferBytes += sizeof(glm::vec3) * 24 + sizeof(glm::vec2) * 24;
 
     return true;
 }
 
+// Image of each side, in SKYBOX_* order; the four walls share one image:
+static const char* const SIDE_IMAGES[6] = { "wall.jpg", "wall.jpg", "wall.jpg", "wall.jpg", "up.jpg", "floor.jpg" };
+
 bool SkyBox::loadTextures(const char* directory) {
     char filename[255];
-
-    sprintf_s(filename, "%s/up.jpg", directory);
-    if (!textures[SKYBOX_UP].load(filename, 1, GL_TEXTURE_2D, GL_LINEAR, GL_LINEAR, true)) {
-        return false;
-    }
-
-    sprintf_s(filename, "%s/floor.jpg", directory);
-    if (!textures[SKYBOX_DOWN].load(filename, 1, GL_TEXTURE_2D, GL_LINEAR, GL_LINEAR, true)) {
-        return false;
-    }
-
-    sprintf_s(filename, "%s/wall.jpg", directory);
-    if (!textures[SKYBOX_LEFT].load(filename, 1, GL_TEXTURE_2D, GL_LINEAR, GL_LINEAR, true)) {
-        return false;
-    }
-
-    sprintf_s(filename, "%s/wall.jpg", directory);
-    if (!textures[SKYBOX_RIGHT].load(filename, 1, GL_TEXTURE_2D, GL_LINEAR, GL_LINEAR, true)) {
-        return false;
-    }
-
-    sprintf_s(filename, "%s/wall.jpg", directory);
-    if (!textures[SKYBOX_BACK].load(filename, 1, GL_TEXTURE_2D, GL_LINEAR, GL_LINEAR, true)) {
-        return false;
+    for (int i = 0; i < 6; ++i) {
+        sprintf_s(filename, "%s/%s", directory, SIDE_IMAGES[i]);
+        if (!textures[i].load(filename, 1, GL_TEXTURE_2D, GL_LINEAR, GL_LINEAR, true)) {
+            return false;
+        }
     }
+    return true;
+}
 
-    sprintf_s(filename, "%s/wall.jpg", directory);
-    if (!textures[SKYBOX_FRONT].load(filename, 1, GL_TEXTURE_2D, GL_LINEAR, GL_LINEAR, true)) {
-        return false;
+std::vector<std::string> SkyBox::getImagePaths(const char* directory) {
+    std::vector<std::string> paths;
+    for (const char* image : SIDE_IMAGES) {
+        paths.push_back(std::string(directory) + "/" + image);
     }
-
-    return true;
+    return paths;
 }
 
 void SkyBox::render(Camera* camera) {
@@ -149,6 +138,7 @@ void SkyBox::render(Camera* camera) {
     for (int i = 0; i < 6; i++) {
         textures[i].bind();
         glDrawArrays(GL_TRIANGLE_STRIP, i * 4, 4);
+        renderStats.countDraw(GL_TRIANGLE_STRIP, 4);
     }
 
     //glDepthMask(1);
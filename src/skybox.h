@@ -6,6 +6,7 @@
 #include "shader.h"
 #include "camera.h"
 
+#include <string>
 #include <vector>
 
 enum {
@@ -18,6 +19,9 @@ public:
 
     bool init(const char* directory);
 
+    // Returns the image of each side, e.g. to read them ahead of init (see Texture::prefetch):
+    static std::vector<std::string> getImagePaths(const char* directory);
+
     void render(Camera* camera);
 
     void destroy();
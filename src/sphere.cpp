@@ -11,6 +11,7 @@
 
 #include <cmath>
 #include "sphere.h"
+#include "meshgen.h"
 
 const int MIN_SECTOR_COUNT = 3;
 const int MIN_STACK_COUNT = 2;
@@ -24,39 +25,38 @@ bool Sphere::init(const char *filename) {
         return false;
     }
 
-    glGenVertexArrays(1, &mesh.vao); // create VAO
-    glBindVertexArray(mesh.vao); // bind VAO
-
-    // VBO:
-    glGenBuffers(1, &mesh.vbo); // create vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo); // bind VBO
-    glBufferData(GL_ARRAY_BUFFER, getInterleavedVertexSize(), getInterleavedVertices(),
-                 GL_STATIC_DRAW); // send interleaved vertex data (V/N/T) to the GPU
-
-    // Index buffer:
-    mesh.nIndices = getIndexSize();
-    glGenBuffers(1, &mesh.indexBuffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.nIndices, getIndices(), GL_STATIC_DRAW);
-
-    int stride = getInterleavedStride();
-
-    // Vertices:
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, nullptr);
-    glEnableVertexAttribArray(0); // enable vertices
+    // Tessellated surface patches replace the mesh and its LOD chain (smooth shading only):
+    MeshParams params = {MESH_SPHERE, sectorCount, stackCount, radius, 0.0f, 0.0f};
+    if (Model::useTessellation && smooth) {
+        initPatches(params);
+        return true;
+    }
 
-    // Normals:
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void *) (sizeof(float) * 3));
-    glEnableVertexAttribArray(1); // enable normals
+    // Smooth spheres come from the generator with coarser levels for distant spheres, through the mesh cache:
+    if (smooth) {
+        initMeshChain(params, sectorCount, radius, radius);
+        return true;
+    }
 
-    // Texture coords:
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void *) (sizeof(float) * 6));
-    glEnableVertexAttribArray(2); // enable texture coords
+    // Interleaved V/N/T vertices and triangle indices:
+    mesh.upload(getInterleavedVertices(), getInterleavedVertexCount(), MESH_VERTEX_FLOATS, getIndices(),
+                getIndexCount());
 
     return true;
 }
 
+void Sphere::prepare() {
+    // Build the mesh chain init uploads, if it uses one
+    if (smooth && !Model::useTessellation) {
+        prepareMeshChain({MESH_SPHERE, sectorCount, stackCount, radius, 0.0f, 0.0f}, sectorCount, radius, radius);
+    }
+}
+
 void Sphere::render() {
+    renderLod(0);
+}
+
+void Sphere::renderLod(int level) {
     glEnableVertexAttribArray(0);
     glEnableVertexAttribArray(1);
     glEnableVertexAttribArray(2);
@@ -65,9 +65,7 @@ void Sphere::render() {
         mesh.material.diffuse.bind();
     }
 
-    glBindVertexArray(mesh.vao); // activate the VBOs contained within the mesh's VAO
-    glDrawElements(GL_TRIANGLES, getIndexCount(), GL_UNSIGNED_INT, NULL);
-    glBindVertexArray(0); // unbind vao
+    getLodMesh(level)->draw(GL_TRIANGLES);
 
     glDisableVertexAttribArray(0);
     glDisableVertexAttribArray(1);
@@ -80,8 +78,8 @@ void Sphere::set(float radius, int sectors, int stacks, bool smooth) {
     if (sectors < MIN_SECTOR_COUNT)
         this->sectorCount = MIN_SECTOR_COUNT;
     this->stackCount = stacks;
-    if (sectors < MIN_STACK_COUNT)
-        this->sectorCount = MIN_STACK_COUNT;
+    if (stacks < MIN_STACK_COUNT)
+        this->stackCount = MIN_STACK_COUNT;
     this->smooth = smooth;
 
     if (smooth)
@@ -123,6 +121,7 @@ void Sphere::clearArrays() {
     std::vector<float>().swap(texCoords);
     std::vector<unsigned int>().swap(indices);
     std::vector<unsigned int>().swap(lineIndices);
+    std::vector<float>().swap(interleavedVertices);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -132,82 +131,17 @@ void Sphere::clearArrays() {
 // z = r * sin(u)
 // where u: stack(latitude) angle (-90 <= u <= 90)
 //       v: sector(longitude) angle (0 <= v <= 360)
+// the generator writes interleaved V/N/T straight into exactly sized arrays
 ///////////////////////////////////////////////////////////////////////////////
 void Sphere::buildVerticesSmooth() {
-    const float pi = acos(-1);
-
     // clear memory of prev arrays
     clearArrays();
 
-    float x, y, z, xy;                              // vertex position
-    float nx, ny, nz, lengthInv = 1.0f / radius;    // normal
-    float s, t;                                     // texCoord
-
-    float sectorStep = 2 * pi / sectorCount;
-    float stackStep = pi / stackCount;
-    float sectorAngle, stackAngle;
-
-    for (int i = 0; i <= stackCount; ++i) {
-        stackAngle = pi / 2 - i * stackStep;        // starting from pi/2 to -pi/2
-        xy = radius * cosf(stackAngle);             // r * cos(u)
-        z = radius * sinf(stackAngle);              // r * sin(u)
-
-        // add (sectorCount+1) vertices per stack
-        // the first and last vertices have same position and normal, but different tex coords
-        for (int j = 0; j <= sectorCount; ++j) {
-            sectorAngle = j * sectorStep;           // starting from 0 to 2pi
-
-            // vertex position
-            x = xy * cosf(sectorAngle);             // r * cos(u) * cos(v)
-            y = xy * sinf(sectorAngle);             // r * cos(u) * sin(v)
-            addVertex(x, y, z);
-
-            // normalized vertex normal
-            nx = x * lengthInv;
-            ny = y * lengthInv;
-            nz = z * lengthInv;
-            addNormal(nx, ny, nz);
-
-            // vertex tex coord between [0, 1]
-            s = (float) j / sectorCount;
-            t = (float) i / stackCount;
-            addTexCoord(s, t);
-        }
-    }
-
-    // indices
-    //  k1--k1+1
-    //  |  / |
-    //  | /  |
-    //  k2--k2+1
-    unsigned int k1, k2;
-    for (int i = 0; i < stackCount; ++i) {
-        k1 = i * (sectorCount + 1);     // beginning of current stack
-        k2 = k1 + sectorCount + 1;      // beginning of next stack
-
-        for (int j = 0; j < sectorCount; ++j, ++k1, ++k2) {
-            // 2 triangles per sector excluding 1st and last stacks
-            if (i != 0) {
-                addIndices(k1, k2, k1 + 1);   // k1---k2---k1+1
-            }
-
-            if (i != (stackCount - 1)) {
-                addIndices(k1 + 1, k2, k2 + 1); // k1+1---k2---k2+1
-            }
-
-            // vertical lines for all stacks
-            lineIndices.push_back(k1);
-            lineIndices.push_back(k2);
-            if (i != 0)  // horizontal lines except 1st stack
-            {
-                lineIndices.push_back(k1);
-                lineIndices.push_back(k1 + 1);
-            }
-        }
-    }
-
-    // generate interleaved vertex array as well
-    buildInterleavedVertices();
+    MeshGenerator generator({MESH_SPHERE, sectorCount, stackCount, radius, 0.0f, 0.0f});
+    interleavedVertices.resize((std::size_t) generator.getVertexCount() * MESH_VERTEX_FLOATS);
+    indices.resize(generator.getIndexCount());
+    lineIndices.resize(generator.getLineIndexCount());
+    generator.generate(interleavedVertices.data(), indices.data(), lineIndices.data());
 }
 
 
@@ -13,8 +13,12 @@ public:
 
     bool init(const char *filename);
 
+    void prepare() override;
+
     void render() override;
 
+    void renderLod(int level) override;
+
     // getters/setters
     float getRadius() const { return radius; }
 
@@ -32,12 +36,8 @@ public:
 
     void setSmooth(bool smooth);
 
-    // for vertex data
-    unsigned int getVertexCount() const { return (unsigned int) vertices.size() / 3; }
-
-    unsigned int getNormalCount() const { return (unsigned int) normals.size() / 3; }
-
-    unsigned int getTexCoordCount() const { return (unsigned int) texCoords.size() / 2; }
+    // for vertex data: the interleaved vertices (below) and the indices
+    unsigned int getVertexCount() const { return (unsigned int) interleavedVertices.size() / 8; }
 
     unsigned int getIndexCount() const { return (unsigned int) indices.size(); }
 
@@ -45,22 +45,10 @@ public:
 
     unsigned int getTriangleCount() const { return getIndexCount() / 3; }
 
-    unsigned int getVertexSize() const { return (unsigned int) vertices.size() * sizeof(float); }
-
-    unsigned int getNormalSize() const { return (unsigned int) normals.size() * sizeof(float); }
-
-    unsigned int getTexCoordSize() const { return (unsigned int) texCoords.size() * sizeof(float); }
-
     unsigned int getIndexSize() const { return (unsigned int) indices.size() * sizeof(unsigned int); }
 
     unsigned int getLineIndexSize() const { return (unsigned int) lineIndices.size() * sizeof(unsigned int); }
 
-    const float *getVertices() const { return vertices.data(); }
-
-    const float *getNormals() const { return normals.data(); }
-
-    const float *getTexCoords() const { return texCoords.data(); }
-
     const unsigned int *getIndices() const { return indices.data(); }
 
     const unsigned int *getLineIndices() const { return lineIndices.data(); }
@@ -102,7 +90,7 @@ private:
     int sectorCount;                        // longitude, # of slices
     int stackCount;                         // latitude, # of stacks
     bool smooth;
-    std::vector<float> vertices;
+    std::vector<float> vertices;            // flat shading builds these, then interleaves them
     std::vector<float> normals;
     std::vector<float> texCoords;
     std::vector<unsigned int> indices;
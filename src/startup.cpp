@@ -0,0 +1,268 @@
+#include "startup.h"
+#include "json.h"
+
+#include <algorithm>
+#include <cstdio>
+
+// The task running on this thread, which is what makes the tasks it adds ready (-1 outside tasks):
+static thread_local int runningTask = -1;
+
+StartupGraph::StartupGraph() {
+    epoch = std::chrono::high_resolution_clock::now();
+    unfinishedTasks = 0;
+    workerThreads = 0;
+    running = false;
+    failed = false;
+    firstFrameTask = -1;
+}
+
+double StartupGraph::now() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - epoch).count();
+}
+
+int StartupGraph::add(const std::string &name, StartupQueue queue, const std::function<bool()> &work,
+                      const std::vector<int> &dependencies) {
+    std::lock_guard<std::mutex> lock(mutex);
+    int id = (int) tasks.size();
+    StartupTask task;
+    task.name = name;
+    task.queue = queue;
+    task.work = work;
+    task.pendingDependencies = 0;
+    task.lastDependency = -1;
+    task.thread = -1;
+    task.ready = 0.0;
+    task.start = 0.0;
+    task.end = 0.0;
+    task.finished = false;
+    tasks.push_back(task);
+    ++unfinishedTasks;
+    for (int dependency : dependencies) {
+        StartupTask &other = tasks[dependency];
+        if (!other.finished) {
+            other.dependents.push_back(id);
+            ++tasks[id].pendingDependencies;
+        } else if (tasks[id].lastDependency < 0 || other.end > tasks[tasks[id].lastDependency].end) {
+            tasks[id].lastDependency = dependency;
+        }
+    }
+    if (runningTask >= 0) {
+        tasks[id].lastDependency = runningTask;
+    }
+    if (tasks[id].pendingDependencies == 0) {
+        makeReady(id);
+    }
+    return id;
+}
+
+void StartupGraph::addDependency(int task, int dependency) {
+    std::lock_guard<std::mutex> lock(mutex);
+    StartupTask &other = tasks[dependency];
+    if (!other.finished) {
+        other.dependents.push_back(task);
+        ++tasks[task].pendingDependencies;
+    } else if (tasks[task].lastDependency < 0 || other.end > tasks[tasks[task].lastDependency].end) {
+        tasks[task].lastDependency = dependency;
+    }
+}
+
+void StartupGraph::makeReady(int task) {
+    tasks[task].ready = now();
+    if (tasks[task].queue == STARTUP_CONTEXT) {
+        readyContextTasks.push_back(task);
+        wakeContext.notify_one();
+    } else if (running && workerThreads > 0) {
+        submit(task);
+    } else {
+        readyWorkerTasks.push_back(task);
+        wakeContext.notify_one();
+    }
+}
+
+void StartupGraph::finish(int task, bool succeeded) {
+    tasks[task].end = now();
+    tasks[task].finished = true;
+    failed = failed || !succeeded;
+    std::vector<int> dependents = tasks[task].dependents;
+    for (int dependent : dependents) {
+        tasks[dependent].lastDependency = task;
+        if (--tasks[dependent].pendingDependencies == 0) {
+            makeReady(dependent);
+        }
+    }
+    if (--unfinishedTasks == 0 || failed) {
+        wakeContext.notify_all();
+    }
+}
+
+bool StartupGraph::run(bool serial) {
+    int threads = serial ? 1 : jobs.getThreadCount();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        workerThreads = threads - 1;
+        running = true;
+        failed = false;
+        while (workerThreads > 0 && !readyWorkerTasks.empty()) {
+            submit(readyWorkerTasks.front());
+            readyWorkerTasks.pop_front();
+        }
+    }
+    runContext();
+
+    // Jobs still queued after a failure skip their task, but must be done before the graph goes:
+    jobs.wait(workerJobs);
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+    return !failed;
+}
+
+void StartupGraph::submit(int task) {
+    jobs.submit([this, task]() { runWorkerTask(task); }, &workerJobs);
+}
+
+void StartupGraph::runWorkerTask(int task) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (failed) {
+        return;
+    }
+    tasks[task].thread = JobSystem::getWorkerIndex();
+    tasks[task].start = now();
+
+    // Run it unlocked; it may add tasks, which can move the task list. A task waiting on jobs may run another
+    // task on this thread in the meantime:
+    std::function<bool()> work = tasks[task].work;
+    lock.unlock();
+    int outerTask = runningTask;
+    runningTask = task;
+    bool succeeded = work();
+    runningTask = outerTask;
+    lock.lock();
+    finish(task, succeeded);
+}
+
+void StartupGraph::runContext() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        // The context thread runs worker tasks only when there are no workers:
+        wakeContext.wait(lock, [this]() {
+            return failed || unfinishedTasks == 0 || !readyContextTasks.empty() || !readyWorkerTasks.empty();
+        });
+        std::deque<int> *queue = !readyContextTasks.empty() ? &readyContextTasks : &readyWorkerTasks;
+        if (failed || queue->empty()) {
+            return;
+        }
+        int task = queue->front();
+        queue->pop_front();
+        tasks[task].thread = 0;
+        tasks[task].start = now();
+
+        std::function<bool()> work = tasks[task].work;
+        lock.unlock();
+        runningTask = task;
+        bool succeeded = work();
+        runningTask = -1;
+        lock.lock();
+        finish(task, succeeded);
+    }
+}
+
+void StartupGraph::markFirstFrame() {
+    std::lock_guard<std::mutex> lock(mutex);
+    StartupTask frame;
+    frame.name = "first frame";
+    frame.queue = STARTUP_CONTEXT;
+    frame.pendingDependencies = 0;
+    frame.lastDependency = -1;
+    frame.thread = 0;
+    frame.ready = 0.0;
+    frame.finished = true;
+
+    // The frame follows the last task to finish:
+    for (int i = 0; i < (int) tasks.size(); ++i) {
+        if (tasks[i].finished && (frame.lastDependency < 0 || tasks[i].end > tasks[frame.lastDependency].end)) {
+            frame.lastDependency = i;
+            frame.ready = tasks[i].end;
+        }
+    }
+    frame.start = frame.ready;
+    frame.end = now();
+    firstFrameTask = (int) tasks.size();
+    tasks.push_back(frame);
+}
+
+std::vector<int> StartupGraph::getCriticalPath() const {
+    int last = firstFrameTask;
+    for (int i = 0; last < 0 && i < (int) tasks.size(); ++i) {
+        if (tasks[i].finished && (last < 0 || tasks[i].end > tasks[last].end)) {
+            last = i;
+        }
+    }
+    std::vector<int> path;
+    for (int task = last; task >= 0; task = tasks[task].lastDependency) {
+        path.push_back(task);
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+void StartupGraph::printReport() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<double> busy((size_t) workerThreads + 1, 0.0);
+    double work = 0.0;
+    int taskCount = 0;
+    for (int i = 0; i < (int) tasks.size(); ++i) {
+        if (tasks[i].finished && i != firstFrameTask) {
+            busy[tasks[i].thread] += tasks[i].end - tasks[i].start;
+            work += tasks[i].end - tasks[i].start;
+            ++taskCount;
+        }
+    }
+    double total = firstFrameTask >= 0 ? tasks[firstFrameTask].end : now();
+    printf("INFO: First frame after %.2f ms: %d startup tasks, %.2f ms of work on %d threads (context thread busy "
+           "%.2f ms)\n", total, taskCount, work, workerThreads + 1, busy[0]);
+
+    // Each task waited for the one before; "queued" is the time it then waited for a free thread:
+    printf("INFO: Critical path:\n");
+    printf("    %10s %10s %10s  %-7s  %s\n", "start", "duration", "queued", "thread", "task");
+    for (int task : getCriticalPath()) {
+        const StartupTask &t = tasks[task];
+        printf("    %7.2f ms %7.2f ms %7.2f ms  %-7s  %s\n", t.start, t.end - t.start, t.start - t.ready,
+               t.thread == 0 ? "context" : "worker", t.name.c_str());
+    }
+}
+
+bool StartupGraph::writeReport(const char *path) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    FILE *file = fopen(path, "w");
+    if (file == nullptr) {
+        printf("ERROR: Failed to write %s\n", path);
+        return false;
+    }
+    std::vector<int> criticalPath = getCriticalPath();
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(file, "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, "
+                  "\"args\": {\"name\": \"context\"}}");
+    for (int i = 1; i <= workerThreads; ++i) {
+        fprintf(file, ",\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                      "\"args\": {\"name\": \"worker %d\"}}", i + 1, i);
+    }
+    for (int i = 0; i < (int) tasks.size(); ++i) {
+        const StartupTask &t = tasks[i];
+        if (!t.finished) {
+            continue;
+        }
+        bool critical = std::find(criticalPath.begin(), criticalPath.end(), i) != criticalPath.end();
+        fprintf(file, ",\n  {\"name\": ");
+        writeJsonString(file, t.name);
+        fprintf(file, ", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f, "
+                      "\"args\": {\"queued ms\": %.3f, \"after\": ", critical ? "critical" : "task", t.thread + 1,
+                t.start * 1000.0, (t.end - t.start) * 1000.0, t.start - t.ready);
+        writeJsonString(file, t.lastDependency >= 0 ? tasks[t.lastDependency].name : std::string());
+        fprintf(file, "}}");
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    printf("INFO: Startup timeline of %d tasks written to %s\n", (int) tasks.size(), path);
+    return true;
+}
@@ -0,0 +1,103 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "jobs.h"
+
+// Where a startup task runs:
+enum StartupQueue {
+    STARTUP_WORKER, // CPU work (file reads, image decoding, mesh generation), as a job on the job pool
+    STARTUP_CONTEXT // GL work, on the thread that owns the context (the one that calls run)
+};
+
+// A unit of startup work. work returns false to stop the startup, after printing why.
+struct StartupTask {
+    std::string name;
+    StartupQueue queue;
+    std::function<bool()> work;
+    std::vector<int> dependents;
+    int pendingDependencies;
+    int lastDependency; // the dependency that finished last, or the task that added it: what made it ready
+    int thread;         // 0 for the context thread, job workers from 1
+    double ready;       // in milliseconds since the graph was created
+    double start;
+    double end;
+    bool finished;
+};
+
+// Initialization as a graph of tasks instead of one serial sequence. Worker tasks run as jobs (see jobs.h) and
+// context tasks on the calling thread, each as soon as the tasks it depends on have finished, so decoding and
+// mesh generation overlap window creation, uploads and shader compiles.
+//
+// Every task is timed, so the report can show the critical path to the first frame: the chain of tasks, each
+// made ready by the one before, that the startup can't finish faster than.
+class StartupGraph {
+public:
+    StartupGraph();
+
+    // Adds a task that runs once its dependencies have finished and returns its id. Tasks may add tasks while
+    // the graph runs, e.g. once a scene file says what to load; dependencies may have finished already.
+    int add(const std::string &name, StartupQueue queue, const std::function<bool()> &work,
+            const std::vector<int> &dependencies = std::vector<int>());
+
+    // Makes a task wait for another one too. The task must not be ready yet: add it to a task from one of its
+    // dependencies.
+    void addDependency(int task, int dependency);
+
+    // Runs every task, worker tasks on the workers of the job pool. Serially, or if the pool has no workers, the
+    // worker tasks run on the calling thread too, in order. Returns false once a task fails; the tasks that
+    // haven't started by then are skipped.
+    bool run(bool serial);
+
+    // Closes the timeline once the first frame has been shown:
+    void markFirstFrame();
+
+    // Prints the time to the first frame, the work done per thread and the critical path.
+    void printReport() const;
+
+    // Writes the timeline as a Chrome trace_event JSON (chrome://tracing, Perfetto): one track per thread,
+    // with the tasks of the critical path in their own category.
+    bool writeReport(const char *path) const;
+
+private:
+    double now() const;
+
+    // Queues a task whose dependencies have all finished:
+    void makeReady(int task);
+
+    // Records a task as done and readies its dependents:
+    void finish(int task, bool succeeded);
+
+    // Submits a ready worker task as a job:
+    void submit(int task);
+
+    // Runs a worker task on a job worker:
+    void runWorkerTask(int task);
+
+    // Runs context tasks (and serially, worker tasks) until the graph is done:
+    void runContext();
+
+    // The tasks of the critical path, first to last:
+    std::vector<int> getCriticalPath() const;
+
+    std::chrono::high_resolution_clock::time_point epoch;
+    std::vector<StartupTask> tasks;
+    std::deque<int> readyWorkerTasks;
+    std::deque<int> readyContextTasks;
+    int unfinishedTasks;
+    int workerThreads;  // 0 while worker tasks are queued for the context thread
+    bool running;
+    bool failed;
+    int firstFrameTask; // the pseudo task closing the timeline, -1 until markFirstFrame
+    mutable std::mutex mutex;
+    std::condition_variable wakeContext;
+    JobCounter workerJobs;
+};
+
+#endif //STARTUP_H
@@ -0,0 +1,82 @@
+#include "stressscene.h"
+#include "transformbatch.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <algorithm>
+
+bool StressScene::generate(const std::vector<StressPart> &parts, int instanceCount, const glm::vec3 &origin,
+                           unsigned int seed) {
+    if (parts.size() > (size_t) STRESS_MAX_PARTS) {
+        printf("ERROR: A stress scene instance holds at most %d parts\n", STRESS_MAX_PARTS);
+        return false;
+    }
+    this->parts = parts;
+    instanceCount = std::max(instanceCount, 1);
+
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    // Material palette: tinted highlights of random strength, shininess spread evenly in log scale over 4-256:
+    for (StressMaterial &material : materials) {
+        glm::vec3 tint(unit(random), unit(random), unit(random));
+        float strength = 0.1f + 0.9f * unit(random);
+        material.specular = strength * glm::mix(glm::vec3(1.0f), tint, 0.5f);
+        material.shininess = 4.0f * std::pow(64.0f, unit(random));
+    }
+
+    // Grid cells, nearest to the center first (ties in a fixed order):
+    int side = (int) std::ceil(std::sqrt((double) instanceCount));
+    std::vector<glm::ivec2> cells;
+    cells.reserve((size_t) side * side);
+    for (int z = 0; z < side; ++z) {
+        for (int x = 0; x < side; ++x) {
+            cells.emplace_back(x - side / 2, z - side / 2);
+        }
+    }
+    std::partial_sort(cells.begin(), cells.begin() + instanceCount, cells.end(),
+                      [](const glm::ivec2 &a, const glm::ivec2 &b) {
+                          int distanceA = a.x * a.x + a.y * a.y;
+                          int distanceB = b.x * b.x + b.y * b.y;
+                          if (distanceA != distanceB) {
+                              return distanceA < distanceB;
+                          }
+                          return a.y != b.y ? a.y < b.y : a.x < b.x;
+                      });
+
+    instances.resize(instanceCount);
+    TransformBatch placements;
+    placements.resize(instanceCount);
+    for (int i = 0; i < instanceCount; ++i) {
+        StressInstance &instance = instances[i];
+        std::fill(instance.levels, instance.levels + STRESS_MAX_PARTS, (unsigned char) 0);
+        if (i == 0) {
+            // The original setup:
+            placements.set(i, glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(1.0f));
+            std::fill(instance.materials, instance.materials + STRESS_MAX_PARTS, STRESS_OWN_MATERIAL);
+            continue;
+        }
+
+        // Turn and scale the setup around its origin, then move it into its cell with some jitter. Turning and
+        // scaling about the origin moves it, which the translation takes back:
+        float yaw = unit(random) * 2.0f * (float) PI;
+        float scale = 0.8f + 0.4f * unit(random);
+        glm::vec3 offset((float) cells[i].x * STRESS_TILE_SPACING + (unit(random) - 0.5f), 0.0f,
+                         (float) cells[i].y * STRESS_TILE_SPACING + (unit(random) - 0.5f));
+        glm::vec3 turned = glm::vec3(glm::rotate(yaw, glm::vec3(0.0f, 1.0f, 0.0f)) * glm::vec4(origin, 0.0f));
+        placements.set(i, origin + offset - scale * turned, glm::vec3(0.0f, yaw, 0.0f), glm::vec3(scale));
+        for (unsigned char &material : instance.materials) {
+            material = (unsigned char) (random() % STRESS_MATERIALS);
+        }
+    }
+
+    // Every instance's matrices in one batch:
+    std::vector<glm::mat4> world(instanceCount), normals(instanceCount);
+    composeTransforms(placements, 0, instanceCount, world.data(), normals.data());
+    for (int i = 0; i < instanceCount; ++i) {
+        instances[i].transform = world[i];
+        instances[i].normalMatrix = normals[i];
+    }
+    return true;
+}
@@ -0,0 +1,75 @@
+#ifndef STRESSSCENE_H
+#define STRESSSCENE_H
+
+#include <vector>
+#include "model.h"
+#include "shader.h"
+
+// Distance between neighbouring desk setups; a desk with its legs spans about 7 units:
+const float STRESS_TILE_SPACING = 9.0f;
+
+// Random materials the instances pick from:
+const int STRESS_MATERIALS = 64;
+
+// Objects per desk setup an instance can hold materials for:
+const int STRESS_MAX_PARTS = 16;
+
+// Material index meaning "the model's own material":
+const unsigned char STRESS_OWN_MATERIAL = 255;
+
+// Seed of the generator, so every run draws the same scene:
+const unsigned int STRESS_SEED = 20240611u;
+
+// One object of the desk setup: a shared prototype model (meshes, textures), the shader it is drawn with and
+// where it sits in the setup.
+struct StressPart {
+    Model *model;
+    Shader *shader;
+    glm::mat4 transform;
+    glm::mat4 normalMatrix; // inverse transpose of transform, in the upper 3x3
+};
+
+struct StressMaterial {
+    glm::vec3 specular;
+    float shininess;
+};
+
+// One desk setup: where it is placed, the material of each of its parts and the level of detail each part drew
+// last, which the next choice keeps hysteresis around (see DrawList::add).
+struct StressInstance {
+    glm::mat4 transform;
+    glm::mat4 normalMatrix;
+    unsigned char materials[STRESS_MAX_PARTS];
+    unsigned char levels[STRESS_MAX_PARTS];
+};
+
+// Tiles a desk setup into a square grid of instances for scaling tests. Instances fill the grid from the center
+// out; the first one is the original setup, the others get a random yaw, scale and offset within their cell
+// and random materials. Parts are drawn from their prototypes, so an instance only costs a transform and a
+// material index and a level of detail per part; no GPU resources are duplicated.
+class StressScene {
+public:
+    // Builds instanceCount copies of parts, placed around the origin of the setup (world position of the
+    // center instance). Returns false if there are more parts than STRESS_MAX_PARTS.
+    bool generate(const std::vector<StressPart> &parts, int instanceCount, const glm::vec3 &origin,
+                  unsigned int seed = STRESS_SEED);
+
+    const std::vector<StressPart> &getParts() const { return parts; }
+
+    const std::vector<StressInstance> &getInstances() const { return instances; }
+
+    // The instances, for the draw list build to update their levels of detail (a part of an instance each):
+    std::vector<StressInstance> &getInstances() { return instances; }
+
+    const StressMaterial &getMaterial(unsigned char index) const { return materials[index]; }
+
+    // Objects drawn per pass:
+    size_t getObjectCount() const { return parts.size() * instances.size(); }
+
+private:
+    std::vector<StressPart> parts;
+    std::vector<StressInstance> instances;
+    StressMaterial materials[STRESS_MATERIALS];
+};
+
+#endif //STRESSSCENE_H
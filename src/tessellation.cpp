@@ -0,0 +1,54 @@
+#include "tessellation.h"
+
+// Appends a patch covering [s0, s1] x [t0, t1]. With flipT the patch's second axis runs from t1 to t0,
+// which turns the winding around for surfaces whose (s, t) orientation faces inwards.
+static void addPatch(std::vector<float> &corners, float s0, float s1, float t0, float t1, PatchPart part,
+                     bool flipT) {
+    if (flipT) {
+        float t = t0;
+        t0 = t1;
+        t1 = t;
+    }
+    const float patch[PATCH_CORNERS][PATCH_VERTEX_FLOATS] = {
+            {s0, t0, (float) part},
+            {s1, t0, (float) part},
+            {s1, t1, (float) part},
+            {s0, t1, (float) part},
+    };
+    corners.insert(corners.end(), &patch[0][0], &patch[0][0] + PATCH_CORNERS * PATCH_VERTEX_FLOATS);
+}
+
+// Appends a grid of sectors x stacks patches over the unit parameter square:
+static void addPatchGrid(std::vector<float> &corners, int sectors, int stacks, PatchPart part, bool flipT) {
+    for (int i = 0; i < stacks; ++i) {
+        for (int j = 0; j < sectors; ++j) {
+            addPatch(corners, (float) j / sectors, (float) (j + 1) / sectors, (float) i / stacks,
+                     (float) (i + 1) / stacks, part, flipT);
+        }
+    }
+}
+
+void buildSurfacePatches(MeshShape shape, std::vector<float> &corners) {
+    corners.clear();
+    switch (shape) {
+        case MESH_SPHERE:
+            // s runs east and t runs south, so (s, t) faces inwards:
+            addPatchGrid(corners, PATCH_SECTORS, PATCH_SPHERE_STACKS, PATCH_SIDE, true);
+            break;
+        case MESH_CYLINDER:
+            // s runs east and t runs up the side; on the caps t is the distance from the center:
+            addPatchGrid(corners, PATCH_SECTORS, 1, PATCH_SIDE, false);
+            addPatchGrid(corners, PATCH_SECTORS, 1, PATCH_BASE_CAP, false);
+            addPatchGrid(corners, PATCH_SECTORS, 1, PATCH_TOP_CAP, true);
+            break;
+        case MESH_TORUS:
+        default:
+            // s runs around the tube and t around the main ring, which faces inwards:
+            addPatchGrid(corners, PATCH_SECTORS, PATCH_TORUS_STACKS, PATCH_SIDE, true);
+            break;
+    }
+}
+
+bool tessellationSupported() {
+    return GLEW_VERSION_4_0 || GLEW_ARB_tessellation_shader;
+}
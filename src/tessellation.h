@@ -0,0 +1,30 @@
+#ifndef TESSELLATION_H
+#define TESSELLATION_H
+
+#include <vector>
+#include "meshgen.h"
+
+// Coarse patch grids of the parametric surfaces, evaluated analytically on the GPU by shader/surface.*
+// Every patch is a quad of 4 corners, each corner holding its surface parameters (s, t) and which part of
+// the surface the patch lies on. The tessellation control stage splits each edge by its length on screen.
+const int PATCH_VERTEX_FLOATS = 3; // s, t, part
+const int PATCH_CORNERS = 4;
+
+// Patches around and along each shape (the GPU does the rest, up to 64 segments per patch edge):
+const int PATCH_SECTORS = 8;
+const int PATCH_SPHERE_STACKS = 4;
+const int PATCH_TORUS_STACKS = 8;
+
+// Parts of a surface a patch can lie on (cylinders have caps):
+enum PatchPart {
+    PATCH_SIDE = 0, PATCH_BASE_CAP = 1, PATCH_TOP_CAP = 2
+};
+
+// Writes the patch corners of a sphere, cylinder or torus (PATCH_VERTEX_FLOATS per corner). Corners are
+// ordered so the tessellator's counter-clockwise triangles face outwards.
+void buildSurfacePatches(MeshShape shape, std::vector<float> &corners);
+
+// True if the context can run tessellation shaders (OpenGL 4.0 or ARB_tessellation_shader):
+bool tessellationSupported();
+
+#endif //TESSELLATION_H
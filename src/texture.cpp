@@ -1,36 +1,88 @@
 #include "texture.h"
+#include "renderstats.h"
+#include "ktxfile.h"
+#include "assetpack.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 
 #include <stb_image.h>
 #include <iostream>
+#include <map>
+#include <mutex>
 
 using namespace std;
 
+bool Texture::useCompressedTextures = true;
+
+// An image read ahead of its upload by Texture::prefetch:
+struct PrefetchedImage {
+    KtxFile ktx;           // the baked texture, if there is one
+    unsigned char* pixels; // otherwise the decoded image, already flipped
+    int width;
+    int height;
+    int channels;
+};
+
+// Prefetched images by file name:
+static mutex prefetchMutex;
+static map<string, PrefetchedImage*> prefetchedImages;
+
 // Constructor for the Texture class, initializing default values for its member variables
 Texture::Texture() {
     textureID = { nullptr };
     textureTarget = GL_TEXTURE_2D;
     totalTextures = 0;
-    width = 800;
-    height = 600;
+    width = 0;
+    height = 0;
     channels = 4;
-    frameBuffer = 0;
-    renderBuffer = 0;
-    drawBuffers = { nullptr };
+    memoryBytes = 0;
 }
 
 // Function to load a texture from a file using stb_image
 // Returns 'true' if the texture was loaded successfully, 'false' otherwise
 bool Texture::load(const char* filename, unsigned int totalTextures, GLenum textureTarget, GLfloat filterMin,
     GLfloat filterMag, bool clamp) {
+    // Upload the image if it was read ahead of time
+    PrefetchedImage* image = nullptr;
+    {
+        lock_guard<mutex> lock(prefetchMutex);
+        auto found = prefetchedImages.find(filename);
+        if (found != prefetchedImages.end()) {
+            image = found->second;
+        }
+    }
+    if (image != nullptr) {
+        if (image->ktx.getLevelCount() > 0 && totalTextures == 1 &&
+            uploadCompressed(image->ktx, getKtxPath(filename).c_str(), textureTarget, filterMin, filterMag, clamp)) {
+            return true;
+        }
+        if (image->pixels != nullptr) {
+            width = image->width;
+            height = image->height;
+            channels = image->channels;
+            return create(image->pixels, totalTextures, textureTarget, filterMin, filterMag, clamp);
+        }
+    }
+
+    // Use the baked version of the image if there is one
+    if (useCompressedTextures && totalTextures == 1 &&
+        loadCompressed(getKtxPath(filename).c_str(), textureTarget, filterMin, filterMag, clamp)) {
+        return true;
+    }
+
+    // Decode the image straight from the mounted pack if it holds it
+    AssetView asset = AssetPack::mounted.find(filename);
+    if (asset.data) {
+        return loadFromMemory(asset.data, (int) asset.size, totalTextures, textureTarget, filterMin, filterMag, clamp);
+    }
+
     // Load the image using stb_image
     unsigned char* data = stbi_load(filename, &width, &height, &channels, 0);
     if (data) {
         // Flip the image vertically
         flipImageVertically(data, width, height, channels);
         // Create a texture with the loaded image data
-        bool status = create(data, totalTextures, textureTarget, filterMin, filterMag, clamp, GL_NONE);
+        bool status = create(data, totalTextures, textureTarget, filterMin, filterMag, clamp);
 
         // Free the image data
         stbi_image_free(data);
@@ -40,10 +92,154 @@ bool Texture::load(const char* filename, unsigned int totalTextures, GLenum text
     return false;
 }
 
+// Function to read an image ahead of its upload: decoding is most of the time a texture takes to load, and
+// unlike the upload it needs no GL context
+// Returns 'true' if the image was read, 'false' otherwise
+bool Texture::prefetch(const char* filename) {
+    {
+        lock_guard<mutex> lock(prefetchMutex);
+        if (prefetchedImages.count(filename) != 0) {
+            return true;
+        }
+    }
+    auto* image = new PrefetchedImage();
+    image->pixels = nullptr;
+
+    // Map the baked version if there is one, as load would use it; its format is checked at upload
+    string ktxPath = getKtxPath(filename);
+    AssetView asset = AssetPack::mounted.find(ktxPath.c_str());
+    bool baked = useCompressedTextures && (asset.data ? image->ktx.openMemory(asset.data, asset.size, ktxPath.c_str())
+                                                      : image->ktx.open(ktxPath.c_str(), false));
+
+    // Otherwise decode the image, from the pack or its file
+    if (!baked) {
+        asset = AssetPack::mounted.find(filename);
+        image->pixels = asset.data ? stbi_load_from_memory(asset.data, (int) asset.size, &image->width,
+                                                           &image->height, &image->channels, 0)
+                                   : stbi_load(filename, &image->width, &image->height, &image->channels, 0);
+        if (image->pixels == nullptr) {
+            delete image;
+            return false;
+        }
+        flipImageVertically(image->pixels, image->width, image->height, image->channels);
+    }
+
+    // Another thread may have read the same file meanwhile
+    lock_guard<mutex> lock(prefetchMutex);
+    if (!prefetchedImages.emplace(filename, image).second) {
+        stbi_image_free(image->pixels);
+        delete image;
+    }
+    return true;
+}
+
+// Function to free the images read ahead, once they are uploaded
+void Texture::releasePrefetched() {
+    lock_guard<mutex> lock(prefetchMutex);
+    for (auto& entry : prefetchedImages) {
+        stbi_image_free(entry.second->pixels);
+        delete entry.second;
+    }
+    prefetchedImages.clear();
+}
+
+// Function to load a texture from an image file in memory, decoded the same way as by load
+bool Texture::loadFromMemory(const unsigned char* bytes, int size, unsigned int totalTextures, GLenum textureTarget,
+    GLfloat filterMin, GLfloat filterMag, bool clamp) {
+    unsigned char* data = stbi_load_from_memory(bytes, size, &width, &height, &channels, 0);
+    if (data) {
+        flipImageVertically(data, width, height, channels);
+        bool status = create(data, totalTextures, textureTarget, filterMin, filterMag, clamp);
+        stbi_image_free(data);
+        return status;
+    }
+    return false;
+}
+
+// Function to check whether the context can sample a compressed format
+static bool isCompressedFormatSupported(GLenum internalFormat) {
+    switch (internalFormat) {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+            return GLEW_EXT_texture_compression_s3tc;
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+            return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+        default:
+            return true; // RGTC is core since OpenGL 3.0
+    }
+}
+
+// Function to load a baked texture: the KTX file is mapped and its blocks handed to OpenGL as they are
+// Returns 'true' if the texture was loaded successfully, 'false' otherwise
+bool Texture::loadCompressed(const char* filename, GLenum textureTarget, GLfloat filterMin, GLfloat filterMag,
+    bool clamp) {
+    // A packed KTX file is read in place from the pack's mapping
+    KtxFile file;
+    AssetView asset = AssetPack::mounted.find(filename);
+    if (asset.data ? !file.openMemory(asset.data, asset.size, filename) : !file.open(filename, false)) {
+        return false;
+    }
+    return uploadCompressed(file, filename, textureTarget, filterMin, filterMag, clamp);
+}
+
+// Function to upload the levels of a KTX file as they are
+// Returns 'true' if the texture was created, 'false' if the context lacks its format
+bool Texture::uploadCompressed(const KtxFile& file, const char* filename, GLenum textureTarget, GLfloat filterMin,
+    GLfloat filterMag, bool clamp) {
+    if (!isCompressedFormatSupported(file.getInternalFormat())) {
+        printf("WARNING: %s uses a compressed format this context lacks, loading the image instead\n", filename);
+        return false;
+    }
+    this->totalTextures = 1;
+    this->textureTarget = textureTarget;
+    width = (int) file.getWidth();
+    height = (int) file.getHeight();
+    textureID = new GLuint[1];
+    glGenTextures(1, textureID);
+    glBindTexture(textureTarget, textureID[0]);
+
+    // Set texture parameters based on input
+    GLint wrap = clamp ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+    glTexParameteri(textureTarget, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(textureTarget, GL_TEXTURE_WRAP_T, wrap);
+    if (clamp) {
+        glTexParameteri(textureTarget, GL_TEXTURE_WRAP_R, wrap);
+    }
+    glTexParameteri(textureTarget, GL_TEXTURE_MIN_FILTER, filterMin);
+    glTexParameteri(textureTarget, GL_TEXTURE_MAG_FILTER, filterMag);
+
+    // Allocate every level at once, then copy the prebuilt mips straight from the mapping
+    glTexStorage2D(textureTarget, file.getLevelCount(), file.getInternalFormat(), width, height);
+    for (uint32_t i = 0; i < file.getLevelCount(); ++i) {
+        const KtxLevel& level = file.getLevel(i);
+        glCompressedTexSubImage2D(textureTarget, i, 0, 0, level.width, level.height, file.getInternalFormat(),
+                                  level.size, level.data);
+        memoryBytes += level.size;
+        memoryStats.textureBytes += level.size;
+    }
+
+    // Unbind the texture
+    glBindTexture(textureTarget, 0);
+
+    return true;
+}
+
+// Function to create a single texel texture of the given color
+bool Texture::createSolid(unsigned char r, unsigned char g, unsigned char b) {
+    unsigned char data[3] = { r, g, b };
+    width = 1;
+    height = 1;
+    channels = 3;
+    return create(data);
+}
+
 // Function to create a texture with the given parameters
 // Returns 'true' if the texture was created successfully, 'false' otherwise
 bool Texture::create(unsigned char* data, unsigned int totalTextures, GLenum textureTarget, GLfloat filterMin,
-    GLfloat filterMag, bool clamp, GLenum attachment) {
+    GLfloat filterMag, bool clamp) {
     // Set member variables based on the input parameters
     this->totalTextures = totalTextures;
     this->textureTarget = textureTarget;
@@ -57,12 +253,14 @@ bool Texture::create(unsigned char* data, unsigned int totalTextures, GLenum tex
         return false;
     }
 
-    // Initialize render target if attachment is specified
-    initRenderTarget(&attachment);
-
     // Generate mipmaps for the texture
     glGenerateMipmap(textureTarget);
 
+    // Drivers store RGB as RGBA; the mip chain adds a third:
+    long long levelBytes = (long long) width * height * 4;
+    memoryBytes += totalTextures * (levelBytes + levelBytes / 3);
+    memoryStats.textureBytes += totalTextures * (levelBytes + levelBytes / 3);
+
     // Unbind the texture
     glBindTexture(textureTarget, 0);
 
@@ -76,33 +274,46 @@ void Texture::destroy() {
         glDeleteTextures(totalTextures, textureID);
         delete[] textureID;
     }
-    if (frameBuffer) {
-        glDeleteFramebuffers(1, &frameBuffer);
-    }
-    if (renderBuffer) {
-        glDeleteRenderbuffers(1, &renderBuffer);
-    }
-    if (drawBuffers) {
-        delete[] drawBuffers;
-    }
+    memoryStats.textureBytes -= memoryBytes;
+    memoryBytes = 0;
 }
 
 // Function to bind a specific texture to the active texture unit
 void Texture::bind(unsigned int texture) {
     glActiveTexture(GL_TEXTURE0 + texture);
     glBindTexture(textureTarget, textureID[texture]);
+    ++renderStats.textureBinds;
 }
 
 // Function to bind the normal map texture to the active texture unit
 void Texture::bindNormalMap() {
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(textureTarget, textureID[0]);
+    ++renderStats.textureBinds;
+}
+
+// Function to create an empty texture for a pass to render into
+// Returns 'true' if the texture was created successfully, 'false' otherwise
+bool Texture::createRenderTexture(int width, int height) {
+    this->width = width;
+    this->height = height;
+    channels = 4;
+    return create(nullptr, 1, GL_TEXTURE_2D, GL_NEAREST, GL_LINEAR, false);
 }
 
-// Function to bind the texture as a render target for rendering to texture
-void Texture::bindAsRenderTarget() {
-    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
-    glViewport(0, 0, width, height);
+// Function to reallocate a render texture at a new size
+void Texture::resize(int width, int height) {
+    this->width = width;
+    this->height = height;
+    glBindTexture(textureTarget, textureID[0]);
+    glTexImage2D(textureTarget, 0, GL_SRGB_ALPHA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glGenerateMipmap(textureTarget);
+    glBindTexture(textureTarget, 0);
+
+    // The image and its mip chain, as create counts them:
+    long long levelBytes = (long long) width * height * 4;
+    memoryStats.textureBytes += levelBytes + levelBytes / 3 - memoryBytes;
+    memoryBytes = levelBytes + levelBytes / 3;
 }
 
 // Function to initialize the texture with the given parameters
@@ -148,64 +359,6 @@ bool Texture::init(unsigned char** data, GLfloat* filterMin, GLfloat* filterMag,
     return true;
 }
 
-// Function to initialize the render target with the given attachment parameters
-// Returns 'true' if the render target was initialized successfully, 'false' otherwise
-bool Texture::initRenderTarget(GLenum* attachments) {
-    // Check if the attachments array is empty
-    if (attachments == nullptr) {
-        return false;
-    }
-
-    // Allocate memory for draw buffers
-    drawBuffers = new GLenum[totalTextures];
-    bool hasDepth = false;
-
-    // Loop through attachments to check for depth/stencil attachment and set draw buffers
-    for (int i = 0; i < totalTextures; ++i) {
-        if (attachments[i] == GL_DEPTH_ATTACHMENT || attachments[i] == GL_STENCIL_ATTACHMENT) {
-            drawBuffers[i] = GL_NONE; // No color attachment for depth/stencil attachment
-            hasDepth = true; // Flag indicating that depth/stencil attachment is present
-        }
-        drawBuffers[i] = attachments[i];
-        if (attachments[i] == GL_NONE) {
-            continue; // Skip this iteration if the attachment is none
-        }
-
-        // Generate and bind framebuffer if not created already
-        if (frameBuffer == 0) {
-            glGenFramebuffers(1, &frameBuffer);
-            glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
-        }
-
-        // Create a renderbuffer for depth if no depth/stencil attachment is present
-        if (!hasDepth) {
-            glGenRenderbuffers(1, &renderBuffer);
-            glBindRenderbuffer(GL_RENDERBUFFER, renderBuffer);
-            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderBuffer);
-        }
-
-        // Attach the texture to the framebuffer
-        glFramebufferTexture2D(GL_FRAMEBUFFER, attachments[i], textureTarget, textureID[i], 0);
-    }
-
-    // If framebuffer is created, set draw buffers and check the framebuffer status
-    if (frameBuffer != 0) {
-        glDrawBuffers(totalTextures, drawBuffers); // Set draw buffers
-
-        // Check if the framebuffer is complete and return the result
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-            printf("ERROR: FrameBuffer initialization failed!\n");
-            assert(false);
-            return false;
-        }
-
-        return true;
-    }
-
-    return false;
-}
-
 // Function to flip an image vertically, used for loading images with correct orientation
 void flipImageVertically(unsigned char* image, int width, int height, int channels) {
     for (int j = 0; j < height / 2; ++j) {
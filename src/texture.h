@@ -2,17 +2,47 @@
 #define TEXTURE_H
 
 #include "opengl.h"
+#include "ktxfile.h"
 
 class Texture {
 public:
     Texture();
 
+    // Loads an image file. If useCompressedTextures is set and the image was baked (see texturebake.h), its
+    // KTX file is uploaded instead. Either is read from the mounted asset pack if it holds it (see assetpack.h).
+    // Images read ahead with prefetch are only uploaded.
     bool load(const char *filename, unsigned int totalTextures = 1, GLenum textureTarget = GL_TEXTURE_2D,
               GLfloat filterMin = GL_NEAREST, GLfloat filterMag = GL_LINEAR, bool clamp = false);
 
+    // Maps a KTX file and uploads its compressed levels as they are, with no decoding. Returns false without
+    // an error if the file doesn't exist, and with a warning if the context lacks its format.
+    bool loadCompressed(const char *filename, GLenum textureTarget = GL_TEXTURE_2D, GLfloat filterMin = GL_NEAREST,
+                        GLfloat filterMag = GL_LINEAR, bool clamp = false);
+
+    // Loads an image file held in memory (PNG, JPEG, ...), such as a texture embedded in a model:
+    bool loadFromMemory(const unsigned char *bytes, int size, unsigned int totalTextures = 1,
+                        GLenum textureTarget = GL_TEXTURE_2D, GLfloat filterMin = GL_NEAREST,
+                        GLfloat filterMag = GL_LINEAR, bool clamp = false);
+
+    // Reads an image file ahead of load, on any thread: opens its baked KTX file or decodes and flips the image,
+    // so load only has the upload left. Images stay in memory, shared by every load of the file, until
+    // releasePrefetched. Returns false if the file can't be read.
+    static bool prefetch(const char *filename);
+
+    static void releasePrefetched();
+
+    // Creates a 1x1 texture of a single color, for materials that have a color instead of an image:
+    bool createSolid(unsigned char r, unsigned char g, unsigned char b);
+
     bool create(unsigned char *data, unsigned int totalTextures = 1, GLenum textureTarget = GL_TEXTURE_2D,
-                GLfloat filterMin = GL_NEAREST, GLfloat filterMag = GL_LINEAR, bool clamp = false,
-                GLenum attachment = GL_NONE);
+                GLfloat filterMin = GL_NEAREST, GLfloat filterMag = GL_LINEAR, bool clamp = false);
+
+    // Creates an empty texture of width x height for a pass of the frame graph to render into (see
+    // framegraph.h), which attaches it to its own framebuffer:
+    bool createRenderTexture(int width, int height);
+
+    // Reallocates a texture made by createRenderTexture at another size, dropping its contents:
+    void resize(int width, int height);
 
     void destroy();
 
@@ -20,12 +50,21 @@ public:
 
     void bindNormalMap();
 
-    void bindAsRenderTarget();
+    GLuint getID(unsigned int texture = 0) const { return textureID[texture]; }
+
+    int getWidth() const { return width; }
+
+    int getHeight() const { return height; }
+
+    // Load baked KTX files in place of images when they exist (on by default).
+    static bool useCompressedTextures;
 
 private:
     bool init(unsigned char **data, GLfloat *filterMin, GLfloat *filterMag, bool clamp);
 
-    bool initRenderTarget(GLenum *attachments);
+    // Uploads the levels of an open KTX file:
+    bool uploadCompressed(const KtxFile &file, const char *filename, GLenum textureTarget, GLfloat filterMin,
+                          GLfloat filterMag, bool clamp);
 
     GLuint *textureID;
     GLenum textureTarget;
@@ -33,9 +72,7 @@ private:
     int width;
     int height;
     int channels;
-    GLuint frameBuffer;
-    GLuint renderBuffer;
-    GLenum *drawBuffers;
+    long long memoryBytes; // GPU memory of the textures and depth buffer, counted in memoryStats
 };
 
 void flipImageVertically(unsigned char *image, int width, int height, int channels);
@@ -0,0 +1,439 @@
+#include "texturebake.h"
+#include "geometry.h"
+#include "ktxfile.h"
+#include "scenefile.h"
+#include "texture.h"
+
+#include <stb_image.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <set>
+
+// Power iterations used to find the principal axis of a block's colors:
+const int BAKE_AXIS_ITERATIONS = 8;
+
+// Interpolation weights of 4-bit BC7 indices, out of 64:
+static const int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+bool parseTextureCompression(const char *name, TextureCompression &compression) {
+    static const char *NAMES[] = {"bc1", "bc3", "bc5", "bc7", "auto"};
+    for (int i = 0; i <= TEXTURE_AUTO; ++i) {
+        if (strcmp(name, NAMES[i]) == 0) {
+            compression = (TextureCompression) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Fits a line through the texels of a block (channels 0 .. channels - 1) and returns its extremes:
+static void fitEndpoints(const unsigned char texels[16][4], int channels, float low[4], float high[4]) {
+    float mean[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < channels; ++c) {
+            mean[c] += texels[i][c] / 16.0f;
+        }
+    }
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; ++i) {
+        for (int a = 0; a < channels; ++a) {
+            for (int b = 0; b < channels; ++b) {
+                covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+            }
+        }
+    }
+
+    // The principal axis by power iteration, starting from the diagonal of the bounding box:
+    float axis[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int c = 0; c < channels; ++c) {
+        unsigned char low8 = 255, high8 = 0;
+        for (int i = 0; i < 16; ++i) {
+            low8 = std::min(low8, texels[i][c]);
+            high8 = std::max(high8, texels[i][c]);
+        }
+        axis[c] = (float) (high8 - low8) + 1e-3f;
+    }
+    for (int iteration = 0; iteration < BAKE_AXIS_ITERATIONS; ++iteration) {
+        float next[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        float length = 0.0f;
+        for (int a = 0; a < channels; ++a) {
+            for (int b = 0; b < channels; ++b) {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length = std::max(length, std::abs(next[a]));
+        }
+        if (length < 1e-6f) {
+            break; // a flat block: keep the box diagonal
+        }
+        for (int c = 0; c < channels; ++c) {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    // Project the texels onto the axis:
+    float axisLength = 0.0f;
+    for (int c = 0; c < channels; ++c) {
+        axisLength += axis[c] * axis[c];
+    }
+    float minT = 0.0f, maxT = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        float t = 0.0f;
+        for (int c = 0; c < channels; ++c) {
+            t += (texels[i][c] - mean[c]) * axis[c];
+        }
+        t /= axisLength;
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    for (int c = 0; c < channels; ++c) {
+        low[c] = glm::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+        high[c] = glm::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+    }
+}
+
+static uint16_t toRgb565(const float color[3]) {
+    int r = (int) (color[0] * 31.0f / 255.0f + 0.5f);
+    int g = (int) (color[1] * 63.0f / 255.0f + 0.5f);
+    int b = (int) (color[2] * 31.0f / 255.0f + 0.5f);
+    return (uint16_t) ((r << 11) | (g << 5) | b);
+}
+
+static void fromRgb565(uint16_t value, int color[3]) {
+    int r = value >> 11, g = (value >> 5) & 63, b = value & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// BC1 color block: two RGB565 endpoints and 2-bit indices into the 4 colors between them.
+void encodeBc1Block(const unsigned char texels[16][4], unsigned char *out) {
+    float low[4], high[4];
+    fitEndpoints(texels, 3, low, high);
+    uint16_t color0 = toRgb565(high);
+    uint16_t color1 = toRgb565(low);
+    // color0 > color1 selects the 4 color mode (no transparent index):
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+    int palette[4][3];
+    fromRgb565(color0, palette[0]);
+    fromRgb565(color1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 4; ++p) {
+                int error = 0;
+                for (int c = 0; c < 3; ++c) {
+                    error += (texels[i][c] - palette[p][c]) * (texels[i][c] - palette[p][c]);
+                }
+                if (error < bestError) {
+                    best = p;
+                    bestError = error;
+                }
+            }
+            indices |= (uint32_t) best << (2 * i);
+        }
+    }
+    memcpy(out, &color0, 2);
+    memcpy(out + 2, &color1, 2);
+    memcpy(out + 4, &indices, 4);
+}
+
+// BC4 channel block (alpha of BC3, each channel of BC5): two 8-bit endpoints and 3-bit indices into the 8
+// values between them.
+static void encodeBc4Block(const unsigned char texels[16][4], int channel, unsigned char *out) {
+    int high = 0, low = 255;
+    for (int i = 0; i < 16; ++i) {
+        high = std::max(high, (int) texels[i][channel]);
+        low = std::min(low, (int) texels[i][channel]);
+    }
+    uint64_t bits = 0;
+    if (high != low) {
+        // Index 0 and 1 are the endpoints, 2 to 7 the values in between from high to low:
+        int palette[8] = {high, low};
+        for (int p = 1; p < 7; ++p) {
+            palette[p + 1] = ((7 - p) * high + p * low) / 7;
+        }
+        for (int i = 0; i < 16; ++i) {
+            int best = 0;
+            for (int p = 1; p < 8; ++p) {
+                if (std::abs(texels[i][channel] - palette[p]) < std::abs(texels[i][channel] - palette[best])) {
+                    best = p;
+                }
+            }
+            bits |= (uint64_t) best << (3 * i);
+        }
+    }
+    out[0] = (unsigned char) high;
+    out[1] = (unsigned char) low;
+    for (int i = 0; i < 6; ++i) {
+        out[2 + i] = (unsigned char) (bits >> (8 * i));
+    }
+}
+
+void encodeBc3Block(const unsigned char texels[16][4], unsigned char *out) {
+    encodeBc4Block(texels, 3, out);
+    encodeBc1Block(texels, out + 8);
+}
+
+void encodeBc5Block(const unsigned char texels[16][4], unsigned char *out) {
+    encodeBc4Block(texels, 0, out);
+    encodeBc4Block(texels, 1, out + 8);
+}
+
+// Appends count bits of value to a 128-bit block, least significant bit first:
+static void writeBits(unsigned char *block, int &position, uint32_t value, int count) {
+    for (int i = 0; i < count; ++i, ++position) {
+        block[position >> 3] |= ((value >> i) & 1) << (position & 7);
+    }
+}
+
+// BC7 block in mode 6: one RGBA line with 7-bit endpoints plus a shared low bit each, and 4-bit indices.
+// Mode 6 suits the smooth gradients of photographs and keeps alpha at full quality.
+void encodeBc7Block(const unsigned char texels[16][4], unsigned char *out) {
+    float endpoints[2][4];
+    fitEndpoints(texels, 4, endpoints[0], endpoints[1]);
+
+    // Quantize each endpoint to 7 bits per channel, choosing the low bit (p) that fits it best:
+    int quantized[2][4], pBits[2], values[2][4];
+    for (int e = 0; e < 2; ++e) {
+        float bestError = 1e30f;
+        for (int p = 0; p < 2; ++p) {
+            int candidate[4];
+            float error = 0.0f;
+            for (int c = 0; c < 4; ++c) {
+                candidate[c] = glm::clamp((int) ((endpoints[e][c] - p) / 2.0f + 0.5f), 0, 127);
+                float value = (float) ((candidate[c] << 1) | p);
+                error += (value - endpoints[e][c]) * (value - endpoints[e][c]);
+            }
+            if (error < bestError) {
+                bestError = error;
+                pBits[e] = p;
+                std::copy(candidate, candidate + 4, quantized[e]);
+            }
+        }
+        for (int c = 0; c < 4; ++c) {
+            values[e][c] = (quantized[e][c] << 1) | pBits[e];
+        }
+    }
+
+    int palette[16][4];
+    for (int p = 0; p < 16; ++p) {
+        for (int c = 0; c < 4; ++c) {
+            palette[p][c] = ((64 - BC7_WEIGHTS[p]) * values[0][c] + BC7_WEIGHTS[p] * values[1][c] + 32) >> 6;
+        }
+    }
+    int indices[16];
+    for (int i = 0; i < 16; ++i) {
+        int bestError = 1 << 30;
+        for (int p = 0; p < 16; ++p) {
+            int error = 0;
+            for (int c = 0; c < 4; ++c) {
+                error += (texels[i][c] - palette[p][c]) * (texels[i][c] - palette[p][c]);
+            }
+            if (error < bestError) {
+                bestError = error;
+                indices[i] = p;
+            }
+        }
+    }
+
+    // The first index is stored without its top bit, which must be 0: swap the endpoints if it isn't.
+    if (indices[0] >= 8) {
+        std::swap(quantized[0], quantized[1]);
+        std::swap(pBits[0], pBits[1]);
+        for (int &index : indices) {
+            index = 15 - index;
+        }
+    }
+
+    memset(out, 0, 16);
+    int position = 0;
+    writeBits(out, position, 1 << 6, 7); // mode 6
+    for (int c = 0; c < 4; ++c) {
+        writeBits(out, position, (uint32_t) quantized[0][c], 7);
+        writeBits(out, position, (uint32_t) quantized[1][c], 7);
+    }
+    writeBits(out, position, (uint32_t) pBits[0], 1);
+    writeBits(out, position, (uint32_t) pBits[1], 1);
+    writeBits(out, position, (uint32_t) indices[0], 3);
+    for (int i = 1; i < 16; ++i) {
+        writeBits(out, position, (uint32_t) indices[i], 4);
+    }
+}
+
+static float srgbToLinear(float value) {
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linearToSrgb(float value) {
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// Halves an RGBA8 level with a box filter: color in linear light, normal maps as renormalized vectors.
+static void downsample(const std::vector<unsigned char> &source, int width, int height, bool normalMap,
+                       std::vector<unsigned char> &target, int targetWidth, int targetHeight) {
+    static float toLinear[256];
+    static bool tableBuilt = false;
+    if (!tableBuilt) {
+        for (int i = 0; i < 256; ++i) {
+            toLinear[i] = srgbToLinear(i / 255.0f);
+        }
+        tableBuilt = true;
+    }
+
+    target.resize((size_t) targetWidth * targetHeight * 4);
+    for (int y = 0; y < targetHeight; ++y) {
+        for (int x = 0; x < targetWidth; ++x) {
+            // The 2x2 texels under the target texel (one row or column at the edge of odd sizes):
+            const unsigned char *texels[4];
+            int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+            int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+            texels[0] = &source[((size_t) y0 * width + x0) * 4];
+            texels[1] = &source[((size_t) y0 * width + x1) * 4];
+            texels[2] = &source[((size_t) y1 * width + x0) * 4];
+            texels[3] = &source[((size_t) y1 * width + x1) * 4];
+
+            unsigned char *result = &target[((size_t) y * targetWidth + x) * 4];
+            if (normalMap) {
+                glm::vec3 normal(0.0f);
+                for (const unsigned char *t : texels) {
+                    normal += glm::vec3(t[0], t[1], t[2]) / 127.5f - 1.0f;
+                }
+                normal = glm::length(normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0.0f, 0.0f, 1.0f);
+                for (int c = 0; c < 3; ++c) {
+                    result[c] = (unsigned char) glm::clamp((normal[c] + 1.0f) * 127.5f + 0.5f, 0.0f, 255.0f);
+                }
+                result[3] = 255;
+                continue;
+            }
+            for (int c = 0; c < 3; ++c) {
+                float sum = 0.0f;
+                for (const unsigned char *t : texels) {
+                    sum += toLinear[t[c]];
+                }
+                result[c] = (unsigned char) (linearToSrgb(sum / 4.0f) * 255.0f + 0.5f);
+            }
+            int alpha = texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3];
+            result[3] = (unsigned char) ((alpha + 2) / 4);
+        }
+    }
+}
+
+// Compresses one RGBA8 level, block by block; blocks past the edge repeat the last row and column:
+static void compressLevel(const std::vector<unsigned char> &texels, int width, int height,
+                          TextureCompression compression, std::vector<unsigned char> &blocks) {
+    void (*encode)(const unsigned char[16][4], unsigned char *);
+    uint32_t blockBytes = 16;
+    switch (compression) {
+        case TEXTURE_BC1:
+            encode = encodeBc1Block;
+            blockBytes = 8;
+            break;
+        case TEXTURE_BC3:
+            encode = encodeBc3Block;
+            break;
+        case TEXTURE_BC5:
+            encode = encodeBc5Block;
+            break;
+        default:
+            encode = encodeBc7Block;
+            break;
+    }
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    blocks.resize((size_t) blocksX * blocksY * blockBytes);
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            unsigned char block[16][4];
+            for (int i = 0; i < 16; ++i) {
+                int x = std::min(bx * 4 + i % 4, width - 1);
+                int y = std::min(by * 4 + i / 4, height - 1);
+                memcpy(block[i], &texels[((size_t) y * width + x) * 4], 4);
+            }
+            encode(block, &blocks[((size_t) by * blocksX + bx) * blockBytes]);
+        }
+    }
+}
+
+bool bakeTexture(const char *input, const char *output, TextureCompression compression) {
+    int width, height, channels;
+    unsigned char *image = stbi_load(input, &width, &height, &channels, 4);
+    if (image == nullptr) {
+        printf("ERROR: Failed to load %s\n", input);
+        return false;
+    }
+    // OpenGL's first row is the bottom one; flip once here instead of on every load:
+    flipImageVertically(image, width, height, 4);
+    std::vector<unsigned char> level(image, image + (size_t) width * height * 4);
+    stbi_image_free(image);
+
+    if (compression == TEXTURE_AUTO) {
+        bool opaque = true;
+        for (size_t i = 3; i < level.size() && opaque; i += 4) {
+            opaque = level[i] == 255;
+        }
+        compression = opaque ? TEXTURE_BC1 : TEXTURE_BC7;
+    }
+    static const GLenum FORMATS[] = {GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT,
+                                     GL_COMPRESSED_RG_RGTC2, GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM};
+    GLenum format = FORMATS[compression];
+
+    // Every level down to 1x1, each filtered from the one above:
+    std::vector<std::vector<unsigned char>> levels;
+    int levelWidth = width, levelHeight = height;
+    while (true) {
+        levels.emplace_back();
+        compressLevel(level, levelWidth, levelHeight, compression, levels.back());
+        if (levelWidth == 1 && levelHeight == 1) {
+            break;
+        }
+        int nextWidth = std::max(1, levelWidth / 2), nextHeight = std::max(1, levelHeight / 2);
+        std::vector<unsigned char> next;
+        downsample(level, levelWidth, levelHeight, compression == TEXTURE_BC5, next, nextWidth, nextHeight);
+        level.swap(next);
+        levelWidth = nextWidth;
+        levelHeight = nextHeight;
+    }
+    if (!KtxFile::write(output, format, (uint32_t) width, (uint32_t) height, levels)) {
+        return false;
+    }
+
+    size_t compressedBytes = 0;
+    for (const std::vector<unsigned char> &blocks : levels) {
+        compressedBytes += blocks.size();
+    }
+    static const char *NAMES[] = {"BC1", "BC3", "BC5", "BC7"};
+    double uncompressedBytes = width * height * 4.0 * 4.0 / 3.0; // RGBA8 with mips, as drivers store it
+    printf("INFO: Baked %s -> %s: %dx%d %s, %d levels, %.2f MB (%.1fx smaller than RGBA8)\n", input, output, width,
+           height, NAMES[compression], (int) levels.size(), compressedBytes / (1024.0 * 1024.0),
+           uncompressedBytes / compressedBytes);
+    return true;
+}
+
+bool bakeSceneTextures(const char *scenePath) {
+    SceneFile scene;
+    if (!scene.load(scenePath)) {
+        return false;
+    }
+    std::set<int32_t> normalMaps;
+    for (uint32_t i = 0; i < scene.getObjectCount(); ++i) {
+        if (scene.getMaterial(i).normal >= 0) {
+            normalMaps.insert(scene.getMaterial(i).normal);
+        }
+    }
+    bool baked = true;
+    for (int32_t i = 0; scene.getTexture(i) != nullptr; ++i) {
+        const char *image = scene.getTexture(i);
+        baked = bakeTexture(image, getKtxPath(image).c_str(), normalMaps.count(i) ? TEXTURE_BC5 : TEXTURE_AUTO) &&
+                baked;
+    }
+    return baked;
+}
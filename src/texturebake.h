@@ -0,0 +1,35 @@
+#ifndef TEXTUREBAKE_H
+#define TEXTUREBAKE_H
+
+#include <vector>
+
+// Block compression formats the baker writes:
+enum TextureCompression {
+    TEXTURE_BC1,  // sRGB color, 8 bytes per block (1/8 of RGBA8)
+    TEXTURE_BC3,  // sRGB color with smooth alpha, 16 bytes per block
+    TEXTURE_BC5,  // normal maps: x and y in two channels, z is rebuilt in the shader
+    TEXTURE_BC7,  // sRGB color and alpha at higher quality than BC3, 16 bytes per block
+    TEXTURE_AUTO  // BC1 for opaque images, BC7 if any texel has alpha
+};
+
+// Parses "bc1", "bc3", "bc5", "bc7" or "auto":
+bool parseTextureCompression(const char *name, TextureCompression &compression);
+
+// Bakes an image file (JPEG, PNG, ...) into a KTX file: flipped for OpenGL, with a full mip chain filtered
+// in linear light (normal maps as unit vectors for BC5), and every level block compressed.
+bool bakeTexture(const char *input, const char *output, TextureCompression compression);
+
+// Bakes every texture of a scene file next to its image (see getKtxPath): normal maps as BC5, the others as
+// TEXTURE_AUTO picks.
+bool bakeSceneTextures(const char *scenePath);
+
+// Encodes a 4x4 block of RGBA8 texels, row by row:
+void encodeBc1Block(const unsigned char texels[16][4], unsigned char *out);
+
+void encodeBc3Block(const unsigned char texels[16][4], unsigned char *out);
+
+void encodeBc5Block(const unsigned char texels[16][4], unsigned char *out);
+
+void encodeBc7Block(const unsigned char texels[16][4], unsigned char *out);
+
+#endif //TEXTUREBAKE_H
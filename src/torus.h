@@ -2,7 +2,6 @@
 #define TORUS_H
 
 #include "model.h"
-#include <vector>
 
 class Torus : public Model {
 public:
@@ -10,25 +9,20 @@ public:
 
     bool init(const char *filename);
 
-    void destroy() override;
+    void prepare() override;
 
     void render() override;
 
+    void renderLod(int level) override;
+
 private:
-    void build();
+    // The circle that drives the LOD selection: its segments and radius.
+    void getLodCircle(int &sectors, float &radius) const;
 
     int _mainSegments;
     int _tubeSegments;
     float _mainRadius;
     float _tubeRadius;
-
-    int _numIndices = 0;
-    int _primitiveRestartIndex = 0;
-
-    glm::vec3 *vertices;
-    glm::vec2 *uvs;
-    glm::vec3 *normals;
-    GLuint *indices;
 };
 
 #endif //TORUS_H
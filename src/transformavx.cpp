@@ -0,0 +1,64 @@
+#include "transformbatch.h"
+
+#include <immintrin.h>
+
+// AVX2 lanes: eight objects per register. The project builds this file alone with /arch:AVX2 (GCC and Clang:
+// -mavx2 -mfma, or the pragma below), so the compiler may contract the kernel's multiplies and adds into FMAs;
+// only called once the CPU and OS report AVX2.
+#if defined(__GNUC__) && !defined(__AVX2__)
+#pragma GCC target("avx2,fma")
+#endif
+
+#include "transformkernel.h"
+
+namespace {
+
+struct Avx2Lanes {
+    typedef __m256 Float;
+    typedef __m256 Mask;
+    static const size_t width = 8;
+
+    static Float load(const float *p) { return _mm256_loadu_ps(p); }
+
+    static Float set(float x) { return _mm256_set1_ps(x); }
+
+    static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+
+    static Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+
+    static Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+
+    static Float div(Float a, Float b) { return _mm256_div_ps(a, b); }
+
+    static Float floor(Float a) { return _mm256_floor_ps(a); }
+
+    static Float abs(Float a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+
+    static Mask less(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+
+    static Mask both(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+
+    static Float select(Mask m, Float a, Float b) { return _mm256_blendv_ps(b, a, m); }
+
+    static void storeColumns(const Float *c, float *out, size_t stride) {
+        // Transpose within each 128-bit half: lanes k and k + 4 come out in the low and high half of row k
+        Float t0 = _mm256_unpacklo_ps(c[0], c[1]);
+        Float t1 = _mm256_unpackhi_ps(c[0], c[1]);
+        Float t2 = _mm256_unpacklo_ps(c[2], c[3]);
+        Float t3 = _mm256_unpackhi_ps(c[2], c[3]);
+        Float rows[4] = {_mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)),
+                         _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)),
+                         _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)),
+                         _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2))};
+        for (size_t k = 0; k < 4; ++k) {
+            _mm_storeu_ps(out + stride * k, _mm256_castps256_ps128(rows[k]));
+            _mm_storeu_ps(out + stride * (k + 4), _mm256_extractf128_ps(rows[k], 1));
+        }
+    }
+};
+
+}
+
+void composeTransformsAvx2(const TransformArrays &arrays, size_t count, float *world, float *normals) {
+    composeTransformKernel<Avx2Lanes>(arrays, count, world, normals);
+}
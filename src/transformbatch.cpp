@@ -0,0 +1,182 @@
+#include "transformbatch.h"
+#include "transformkernel.h"
+
+#include <atomic>
+#include <cmath>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+
+namespace {
+
+// One object at a time, for the objects past the last whole group and CPUs without SSE4.1:
+struct ScalarLanes {
+    typedef float Float;
+    typedef bool Mask;
+    static const size_t width = 1;
+
+    static Float load(const float *p) { return *p; }
+
+    static Float set(float x) { return x; }
+
+    static Float add(Float a, Float b) { return a + b; }
+
+    static Float sub(Float a, Float b) { return a - b; }
+
+    static Float mul(Float a, Float b) { return a * b; }
+
+    static Float div(Float a, Float b) { return a / b; }
+
+    static Float floor(Float a) { return std::floor(a); }
+
+    static Float abs(Float a) { return std::fabs(a); }
+
+    static Mask less(Float a, Float b) { return a < b; }
+
+    static Mask both(Mask a, Mask b) { return a && b; }
+
+    static Float select(Mask m, Float a, Float b) { return m ? a : b; }
+
+    static void storeColumns(const Float *c, float *out, size_t) {
+        out[0] = c[0];
+        out[1] = c[1];
+        out[2] = c[2];
+        out[3] = c[3];
+    }
+};
+
+// Which kernel composeTransforms uses, once picked (any thread may pick it first):
+std::atomic<int> selectedKernel(TRANSFORM_KERNEL_COUNT);
+
+// Reads a CPUID leaf; false if the CPU (or compiler) has none:
+bool cpuid(unsigned int leaf, unsigned int subleaf, unsigned int registers[4]) {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if ((unsigned int) info[0] < leaf) {
+        return false;
+    }
+    __cpuidex(info, (int) leaf, (int) subleaf);
+    for (int i = 0; i < 4; ++i) {
+        registers[i] = (unsigned int) info[i];
+    }
+    return true;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    return __get_cpuid_count(leaf, subleaf, &registers[0], &registers[1], &registers[2], &registers[3]) != 0;
+#else
+    return false;
+#endif
+}
+
+// Checks that the OS saves the SSE and AVX registers on context switches (XCR0 bits 1 and 2):
+bool osSavesAvx() {
+#if defined(_MSC_VER)
+    return (_xgetbv(0) & 6) == 6;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    unsigned int low, high;
+    __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return (low & 6) == 6;
+#else
+    return false;
+#endif
+}
+
+}
+
+void TransformBatch::resize(size_t count) {
+    for (std::vector<float> *array : {&positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ,
+                                      &scaleX, &scaleY, &scaleZ}) {
+        array->resize(count);
+    }
+}
+
+void TransformBatch::set(size_t index, const glm::vec3 &position, const glm::vec3 &rotation,
+                         const glm::vec3 &scale) {
+    positionX[index] = position.x;
+    positionY[index] = position.y;
+    positionZ[index] = position.z;
+    rotationX[index] = rotation.x;
+    rotationY[index] = rotation.y;
+    rotationZ[index] = rotation.z;
+    scaleX[index] = scale.x;
+    scaleY[index] = scale.y;
+    scaleZ[index] = scale.z;
+}
+
+bool isTransformKernelSupported(TransformKernel kernel) {
+    unsigned int leaf1[4] = {0, 0, 0, 0};
+    unsigned int leaf7[4] = {0, 0, 0, 0};
+    switch (kernel) {
+        case TRANSFORM_KERNEL_SCALAR:
+            return true;
+        case TRANSFORM_KERNEL_SSE41:
+            return cpuid(1, 0, leaf1) && (leaf1[2] & (1u << 19)) != 0;
+        case TRANSFORM_KERNEL_AVX2:
+            // AVX and OSXSAVE (leaf 1 ecx bits 28 and 27), FMA (bit 12, the AVX2 unit is built with it) and
+            // AVX2 (leaf 7 ebx bit 5):
+            return cpuid(1, 0, leaf1) && (leaf1[2] & (1u << 28)) != 0 && (leaf1[2] & (1u << 27)) != 0 &&
+                   (leaf1[2] & (1u << 12)) != 0 && osSavesAvx() && cpuid(7, 0, leaf7) &&
+                   (leaf7[1] & (1u << 5)) != 0;
+        default:
+            return false;
+    }
+}
+
+TransformKernel getTransformKernel() {
+    int kernel = selectedKernel.load(std::memory_order_relaxed);
+    if (kernel == TRANSFORM_KERNEL_COUNT) {
+        return setTransformKernel(TRANSFORM_KERNEL_AVX2);
+    }
+    return (TransformKernel) kernel;
+}
+
+TransformKernel setTransformKernel(TransformKernel kernel) {
+    int fastest = (int) kernel;
+    while (fastest > 0 && !isTransformKernelSupported((TransformKernel) fastest)) {
+        --fastest;
+    }
+    selectedKernel.store(fastest, std::memory_order_relaxed);
+    return (TransformKernel) fastest;
+}
+
+const char *getTransformKernelName(TransformKernel kernel) {
+    static const char *names[] = {"scalar", "sse4.1", "avx2"};
+    return kernel < TRANSFORM_KERNEL_COUNT ? names[kernel] : "none";
+}
+
+void composeTransforms(const TransformBatch &batch, size_t begin, size_t end, glm::mat4 *world, glm::mat4 *normals) {
+    composeTransforms(getTransformKernel(), batch, begin, end, world, normals);
+}
+
+void composeTransforms(TransformKernel kernel, const TransformBatch &batch, size_t begin, size_t end,
+                       glm::mat4 *world, glm::mat4 *normals) {
+    if (end <= begin) {
+        return;
+    }
+    TransformArrays arrays = {{&batch.positionX[begin], &batch.positionY[begin], &batch.positionZ[begin]},
+                              {&batch.rotationX[begin], &batch.rotationY[begin], &batch.rotationZ[begin]},
+                              {&batch.scaleX[begin], &batch.scaleY[begin], &batch.scaleZ[begin]}};
+    float *worldOut = &world[0][0][0];
+    float *normalsOut = normals != nullptr ? &normals[0][0][0] : nullptr;
+
+    // Whole groups with the wide kernel, then the rest one by one:
+    size_t count = end - begin;
+    size_t done = 0;
+    if (kernel == TRANSFORM_KERNEL_AVX2) {
+        done = count / 8 * 8;
+        composeTransformsAvx2(arrays, done, worldOut, normalsOut);
+    } else if (kernel == TRANSFORM_KERNEL_SSE41) {
+        done = count / 4 * 4;
+        composeTransformsSse41(arrays, done, worldOut, normalsOut);
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+        arrays.position[axis] += done;
+        arrays.rotation[axis] += done;
+        arrays.scale[axis] += done;
+    }
+    composeTransformKernel<ScalarLanes>(arrays, count - done, worldOut + done * 16,
+                                        normalsOut != nullptr ? normalsOut + done * 16 : nullptr);
+}
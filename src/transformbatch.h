@@ -0,0 +1,67 @@
+#ifndef TRANSFORMBATCH_H
+#define TRANSFORMBATCH_H
+
+#include <cstddef>
+#include <vector>
+#include "geometry.h"
+
+// Instruction sets the batch kernels are built for, slowest first:
+enum TransformKernel {
+    TRANSFORM_KERNEL_SCALAR,
+    TRANSFORM_KERNEL_SSE41,
+    TRANSFORM_KERNEL_AVX2,
+    TRANSFORM_KERNEL_COUNT
+};
+
+// Placements of many objects as separate arrays (structure of arrays), the layout the batch kernels load from:
+// a position, Euler angles in radians (as Model::setRotation) and a scale per object.
+struct TransformBatch {
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> rotationX, rotationY, rotationZ;
+    std::vector<float> scaleX, scaleY, scaleZ;
+
+    void resize(size_t count);
+
+    size_t size() const { return positionX.size(); }
+
+    void set(size_t index, const glm::vec3 &position, const glm::vec3 &rotation, const glm::vec3 &scale);
+};
+
+// Pointers into the arrays of a batch, from its first object to compose on. The kernels touch nothing else, so
+// the translation units built for wider instruction sets share no inline code with the rest of the program.
+struct TransformArrays {
+    const float *position[3];
+    const float *rotation[3];
+    const float *scale[3];
+};
+
+// Composes the objects [begin, end) of batch into world matrices, translation * rotation * scale exactly as
+// Model::getTransform, and normal matrices, the inverse transpose of the world matrix's upper 3x3 (rotation
+// divided by scale, so no inverse is taken) with the rest of the identity. world[i] and normals[i] receive
+// object begin + i; normals may be null. Uses the fastest kernel the CPU supports, or the one forced with
+// setTransformKernel.
+void composeTransforms(const TransformBatch &batch, size_t begin, size_t end, glm::mat4 *world, glm::mat4 *normals);
+
+// The same with a given kernel, which must be supported:
+void composeTransforms(TransformKernel kernel, const TransformBatch &batch, size_t begin, size_t end,
+                       glm::mat4 *world, glm::mat4 *normals);
+
+// Checks the CPU (and, for AVX2, that the OS saves the wider registers):
+bool isTransformKernelSupported(TransformKernel kernel);
+
+// The kernel composeTransforms uses: the fastest supported one unless forced.
+TransformKernel getTransformKernel();
+
+// Forces a kernel, falling back to the fastest supported one if it isn't; returns the kernel used.
+TransformKernel setTransformKernel(TransformKernel kernel);
+
+const char *getTransformKernelName(TransformKernel kernel);
+
+// The kernels for each instruction set, over count objects, a multiple of their width (4 for SSE4.1, 8 for
+// AVX2), into 16 floats per object (normals may be null). Each is built in its own translation unit with its own
+// code generation flags.
+void composeTransformsSse41(const TransformArrays &arrays, size_t count, float *world, float *normals);
+
+void composeTransformsAvx2(const TransformArrays &arrays, size_t count, float *world, float *normals);
+
+#endif //TRANSFORMBATCH_H
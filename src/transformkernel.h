@@ -0,0 +1,110 @@
+#ifndef TRANSFORMKERNEL_H
+#define TRANSFORMKERNEL_H
+
+#include <cstddef>
+
+// The body of the batch transform kernels, written once over a lane type V that holds V::width floats:
+//
+//   V::Float, V::Mask                   a register of floats and the result of a comparison
+//   V::load(p), V::set(x)               width floats from p, x in every lane
+//   V::add, sub, mul, div, floor, abs   lane by lane
+//   V::less(a, b), V::both(m, n)        a < b; m and n
+//   V::select(m, a, b)                  a where m is set, else b
+//   V::storeColumns(c, out, stride)     stores c[0..3] lane k at out + k * stride (a column of lane k's matrix)
+//
+// Each translation unit defines its V in an anonymous namespace, so the instantiations built with different
+// code generation flags never mix, and the kernel only works on plain pointers, so no inline function of a
+// library header is built with them either.
+
+// Sine and cosine of x at once, in float precision for |x| up to a few thousand (Cephes sincosf: reduction to
+// [-pi/4, pi/4] in three steps, then the polynomial of whichever function the octant needs).
+template <class V>
+inline void transformSinCos(typename V::Float x, typename V::Float &sine, typename V::Float &cosine) {
+    typedef typename V::Float Float;
+    Float sign = V::select(V::less(x, V::set(0.0f)), V::set(-1.0f), V::set(1.0f));
+    x = V::abs(x);
+
+    // The even octant at or above x; its half q picks the polynomial (q odd) and the signs (q mod 4):
+    Float j = V::mul(V::floor(V::mul(V::add(V::mul(x, V::set(1.27323954473516f)), V::set(1.0f)), V::set(0.5f))),
+                     V::set(2.0f));
+    Float q = V::mul(j, V::set(0.5f));
+    Float quadrant = V::sub(q, V::mul(V::floor(V::mul(q, V::set(0.25f))), V::set(4.0f)));
+    typename V::Mask swap = V::less(V::set(0.5f), V::sub(quadrant, V::mul(V::floor(V::mul(quadrant, V::set(0.5f))),
+                                                                         V::set(2.0f))));
+    typename V::Mask sineNegative = V::less(V::set(1.5f), quadrant);
+    typename V::Mask cosineNegative = V::both(V::less(V::set(0.5f), quadrant), V::less(quadrant, V::set(2.5f)));
+
+    x = V::sub(x, V::mul(j, V::set(0.78515625f)));
+    x = V::sub(x, V::mul(j, V::set(2.4187564849853515625e-4f)));
+    x = V::sub(x, V::mul(j, V::set(3.77489497744594108e-8f)));
+    Float z = V::mul(x, x);
+
+    Float cosPoly = V::add(V::mul(V::set(2.443315711809948e-5f), z), V::set(-1.388731625493765e-3f));
+    cosPoly = V::add(V::mul(cosPoly, z), V::set(4.166664568298827e-2f));
+    cosPoly = V::add(V::sub(V::mul(V::mul(cosPoly, z), z), V::mul(z, V::set(0.5f))), V::set(1.0f));
+    Float sinPoly = V::add(V::mul(V::set(-1.9515295891e-4f), z), V::set(8.3321608736e-3f));
+    sinPoly = V::add(V::mul(sinPoly, z), V::set(-1.6666654611e-1f));
+    sinPoly = V::add(V::mul(V::mul(sinPoly, z), x), x);
+
+    sine = V::select(swap, cosPoly, sinPoly);
+    cosine = V::select(swap, sinPoly, cosPoly);
+    sine = V::mul(V::select(sineNegative, V::set(-1.0f), V::set(1.0f)), V::mul(sine, sign));
+    cosine = V::select(cosineNegative, V::sub(V::set(0.0f), cosine), cosine);
+}
+
+// Composes count objects from arrays (a TransformArrays), a multiple of V::width of them, into world and normals,
+// 16 floats per object (see composeTransforms):
+template <class V, class Arrays>
+void composeTransformKernel(const Arrays &arrays, size_t count, float *world, float *normals) {
+    typedef typename V::Float Float;
+    const Float half = V::set(0.5f);
+    const Float one = V::set(1.0f);
+    const Float two = V::set(2.0f);
+    const Float zero = V::set(0.0f);
+    for (size_t i = 0; i + V::width <= count; i += V::width) {
+        // The quaternion of the Euler angles, as glm::quat(vec3):
+        Float sx, cx, sy, cy, sz, cz;
+        transformSinCos<V>(V::mul(V::load(arrays.rotation[0] + i), half), sx, cx);
+        transformSinCos<V>(V::mul(V::load(arrays.rotation[1] + i), half), sy, cy);
+        transformSinCos<V>(V::mul(V::load(arrays.rotation[2] + i), half), sz, cz);
+        Float qw = V::add(V::mul(V::mul(cx, cy), cz), V::mul(V::mul(sx, sy), sz));
+        Float qx = V::sub(V::mul(V::mul(sx, cy), cz), V::mul(V::mul(cx, sy), sz));
+        Float qy = V::add(V::mul(V::mul(cx, sy), cz), V::mul(V::mul(sx, cy), sz));
+        Float qz = V::sub(V::mul(V::mul(cx, cy), sz), V::mul(V::mul(sx, sy), cz));
+
+        // Its rotation matrix, as glm::toMat3 (r[column][row]):
+        Float xx = V::mul(qx, qx), yy = V::mul(qy, qy), zz = V::mul(qz, qz);
+        Float xz = V::mul(qx, qz), xy = V::mul(qx, qy), yz = V::mul(qy, qz);
+        Float wx = V::mul(qw, qx), wy = V::mul(qw, qy), wz = V::mul(qw, qz);
+        Float r[3][3] = {
+            {V::sub(one, V::mul(two, V::add(yy, zz))), V::mul(two, V::add(xy, wz)), V::mul(two, V::sub(xz, wy))},
+            {V::mul(two, V::sub(xy, wz)), V::sub(one, V::mul(two, V::add(xx, zz))), V::mul(two, V::add(yz, wx))},
+            {V::mul(two, V::add(xz, wy)), V::mul(two, V::sub(yz, wx)), V::sub(one, V::mul(two, V::add(xx, yy)))}
+        };
+
+        // World: the rotation's columns times the scale, then the position; normals: divided by the scale instead
+        Float scale[3] = {V::load(arrays.scale[0] + i), V::load(arrays.scale[1] + i), V::load(arrays.scale[2] + i)};
+        float *out = world + i * 16;
+        for (int column = 0; column < 3; ++column) {
+            Float c[4] = {V::mul(r[column][0], scale[column]), V::mul(r[column][1], scale[column]),
+                          V::mul(r[column][2], scale[column]), zero};
+            V::storeColumns(c, out + column * 4, 16);
+        }
+        Float position[4] = {V::load(arrays.position[0] + i), V::load(arrays.position[1] + i),
+                             V::load(arrays.position[2] + i), one};
+        V::storeColumns(position, out + 12, 16);
+        if (normals != nullptr) {
+            out = normals + i * 16;
+            for (int column = 0; column < 3; ++column) {
+                Float inverse = V::div(one, scale[column]);
+                Float c[4] = {V::mul(r[column][0], inverse), V::mul(r[column][1], inverse),
+                              V::mul(r[column][2], inverse), zero};
+                V::storeColumns(c, out + column * 4, 16);
+            }
+            Float last[4] = {zero, zero, zero, one};
+            V::storeColumns(last, out + 12, 16);
+        }
+    }
+}
+
+#endif //TRANSFORMKERNEL_H
@@ -0,0 +1,56 @@
+#include "transformbatch.h"
+
+#include <smmintrin.h>
+
+// SSE4.1 lanes: four objects per register. Needs no code generation flags (the intrinsics are enabled per
+// function by the compiler); only called once the CPU reports SSE4.1.
+#if defined(__GNUC__) && !defined(__SSE4_1__)
+#pragma GCC target("sse4.1")
+#endif
+
+#include "transformkernel.h"
+
+namespace {
+
+struct Sse41Lanes {
+    typedef __m128 Float;
+    typedef __m128 Mask;
+    static const size_t width = 4;
+
+    static Float load(const float *p) { return _mm_loadu_ps(p); }
+
+    static Float set(float x) { return _mm_set1_ps(x); }
+
+    static Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+
+    static Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+
+    static Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+
+    static Float div(Float a, Float b) { return _mm_div_ps(a, b); }
+
+    static Float floor(Float a) { return _mm_floor_ps(a); }
+
+    static Float abs(Float a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+    static Mask less(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+
+    static Mask both(Mask a, Mask b) { return _mm_and_ps(a, b); }
+
+    static Float select(Mask m, Float a, Float b) { return _mm_blendv_ps(b, a, m); }
+
+    static void storeColumns(const Float *c, float *out, size_t stride) {
+        Float c0 = c[0], c1 = c[1], c2 = c[2], c3 = c[3];
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        _mm_storeu_ps(out, c0);
+        _mm_storeu_ps(out + stride, c1);
+        _mm_storeu_ps(out + stride * 2, c2);
+        _mm_storeu_ps(out + stride * 3, c3);
+    }
+};
+
+}
+
+void composeTransformsSse41(const TransformArrays &arrays, size_t count, float *world, float *normals) {
+    composeTransformKernel<Sse41Lanes>(arrays, count, world, normals);
+}
@@ -0,0 +1,198 @@
+#include "vertexformat.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+unsigned short floatToHalf(float value) {
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    unsigned int sign = (bits >> 16) & 0x8000;
+    unsigned int floatExponent = (bits >> 23) & 0xff;
+    unsigned int mantissa = bits & 0x7fffff;
+    int exponent = (int) floatExponent - 127 + 15;
+
+    if (floatExponent == 0xff) {
+        return (unsigned short) (sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0)); // inf/nan
+    }
+    if (exponent >= 31) {
+        return (unsigned short) (sign | 0x7c00); // overflow to inf
+    }
+    if (exponent <= 0) {
+        // Denormal (or zero) half:
+        if (exponent < -10) {
+            return (unsigned short) sign;
+        }
+        mantissa |= 0x800000; // implicit leading 1
+        unsigned int shift = (unsigned int) (14 - exponent);
+        unsigned int half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1) {
+            ++half; // round to nearest
+        }
+        return (unsigned short) (sign | half);
+    }
+
+    unsigned int half = sign | ((unsigned int) exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000) {
+        ++half; // round to nearest, a carry correctly bumps the exponent
+    }
+    return (unsigned short) half;
+}
+
+float halfToFloat(unsigned short value) {
+    unsigned int sign = (unsigned int) (value & 0x8000) << 16;
+    unsigned int exponent = (value >> 10) & 0x1f;
+    unsigned int mantissa = value & 0x3ff;
+    unsigned int bits;
+
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        } else {
+            // Normalize the denormal:
+            int e = -1;
+            do {
+                ++e;
+                mantissa <<= 1;
+            } while ((mantissa & 0x400) == 0);
+            bits = sign | ((unsigned int) (127 - 15 - e) << 23) | ((mantissa & 0x3ff) << 13);
+        }
+    } else if (exponent == 31) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// Signed normalized float to a 10-bit two's complement field:
+static GLuint packSnorm10(float value) {
+    int q = (int) lroundf(std::max(-1.0f, std::min(1.0f, value)) * 511.0f);
+    return (GLuint) q & 0x3ff;
+}
+
+static float unpackSnorm10(GLuint bits) {
+    int q = (int) (bits & 0x3ff);
+    if (q & 0x200) {
+        q -= 0x400; // sign extend
+    }
+    return std::max(-1.0f, (float) q / 511.0f);
+}
+
+GLuint packOctahedral(const glm::vec3 &v, float w) {
+    // Project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the diagonals:
+    float l1 = fabsf(v.x) + fabsf(v.y) + fabsf(v.z);
+    if (l1 == 0.0f) {
+        l1 = 1.0f;
+    }
+    float x = v.x / l1;
+    float y = v.y / l1;
+    if (v.z < 0.0f) {
+        float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    GLuint sign = w < 0.0f ? 0x3 : (w > 0.0f ? 0x1 : 0x0); // 2-bit snorm
+    return packSnorm10(x) | (packSnorm10(y) << 10) | (sign << 30);
+}
+
+glm::vec3 unpackOctahedral(GLuint packed) {
+    float x = unpackSnorm10(packed);
+    float y = unpackSnorm10(packed >> 10);
+    glm::vec3 v(x, y, 1.0f - fabsf(x) - fabsf(y));
+    if (v.z < 0.0f) {
+        v.x = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        v.y = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return glm::normalize(v);
+}
+
+void packVertices(const float *vertices, unsigned int vertexCount, int floatsPerVertex,
+                  std::vector<unsigned char> &packed, glm::vec3 *scale, glm::vec3 *offset) {
+    bool tangents = floatsPerVertex >= MESH_TANGENT_VERTEX_FLOATS;
+    int stride = tangents ? PACKED_TANGENT_VERTEX_STRIDE : PACKED_VERTEX_STRIDE;
+
+    // Mesh bounds:
+    glm::vec3 boundsMin(0.0f), boundsMax(0.0f);
+    for (unsigned int i = 0; i < vertexCount; ++i) {
+        glm::vec3 p = glm::make_vec3(vertices + (std::size_t) i * floatsPerVertex);
+        boundsMin = i == 0 ? p : glm::min(boundsMin, p);
+        boundsMax = i == 0 ? p : glm::max(boundsMax, p);
+    }
+    glm::vec3 extent = boundsMax - boundsMin;
+    for (int k = 0; k < 3; ++k) {
+        if (extent[k] <= 0.0f) {
+            extent[k] = 1.0f; // flat along this axis
+        }
+    }
+    *scale = extent;
+    *offset = boundsMin;
+
+    packed.resize((std::size_t) vertexCount * stride);
+    unsigned char *out = packed.data();
+    for (unsigned int i = 0; i < vertexCount; ++i, out += stride) {
+        const float *v = vertices + (std::size_t) i * floatsPerVertex;
+
+        unsigned short position[4] = {0, 0, 0, 0};
+        for (int k = 0; k < 3; ++k) {
+            float unorm = (v[k] - boundsMin[k]) / extent[k];
+            position[k] = (unsigned short) lroundf(std::max(0.0f, std::min(1.0f, unorm)) * PACKED_POSITION_STEPS);
+        }
+        GLuint normal = packOctahedral(glm::make_vec3(v + 3));
+        unsigned short uv[2] = {floatToHalf(v[6]), floatToHalf(v[7])};
+
+        memcpy(out, position, sizeof(position));
+        memcpy(out + 8, &normal, sizeof(normal));
+        memcpy(out + 12, uv, sizeof(uv));
+
+        if (tangents) {
+            // Only the handedness of the bitangent is kept, in w; the shader rebuilds it as cross(N, T) * w:
+            glm::vec3 n = glm::make_vec3(v + 3);
+            glm::vec3 t = glm::make_vec3(v + 8);
+            glm::vec3 b = glm::make_vec3(v + 11);
+            float handedness = glm::dot(glm::cross(n, t), b) < 0.0f ? -1.0f : 1.0f;
+            GLuint tangent = packOctahedral(glm::length(t) > 0.0f ? glm::normalize(t) : glm::vec3(1.0f, 0.0f, 0.0f),
+                                            handedness);
+            memcpy(out + 16, &tangent, sizeof(tangent));
+        }
+    }
+}
+
+void setVertexAttributes(int floatsPerVertex, bool packed) {
+    bool tangents = floatsPerVertex >= MESH_TANGENT_VERTEX_FLOATS;
+
+    if (packed) {
+        int stride = tangents ? PACKED_TANGENT_VERTEX_STRIDE : PACKED_VERTEX_STRIDE;
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, nullptr);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void *) 8);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void *) 12);
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+        if (tangents) {
+            glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void *) 16);
+            glEnableVertexAttribArray(3);
+        }
+        return;
+    }
+
+    int stride = floatsPerVertex * sizeof(float);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, nullptr);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void *) (sizeof(float) * 3));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void *) (sizeof(float) * 6));
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    if (tangents) {
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void *) (sizeof(float) * 8));
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (void *) (sizeof(float) * 11));
+        glEnableVertexAttribArray(3);
+        glEnableVertexAttribArray(4);
+    }
+}
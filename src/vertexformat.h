@@ -0,0 +1,44 @@
+#ifndef VERTEXFORMAT_H
+#define VERTEXFORMAT_H
+
+#include <vector>
+#include "opengl.h"
+#include "geometry.h"
+
+// Float vertex layouts: position, normal, uv (8 floats, 32 bytes), optionally followed by
+// tangent and bitangent (14 floats, 56 bytes)
+const int MESH_VERTEX_FLOATS = 8;
+const int MESH_VERTEX_STRIDE = MESH_VERTEX_FLOATS * sizeof(float);
+const int MESH_TANGENT_VERTEX_FLOATS = 14;
+
+// Packed layout (16 bytes, 20 with a tangent frame):
+// - position: 3 x 16-bit unorm relative to the mesh bounds (4th component is padding)
+// - normal  : octahedral x/y in GL_INT_2_10_10_10_REV snorm
+// - uv      : 2 x half float
+// - tangent : octahedral x/y in GL_INT_2_10_10_10_REV snorm, bitangent sign in w
+const int PACKED_VERTEX_STRIDE = 16;
+const int PACKED_TANGENT_VERTEX_STRIDE = 20;
+
+// Steps of a packed position across the mesh bounds (the largest 16-bit unorm):
+const float PACKED_POSITION_STEPS = 65535.0f;
+
+// IEEE 754 half float conversion (round to nearest):
+unsigned short floatToHalf(float value);
+
+float halfToFloat(unsigned short value);
+
+// Octahedral encoding of a unit vector into GL_INT_2_10_10_10_REV (w must be -1, 0 or 1):
+GLuint packOctahedral(const glm::vec3 &v, float w = 0.0f);
+
+glm::vec3 unpackOctahedral(GLuint packed);
+
+// Packs interleaved float vertices. Positions are quantized against the mesh bounds; the shader
+// rebuilds them as position * scale + offset.
+void packVertices(const float *vertices, unsigned int vertexCount, int floatsPerVertex,
+                  std::vector<unsigned char> &packed, glm::vec3 *scale, glm::vec3 *offset);
+
+// Sets the attribute pointers of the bound VAO for the bound vertex buffer:
+// 0 = position, 1 = normal, 2 = uv, 3 = tangent, 4 = bitangent (float layout only)
+void setVertexAttributes(int floatsPerVertex, bool packed);
+
+#endif //VERTEXFORMAT_H